@@ -17,62 +17,151 @@
 #include "cartographer/common/histogram.h"
 
 #include <algorithm>
-#include <numeric>
+#include <cmath>
+#include <cstring>
 #include <string>
+#include <vector>
 
+#include "cartographer/common/math.h"
 #include "cartographer/common/port.h"
 #include "glog/logging.h"
 
 namespace cartographer {
 namespace common {
 
-void Histogram::Add(const float value) { values_.push_back(value); }
+namespace {
+
+// Number of mantissa bits kept in the bucket index, i.e. each power of two is
+// split into 32 buckets.
+constexpr int kNumMantissaBits = 5;
+constexpr int kNumDroppedBits = 23 - kNumMantissaBits;
+
+uint32 ToBits(const float value) {
+  uint32 bits;
+  static_assert(sizeof(bits) == sizeof(value), "Unexpected float size.");
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float FromBits(const uint32 bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+// The bits of non-negative IEEE floats are ordered like their values, so
+// dropping the lower mantissa bits yields logarithmically sized buckets.
+// Negative values use the negated index of their magnitude.
+int Histogram::BucketIndex(const float value) {
+  const int magnitude_index = ToBits(std::abs(value)) >> kNumDroppedBits;
+  return value < 0.f ? -magnitude_index : magnitude_index;
+}
+
+float Histogram::BucketValue(const int bucket_index) {
+  const uint32 magnitude_index = std::abs(bucket_index);
+  const float lower = FromBits(magnitude_index << kNumDroppedBits);
+  const float upper = FromBits(((magnitude_index + 1) << kNumDroppedBits) - 1);
+  const float center = lower / 2.f + upper / 2.f;
+  return bucket_index < 0 ? -center : center;
+}
+
+void Histogram::Add(const float value) {
+  CHECK(!std::isnan(value));
+  if (count_ == 0) {
+    min_ = value;
+    max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  ++count_;
+  sum_ += value;
+  ++bucket_counts_[BucketIndex(value)];
+}
+
+void Histogram::Merge(const Histogram& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  for (const auto& bucket : other.bucket_counts_) {
+    bucket_counts_[bucket.first] += bucket.second;
+  }
+}
+
+float Histogram::Percentile(const float percentile) const {
+  CHECK_GT(count_, 0);
+  CHECK_GE(percentile, 0.f);
+  CHECK_LE(percentile, 100.f);
+  const int64 rank = std::max<int64>(
+      1, static_cast<int64>(std::ceil(percentile / 100.f * count_)));
+  int64 total_count = 0;
+  for (const auto& bucket : bucket_counts_) {
+    total_count += bucket.second;
+    if (total_count >= rank) {
+      return common::Clamp(BucketValue(bucket.first), min_, max_);
+    }
+  }
+  return max_;
+}
 
 string Histogram::ToString(const int buckets) const {
   CHECK_GE(buckets, 1);
-  if (values_.empty()) {
+  if (count_ == 0) {
     return "Count: 0";
   }
-  const float min = *std::min_element(values_.begin(), values_.end());
-  const float max = *std::max_element(values_.begin(), values_.end());
-  const float mean =
-      std::accumulate(values_.begin(), values_.end(), 0.f) / values_.size();
-  string result = "Count: " + std::to_string(values_.size()) +
-                  "  Min: " + std::to_string(min) +
-                  "  Max: " + std::to_string(max) +
-                  "  Mean: " + std::to_string(mean);
-  if (min == max) {
+  string result = "Count: " + std::to_string(count_) +
+                  "  Min: " + std::to_string(min_) +
+                  "  Max: " + std::to_string(max_) +
+                  "  Mean: " + std::to_string(sum_ / count_) +
+                  "  P50: " + std::to_string(Percentile(50.f)) +
+                  "  P90: " + std::to_string(Percentile(90.f)) +
+                  "  P99: " + std::to_string(Percentile(99.f));
+  if (min_ == max_) {
     return result;
   }
-  CHECK_LT(min, max);
-  float lower_bound = min;
-  int total_count = 0;
+  CHECK_LT(min_, max_);
+  // Each logarithmic bucket is counted in the output bucket containing its
+  // center.
+  std::vector<int64> counts(buckets, 0);
+  for (const auto& bucket : bucket_counts_) {
+    const float value = common::Clamp(BucketValue(bucket.first), min_, max_);
+    const int i =
+        std::min(buckets - 1,
+                 static_cast<int>((value - min_) / (max_ - min_) * buckets));
+    counts[i] += bucket.second;
+  }
+  float lower_bound = min_;
+  int64 total_count = 0;
   for (int i = 0; i != buckets; ++i) {
     const float upper_bound =
         (i + 1 == buckets)
-            ? max
-            : (max * (i + 1) / buckets + min * (buckets - i - 1) / buckets);
-    int count = 0;
-    for (const float value : values_) {
-      if (lower_bound <= value &&
-          (i + 1 == buckets ? value <= upper_bound : value < upper_bound)) {
-        ++count;
-      }
-    }
+            ? max_
+            : (max_ * (i + 1) / buckets + min_ * (buckets - i - 1) / buckets);
+    const int64 count = counts[i];
     total_count += count;
     result += "\n[" + std::to_string(lower_bound) + ", " +
               std::to_string(upper_bound) + ((i + 1 == buckets) ? "]" : ")");
     constexpr int kMaxBarChars = 20;
-    const int bar =
-        (count * kMaxBarChars + values_.size() / 2) / values_.size();
+    const int bar = (count * kMaxBarChars + count_ / 2) / count_;
     result += "\t";
     for (int i = 0; i != kMaxBarChars; ++i) {
       result += (i < (kMaxBarChars - bar)) ? " " : "#";
     }
     result += "\tCount: " + std::to_string(count) + " (" +
-              std::to_string(count * 1e2f / values_.size()) + "%)";
+              std::to_string(count * 1e2f / count_) + "%)";
     result += "\tTotal: " + std::to_string(total_count) + " (" +
-              std::to_string(total_count * 1e2f / values_.size()) + "%)";
+              std::to_string(total_count * 1e2f / count_) + "%)";
     lower_bound = upper_bound;
   }
   return result;
@@ -17,21 +17,49 @@
 #ifndef CARTOGRAPHER_COMMON_HISTOGRAM_H_
 #define CARTOGRAPHER_COMMON_HISTOGRAM_H_
 
+#include <map>
 #include <string>
-#include <vector>
 
 #include "cartographer/common/port.h"
 
 namespace cartographer {
 namespace common {
 
+// Streaming histogram of float values in bounded memory. Values are counted in
+// logarithmically sized buckets, each spanning about 3% of its values, similar
+// to HdrHistogram. Only buckets that received values are stored, so memory
+// grows with the number of orders of magnitude covered, not with the number
+// of values. Count, minimum, maximum and mean are exact, while percentiles and
+// the bucket counts of ToString() are accurate to the width of a bucket.
 class Histogram {
  public:
   void Add(float value);
+
+  // Adds all values added to 'other'.
+  void Merge(const Histogram& other);
+
+  // Returns an estimate of the value below which 'percentile' percent of the
+  // values lie. Must not be called on an empty histogram.
+  float Percentile(float percentile) const;
+
+  int64 count() const { return count_; }
+  float min() const { return min_; }
+  float max() const { return max_; }
+  double sum() const { return sum_; }
+
   string ToString(int buckets) const;
 
  private:
-  std::vector<float> values_;
+  static int BucketIndex(float value);
+  static float BucketValue(int bucket_index);
+
+  // Maps bucket indices, which are ordered like the values they contain, to
+  // the number of values in the bucket.
+  std::map<int, int64> bucket_counts_;
+  int64 count_ = 0;
+  float min_ = 0.f;
+  float max_ = 0.f;
+  double sum_ = 0.;
 };
 
 }  // namespace common
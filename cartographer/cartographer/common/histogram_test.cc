@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/common/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace common {
+namespace {
+
+TEST(HistogramTest, EmptyHistogram) {
+  Histogram histogram;
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ("Count: 0", histogram.ToString(10));
+}
+
+TEST(HistogramTest, ExactStatistics) {
+  Histogram histogram;
+  for (const float value : {-2.f, 0.f, 1.f, 5.f}) {
+    histogram.Add(value);
+  }
+  EXPECT_EQ(4, histogram.count());
+  EXPECT_EQ(-2.f, histogram.min());
+  EXPECT_EQ(5.f, histogram.max());
+  EXPECT_EQ(4., histogram.sum());
+  EXPECT_EQ(-2.f, histogram.Percentile(0.f));
+  EXPECT_EQ(5.f, histogram.Percentile(100.f));
+}
+
+TEST(HistogramTest, PercentilesWithinBucketWidth) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<float> distribution(0.f, 1000.f);
+  std::vector<float> values;
+  Histogram histogram;
+  for (int i = 0; i != 100000; ++i) {
+    values.push_back(distribution(prng));
+    histogram.Add(values.back());
+  }
+  std::sort(values.begin(), values.end());
+  for (const float percentile : {1.f, 10.f, 50.f, 90.f, 99.f}) {
+    const float expected = values[static_cast<int>(
+        std::ceil(percentile / 100.f * values.size())) - 1];
+    EXPECT_NEAR(expected, histogram.Percentile(percentile), 0.02f * expected);
+  }
+}
+
+TEST(HistogramTest, MergeEqualsAddingAllValues) {
+  Histogram first;
+  Histogram second;
+  Histogram all;
+  for (int i = 1; i != 100; ++i) {
+    (i % 2 == 0 ? first : second).Add(0.01f * i);
+    all.Add(0.01f * i);
+  }
+  first.Merge(second);
+  EXPECT_EQ(all.count(), first.count());
+  EXPECT_EQ(all.ToString(10), first.ToString(10));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace cartographer
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/common/metrics.h"
+
+#include <sstream>
+
+#include "cartographer/common/make_unique.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace common {
+
+namespace {
+
+// Threads are assigned shards round-robin on their first observation.
+int GetShardIndex(const int num_shards) {
+  static std::atomic<int> next_shard_index{0};
+  thread_local const int shard_index = next_shard_index++ % num_shards;
+  return shard_index;
+}
+
+}  // namespace
+
+constexpr int HistogramMetric::kNumShards;
+
+void HistogramMetric::Observe(const float value) {
+  Shard& shard = shards_[GetShardIndex(kNumShards)];
+  MutexLocker locker(&shard.mutex);
+  shard.histogram.Add(value);
+}
+
+Histogram HistogramMetric::Snapshot() const {
+  Histogram histogram;
+  for (const Shard& shard : shards_) {
+    MutexLocker locker(&shard.mutex);
+    histogram.Merge(shard.histogram);
+  }
+  return histogram;
+}
+
+ScopedLatency::ScopedLatency(HistogramMetric* const metric)
+    : metric_(metric), start_(std::chrono::steady_clock::now()) {}
+
+ScopedLatency::~ScopedLatency() {
+  metric_->Observe(std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start_)
+                       .count());
+}
+
+MetricsRegistry* MetricsRegistry::Global() {
+  static MetricsRegistry* const registry = new MetricsRegistry;
+  return registry;
+}
+
+Counter* MetricsRegistry::GetCounter(const string& name,
+                                     const string& description) {
+  MutexLocker locker(&mutex_);
+  CHECK_EQ(histograms_.count(name), 0) << name << " is a histogram.";
+  Entry<Counter>& entry = counters_[name];
+  if (entry.metric == nullptr) {
+    entry.description = description;
+    entry.metric = common::make_unique<Counter>();
+  }
+  return entry.metric.get();
+}
+
+HistogramMetric* MetricsRegistry::GetHistogram(const string& name,
+                                               const string& description) {
+  MutexLocker locker(&mutex_);
+  CHECK_EQ(counters_.count(name), 0) << name << " is a counter.";
+  Entry<HistogramMetric>& entry = histograms_[name];
+  if (entry.metric == nullptr) {
+    entry.description = description;
+    entry.metric = common::make_unique<HistogramMetric>();
+  }
+  return entry.metric.get();
+}
+
+string MetricsRegistry::ToString() const {
+  std::ostringstream out;
+  MutexLocker locker(&mutex_);
+  for (const auto& name_and_entry : counters_) {
+    const string& name = name_and_entry.first;
+    out << "# HELP " << name << " " << name_and_entry.second.description
+        << "\n# TYPE " << name << " counter\n"
+        << name << " " << name_and_entry.second.metric->value() << "\n";
+  }
+  for (const auto& name_and_entry : histograms_) {
+    const string& name = name_and_entry.first;
+    const Histogram histogram = name_and_entry.second.metric->Snapshot();
+    out << "# HELP " << name << " " << name_and_entry.second.description
+        << "\n# TYPE " << name << " summary\n";
+    if (histogram.count() != 0) {
+      for (const float quantile : {0.5f, 0.9f, 0.99f, 1.f}) {
+        out << name << "{quantile=\"" << quantile << "\"} "
+            << histogram.Percentile(100.f * quantile) << "\n";
+      }
+    }
+    out << name << "_sum " << histogram.sum() << "\n"
+        << name << "_count " << histogram.count() << "\n";
+  }
+  return out.str();
+}
+
+}  // namespace common
+}  // namespace cartographer
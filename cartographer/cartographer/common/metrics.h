@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_COMMON_METRICS_H_
+#define CARTOGRAPHER_COMMON_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "cartographer/common/histogram.h"
+#include "cartographer/common/mutex.h"
+#include "cartographer/common/port.h"
+
+namespace cartographer {
+namespace common {
+
+// Number of events that happened, e.g. scans inserted. Thread-safe.
+class Counter {
+ public:
+  void Increment(const int64 value = 1) { value_ += value; }
+  int64 value() const { return value_.load(); }
+
+ private:
+  std::atomic<int64> value_{0};
+};
+
+// Distribution of observed values, e.g. latencies in seconds. Thread-safe.
+//
+// Values are recorded into one of several shards picked by the observing
+// thread, so that threads rarely contend on the same lock, e.g. the workers
+// of a thread pool. Snapshot() merges the shards.
+class HistogramMetric {
+ public:
+  void Observe(float value);
+  Histogram Snapshot() const;
+
+ private:
+  static constexpr int kNumShards = 16;
+
+  struct Shard {
+    mutable Mutex mutex;
+    Histogram histogram GUARDED_BY(mutex);
+  };
+
+  std::array<Shard, kNumShards> shards_;
+};
+
+// Observes the wall time in seconds between its construction and destruction.
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(HistogramMetric* metric);
+  ~ScopedLatency();
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+  HistogramMetric* const metric_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+// Named counters and histograms, so that the performance of a running system
+// can be monitored. Metrics are created on first use and live as long as the
+// registry, so callers look them up once and keep the pointers.
+class MetricsRegistry {
+ public:
+  MetricsRegistry() = default;
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // Returns the process-wide registry, which is never destroyed.
+  static MetricsRegistry* Global();
+
+  // Returns the counter or histogram called 'name', creating it with
+  // 'description' if it does not exist yet.
+  Counter* GetCounter(const string& name, const string& description)
+      EXCLUDES(mutex_);
+  HistogramMetric* GetHistogram(const string& name, const string& description)
+      EXCLUDES(mutex_);
+
+  // Returns a snapshot of all metrics in the Prometheus text format. Histograms
+  // are exported as summaries of their count, sum and percentiles.
+  string ToString() const EXCLUDES(mutex_);
+
+ private:
+  template <typename MetricType>
+  struct Entry {
+    string description;
+    std::unique_ptr<MetricType> metric;
+  };
+
+  mutable Mutex mutex_;
+  std::map<string, Entry<Counter>> counters_ GUARDED_BY(mutex_);
+  std::map<string, Entry<HistogramMetric>> histograms_ GUARDED_BY(mutex_);
+};
+
+}  // namespace common
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_COMMON_METRICS_H_
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/common/metrics.h"
+
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+
+namespace cartographer {
+namespace common {
+namespace {
+
+using ::testing::HasSubstr;
+
+TEST(MetricsRegistryTest, ReturnsSameMetricForSameName) {
+  MetricsRegistry registry;
+  Counter* const counter = registry.GetCounter("scans", "Scans added.");
+  counter->Increment();
+  counter->Increment(2);
+  EXPECT_EQ(counter, registry.GetCounter("scans", "Ignored."));
+  EXPECT_EQ(3, counter->value());
+  HistogramMetric* const histogram =
+      registry.GetHistogram("latency_seconds", "Latency.");
+  EXPECT_EQ(histogram, registry.GetHistogram("latency_seconds", "Ignored."));
+}
+
+TEST(MetricsRegistryTest, ToString) {
+  MetricsRegistry registry;
+  registry.GetCounter("scans", "Scans added.")->Increment(5);
+  HistogramMetric* const histogram =
+      registry.GetHistogram("latency_seconds", "Latency.");
+  histogram->Observe(1.f);
+  histogram->Observe(3.f);
+  const string text = registry.ToString();
+  EXPECT_THAT(text, HasSubstr("# HELP scans Scans added.\n"
+                              "# TYPE scans counter\n"
+                              "scans 5\n"));
+  EXPECT_THAT(text, HasSubstr("# TYPE latency_seconds summary\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds{quantile=\"1\"} 3\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_sum 4\n"
+                              "latency_seconds_count 2\n"));
+}
+
+TEST(MetricsRegistryTest, ScopedLatency) {
+  MetricsRegistry registry;
+  HistogramMetric* const histogram =
+      registry.GetHistogram("latency_seconds", "Latency.");
+  { ScopedLatency latency(histogram); }
+  EXPECT_EQ(1, histogram->Snapshot().count());
+  EXPECT_GE(histogram->Snapshot().min(), 0.f);
+}
+
+TEST(HistogramMetricTest, MergesObservationsOfAllThreads) {
+  constexpr int kNumThreads = 20;
+  constexpr int kNumObservations = 1000;
+  HistogramMetric histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i != kNumThreads; ++i) {
+    threads.emplace_back([&histogram, i]() {
+      for (int j = 0; j != kNumObservations; ++j) {
+        histogram.Observe(i + 1.f);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const Histogram snapshot = histogram.Snapshot();
+  EXPECT_EQ(kNumThreads * kNumObservations, snapshot.count());
+  EXPECT_EQ(1.f, snapshot.min());
+  EXPECT_EQ(kNumThreads, snapshot.max());
+  EXPECT_EQ(kNumObservations * kNumThreads * (kNumThreads + 1) / 2,
+            snapshot.sum());
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace cartographer
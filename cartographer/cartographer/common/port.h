@@ -47,6 +47,17 @@ inline int64 RoundToInt64(const float x) { return std::lround(x); }
 
 inline int64 RoundToInt64(const double x) { return std::lround(x); }
 
+// Rounds halfway cases away from zero like RoundToInt(), but without calling
+// std::lround(), which makes it much faster in tight loops. 'x' must be in the
+// range of 'int'.
+inline int FastRoundToInt(const float x) {
+  const int truncated = static_cast<int>(x);
+  // The subtraction is exact, since 'truncated' only lacks the fraction.
+  const float fraction = x - static_cast<float>(truncated);
+  return truncated + static_cast<int>(fraction >= 0.5f) -
+         static_cast<int>(fraction <= -0.5f);
+}
+
 inline void FastGzipString(const string& uncompressed, string* compressed) {
   boost::iostreams::filtering_ostream out;
   out.push(
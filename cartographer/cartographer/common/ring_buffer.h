@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_COMMON_RING_BUFFER_H_
+#define CARTOGRAPHER_COMMON_RING_BUFFER_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace common {
+
+// A first-in first-out queue stored in a ring buffer, which doubles its
+// capacity when full. Once it has grown to the largest number of queued
+// values, pushing and popping neither allocates nor locks. Unlike
+// BlockingQueue, it is thread-compatible, i.e. meant for a single thread
+// producing and consuming values. 'T' must be default constructible and
+// movable.
+template <typename T>
+class RingBuffer {
+ public:
+  RingBuffer() : buffer_(kInitialCapacity) {}
+
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
+
+  // Pushes a value onto the end of the queue.
+  void Push(T t) {
+    if (size_ == buffer_.size()) {
+      Grow();
+    }
+    buffer_[(begin_ + size_) & (buffer_.size() - 1)] = std::move(t);
+    ++size_;
+  }
+
+  // Pops the first value from the queue, which must not be empty.
+  T Pop() {
+    CHECK_NE(size_, 0);
+    T t = std::move(buffer_[begin_]);
+    begin_ = (begin_ + 1) & (buffer_.size() - 1);
+    --size_;
+    return t;
+  }
+
+  // Returns the first value in the queue or nullptr if the queue is empty.
+  // Maintains ownership. This assumes a member function get() that returns
+  // a pointer to the given type R.
+  template <typename R>
+  const R* Peek() const {
+    if (size_ == 0) {
+      return nullptr;
+    }
+    return buffer_[begin_].get();
+  }
+
+  // Returns the number of values currently in the queue.
+  size_t Size() const { return size_; }
+
+ private:
+  // Must be a power of two, so that indices wrap around by masking.
+  static constexpr size_t kInitialCapacity = 16;
+
+  void Grow() {
+    std::vector<T> buffer(2 * buffer_.size());
+    for (size_t i = 0; i != size_; ++i) {
+      buffer[i] = std::move(buffer_[(begin_ + i) & (buffer_.size() - 1)]);
+    }
+    buffer_.swap(buffer);
+    begin_ = 0;
+  }
+
+  std::vector<T> buffer_;
+  size_t begin_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace common
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_COMMON_RING_BUFFER_H_
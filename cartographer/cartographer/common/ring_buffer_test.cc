@@ -0,0 +1,65 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/common/ring_buffer.h"
+
+#include <memory>
+
+#include "cartographer/common/make_unique.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace common {
+namespace {
+
+TEST(RingBufferTest, PushPeekPop) {
+  RingBuffer<std::unique_ptr<int>> ring_buffer;
+  EXPECT_EQ(nullptr, ring_buffer.Peek<int>());
+  ring_buffer.Push(common::make_unique<int>(42));
+  ASSERT_EQ(1, ring_buffer.Size());
+  ring_buffer.Push(common::make_unique<int>(24));
+  ASSERT_EQ(2, ring_buffer.Size());
+  EXPECT_EQ(42, *ring_buffer.Peek<int>());
+  ASSERT_EQ(2, ring_buffer.Size());
+  EXPECT_EQ(42, *ring_buffer.Pop());
+  ASSERT_EQ(1, ring_buffer.Size());
+  EXPECT_EQ(24, *ring_buffer.Pop());
+  ASSERT_EQ(0, ring_buffer.Size());
+  EXPECT_EQ(nullptr, ring_buffer.Peek<int>());
+}
+
+TEST(RingBufferTest, KeepsOrderWhenGrowingWrappedAround) {
+  RingBuffer<std::unique_ptr<int>> ring_buffer;
+  int next_pushed = 0;
+  int next_popped = 0;
+  // Interleaving pushes and pops moves the start of the queue through the
+  // buffer before it has to grow.
+  for (int i = 0; i != 100; ++i) {
+    ring_buffer.Push(common::make_unique<int>(next_pushed++));
+    ring_buffer.Push(common::make_unique<int>(next_pushed++));
+    EXPECT_EQ(next_popped++, *ring_buffer.Pop());
+    EXPECT_EQ(next_popped, *ring_buffer.Peek<int>());
+  }
+  EXPECT_EQ(100, ring_buffer.Size());
+  while (ring_buffer.Size() > 0) {
+    EXPECT_EQ(next_popped++, *ring_buffer.Pop());
+  }
+  EXPECT_EQ(next_pushed, next_popped);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace cartographer
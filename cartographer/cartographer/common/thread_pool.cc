@@ -19,61 +19,263 @@
 #include <unistd.h>
 #include <algorithm>
 #include <chrono>
+#include <iomanip>
 #include <numeric>
+#include <sstream>
 
+#include "cartographer/common/make_unique.h"
 #include "glog/logging.h"
 
 namespace cartographer {
 namespace common {
 
-ThreadPool::ThreadPool(int num_threads) {
-  MutexLocker locker(&mutex_);
+namespace {
+
+// Identifies the worker thread the calling code runs on, so that work items
+// scheduled from within work items end up in the local queue.
+thread_local const ThreadPool* current_thread_pool = nullptr;
+thread_local int current_worker_index = -1;
+
+void UpdateMaximum(std::atomic<int64>* maximum, const int64 value) {
+  int64 current = maximum->load();
+  while (value > current && !maximum->compare_exchange_weak(current, value)) {
+  }
+}
+
+}  // namespace
+
+bool ThreadPool::TaskHandle::Cancel() {
+  if (state_ == nullptr) {
+    return false;
+  }
+  int expected = kPending;
+  return state_->compare_exchange_strong(expected, kCancelled);
+}
+
+bool ThreadPool::TaskHandle::done() const {
+  return state_ != nullptr && state_->load() == kDone;
+}
+
+ThreadPool::ThreadPool(int num_threads)
+    : queue_latency_metric_(MetricsRegistry::Global()->GetHistogram(
+          "thread_pool_queue_latency_seconds",
+          "Time between scheduling and starting work items.")),
+      run_time_metric_(MetricsRegistry::Global()->GetHistogram(
+          "thread_pool_run_time_seconds", "Execution time of work items.")) {
+  CHECK_GT(num_threads, 0);
+  for (int i = 0; i != num_threads; ++i) {
+    queues_.push_back(common::make_unique<WorkerQueue>());
+  }
   for (int i = 0; i != num_threads; ++i) {
-    pool_.emplace_back([this]() { ThreadPool::DoWork(); });
+    pool_.emplace_back([this, i]() { ThreadPool::DoWork(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
   {
-    MutexLocker locker(&mutex_);
+    MutexLocker locker(&idle_mutex_);
     CHECK(running_);
     running_ = false;
-    CHECK_EQ(work_queue_.size(), 0);
   }
   for (std::thread& thread : pool_) {
     thread.join();
   }
+  CHECK_EQ(num_queued_tasks_.load(), 0);
 }
 
 void ThreadPool::Schedule(std::function<void()> work_item) {
-  MutexLocker locker(&mutex_);
-  CHECK(running_);
-  work_queue_.push_back(work_item);
+  Schedule(std::move(work_item), Priority::kNormal);
+}
+
+ThreadPool::TaskHandle ThreadPool::Schedule(std::function<void()> work_item,
+                                            const Priority priority) {
+  CHECK(work_item);
+  const int priority_index = static_cast<int>(priority);
+  auto state = std::make_shared<std::atomic<int>>(TaskHandle::kPending);
+  const int queue_index =
+      current_thread_pool == this
+          ? current_worker_index
+          : static_cast<int>(next_queue_.fetch_add(1) % queues_.size());
+  {
+    WorkerQueue* const queue = queues_[queue_index].get();
+    MutexLocker locker(&queue->mutex);
+    queue->tasks[priority_index].push_back(
+        Task{std::move(work_item), state, Clock::now()});
+    ++counters_[priority_index].depth;
+    ++counters_[priority_index].num_scheduled;
+    ++num_queued_tasks_;
+  }
+  NotifyIdleThreads();
+  return TaskHandle(std::move(state));
+}
+
+void ThreadPool::ParallelFor(const int num_indices,
+                             const std::function<void(int)>& function) {
+  struct SharedState {
+    std::atomic<int> next_index{0};
+    Mutex mutex;
+    int num_done GUARDED_BY(mutex) = 0;
+  };
+  // Helpers may only start after all indices were processed and this function
+  // returned. They hold on to 'state' and only touch 'function' if they still
+  // claim an index.
+  const auto state = std::make_shared<SharedState>();
+  const auto process_indices = [state, num_indices, &function]() {
+    for (int index = state->next_index++; index < num_indices;
+         index = state->next_index++) {
+      function(index);
+      MutexLocker locker(&state->mutex);
+      ++state->num_done;
+    }
+  };
+  const int num_helpers =
+      std::min(static_cast<int>(pool_.size()), num_indices - 1);
+  for (int i = 0; i < num_helpers; ++i) {
+    // The caller is blocked until the helpers are done.
+    Schedule(process_indices, Priority::kHigh);
+  }
+  process_indices();
+  MutexLocker locker(&state->mutex);
+  locker.Await([&state, num_indices]() REQUIRES(state->mutex) {
+    return state->num_done == num_indices;
+  });
+}
+
+void ThreadPool::NotifyIdleThreads() {
+  // Idle threads register themselves before checking for queued tasks while
+  // holding 'idle_mutex_'. Since 'num_queued_tasks_' was incremented before,
+  // either they see the new task, or we see them and wake them up when
+  // releasing the lock.
+  if (num_idle_threads_.load() > 0) {
+    MutexLocker locker(&idle_mutex_);
+  }
 }
 
-void ThreadPool::DoWork() {
+ThreadPool::QueueStatistics ThreadPool::GetQueueStatistics(
+    const Priority priority) const {
+  const Counters& counters = counters_[static_cast<int>(priority)];
+  QueueStatistics statistics;
+  statistics.depth = counters.depth.load();
+  statistics.num_scheduled = counters.num_scheduled.load();
+  statistics.num_executed = counters.num_executed.load();
+  statistics.num_cancelled = counters.num_cancelled.load();
+  statistics.num_stolen = counters.num_stolen.load();
+  const int64 num_started =
+      statistics.num_executed + statistics.num_cancelled;
+  statistics.mean_latency_seconds =
+      num_started == 0
+          ? 0.
+          : 1e-9 * counters.total_latency_ns.load() / num_started;
+  statistics.max_latency_seconds = 1e-9 * counters.max_latency_ns.load();
+  return statistics;
+}
+
+string ThreadPool::StatisticsToString() const {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(4);
+  for (const auto& name_and_priority :
+       {std::make_pair("high", Priority::kHigh),
+        std::make_pair("normal", Priority::kNormal)}) {
+    const QueueStatistics statistics =
+        GetQueueStatistics(name_and_priority.second);
+    out << name_and_priority.first << " priority: depth " << statistics.depth
+        << ", scheduled " << statistics.num_scheduled << ", executed "
+        << statistics.num_executed << ", cancelled "
+        << statistics.num_cancelled << ", stolen " << statistics.num_stolen
+        << ", latency mean " << statistics.mean_latency_seconds << " s max "
+        << statistics.max_latency_seconds << " s\n";
+  }
+  return out.str();
+}
+
+bool ThreadPool::TryPopFromQueue(const int queue_index, const int priority,
+                                 const bool steal, Task* const task) {
+  WorkerQueue* const queue = queues_[queue_index].get();
+  MutexLocker locker(&queue->mutex);
+  std::deque<Task>& tasks = queue->tasks[priority];
+  if (tasks.empty()) {
+    return false;
+  }
+  // The owner takes the oldest task, thieves take from the other end to keep
+  // contention on the same tasks low.
+  if (steal) {
+    *task = std::move(tasks.back());
+    tasks.pop_back();
+  } else {
+    *task = std::move(tasks.front());
+    tasks.pop_front();
+  }
+  --num_queued_tasks_;
+  --counters_[priority].depth;
+  return true;
+}
+
+bool ThreadPool::TryPopTask(const int worker_index, Task* const task,
+                            int* const priority) {
+  const int num_queues = queues_.size();
+  for (*priority = 0; *priority != kNumPriorities; ++*priority) {
+    if (TryPopFromQueue(worker_index, *priority, false /* steal */, task)) {
+      return true;
+    }
+    for (int i = 1; i < num_queues; ++i) {
+      if (TryPopFromQueue((worker_index + i) % num_queues, *priority,
+                          true /* steal */, task)) {
+        ++counters_[*priority].num_stolen;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ThreadPool::RunTask(const int priority, Task* const task) {
+  Counters& counters = counters_[priority];
+  const int64 latency_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          Clock::now() - task->schedule_time)
+          .count();
+  counters.total_latency_ns += latency_ns;
+  UpdateMaximum(&counters.max_latency_ns, latency_ns);
+  queue_latency_metric_->Observe(1e-9 * latency_ns);
+
+  int expected = TaskHandle::kPending;
+  if (!task->state->compare_exchange_strong(expected, TaskHandle::kRunning)) {
+    ++counters.num_cancelled;
+    return;
+  }
+  {
+    ScopedLatency run_time(run_time_metric_);
+    task->work_item();
+  }
+  ++counters.num_executed;
+  task->state->store(TaskHandle::kDone);
+}
+
+void ThreadPool::DoWork(const int worker_index) {
 #ifdef __linux__
   // This changes the per-thread nice level of the current thread on Linux. We
   // do this so that the background work done by the thread pool is not taking
   // away CPU resources from more important foreground threads.
   CHECK_NE(nice(10), -1);
 #endif
+  current_thread_pool = this;
+  current_worker_index = worker_index;
   for (;;) {
-    std::function<void()> work_item;
-    {
-      MutexLocker locker(&mutex_);
-      locker.Await([this]() REQUIRES(mutex_) {
-        return !work_queue_.empty() || !running_;
-      });
-      if (!work_queue_.empty()) {
-        work_item = work_queue_.front();
-        work_queue_.pop_front();
-      } else if (!running_) {
-        return;
-      }
+    Task task;
+    int priority;
+    if (TryPopTask(worker_index, &task, &priority)) {
+      RunTask(priority, &task);
+      continue;
+    }
+    MutexLocker locker(&idle_mutex_);
+    ++num_idle_threads_;
+    locker.Await([this]() REQUIRES(idle_mutex_) {
+      return num_queued_tasks_.load() > 0 || !running_;
+    });
+    --num_idle_threads_;
+    if (num_queued_tasks_.load() == 0 && !running_) {
+      return;
     }
-    CHECK(work_item);
-    work_item();
   }
 }
 
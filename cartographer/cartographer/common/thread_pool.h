@@ -17,38 +17,151 @@
 #ifndef CARTOGRAPHER_COMMON_THREAD_POOL_H_
 #define CARTOGRAPHER_COMMON_THREAD_POOL_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "cartographer/common/metrics.h"
 #include "cartographer/common/mutex.h"
+#include "cartographer/common/port.h"
 
 namespace cartographer {
 namespace common {
 
-// A fixed number of threads working on a work queue of work items. Adding a
-// new work item does not block, and will be executed by a background thread
-// eventually. The queue must be empty before calling the destructor. The thread
-// pool will then wait for the currently executing work items to finish and then
-// destroy the threads.
+// A fixed number of threads working on per-thread work queues of work items.
+// Adding a new work item does not block, and will be executed by a background
+// thread eventually. Idle threads steal work from the queues of busy threads.
+//
+// Work items are scheduled with a priority. Work items of high priority, e.g.
+// work which unblocks other pending work items, are always started before work
+// items of normal priority, e.g. speculative constraint searches.
+//
+// The destructor waits for all queued work items to be executed (or skipped if
+// they were cancelled) and then destroys the threads.
 class ThreadPool {
  public:
+  enum class Priority { kHigh = 0, kNormal = 1 };
+  static constexpr int kNumPriorities = 2;
+
+  // Handle to a scheduled work item. It can be used to cancel the work item as
+  // long as it has not started executing. A default constructed handle refers
+  // to no work item.
+  class TaskHandle {
+   public:
+    TaskHandle() = default;
+
+    // Returns true if the work item was cancelled and will never run. Returns
+    // false if it has already started or was cancelled before.
+    bool Cancel();
+
+    // Returns true if the work item has finished executing.
+    bool done() const;
+
+   private:
+    friend class ThreadPool;
+    enum State : int { kPending, kRunning, kDone, kCancelled };
+
+    explicit TaskHandle(std::shared_ptr<std::atomic<int>> state)
+        : state_(std::move(state)) {}
+
+    std::shared_ptr<std::atomic<int>> state_;
+  };
+
+  // Counters for one priority class, summed over all worker queues.
+  struct QueueStatistics {
+    int64 depth;
+    int64 num_scheduled;
+    int64 num_executed;
+    int64 num_cancelled;
+    int64 num_stolen;
+    // Time between scheduling and starting execution of work items.
+    double mean_latency_seconds;
+    double max_latency_seconds;
+  };
+
   explicit ThreadPool(int num_threads);
   ~ThreadPool();
 
   ThreadPool(const ThreadPool&) = delete;
   ThreadPool& operator=(const ThreadPool&) = delete;
 
+  // Schedules 'work_item' with normal priority.
   void Schedule(std::function<void()> work_item);
 
+  // Schedules 'work_item' with the given 'priority'. The returned handle may be
+  // dropped if cancellation is not needed.
+  TaskHandle Schedule(std::function<void()> work_item, Priority priority);
+
+  // Calls 'function' for every index in [0, num_indices) and returns once all
+  // calls have finished. The calls are distributed over the calling thread and
+  // the threads of the pool. Since the calling thread takes part, this may also
+  // be called from within work items.
+  void ParallelFor(int num_indices, const std::function<void(int)>& function);
+
+  QueueStatistics GetQueueStatistics(Priority priority) const;
+
+  // Returns a human-readable summary of the queue statistics.
+  string StatisticsToString() const;
+
  private:
-  void DoWork();
+  using Clock = std::chrono::steady_clock;
+
+  struct Task {
+    std::function<void()> work_item;
+    std::shared_ptr<std::atomic<int>> state;
+    Clock::time_point schedule_time;
+  };
+
+  struct WorkerQueue {
+    Mutex mutex;
+    std::array<std::deque<Task>, kNumPriorities> tasks GUARDED_BY(mutex);
+  };
+
+  struct Counters {
+    std::atomic<int64> depth{0};
+    std::atomic<int64> num_scheduled{0};
+    std::atomic<int64> num_executed{0};
+    std::atomic<int64> num_cancelled{0};
+    std::atomic<int64> num_stolen{0};
+    std::atomic<int64> total_latency_ns{0};
+    std::atomic<int64> max_latency_ns{0};
+  };
+
+  void DoWork(int worker_index);
+
+  // Pops the next task for 'worker_index' into 'task', first looking at its
+  // own queue, then stealing from others, in order of priority.
+  bool TryPopTask(int worker_index, Task* task, int* priority);
+  bool TryPopFromQueue(int queue_index, int priority, bool steal, Task* task);
+
+  // Runs 'task' unless it was cancelled and updates the counters.
+  void RunTask(int priority, Task* task);
+
+  // Wakes up idle threads if there are any.
+  void NotifyIdleThreads();
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::array<Counters, kNumPriorities> counters_;
+
+  // Shared by all thread pools in the global metrics registry.
+  HistogramMetric* const queue_latency_metric_;
+  HistogramMetric* const run_time_metric_;
+
+  // Total number of tasks in all queues, including cancelled ones not yet
+  // removed.
+  std::atomic<int64> num_queued_tasks_{0};
+  std::atomic<int> num_idle_threads_{0};
+  std::atomic<uint32> next_queue_{0};
 
-  Mutex mutex_;
-  bool running_ GUARDED_BY(mutex_) = true;
-  std::vector<std::thread> pool_ GUARDED_BY(mutex_);
-  std::deque<std::function<void()>> work_queue_ GUARDED_BY(mutex_);
+  Mutex idle_mutex_;
+  bool running_ GUARDED_BY(idle_mutex_) = true;
+  std::vector<std::thread> pool_;
 };
 
 }  // namespace common
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/common/thread_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "cartographer/common/mutex.h"
+#include "cartographer/common/time.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace common {
+namespace {
+
+TEST(ThreadPoolTest, RunsAllWorkItems) {
+  std::atomic<int> counter(0);
+  {
+    ThreadPool thread_pool(4);
+    for (int i = 0; i != 1000; ++i) {
+      thread_pool.Schedule([&counter]() { ++counter; });
+    }
+  }
+  EXPECT_EQ(1000, counter.load());
+}
+
+TEST(ThreadPoolTest, WorkItemsCanScheduleWorkItems) {
+  std::atomic<int> counter(0);
+  {
+    ThreadPool thread_pool(3);
+    for (int i = 0; i != 10; ++i) {
+      thread_pool.Schedule([&thread_pool, &counter]() {
+        for (int j = 0; j != 10; ++j) {
+          thread_pool.Schedule([&counter]() { ++counter; },
+                               ThreadPool::Priority::kHigh);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(100, counter.load());
+}
+
+TEST(ThreadPoolTest, HighPriorityRunsFirst) {
+  Mutex mutex;
+  bool blocked = true;
+  std::vector<int> order;
+  {
+    ThreadPool thread_pool(1);
+    // Keep the only thread busy until all work items are queued.
+    thread_pool.Schedule([&mutex, &blocked]() {
+      MutexLocker locker(&mutex);
+      locker.Await([&blocked]() { return !blocked; });
+    });
+    for (int i = 0; i != 3; ++i) {
+      thread_pool.Schedule([&order, i]() { order.push_back(i); });
+    }
+    thread_pool.Schedule([&order]() { order.push_back(-1); },
+                         ThreadPool::Priority::kHigh);
+    MutexLocker locker(&mutex);
+    blocked = false;
+  }
+  EXPECT_EQ((std::vector<int>{-1, 0, 1, 2}), order);
+}
+
+TEST(ThreadPoolTest, CancelledWorkItemsDoNotRun) {
+  Mutex mutex;
+  bool blocked = true;
+  bool ran = false;
+  ThreadPool::TaskHandle handle;
+  {
+    ThreadPool thread_pool(1);
+    thread_pool.Schedule([&mutex, &blocked]() {
+      MutexLocker locker(&mutex);
+      locker.Await([&blocked]() { return !blocked; });
+    });
+    handle = thread_pool.Schedule([&ran]() { ran = true; },
+                                  ThreadPool::Priority::kNormal);
+    EXPECT_TRUE(handle.Cancel());
+    EXPECT_FALSE(handle.Cancel());
+    MutexLocker locker(&mutex);
+    blocked = false;
+  }
+  EXPECT_FALSE(ran);
+  EXPECT_FALSE(handle.done());
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsAllIndices) {
+  ThreadPool thread_pool(3);
+  std::vector<std::atomic<int>> visits(1000);
+  thread_pool.ParallelFor(visits.size(), [&visits](int index) {
+    ++visits[index];
+  });
+  for (const std::atomic<int>& num_visits : visits) {
+    EXPECT_EQ(1, num_visits.load());
+  }
+  thread_pool.ParallelFor(0, [](int) { FAIL(); });
+}
+
+TEST(ThreadPoolTest, ParallelForInsideWorkItems) {
+  std::atomic<int> counter(0);
+  {
+    // More work items calling ParallelFor() than threads must not deadlock.
+    ThreadPool thread_pool(2);
+    for (int i = 0; i != 8; ++i) {
+      thread_pool.Schedule([&thread_pool, &counter]() {
+        thread_pool.ParallelFor(100, [&counter](int) { ++counter; });
+      });
+    }
+  }
+  EXPECT_EQ(800, counter.load());
+}
+
+TEST(ThreadPoolTest, CountsWorkItems) {
+  ThreadPool thread_pool(1);
+  for (int i = 0; i != 5; ++i) {
+    thread_pool.Schedule([]() {}, ThreadPool::Priority::kHigh);
+  }
+  const ThreadPool::TaskHandle handle =
+      thread_pool.Schedule([]() {}, ThreadPool::Priority::kNormal);
+  while (!handle.done()) {
+    std::this_thread::sleep_for(common::FromMilliseconds(1));
+  }
+  const ThreadPool::QueueStatistics high_statistics =
+      thread_pool.GetQueueStatistics(ThreadPool::Priority::kHigh);
+  EXPECT_EQ(0, high_statistics.depth);
+  EXPECT_EQ(5, high_statistics.num_scheduled);
+  EXPECT_EQ(5, high_statistics.num_executed);
+  EXPECT_EQ(0, high_statistics.num_cancelled);
+  const ThreadPool::QueueStatistics normal_statistics =
+      thread_pool.GetQueueStatistics(ThreadPool::Priority::kNormal);
+  EXPECT_EQ(1, normal_statistics.num_scheduled);
+  EXPECT_EQ(1, normal_statistics.num_executed);
+  EXPECT_GE(normal_statistics.max_latency_seconds,
+            normal_statistics.mean_latency_seconds);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace cartographer
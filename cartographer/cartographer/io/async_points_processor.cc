@@ -0,0 +1,70 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/async_points_processor.h"
+
+#include "cartographer/common/make_unique.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+std::unique_ptr<AsyncPointsProcessor> AsyncPointsProcessor::FromDictionary(
+    common::LuaParameterDictionary* const dictionary,
+    PointsProcessor* const next) {
+  const int queue_size = dictionary->GetNonNegativeInt("queue_size");
+  CHECK_GT(queue_size, 0) << "The queue must hold at least one batch.";
+  return common::make_unique<AsyncPointsProcessor>(queue_size, next);
+}
+
+AsyncPointsProcessor::AsyncPointsProcessor(const int queue_size,
+                                           PointsProcessor* const next)
+    : next_(next),
+      queue_(queue_size),
+      thread_([this]() { ProcessQueue(); }) {}
+
+AsyncPointsProcessor::~AsyncPointsProcessor() {
+  queue_.Push(nullptr);
+  thread_.join();
+}
+
+void AsyncPointsProcessor::Process(std::unique_ptr<PointsBatch> batch) {
+  {
+    common::MutexLocker lock(&mutex_);
+    ++num_pending_batches_;
+  }
+  queue_.Push(std::move(batch));
+}
+
+PointsProcessor::FlushResult AsyncPointsProcessor::Flush() {
+  {
+    common::MutexLocker lock(&mutex_);
+    lock.Await(
+        [this]() REQUIRES(mutex_) { return num_pending_batches_ == 0; });
+  }
+  return next_->Flush();
+}
+
+void AsyncPointsProcessor::ProcessQueue() {
+  while (std::unique_ptr<PointsBatch> batch = queue_.Pop()) {
+    next_->Process(std::move(batch));
+    common::MutexLocker lock(&mutex_);
+    --num_pending_batches_;
+  }
+}
+
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_ASYNC_POINTS_PROCESSOR_H_
+#define CARTOGRAPHER_IO_ASYNC_POINTS_PROCESSOR_H_
+
+#include <memory>
+#include <thread>
+
+#include "cartographer/common/blocking_queue.h"
+#include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/mutex.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Passes batches on to 'next' on a separate thread, so that the processors
+// before and after this one run concurrently. Up to 'queue_size' batches are
+// queued and the order of batches is preserved.
+class AsyncPointsProcessor : public PointsProcessor {
+ public:
+  constexpr static const char* kConfigurationFileActionName = "async";
+
+  AsyncPointsProcessor(int queue_size, PointsProcessor* next);
+
+  static std::unique_ptr<AsyncPointsProcessor> FromDictionary(
+      common::LuaParameterDictionary* dictionary, PointsProcessor* next);
+
+  ~AsyncPointsProcessor() override;
+
+  AsyncPointsProcessor(const AsyncPointsProcessor&) = delete;
+  AsyncPointsProcessor& operator=(const AsyncPointsProcessor&) = delete;
+
+  void Process(std::unique_ptr<PointsBatch> batch) override;
+  FlushResult Flush() override;
+
+ private:
+  void ProcessQueue();
+
+  PointsProcessor* const next_;
+
+  common::Mutex mutex_;
+  int64 num_pending_batches_ GUARDED_BY(mutex_) = 0;
+
+  common::BlockingQueue<std::unique_ptr<PointsBatch>> queue_;
+  std::thread thread_;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_ASYNC_POINTS_PROCESSOR_H_
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/async_points_processor.h"
+
+#include <thread>
+#include <vector>
+
+#include "cartographer/common/make_unique.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+// Records the 'trajectory_id's of all batches it receives and the threads it
+// receives them on.
+class RecordingPointsProcessor : public PointsProcessor {
+ public:
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    trajectory_ids_.push_back(batch->trajectory_id);
+    thread_ids_.push_back(std::this_thread::get_id());
+  }
+  FlushResult Flush() override { return FlushResult::kFinished; }
+
+  const std::vector<int>& trajectory_ids() const { return trajectory_ids_; }
+  const std::vector<std::thread::id>& thread_ids() const {
+    return thread_ids_;
+  }
+
+ private:
+  std::vector<int> trajectory_ids_;
+  std::vector<std::thread::id> thread_ids_;
+};
+
+TEST(AsyncPointsProcessorTest, ProcessesInOrderOnSeparateThread) {
+  constexpr int kNumBatches = 100;
+  RecordingPointsProcessor recorder;
+  AsyncPointsProcessor processor(3, &recorder);
+  for (int i = 0; i != kNumBatches; ++i) {
+    auto batch = common::make_unique<PointsBatch>();
+    batch->trajectory_id = i;
+    processor.Process(std::move(batch));
+  }
+  EXPECT_EQ(PointsProcessor::FlushResult::kFinished, processor.Flush());
+  ASSERT_EQ(kNumBatches, recorder.trajectory_ids().size());
+  for (int i = 0; i != kNumBatches; ++i) {
+    EXPECT_EQ(i, recorder.trajectory_ids()[i]);
+    EXPECT_NE(std::this_thread::get_id(), recorder.thread_ids()[i]);
+  }
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
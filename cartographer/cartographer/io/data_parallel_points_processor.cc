@@ -0,0 +1,151 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/data_parallel_points_processor.h"
+
+#include "cartographer/common/make_unique.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+namespace {
+
+// Output of the task the stage is processing on this thread.
+thread_local std::unique_ptr<PointsBatch>* current_output = nullptr;
+
+}  // namespace
+
+constexpr int DataParallelPointsProcessor::kMaxNumBatchesInFlightPerThread;
+
+// The 'next' processor of the stage, collecting its output.
+class DataParallelPointsProcessor::StageOutput : public PointsProcessor {
+ public:
+  explicit StageOutput(DataParallelPointsProcessor* const parent)
+      : parent_(parent) {}
+
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    parent_->AddOutput(std::move(batch));
+  }
+
+  // Only called by the stage while the parent is flushed, i.e. no batches are
+  // in flight.
+  FlushResult Flush() override { return parent_->next_->Flush(); }
+
+ private:
+  DataParallelPointsProcessor* const parent_;
+};
+
+DataParallelPointsProcessor::DataParallelPointsProcessor(
+    const int num_threads, const StageFactory& stage_factory,
+    PointsProcessor* const next)
+    : max_num_batches_in_flight_(num_threads *
+                                 kMaxNumBatchesInFlightPerThread),
+      next_(next),
+      stage_output_(common::make_unique<StageOutput>(this)),
+      stage_(stage_factory(stage_output_.get())),
+      tasks_(max_num_batches_in_flight_) {
+  CHECK_GT(num_threads, 0);
+  for (int i = 0; i != num_threads; ++i) {
+    threads_.emplace_back([this]() { ProcessTasks(); });
+  }
+}
+
+DataParallelPointsProcessor::~DataParallelPointsProcessor() {
+  for (size_t i = 0; i != threads_.size(); ++i) {
+    tasks_.Push(nullptr);
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void DataParallelPointsProcessor::Process(std::unique_ptr<PointsBatch> batch) {
+  auto task = common::make_unique<Task>();
+  task->batch = std::move(batch);
+  {
+    common::MutexLocker lock(&mutex_);
+    // Waiting on the batches handed on, and not only on the queue, also bounds
+    // 'outputs_' while earlier batches or 'next_' are slow.
+    lock.Await([this]() REQUIRES(mutex_) {
+      return num_received_ - num_handed_on_ < max_num_batches_in_flight_;
+    });
+    task->sequence_number = num_received_++;
+  }
+  tasks_.Push(std::move(task));
+}
+
+PointsProcessor::FlushResult DataParallelPointsProcessor::Flush() {
+  {
+    common::MutexLocker lock(&mutex_);
+    lock.Await(
+        [this]() REQUIRES(mutex_) { return num_handed_on_ == num_received_; });
+  }
+  // The stage forwards this to 'next_' through its output.
+  return stage_->Flush();
+}
+
+void DataParallelPointsProcessor::ProcessTasks() {
+  while (std::unique_ptr<Task> task = tasks_.Pop()) {
+    current_output = &task->output;
+    stage_->Process(std::move(task->batch));
+    current_output = nullptr;
+    CompleteTask(std::move(task));
+  }
+}
+
+void DataParallelPointsProcessor::AddOutput(
+    std::unique_ptr<PointsBatch> batch) {
+  CHECK(current_output != nullptr)
+      << "The stage must hand on batches from within Process().";
+  CHECK(*current_output == nullptr)
+      << "The stage handed on a batch more than once.";
+  *current_output = std::move(batch);
+}
+
+void DataParallelPointsProcessor::CompleteTask(std::unique_ptr<Task> task) {
+  {
+    common::MutexLocker lock(&mutex_);
+    outputs_.emplace(task->sequence_number, std::move(task->output));
+    if (handing_on_) {
+      return;
+    }
+    handing_on_ = true;
+  }
+  // Only one thread at a time hands on batches, so 'next_' sees them in order
+  // and is never called concurrently.
+  for (;;) {
+    std::unique_ptr<PointsBatch> batch;
+    {
+      common::MutexLocker lock(&mutex_);
+      const auto it = outputs_.begin();
+      if (it == outputs_.end() || it->first != num_handed_on_) {
+        handing_on_ = false;
+        return;
+      }
+      batch = std::move(it->second);
+      outputs_.erase(it);
+    }
+    if (batch != nullptr) {
+      next_->Process(std::move(batch));
+    }
+    common::MutexLocker lock(&mutex_);
+    ++num_handed_on_;
+  }
+}
+
+}  // namespace io
+}  // namespace cartographer
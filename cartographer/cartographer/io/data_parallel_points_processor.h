@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_DATA_PARALLEL_POINTS_PROCESSOR_H_
+#define CARTOGRAPHER_IO_DATA_PARALLEL_POINTS_PROCESSOR_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cartographer/common/blocking_queue.h"
+#include "cartographer/common/mutex.h"
+#include "cartographer/common/port.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Runs a stage on 'num_threads' threads. The stage's Process() must be
+// thread-safe and must hand each batch on at most once, independently of all
+// other batches. The batches coming out of the stage are passed on to 'next'
+// in the order they were received. Process() blocks while too many batches
+// are in flight, so that a slow 'next' bounds the memory used.
+class DataParallelPointsProcessor : public PointsProcessor {
+ public:
+  // Batches which have been received but not yet handed on, i.e. which are
+  // queued, processed by the stage or waiting for earlier batches.
+  static constexpr int kMaxNumBatchesInFlightPerThread = 4;
+
+  // Creates the stage with the given 'next' processor.
+  using StageFactory =
+      std::function<std::unique_ptr<PointsProcessor>(PointsProcessor* next)>;
+
+  DataParallelPointsProcessor(int num_threads,
+                              const StageFactory& stage_factory,
+                              PointsProcessor* next);
+  ~DataParallelPointsProcessor() override;
+
+  DataParallelPointsProcessor(const DataParallelPointsProcessor&) = delete;
+  DataParallelPointsProcessor& operator=(const DataParallelPointsProcessor&) =
+      delete;
+
+  void Process(std::unique_ptr<PointsBatch> batch) override;
+  FlushResult Flush() override;
+
+ private:
+  class StageOutput;
+
+  struct Task {
+    int64 sequence_number;
+    std::unique_ptr<PointsBatch> batch;
+    // What the 'stage_' handed on, if anything.
+    std::unique_ptr<PointsBatch> output;
+  };
+
+  void ProcessTasks();
+
+  // Called by the 'stage_' with its output for the current thread's task.
+  void AddOutput(std::unique_ptr<PointsBatch> batch);
+
+  // Called once the 'stage_' is done with 'task'. Passes on all outputs that
+  // are next in order to 'next_'.
+  void CompleteTask(std::unique_ptr<Task> task) EXCLUDES(mutex_);
+
+  const int64 max_num_batches_in_flight_;
+  PointsProcessor* const next_;
+  const std::unique_ptr<PointsProcessor> stage_output_;
+  const std::unique_ptr<PointsProcessor> stage_;
+
+  common::Mutex mutex_;
+  int64 num_received_ GUARDED_BY(mutex_) = 0;
+  // Number of batches completely handed on, which is also the sequence number
+  // of the next batch to hand on.
+  int64 num_handed_on_ GUARDED_BY(mutex_) = 0;
+  // Whether one of the threads is currently handing on batches.
+  bool handing_on_ GUARDED_BY(mutex_) = false;
+  // Output of the 'stage_' by sequence number. A nullptr means the stage
+  // dropped the batch.
+  std::map<int64, std::unique_ptr<PointsBatch>> outputs_ GUARDED_BY(mutex_);
+
+  common::BlockingQueue<std::unique_ptr<Task>> tasks_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_DATA_PARALLEL_POINTS_PROCESSOR_H_
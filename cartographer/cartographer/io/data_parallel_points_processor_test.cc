@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/data_parallel_points_processor.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "cartographer/common/make_unique.h"
+#include "cartographer/common/mutex.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+// Records the 'trajectory_id's of all batches it receives.
+class RecordingPointsProcessor : public PointsProcessor {
+ public:
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    trajectory_ids_.push_back(batch->trajectory_id);
+  }
+  FlushResult Flush() override { return FlushResult::kRestartStream; }
+
+  const std::vector<int>& trajectory_ids() const { return trajectory_ids_; }
+
+ private:
+  std::vector<int> trajectory_ids_;
+};
+
+// Drops batches with odd 'trajectory_id's and takes longer for earlier
+// batches, so that batches complete out of order.
+class SlowFilteringPointsProcessor : public PointsProcessor {
+ public:
+  explicit SlowFilteringPointsProcessor(PointsProcessor* const next)
+      : next_(next) {}
+
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(100 * (batch->trajectory_id % 7)));
+    {
+      common::MutexLocker lock(&mutex_);
+      ++num_processed_;
+    }
+    if (batch->trajectory_id % 2 == 0) {
+      next_->Process(std::move(batch));
+    }
+  }
+  FlushResult Flush() override { return next_->Flush(); }
+
+  int num_processed() {
+    common::MutexLocker lock(&mutex_);
+    return num_processed_;
+  }
+
+ private:
+  PointsProcessor* const next_;
+  common::Mutex mutex_;
+  int num_processed_ = 0;
+};
+
+TEST(DataParallelPointsProcessorTest, PreservesOrder) {
+  constexpr int kNumBatches = 100;
+  RecordingPointsProcessor recorder;
+  SlowFilteringPointsProcessor* stage = nullptr;
+  DataParallelPointsProcessor processor(
+      4,
+      [&stage](PointsProcessor* const next) {
+        auto result = common::make_unique<SlowFilteringPointsProcessor>(next);
+        stage = result.get();
+        return std::unique_ptr<PointsProcessor>(std::move(result));
+      },
+      &recorder);
+  for (int pass = 0; pass != 2; ++pass) {
+    for (int i = 0; i != kNumBatches; ++i) {
+      auto batch = common::make_unique<PointsBatch>();
+      batch->trajectory_id = i;
+      processor.Process(std::move(batch));
+    }
+    EXPECT_EQ(PointsProcessor::FlushResult::kRestartStream, processor.Flush());
+    EXPECT_EQ((pass + 1) * kNumBatches, stage->num_processed());
+    ASSERT_EQ((pass + 1) * kNumBatches / 2, recorder.trajectory_ids().size());
+    for (int i = 0; i != kNumBatches / 2; ++i) {
+      EXPECT_EQ(2 * i, recorder.trajectory_ids()[pass * kNumBatches / 2 + i]);
+    }
+  }
+}
+
+// Blocks in Process() until released, like a slow downstream processor.
+class BlockingPointsProcessor : public PointsProcessor {
+ public:
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    common::MutexLocker lock(&mutex_);
+    lock.Await([this]() REQUIRES(mutex_) { return released_; });
+    trajectory_ids_.push_back(batch->trajectory_id);
+  }
+  FlushResult Flush() override { return FlushResult::kFinished; }
+
+  void Release() {
+    common::MutexLocker lock(&mutex_);
+    released_ = true;
+  }
+
+  std::vector<int> trajectory_ids() {
+    common::MutexLocker lock(&mutex_);
+    return trajectory_ids_;
+  }
+
+ private:
+  common::Mutex mutex_;
+  bool released_ GUARDED_BY(mutex_) = false;
+  std::vector<int> trajectory_ids_ GUARDED_BY(mutex_);
+};
+
+// Hands on every batch immediately.
+class ForwardingPointsProcessor : public PointsProcessor {
+ public:
+  explicit ForwardingPointsProcessor(PointsProcessor* const next)
+      : next_(next) {}
+
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    next_->Process(std::move(batch));
+  }
+  FlushResult Flush() override { return next_->Flush(); }
+
+ private:
+  PointsProcessor* const next_;
+};
+
+TEST(DataParallelPointsProcessorTest, BlocksWhileNextIsSlow) {
+  constexpr int kNumThreads = 2;
+  constexpr int kNumBatches = 100;
+  BlockingPointsProcessor blocking;
+  DataParallelPointsProcessor processor(
+      kNumThreads,
+      [](PointsProcessor* const next) {
+        return std::unique_ptr<PointsProcessor>(
+            common::make_unique<ForwardingPointsProcessor>(next));
+      },
+      &blocking);
+  common::Mutex mutex;
+  int num_received = 0;
+  std::thread feeder([&processor, &mutex, &num_received]() {
+    for (int i = 0; i != kNumBatches; ++i) {
+      auto batch = common::make_unique<PointsBatch>();
+      batch->trajectory_id = i;
+      processor.Process(std::move(batch));
+      common::MutexLocker lock(&mutex);
+      ++num_received;
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    common::MutexLocker lock(&mutex);
+    EXPECT_LE(num_received,
+              kNumThreads *
+                  DataParallelPointsProcessor::kMaxNumBatchesInFlightPerThread);
+  }
+  blocking.Release();
+  feeder.join();
+  EXPECT_EQ(PointsProcessor::FlushResult::kFinished, processor.Flush());
+  const std::vector<int> trajectory_ids = blocking.trajectory_ids();
+  ASSERT_EQ(kNumBatches, trajectory_ids.size());
+  for (int i = 0; i != kNumBatches; ++i) {
+    EXPECT_EQ(i, trajectory_ids[i]);
+  }
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
@@ -43,9 +43,12 @@ FixedRatioSamplingPointsProcessor::FixedRatioSamplingPointsProcessor(
 void FixedRatioSamplingPointsProcessor::Process(
     std::unique_ptr<PointsBatch> batch) {
   std::vector<int> to_remove;
-  for (size_t i = 0; i < batch->points.size(); ++i) {
-    if (!sampler_->Pulse()) {
-      to_remove.push_back(i);
+  {
+    common::MutexLocker lock(&mutex_);
+    for (size_t i = 0; i < batch->points.size(); ++i) {
+      if (!sampler_->Pulse()) {
+        to_remove.push_back(i);
+      }
     }
   }
   RemovePoints(to_remove, batch.get());
@@ -57,10 +60,12 @@ PointsProcessor::FlushResult FixedRatioSamplingPointsProcessor::Flush() {
     case PointsProcessor::FlushResult::kFinished:
       return PointsProcessor::FlushResult::kFinished;
 
-    case PointsProcessor::FlushResult::kRestartStream:
+    case PointsProcessor::FlushResult::kRestartStream: {
+      common::MutexLocker lock(&mutex_);
       sampler_ =
           common::make_unique<common::FixedRatioSampler>(sampling_ratio_);
       return PointsProcessor::FlushResult::kRestartStream;
+    }
   }
   LOG(FATAL);
 }
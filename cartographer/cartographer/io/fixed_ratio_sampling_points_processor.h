@@ -21,13 +21,16 @@
 
 #include "cartographer/common/fixed_ratio_sampler.h"
 #include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/mutex.h"
 #include "cartographer/io/points_processor.h"
 
 namespace cartographer {
 namespace io {
 
 // Only let a fixed 'sampling_ratio' of points through. A 'sampling_ratio' of 1.
-// makes this filter a no-op.
+// makes this filter a no-op. Process() is thread-safe, but if batches are
+// processed concurrently, which points are let through depends on the order in
+// which the batches reach the sampler.
 class FixedRatioSamplingPointsProcessor : public PointsProcessor {
  public:
   constexpr static const char* kConfigurationFileActionName =
@@ -52,7 +55,8 @@ class FixedRatioSamplingPointsProcessor : public PointsProcessor {
  private:
   const double sampling_ratio_;
   PointsProcessor* const next_;
-  std::unique_ptr<common::FixedRatioSampler> sampler_;
+  common::Mutex mutex_;
+  std::unique_ptr<common::FixedRatioSampler> sampler_ GUARDED_BY(mutex_);
 };
 
 }  // namespace io
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/points_batch_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "cartographer/common/make_unique.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+namespace {
+
+// Each batch is stored as its time, origin, trajectory ID, the sizes of its
+// frame ID, points, intensities and colors, followed by their contents.
+struct BatchHeader {
+  int64 time;
+  float origin[3];
+  int32 trajectory_id;
+  uint32 frame_id_size;
+  uint32 num_points;
+  uint32 num_intensities;
+  uint32 num_colors;
+};
+
+template <typename T>
+void Append(const T* const values, const size_t count,
+            std::vector<char>* const buffer) {
+  const char* const bytes = reinterpret_cast<const char*>(values);
+  buffer->insert(buffer->end(), bytes, bytes + count * sizeof(T));
+}
+
+template <typename T>
+const char* Extract(const char* const data, const size_t count,
+                    std::vector<T>* const values) {
+  values->resize(count);
+  memcpy(values->data(), data, count * sizeof(T));
+  return data + count * sizeof(T);
+}
+
+}  // namespace
+
+PointsBatchCache::PointsBatchCache(const string& filename)
+    : filename_(filename),
+      out_(filename, std::ios::out | std::ios::binary | std::ios::trunc) {
+  CHECK(out_.good()) << "Could not open '" << filename_ << "' for writing.";
+}
+
+PointsBatchCache::~PointsBatchCache() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  if (out_.is_open()) {
+    out_.close();
+  }
+  remove(filename_.c_str());
+}
+
+void PointsBatchCache::Add(const PointsBatch& batch) {
+  CHECK(out_.is_open()) << "Cannot add to a finished cache.";
+  CHECK(batch.intensities.empty() ||
+        batch.intensities.size() == batch.points.size());
+  CHECK(batch.colors.empty() || batch.colors.size() == batch.points.size());
+  const BatchHeader header{common::ToUniversal(batch.time),
+                           {batch.origin.x(), batch.origin.y(),
+                            batch.origin.z()},
+                           batch.trajectory_id,
+                           static_cast<uint32>(batch.frame_id.size()),
+                           static_cast<uint32>(batch.points.size()),
+                           static_cast<uint32>(batch.intensities.size()),
+                           static_cast<uint32>(batch.colors.size())};
+  buffer_.clear();
+  Append(&header, 1, &buffer_);
+  Append(batch.frame_id.data(), batch.frame_id.size(), &buffer_);
+  for (const Eigen::Vector3f& point : batch.points) {
+    Append(point.data(), 3, &buffer_);
+  }
+  Append(batch.intensities.data(), batch.intensities.size(), &buffer_);
+  Append(batch.colors.data(), batch.colors.size(), &buffer_);
+  out_.write(buffer_.data(), buffer_.size());
+  CHECK(out_.good()) << "Could not write to '" << filename_ << "'.";
+  ++num_batches_;
+}
+
+void PointsBatchCache::FinishWriting() {
+  CHECK(out_.is_open());
+  out_.close();
+  CHECK(!out_.fail()) << "Could not write to '" << filename_ << "'.";
+  const int fd = open(filename_.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Could not open '" << filename_
+                  << "': " << strerror(errno);
+  struct stat file_stat;
+  CHECK_EQ(fstat(fd, &file_stat), 0) << strerror(errno);
+  size_ = file_stat.st_size;
+  if (size_ != 0) {
+    void* const data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK(data != MAP_FAILED) << "Could not map '" << filename_
+                              << "': " << strerror(errno);
+    // Replays read the file from beginning to end.
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+  }
+  close(fd);
+}
+
+void PointsBatchCache::Replay(PointsProcessor* const processor) const {
+  CHECK(!out_.is_open()) << "FinishWriting() must be called before Replay().";
+  const char* current = data_;
+  const char* const end = data_ + size_;
+  std::vector<float> coordinates;
+  for (int64 i = 0; i != num_batches_; ++i) {
+    CHECK_LE(current + sizeof(BatchHeader), end);
+    BatchHeader header;
+    memcpy(&header, current, sizeof(header));
+    current += sizeof(header);
+    auto batch = common::make_unique<PointsBatch>();
+    batch->time = common::FromUniversal(header.time);
+    batch->origin =
+        Eigen::Vector3f(header.origin[0], header.origin[1], header.origin[2]);
+    batch->trajectory_id = header.trajectory_id;
+    batch->frame_id.assign(current, header.frame_id_size);
+    current += header.frame_id_size;
+    current = Extract(current, 3 * header.num_points, &coordinates);
+    batch->points.reserve(header.num_points);
+    for (size_t j = 0; j != coordinates.size(); j += 3) {
+      batch->points.emplace_back(coordinates[j], coordinates[j + 1],
+                                 coordinates[j + 2]);
+    }
+    current = Extract(current, header.num_intensities, &batch->intensities);
+    current = Extract(current, header.num_colors, &batch->colors);
+    CHECK_LE(current, end);
+    processor->Process(std::move(batch));
+  }
+}
+
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_POINTS_BATCH_CACHE_H_
+#define CARTOGRAPHER_IO_POINTS_BATCH_CACHE_H_
+
+#include <fstream>
+#include <vector>
+
+#include "cartographer/common/port.h"
+#include "cartographer/io/points_batch.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Caches points batches in a local file, so that a pipeline asking for another
+// pass over the data can be fed again without reading and converting the
+// original data. Batches are appended to the file while writing and replayed
+// from a memory mapping of the file.
+class PointsBatchCache {
+ public:
+  // Creates the file 'filename', which is removed again on destruction.
+  explicit PointsBatchCache(const string& filename);
+  ~PointsBatchCache();
+
+  PointsBatchCache(const PointsBatchCache&) = delete;
+  PointsBatchCache& operator=(const PointsBatchCache&) = delete;
+
+  // Appends 'batch' to the cache. Must be called before FinishWriting().
+  void Add(const PointsBatch& batch);
+
+  // Closes the file for writing and maps it into memory for Replay().
+  void FinishWriting();
+
+  // Hands copies of all cached batches in the order they were added to
+  // 'processor'. Must be called after FinishWriting().
+  void Replay(PointsProcessor* processor) const;
+
+  int64 num_batches() const { return num_batches_; }
+
+ private:
+  const string filename_;
+  std::ofstream out_;
+  std::vector<char> buffer_;
+  int64 num_batches_ = 0;
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_POINTS_BATCH_CACHE_H_
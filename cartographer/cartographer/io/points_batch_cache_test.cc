@@ -0,0 +1,119 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/points_batch_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "cartographer/common/make_unique.h"
+#include "cartographer/common/port.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+class CollectingPointsProcessor : public PointsProcessor {
+ public:
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    batches_.push_back(std::move(batch));
+  }
+  FlushResult Flush() override { return FlushResult::kFinished; }
+
+  const std::vector<std::unique_ptr<PointsBatch>>& batches() const {
+    return batches_;
+  }
+
+ private:
+  std::vector<std::unique_ptr<PointsBatch>> batches_;
+};
+
+std::unique_ptr<PointsBatch> CreateBatch(const int index) {
+  auto batch = common::make_unique<PointsBatch>();
+  batch->time = common::FromUniversal(1000 + index);
+  batch->origin = Eigen::Vector3f(index, -index, 0.5f);
+  batch->frame_id = "frame_" + std::to_string(index);
+  batch->trajectory_id = index % 2;
+  for (int i = 0; i != index; ++i) {
+    batch->points.emplace_back(i, 2.f * i, -0.25f * i);
+    if (index % 2 == 0) {
+      batch->intensities.push_back(10.f * i);
+    }
+    if (index % 3 == 0) {
+      batch->colors.push_back({{static_cast<uint8_t>(i), 20, 30}});
+    }
+  }
+  return batch;
+}
+
+class PointsBatchCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const string tmpdir = P_tmpdir;
+    test_directory_ = tmpdir + "/points_batch_cache_test_XXXXXX";
+    ASSERT_NE(mkdtemp(&test_directory_[0]), nullptr) << strerror(errno);
+  }
+
+  void TearDown() override { remove(test_directory_.c_str()); }
+
+  string test_directory_;
+};
+
+TEST_F(PointsBatchCacheTest, ReplaysAllBatchesInOrder) {
+  constexpr int kNumBatches = 7;
+  PointsBatchCache cache(test_directory_ + "/test.points_cache");
+  for (int i = 0; i != kNumBatches; ++i) {
+    cache.Add(*CreateBatch(i));
+  }
+  cache.FinishWriting();
+  EXPECT_EQ(kNumBatches, cache.num_batches());
+
+  // Every replay hands out the same batches.
+  for (int pass = 0; pass != 2; ++pass) {
+    CollectingPointsProcessor processor;
+    cache.Replay(&processor);
+    ASSERT_EQ(kNumBatches, processor.batches().size());
+    for (int i = 0; i != kNumBatches; ++i) {
+      const auto expected = CreateBatch(i);
+      const PointsBatch& actual = *processor.batches()[i];
+      EXPECT_EQ(expected->time, actual.time);
+      EXPECT_EQ(expected->origin, actual.origin);
+      EXPECT_EQ(expected->frame_id, actual.frame_id);
+      EXPECT_EQ(expected->trajectory_id, actual.trajectory_id);
+      EXPECT_EQ(expected->points, actual.points);
+      EXPECT_EQ(expected->intensities, actual.intensities);
+      EXPECT_EQ(expected->colors, actual.colors);
+    }
+  }
+}
+
+TEST_F(PointsBatchCacheTest, EmptyCache) {
+  PointsBatchCache cache(test_directory_ + "/empty.points_cache");
+  cache.FinishWriting();
+  CollectingPointsProcessor processor;
+  cache.Replay(&processor);
+  EXPECT_TRUE(processor.batches().empty());
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
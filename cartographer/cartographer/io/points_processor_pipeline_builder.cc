@@ -17,8 +17,10 @@
 #include "cartographer/io/points_processor_pipeline_builder.h"
 
 #include "cartographer/common/make_unique.h"
+#include "cartographer/io/async_points_processor.h"
 #include "cartographer/io/coloring_points_processor.h"
 #include "cartographer/io/counting_points_processor.h"
+#include "cartographer/io/data_parallel_points_processor.h"
 #include "cartographer/io/fixed_ratio_sampling_points_processor.h"
 #include "cartographer/io/hybrid_grid_points_processor.h"
 #include "cartographer/io/intensity_to_color_points_processor.h"
@@ -46,6 +48,17 @@ void RegisterPlainPointsProcessor(
       });
 }
 
+template <typename PointsProcessorType>
+void RegisterDataParallelPointsProcessor(
+    PointsProcessorPipelineBuilder* const builder) {
+  builder->RegisterDataParallel(
+      PointsProcessorType::kConfigurationFileActionName,
+      [](common::LuaParameterDictionary* const dictionary,
+         PointsProcessor* const next) -> std::unique_ptr<PointsProcessor> {
+        return PointsProcessorType::FromDictionary(dictionary, next);
+      });
+}
+
 template <typename PointsProcessorType>
 void RegisterFileWritingPointsProcessor(
     FileWriterFactory file_writer_factory,
@@ -64,12 +77,16 @@ void RegisterBuiltInPointsProcessors(
     const mapping::proto::Trajectory& trajectory,
     FileWriterFactory file_writer_factory,
     PointsProcessorPipelineBuilder* builder) {
+  RegisterPlainPointsProcessor<AsyncPointsProcessor>(builder);
   RegisterPlainPointsProcessor<CountingPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<FixedRatioSamplingPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<MinMaxRangeFiteringPointsProcessor>(builder);
+  RegisterDataParallelPointsProcessor<FixedRatioSamplingPointsProcessor>(
+      builder);
+  RegisterDataParallelPointsProcessor<MinMaxRangeFiteringPointsProcessor>(
+      builder);
   RegisterPlainPointsProcessor<OutlierRemovingPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<ColoringPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<IntensityToColorPointsProcessor>(builder);
+  RegisterDataParallelPointsProcessor<ColoringPointsProcessor>(builder);
+  RegisterDataParallelPointsProcessor<IntensityToColorPointsProcessor>(
+      builder);
   RegisterFileWritingPointsProcessor<PcdWritingPointsProcessor>(
       file_writer_factory, builder);
   RegisterFileWritingPointsProcessor<PlyWritingPointsProcessor>(
@@ -100,6 +117,12 @@ void PointsProcessorPipelineBuilder::Register(const std::string& name,
   factories_[name] = factory;
 }
 
+void PointsProcessorPipelineBuilder::RegisterDataParallel(
+    const std::string& name, FactoryFunction factory) {
+  Register(name, factory);
+  data_parallel_names_.insert(name);
+}
+
 PointsProcessorPipelineBuilder::PointsProcessorPipelineBuilder() {}
 
 std::vector<std::unique_ptr<PointsProcessor>>
@@ -121,7 +144,23 @@ PointsProcessorPipelineBuilder::CreatePipeline(
     CHECK(factory_it != factories_.end())
         << "Unknown action '" << action
         << "'. Did you register the correspoinding PointsProcessor?";
-    pipeline.push_back(factory_it->second(it->get(), pipeline.back().get()));
+    const int num_threads = (*it)->HasKey("num_threads")
+                                ? (*it)->GetNonNegativeInt("num_threads")
+                                : 1;
+    if (num_threads > 1) {
+      CHECK(data_parallel_names_.count(action) != 0)
+          << "Action '" << action << "' cannot run on multiple threads.";
+      common::LuaParameterDictionary* const stage_dictionary = it->get();
+      const FactoryFunction& factory = factory_it->second;
+      pipeline.push_back(common::make_unique<DataParallelPointsProcessor>(
+          num_threads,
+          [stage_dictionary, &factory](PointsProcessor* const next) {
+            return factory(stage_dictionary, next);
+          },
+          pipeline.back().get()));
+    } else {
+      pipeline.push_back(factory_it->second(it->get(), pipeline.back().get()));
+    }
   }
   return pipeline;
 }
@@ -19,6 +19,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "cartographer/common/lua_parameter_dictionary.h"
@@ -35,6 +36,10 @@ namespace io {
 // a name and a factory method for building itself from a
 // LuaParameterDictionary. See the various built-in PointsProcessors for
 // examples.
+//
+// PointsProcessors registered using 'RegisterDataParallel' can be configured
+// with 'num_threads' to process batches on multiple threads. An "async" stage
+// can be inserted between any two PointsProcessors to run them concurrently.
 class PointsProcessorPipelineBuilder {
  public:
   using FactoryFunction = std::function<std::unique_ptr<PointsProcessor>(
@@ -51,11 +56,17 @@ class PointsProcessorPipelineBuilder {
   // be created using 'factory'.
   void Register(const std::string& name, FactoryFunction factory);
 
+  // Like 'Register', but for PointsProcessors whose Process() is thread-safe
+  // and handles each batch on its own, so that they can be run on multiple
+  // threads.
+  void RegisterDataParallel(const std::string& name, FactoryFunction factory);
+
   std::vector<std::unique_ptr<PointsProcessor>> CreatePipeline(
       common::LuaParameterDictionary* dictionary) const;
 
  private:
   std::unordered_map<std::string, FactoryFunction> factories_;
+  std::unordered_set<std::string> data_parallel_names_;
 };
 
 // Register all 'PointsProcessor' that ship with Cartographer with this
@@ -16,14 +16,24 @@
 
 #include "cartographer/io/proto_stream.h"
 
+#include "glog/logging.h"
+
 namespace cartographer {
 namespace io {
 
 namespace {
 
-// First eight bytes to identify our proto stream format.
+// First eight bytes to identify our proto stream format. Files written without
+// an index start with 'kMagic'.
 const size_t kMagic = 0x7b1d1f7b5bf501db;
 
+// Files with an index start with 'kMagicWithIndex'. At their end, the offset
+// of the index record and again 'kMagicWithIndex' follow the index.
+const size_t kMagicWithIndex = 0x7b1d1f7b5bf502dc;
+
+// Size of the offset and magic after the index.
+constexpr size_t kTrailerSize = 16;
+
 void WriteSizeAsLittleEndian(size_t size, std::ostream* out) {
   for (int i = 0; i != 8; ++i) {
     out->put(size & 0xff);
@@ -42,49 +52,163 @@ bool ReadSizeAsLittleEndian(std::istream* in, size_t* size) {
 
 }  // namespace
 
-ProtoStreamWriter::ProtoStreamWriter(const string& filename)
-    : out_(filename, std::ios::out | std::ios::binary) {
-  WriteSizeAsLittleEndian(kMagic, &out_);
+ProtoStreamWriter::ProtoStreamWriter(const string& filename,
+                                     const Compression compression)
+    : out_(filename, std::ios::out | std::ios::binary),
+      compression_(compression) {
+  WriteSizeAsLittleEndian(kMagicWithIndex, &out_);
+}
+
+ProtoStreamWriter::~ProtoStreamWriter() {
+  if (out_.is_open()) {
+    Close();
+  }
 }
 
-ProtoStreamWriter::~ProtoStreamWriter() {}
+void ProtoStreamWriter::AddToIndex(const string& key) {
+  CHECK(keys_.insert(key).second) << "Duplicate key '" << key << "'.";
+  auto* const entry = index_.add_entry();
+  entry->set_key(key);
+  entry->set_offset(out_.tellp());
+}
 
 void ProtoStreamWriter::Write(const string& uncompressed_data) {
+  // Each record consists of the size of its data, how it is compressed and the
+  // data.
   string compressed_data;
-  common::FastGzipString(uncompressed_data, &compressed_data);
+  switch (compression_) {
+    case Compression::kNone:
+      compressed_data = uncompressed_data;
+      break;
+    case Compression::kGzip:
+      common::FastGzipString(uncompressed_data, &compressed_data);
+      break;
+  }
   WriteSizeAsLittleEndian(compressed_data.size(), &out_);
+  out_.put(static_cast<char>(compression_));
   out_.write(compressed_data.data(), compressed_data.size());
 }
 
 bool ProtoStreamWriter::Close() {
-  out_.close();
+  if (out_.is_open()) {
+    const size_t index_offset = out_.tellp();
+    WriteProto(index_);
+    WriteSizeAsLittleEndian(index_offset, &out_);
+    WriteSizeAsLittleEndian(kMagicWithIndex, &out_);
+    out_.close();
+  }
   return !out_.fail();
 }
 
 ProtoStreamReader::ProtoStreamReader(const string& filename)
     : in_(filename, std::ios::in | std::ios::binary) {
   size_t magic;
-  if (!ReadSizeAsLittleEndian(&in_, &magic) || magic != kMagic) {
+  if (!ReadSizeAsLittleEndian(&in_, &magic)) {
+    in_.setstate(std::ios::failbit);
+  } else if (magic == kMagic) {
+    version_ = 1;
+  } else if (magic == kMagicWithIndex) {
+    version_ = 2;
+    has_index_ = ReadIndex();
+  } else {
     in_.setstate(std::ios::failbit);
   }
 }
 
 ProtoStreamReader::~ProtoStreamReader() {}
 
-bool ProtoStreamReader::Read(string* decompressed_data) {
+bool ProtoStreamReader::ReadIndex() {
+  in_.seekg(0, std::ios::end);
+  const size_t file_size = in_.tellg();
+  // If the file was not closed properly, it has no index, but the records
+  // before the end can still be read.
+  end_of_records_ = file_size;
+  bool success = false;
+  size_t index_offset;
+  size_t magic;
+  if (file_size >= 8 + kTrailerSize &&
+      in_.seekg(file_size - kTrailerSize) &&
+      ReadSizeAsLittleEndian(&in_, &index_offset) &&
+      ReadSizeAsLittleEndian(&in_, &magic) && magic == kMagicWithIndex &&
+      index_offset >= 8 && index_offset < file_size - kTrailerSize) {
+    proto::ProtoStreamIndex index;
+    CompressedRecord record;
+    if (in_.seekg(index_offset) && ReadRecord(&record) &&
+        ParseCompressedRecord(record, &index)) {
+      for (const auto& entry : index.entry()) {
+        offsets_[entry.key()] = entry.offset();
+      }
+      end_of_records_ = index_offset;
+      success = true;
+    }
+  }
+  in_.clear();
+  in_.seekg(8);
+  return success;
+}
+
+bool ProtoStreamReader::ReadCompressedRecord(CompressedRecord* const record) {
+  if (version_ == 2 && in_.good() &&
+      static_cast<size_t>(in_.tellg()) >= end_of_records_) {
+    reached_end_of_records_ = true;
+    return false;
+  }
+  if (!ReadRecord(record)) {
+    // A file which was not closed properly can end within its last record.
+    if (version_ == 2 && in_.eof()) {
+      reached_end_of_records_ = true;
+    }
+    return false;
+  }
+  return true;
+}
+
+bool ProtoStreamReader::ReadCompressedRecord(const string& key,
+                                             CompressedRecord* const record) {
+  const auto it = offsets_.find(key);
+  if (it == offsets_.end()) {
+    return false;
+  }
+  const std::streampos position = in_.tellg();
+  in_.seekg(it->second);
+  const bool success = ReadRecord(record);
+  in_.clear();
+  in_.seekg(position);
+  return success;
+}
+
+bool ProtoStreamReader::ReadRecord(CompressedRecord* const record) {
   size_t compressed_size;
   if (!ReadSizeAsLittleEndian(&in_, &compressed_size)) {
     return false;
   }
-  string compressed_data(compressed_size, '\0');
-  if (!in_.read(&compressed_data.front(), compressed_size)) {
+  // Files without an index have all records compressed using gzip.
+  int compression = static_cast<int>(ProtoStreamWriter::Compression::kGzip);
+  if (version_ == 2) {
+    compression = in_.get();
+    if (in_.fail()) {
+      return false;
+    }
+  }
+  if (compression !=
+          static_cast<int>(ProtoStreamWriter::Compression::kNone) &&
+      compression != static_cast<int>(ProtoStreamWriter::Compression::kGzip)) {
+    LOG(ERROR) << "Unknown compression " << compression << ".";
     return false;
   }
-  common::FastGunzipString(compressed_data, decompressed_data);
-  return true;
+  record->compression =
+      static_cast<ProtoStreamWriter::Compression>(compression);
+  record->data.resize(compressed_size);
+  return static_cast<bool>(in_.read(&record->data[0], compressed_size));
 }
 
-bool ProtoStreamReader::eof() const { return in_.eof(); }
+bool ProtoStreamReader::HasKey(const string& key) const {
+  return offsets_.count(key) != 0;
+}
+
+bool ProtoStreamReader::eof() const {
+  return version_ == 2 ? reached_end_of_records_ : in_.eof();
+}
 
 }  // namespace io
 }  // namespace cartographer
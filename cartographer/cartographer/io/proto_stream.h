@@ -18,21 +18,31 @@
 #define CARTOGRAPHER_IO_PROTO_STREAM_H_
 
 #include <fstream>
+#include <set>
+#include <unordered_map>
 
 #include "cartographer/common/port.h"
+#include "cartographer/io/proto/proto_stream_index.pb.h"
 
 namespace cartographer {
 namespace io {
 
-// A simple writer of a compressed sequence of protocol buffer messages to a
-// file. The format is not intended to be compatible with any other format used
-// outside of Cartographer.
+// A simple writer of a sequence of protocol buffer messages to a file. The
+// format is not intended to be compatible with any other format used outside
+// of Cartographer.
 //
-// TODO(whess): Compress the file instead of individual messages for better
-// compression performance? Should we use LZ4?
+// Each message is stored as a record, which is compressed on its own. Messages
+// written with a key are listed in an index at the end of the file, so that
+// ProtoStreamReader can read them directly, without reading the records before
+// them.
 class ProtoStreamWriter {
  public:
-  ProtoStreamWriter(const string& filename);
+  // How each record is compressed. Storing records uncompressed makes files
+  // larger, but faster to read.
+  enum class Compression : uint8 { kNone = 0, kGzip = 1 };
+
+  explicit ProtoStreamWriter(const string& filename,
+                             Compression compression = Compression::kGzip);
   ~ProtoStreamWriter();
 
   ProtoStreamWriter(const ProtoStreamWriter&) = delete;
@@ -46,37 +56,104 @@ class ProtoStreamWriter {
     Write(uncompressed_data);
   }
 
-  // This should be called to check whether writing was successful.
+  // Like WriteProto(), but also adds the record to the index under 'key',
+  // which must be unique within the file.
+  template <typename MessageType>
+  void WriteProto(const string& key, const MessageType& proto) {
+    AddToIndex(key);
+    WriteProto(proto);
+  }
+
+  // Writes the index. This should be called to check whether writing was
+  // successful. Otherwise it is called on destruction.
   bool Close();
 
  private:
+  void AddToIndex(const string& key);
   void Write(const string& uncompressed_data);
 
   std::ofstream out_;
+  const Compression compression_;
+  std::set<string> keys_;
+  proto::ProtoStreamIndex index_;
 };
 
-// A reader of the format produced by ProtoStreamWriter.
+// A reader of the format produced by ProtoStreamWriter. It also reads files
+// written by earlier versions, which have no index.
 class ProtoStreamReader {
  public:
-  ProtoStreamReader(const string& filename);
+  // A record as it is stored in the file, i.e. still compressed. Parsing it
+  // does not need the reader, so it can be done on another thread.
+  struct CompressedRecord {
+    ProtoStreamWriter::Compression compression;
+    string data;
+  };
+
+  explicit ProtoStreamReader(const string& filename);
   ~ProtoStreamReader();
 
   ProtoStreamReader(const ProtoStreamReader&) = delete;
   ProtoStreamReader& operator=(const ProtoStreamReader&) = delete;
 
+  // Reads the next message in the order they were written.
   template <typename MessageType>
   bool ReadProto(MessageType* proto) {
-    string decompressed_data;
-    return Read(&decompressed_data) &&
-           proto->ParseFromString(decompressed_data);
+    CompressedRecord record;
+    return ReadCompressedRecord(&record) &&
+           ParseCompressedRecord(record, proto);
+  }
+
+  // Reads the message that was written with 'key'. This seeks directly to its
+  // record and does not change which message ReadProto() reads next.
+  template <typename MessageType>
+  bool ReadProto(const string& key, MessageType* proto) {
+    CompressedRecord record;
+    return ReadCompressedRecord(key, &record) &&
+           ParseCompressedRecord(record, proto);
   }
 
+  // Like ReadProto(), but the message is only parsed later by
+  // ParseCompressedRecord().
+  bool ReadCompressedRecord(CompressedRecord* record);
+  bool ReadCompressedRecord(const string& key, CompressedRecord* record);
+
+  // Decompresses the 'record' and parses the message.
+  template <typename MessageType>
+  static bool ParseCompressedRecord(const CompressedRecord& record,
+                                    MessageType* proto) {
+    switch (record.compression) {
+      case ProtoStreamWriter::Compression::kNone:
+        return proto->ParseFromString(record.data);
+      case ProtoStreamWriter::Compression::kGzip: {
+        string decompressed_data;
+        common::FastGunzipString(record.data, &decompressed_data);
+        return proto->ParseFromString(decompressed_data);
+      }
+    }
+    return false;
+  }
+
+  // Returns true if the file has an index, which lists the messages that can
+  // be read by key.
+  bool has_index() const { return has_index_; }
+
+  // Returns true if a message was written with 'key'.
+  bool HasKey(const string& key) const;
+
   bool eof() const;
 
  private:
-  bool Read(string* decompressed_data);
+  bool ReadIndex();
+  bool ReadRecord(CompressedRecord* record);
 
   std::ifstream in_;
+  int version_ = 0;
+  bool has_index_ = false;
+  // Offset at which the index starts, i.e. the end of the records that are
+  // read sequentially.
+  size_t end_of_records_ = 0;
+  bool reached_end_of_records_ = false;
+  std::unordered_map<string, size_t> offsets_;
 };
 
 }  // namespace io
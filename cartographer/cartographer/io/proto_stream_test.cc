@@ -21,6 +21,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <fstream>
+#include <iterator>
+#include <vector>
+
 #include "cartographer/common/port.h"
 #include "cartographer/mapping/proto/trajectory.pb.h"
 #include "gtest/gtest.h"
@@ -67,6 +71,154 @@ TEST_F(ProtoStreamTest, WriteAndReadBack) {
   remove(test_file.c_str());
 }
 
+TEST_F(ProtoStreamTest, ReadByKey) {
+  const string test_file = test_directory_ + "/test_trajectory.pbstream";
+  for (const auto compression : {ProtoStreamWriter::Compression::kNone,
+                                 ProtoStreamWriter::Compression::kGzip}) {
+    {
+      ProtoStreamWriter writer(test_file, compression);
+      for (int i = 0; i != 10; ++i) {
+        mapping::proto::Trajectory trajectory;
+        trajectory.add_node()->set_timestamp(i);
+        if (i % 2 == 0) {
+          writer.WriteProto("node/" + std::to_string(i), trajectory);
+        } else {
+          writer.WriteProto(trajectory);
+        }
+      }
+      ASSERT_TRUE(writer.Close());
+    }
+    ProtoStreamReader reader(test_file);
+    EXPECT_TRUE(reader.has_index());
+    EXPECT_TRUE(reader.HasKey("node/4"));
+    EXPECT_FALSE(reader.HasKey("node/5"));
+    mapping::proto::Trajectory trajectory;
+    ASSERT_TRUE(reader.ReadProto(&trajectory));
+    EXPECT_EQ(0, trajectory.node(0).timestamp());
+    // Reading by key does not change the sequential position.
+    for (const int i : {8, 2, 6}) {
+      ASSERT_TRUE(reader.ReadProto("node/" + std::to_string(i), &trajectory));
+      ASSERT_EQ(1, trajectory.node_size());
+      EXPECT_EQ(i, trajectory.node(0).timestamp());
+    }
+    EXPECT_FALSE(reader.ReadProto("node/5", &trajectory));
+    for (int i = 1; i != 10; ++i) {
+      ASSERT_TRUE(reader.ReadProto(&trajectory));
+      EXPECT_EQ(i, trajectory.node(0).timestamp());
+    }
+    // The index is not read as a message.
+    EXPECT_FALSE(reader.ReadProto(&trajectory));
+    EXPECT_TRUE(reader.eof());
+  }
+  remove(test_file.c_str());
+}
+
+TEST_F(ProtoStreamTest, ParseCompressedRecordsLater) {
+  const string test_file = test_directory_ + "/test_trajectory.pbstream";
+  {
+    ProtoStreamWriter writer(test_file);
+    for (int i = 0; i != 3; ++i) {
+      mapping::proto::Trajectory trajectory;
+      trajectory.add_node()->set_timestamp(i);
+      writer.WriteProto("node/" + std::to_string(i), trajectory);
+    }
+    ASSERT_TRUE(writer.Close());
+  }
+  std::vector<ProtoStreamReader::CompressedRecord> records(4);
+  {
+    ProtoStreamReader reader(test_file);
+    ASSERT_TRUE(reader.ReadCompressedRecord("node/2", &records[0]));
+    for (int i = 1; i != 4; ++i) {
+      ASSERT_TRUE(reader.ReadCompressedRecord(&records[i]));
+    }
+    EXPECT_FALSE(reader.ReadCompressedRecord(&records[0]));
+    EXPECT_TRUE(reader.eof());
+  }
+  for (int i = 0; i != 4; ++i) {
+    mapping::proto::Trajectory trajectory;
+    ASSERT_TRUE(
+        ProtoStreamReader::ParseCompressedRecord(records[i], &trajectory));
+    ASSERT_EQ(1, trajectory.node_size());
+    EXPECT_EQ(i == 0 ? 2 : i - 1, trajectory.node(0).timestamp());
+  }
+  remove(test_file.c_str());
+}
+
+TEST_F(ProtoStreamTest, ReadFileWithoutIndex) {
+  // Files written before the index was added consist of a magic number and
+  // the sizes and gzipped data of the messages.
+  const string test_file = test_directory_ + "/test_trajectory.pbstream";
+  {
+    std::ofstream out(test_file, std::ios::out | std::ios::binary);
+    const auto write_size = [&out](size_t size) {
+      for (int i = 0; i != 8; ++i) {
+        out.put(size & 0xff);
+        size >>= 8;
+      }
+    };
+    write_size(0x7b1d1f7b5bf501db);
+    for (int i = 0; i != 3; ++i) {
+      mapping::proto::Trajectory trajectory;
+      trajectory.add_node()->set_timestamp(i);
+      string compressed_data;
+      common::FastGzipString(trajectory.SerializeAsString(), &compressed_data);
+      write_size(compressed_data.size());
+      out.write(compressed_data.data(), compressed_data.size());
+    }
+  }
+  ProtoStreamReader reader(test_file);
+  EXPECT_FALSE(reader.has_index());
+  mapping::proto::Trajectory trajectory;
+  for (int i = 0; i != 3; ++i) {
+    ASSERT_TRUE(reader.ReadProto(&trajectory));
+    EXPECT_EQ(i, trajectory.node(0).timestamp());
+  }
+  EXPECT_FALSE(reader.ReadProto(&trajectory));
+  EXPECT_TRUE(reader.eof());
+  remove(test_file.c_str());
+}
+
+TEST_F(ProtoStreamTest, ReadTruncatedFileWithoutIndex) {
+  const string test_file = test_directory_ + "/test_trajectory.pbstream";
+  size_t size_without_last_record = 8;
+  size_t last_record_size = 0;
+  {
+    ProtoStreamWriter writer(test_file, ProtoStreamWriter::Compression::kNone);
+    for (int i = 0; i != 3; ++i) {
+      mapping::proto::Trajectory trajectory;
+      trajectory.add_node()->set_timestamp(i);
+      writer.WriteProto(trajectory);
+      // Each record has its size, compression and data.
+      size_without_last_record += last_record_size;
+      last_record_size = 9 + trajectory.ByteSize();
+    }
+    ASSERT_TRUE(writer.Close());
+  }
+  // Cuts the file in the middle of the last record, as if writing stopped
+  // before the index was written.
+  string data;
+  {
+    std::ifstream in(test_file, std::ios::in | std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+  }
+  ASSERT_GT(data.size(), size_without_last_record + last_record_size);
+  {
+    std::ofstream out(test_file, std::ios::out | std::ios::binary);
+    out.write(data.data(), size_without_last_record + last_record_size / 2);
+  }
+  ProtoStreamReader reader(test_file);
+  EXPECT_FALSE(reader.has_index());
+  mapping::proto::Trajectory trajectory;
+  for (int i = 0; i != 2; ++i) {
+    ASSERT_TRUE(reader.ReadProto(&trajectory));
+    EXPECT_EQ(i, trajectory.node(0).timestamp());
+  }
+  EXPECT_FALSE(reader.ReadProto(&trajectory));
+  EXPECT_TRUE(reader.eof());
+  remove(test_file.c_str());
+}
+
 }  // namespace
 }  // namespace io
 }  // namespace cartographer
@@ -17,12 +17,10 @@
 namespace cartographer {
 namespace kalman_filter {
 
-namespace {
-
 /*定义函数AddDelta,当前状态State加上delta.
 */
-PoseTracker::State AddDelta(const PoseTracker::State& state,
-                            const PoseTracker::State& delta) {
+PoseTracker::State PoseTracker::AddDelta::operator()(
+    const PoseTracker::State& state, const PoseTracker::State& delta) const {
   PoseTracker::State new_state = state + delta;
   const Eigen::Quaterniond orientation =
       transform::AngleAxisVectorToRotationQuaternion(
@@ -46,8 +44,8 @@ PoseTracker::State AddDelta(const PoseTracker::State& state,
 
 /*定义ComputeDelta()函数,计算State的差值delta
 */
-PoseTracker::State ComputeDelta(const PoseTracker::State& origin,
-                                const PoseTracker::State& target) {
+PoseTracker::State PoseTracker::ComputeDelta::operator()(
+    const PoseTracker::State& origin, const PoseTracker::State& target) const {
   PoseTracker::State delta = target - origin;
   const Eigen::Quaterniond origin_orientation =
       transform::AngleAxisVectorToRotationQuaternion(
@@ -68,6 +66,8 @@ PoseTracker::State ComputeDelta(const PoseTracker::State& origin,
   return delta;
 }
 
+namespace {
+
 // Build a model matrix for the given time delta.返回delta时间后的状态
 PoseTracker::State ModelFunction(const PoseTracker::State& state,
                                  const double delta_t) {
@@ -165,7 +165,7 @@ PoseTracker::PoseTracker(const proto::PoseTrackerOptions& options,
                          const common::Time time)
     : options_(options),
       time_(time),
-      kalman_filter_(KalmanFilterInit(), AddDelta, ComputeDelta),
+      kalman_filter_(KalmanFilterInit()),
       imu_tracker_(options.imu_gravity_time_constant(), time),
       odometry_state_tracker_(options.num_odometry_states()) {}
 
@@ -59,8 +59,19 @@ class PoseTracker {
     kDimension  //9, We terminate loops with this. 只追踪9个维度
   };
 
-  using KalmanFilter = UnscentedKalmanFilter<double, kDimension>;//9维的卡尔曼滤波
-  using State = KalmanFilter::StateType;                         //N*1矩阵
+  using State = Eigen::Matrix<double, kDimension, 1>;  // N*1矩阵
+
+  // Operations on states whose orientation is a rotation vector.
+  struct AddDelta {
+    State operator()(const State& state, const State& delta) const;
+  };
+  struct ComputeDelta {
+    State operator()(const State& origin, const State& target) const;
+  };
+
+  //9维的卡尔曼滤波
+  using KalmanFilter =
+      UnscentedKalmanFilter<double, kDimension, AddDelta, ComputeDelta>;
   using StateCovariance = Eigen::Matrix<double, kDimension, kDimension>;//9*9
   using Distribution = GaussianDistribution<double, kDimension>;
    //参数类型的double,9*1的矩阵
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the per-update latency of the PoseTracker, i.e. of the unscented
+// Kalman filter driven by simulated IMU data and pose observations from scan
+// matching as in the local trajectory builder.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "Eigen/Geometry"
+#include "cartographer/common/port.h"
+#include "cartographer/common/time.h"
+#include "cartographer/kalman_filter/pose_tracker.h"
+#include "cartographer/transform/rigid_transform.h"
+#include "cartographer/transform/transform.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_double(imu_frequency, 400., "Frequency of the simulated IMU in Hz.");
+DEFINE_double(pose_frequency, 10.,
+              "Frequency of the simulated pose observations in Hz.");
+DEFINE_double(duration, 60., "Simulated time in seconds.");
+
+namespace cartographer {
+namespace kalman_filter {
+namespace {
+
+// The options used by the 2D local trajectory builder.
+proto::PoseTrackerOptions CreatePoseTrackerOptions() {
+  proto::PoseTrackerOptions options;
+  options.set_position_model_variance(1e-8);
+  options.set_orientation_model_variance(1e-8);
+  options.set_velocity_model_variance(1e-8);
+  options.set_imu_gravity_time_constant(100.);
+  options.set_imu_gravity_variance(1e-9);
+  options.set_num_odometry_states(1);
+  return options;
+}
+
+// The robot drives along a circle with a radius of 5 m at 1 m/s.
+transform::Rigid3d SimulatePose(const double seconds) {
+  constexpr double kRadius = 5.;
+  const double angle = seconds / kRadius;
+  return transform::Rigid3d(
+      kRadius * Eigen::Vector3d(std::sin(angle), 1. - std::cos(angle), 0.),
+      transform::RollPitchYaw(0., 0., angle));
+}
+
+class LatencyStats {
+ public:
+  template <typename Function>
+  void Time(const Function& function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    seconds_ +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+    ++count_;
+  }
+
+  void Print(const string& name) const {
+    std::cout << name << ": " << std::fixed << std::setprecision(3)
+              << 1e6 * seconds_ / count_ << " us per update, " << count_
+              << " updates\n";
+  }
+
+ private:
+  double seconds_ = 0.;
+  int64 count_ = 0;
+};
+
+void Run() {
+  const common::Time start_time = common::FromUniversal(0);
+  PoseTracker pose_tracker(CreatePoseTrackerOptions(), start_time);
+  const Eigen::Vector3d gravity(0., 0., 9.81);
+  const Eigen::Vector3d angular_velocity(0., 0., 0.2);
+  const int num_imu_updates = FLAGS_duration * FLAGS_imu_frequency;
+  const int imu_updates_per_pose = std::max<int>(
+      1, std::lround(FLAGS_imu_frequency / FLAGS_pose_frequency));
+  LatencyStats imu_stats;
+  LatencyStats pose_stats;
+  for (int i = 1; i <= num_imu_updates; ++i) {
+    const double seconds = i / FLAGS_imu_frequency;
+    const common::Time time = start_time + common::FromSeconds(seconds);
+    const transform::Rigid3d pose = SimulatePose(seconds);
+    imu_stats.Time([&]() {
+      pose_tracker.AddImuLinearAccelerationObservation(time, gravity,
+                                                       pose.rotation());
+      pose_tracker.AddImuAngularVelocityObservation(time, angular_velocity);
+    });
+    if (i % imu_updates_per_pose == 0) {
+      pose_stats.Time([&]() {
+        pose_tracker.AddPoseObservation(
+            time, pose, BuildPoseCovariance(1e-4, 1e-4));
+      });
+    }
+  }
+  imu_stats.Print("IMU");
+  pose_stats.Print("Pose");
+}
+
+}  // namespace
+}  // namespace kalman_filter
+}  // namespace cartographer
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  google::SetUsageMessage(
+      "\n\n"
+      "Benchmarks the per-update latency of the pose tracker for simulated\n"
+      "IMU data and pose observations.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_GT(FLAGS_imu_frequency, 0.);
+  CHECK_GT(FLAGS_pose_frequency, 0.);
+  CHECK_GT(FLAGS_duration, 0.);
+  ::cartographer::kalman_filter::Run();
+}
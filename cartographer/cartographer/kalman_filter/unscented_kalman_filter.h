@@ -3,9 +3,8 @@
 #define CARTOGRAPHER_KALMAN_FILTER_UNSCENTED_KALMAN_FILTER_H_
 
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <functional>
-#include <vector>
 
 #include "Eigen/Cholesky"
 #include "Eigen/Core"
@@ -82,6 +81,40 @@ Eigen::Matrix<FloatType, N, N> MatrixSqrt(
          adjoint_eigen_solver.eigenvectors().transpose();
 }
 
+// Returns a matrix 'L' with L * L^T = 'A' for a symmetric positive semidefinite
+// matrix 'A'. This is all that is needed to spread sigma points. The Cholesky
+// decomposition is used if 'A' is positive definite since it is much cheaper
+// than an eigendecomposition, otherwise this falls back to MatrixSqrt().
+template <typename FloatType, int N>
+Eigen::Matrix<FloatType, N, N> CholeskyOrMatrixSqrt(
+    const Eigen::Matrix<FloatType, N, N>& A) {
+  CheckSymmetric(A);
+  const Eigen::LLT<Eigen::Matrix<FloatType, N, N>> llt(A);
+  if (llt.info() == Eigen::Success) {
+    return llt.matrixL();
+  }
+  return MatrixSqrt(A);
+}
+
+// Default operations on states which live in a vector space.
+template <typename FloatType, int N>
+struct VectorSpaceAddDelta {
+  Eigen::Matrix<FloatType, N, 1> operator()(
+      const Eigen::Matrix<FloatType, N, 1>& state,
+      const Eigen::Matrix<FloatType, N, 1>& delta) const {
+    return state + delta;
+  }
+};
+
+template <typename FloatType, int N>
+struct VectorSpaceComputeDelta {
+  Eigen::Matrix<FloatType, N, 1> operator()(
+      const Eigen::Matrix<FloatType, N, 1>& origin,
+      const Eigen::Matrix<FloatType, N, 1>& target) const {
+    return target - origin;
+  }
+};
+
 /*
 无损卡尔曼滤波
 对于雷达来说，人们感兴趣的是其能够跟踪目标。但目标的位置、速度、加速度的测量值往往在任何时候都有噪声。
@@ -113,30 +146,29 @@ Extended to handle non-additive noise/sensors inspired by Kraft, E., A
 Quaternion-based Unscented Kalman Filter for Orientation Tracking.
 
 */
-template <typename FloatType, int N>
+// The state operations and models are template parameters instead of
+// std::functions, and the sigma points are kept in std::arrays, so that a
+// filter step neither allocates nor calls through type erasure. This matters
+// since the filter runs at IMU rate.
+template <typename FloatType, int N,
+          typename AddDeltaType = VectorSpaceAddDelta<FloatType, N>,
+          typename ComputeDeltaType = VectorSpaceComputeDelta<FloatType, N>>
 class UnscentedKalmanFilter {
  public:
   using StateType = Eigen::Matrix<FloatType, N, 1>;           //状态矩阵N*1
   using StateCovarianceType = Eigen::Matrix<FloatType, N, N>; //协方差矩阵N*N
+  using SigmaPoints = std::array<StateType, 2 * N + 1>;
 
 /*
 构造函数,
 参数1,N*1矩阵,
-参数2,stl函数对象 add_delta(默认),
-参数3,stl函数对象 compute_delta(默认),
+参数2,函数对象 add_delta(默认),
+参数3,函数对象 compute_delta(默认),
 */
   explicit UnscentedKalmanFilter(
-      const GaussianDistribution<FloatType, N>& initial_belief,                 //参数1
-
-      std::function<StateType(const StateType& state, const StateType& delta)>  //参数2
-          add_delta = [](const StateType& state,
-                         const StateType& delta) { return state + delta; },
-
-      std::function<StateType(const StateType& origin, const StateType& target)> //参数3
-          compute_delta =
-              [](const StateType& origin, const StateType& target) {
-                return target - origin;
-              })
+      const GaussianDistribution<FloatType, N>& initial_belief,
+      AddDeltaType add_delta = AddDeltaType(),
+      ComputeDeltaType compute_delta = ComputeDeltaType())
       : belief_(initial_belief),
         add_delta_(add_delta),
         compute_delta_(compute_delta) {}
@@ -151,17 +183,18 @@ class UnscentedKalmanFilter {
   // Does the control/prediction step for the filter. The control must be
   // implicitly added by the function g which also does the state transition.
   // 'epsilon' is the additive combination of control and model noise.
-  void Predict(std::function<StateType(const StateType&)> g,
+  template <typename PredictionModel>
+  void Predict(const PredictionModel& g,
                const GaussianDistribution<FloatType, N>& epsilon) {
     CheckSymmetric(epsilon.GetCovariance());
 
     // Get the state mean and matrix root of its covariance.
     const StateType& mu = belief_.GetMean();
-    const StateCovarianceType sqrt_sigma = MatrixSqrt(belief_.GetCovariance());//N*N
+    const StateCovarianceType sqrt_sigma =
+        CholeskyOrMatrixSqrt(belief_.GetCovariance());  // N*N
 
-    std::vector<StateType> Y;//需要计算的状态矩阵，N*1矩阵。
-    Y.reserve(2 * N + 1);//公式：p65
-    Y.emplace_back(g(mu));//状态转移方程,公式p65:3.68,p70:3
+    SigmaPoints Y;  //需要计算的状态矩阵，N*1矩阵。公式：p65
+    Y[0] = g(mu);   //状态转移方程,公式p65:3.68,p70:3
 /*
 按照公式p65,3.66计算：
 1),mu是u,
@@ -175,8 +208,9 @@ class UnscentedKalmanFilter {
     for (int i = 0; i < N; ++i) {
       // Order does not matter here as all have the same weights in the
       // summation later on anyways.
-      Y.emplace_back(g(add_delta_(mu, kSqrtNPlusLambda * sqrt_sigma.col(i))));
-      Y.emplace_back(g(add_delta_(mu, -kSqrtNPlusLambda * sqrt_sigma.col(i))));
+      const StateType scaled_column = kSqrtNPlusLambda * sqrt_sigma.col(i);
+      Y[2 * i + 1] = g(add_delta_(mu, scaled_column));
+      Y[2 * i + 2] = g(add_delta_(mu, -scaled_column));
     }
     const StateType new_mu = ComputeMean(Y);
 
@@ -212,38 +246,36 @@ class UnscentedKalmanFilter {
   // into an observation that should be zero, i.e., the sensor readings should
   // be included in this function already. 'delta' is the measurement noise and
   // must have zero mean.
-  template <int K>
-  void Observe(
-      std::function<Eigen::Matrix<FloatType, K, 1>(const StateType&)> h,
-      const GaussianDistribution<FloatType, K>& delta) {
+  template <int K, typename ObservationModel>
+  void Observe(const ObservationModel& h,
+               const GaussianDistribution<FloatType, K>& delta) {
     CheckSymmetric(delta.GetCovariance());
     // We expect zero mean delta.
     CHECK_NEAR(delta.GetMean().norm(), 0., 1e-9);
 
     // Get the state mean and matrix root of its covariance.
     const StateType& mu = belief_.GetMean();
-    const StateCovarianceType sqrt_sigma = MatrixSqrt(belief_.GetCovariance());
+    const StateCovarianceType sqrt_sigma =
+        CholeskyOrMatrixSqrt(belief_.GetCovariance());
 
     // As in Kraft's paper, we compute W containing the zero-mean sigma points,
     // since this is all we need.
-    std::vector<StateType> W;
-    W.reserve(2 * N + 1);
-    W.emplace_back(StateType::Zero());
+    SigmaPoints W;
+    W[0] = StateType::Zero();
 
-    std::vector<Eigen::Matrix<FloatType, K, 1>> Z;
-    Z.reserve(2 * N + 1);
-    Z.emplace_back(h(mu));
+    std::array<Eigen::Matrix<FloatType, K, 1>, 2 * N + 1> Z;
+    Z[0] = h(mu);
 
     Eigen::Matrix<FloatType, K, 1> z_hat = kMeanWeight0 * Z[0];
     const FloatType kSqrtNPlusLambda = std::sqrt(N + kLambda);
     for (int i = 0; i < N; ++i) {
       // Order does not matter here as all have the same weights in the
       // summation later on anyways.
-      W.emplace_back(kSqrtNPlusLambda * sqrt_sigma.col(i));
-      Z.emplace_back(h(add_delta_(mu, W.back())));
+      W[2 * i + 1] = kSqrtNPlusLambda * sqrt_sigma.col(i);
+      Z[2 * i + 1] = h(add_delta_(mu, W[2 * i + 1]));
 
-      W.emplace_back(-kSqrtNPlusLambda * sqrt_sigma.col(i));
-      Z.emplace_back(h(add_delta_(mu, W.back())));
+      W[2 * i + 2] = -kSqrtNPlusLambda * sqrt_sigma.col(i);
+      Z[2 * i + 2] = h(add_delta_(mu, W[2 * i + 2]));
 
       z_hat += kMeanWeightI * Z[2 * i + 1];
       z_hat += kMeanWeightI * Z[2 * i + 2];
@@ -284,7 +316,7 @@ class UnscentedKalmanFilter {
  private:
   //计算带权重的偏差
   StateType ComputeWeightedError(const StateType& mean_estimate,
-                                 const std::vector<StateType>& states) {
+                                 const SigmaPoints& states) {
     StateType weighted_error =
         kMeanWeight0 * compute_delta_(mean_estimate, states[0]);
     for (int i = 1; i != 2 * N + 1; ++i) {
@@ -296,8 +328,7 @@ class UnscentedKalmanFilter {
   // Algorithm for computing the mean of non-additive states taken from Kraft's
   // Section 3.4, adapted to our implementation.
   //计算均值
-  StateType ComputeMean(const std::vector<StateType>& states) {
-    CHECK_EQ(states.size(), 2 * N + 1);
+  StateType ComputeMean(const SigmaPoints& states) {
     StateType current_estimate = states[0];
     StateType weighted_error = ComputeWeightedError(current_estimate, states);
     int iterations = 0;
@@ -337,31 +368,44 @@ class UnscentedKalmanFilter {
 //1),N*1矩阵,对N个变量的估计
   GaussianDistribution<FloatType, N> belief_; 
 //2),add_delta_，加法操作
-  const std::function<StateType(const StateType& state, const StateType& delta)>
-      add_delta_;
+  const AddDeltaType add_delta_;
 //3),compute_delta_，计算偏差操作
-  const std::function<StateType(const StateType& origin,
-                                const StateType& target)>
-      compute_delta_;
+  const ComputeDeltaType compute_delta_;
 };
 
 //外部声明。
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kAlpha;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kKappa;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kBeta;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kLambda;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kMeanWeight0;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kCovWeight0;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kMeanWeightI;
-template <typename FloatType, int N>
-constexpr FloatType UnscentedKalmanFilter<FloatType, N>::kCovWeightI;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kAlpha;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kKappa;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kBeta;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kLambda;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kMeanWeight0;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kCovWeight0;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kMeanWeightI;
+template <typename FloatType, int N, typename AddDeltaType,
+          typename ComputeDeltaType>
+constexpr FloatType UnscentedKalmanFilter<FloatType, N, AddDeltaType,
+                                          ComputeDeltaType>::kCovWeightI;
 
 }  // namespace kalman_filter
 }  // namespace cartographer
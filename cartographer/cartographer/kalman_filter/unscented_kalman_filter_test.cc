@@ -83,6 +83,22 @@ TEST(KalmanFilterTest, testObserve) {
   EXPECT_NEAR(filter.GetBelief().GetMean()[1], 5, 1e-2);
 }
 
+TEST(KalmanFilterTest, CholeskyOrMatrixSqrt) {
+  Eigen::Matrix3d positive_definite;
+  positive_definite << 4., 1., 0.5, 1., 3., 0.2, 0.5, 0.2, 2.;
+  const Eigen::Matrix3d cholesky = CholeskyOrMatrixSqrt(positive_definite);
+  EXPECT_TRUE(
+      (cholesky * cholesky.transpose()).isApprox(positive_definite, 1e-12));
+
+  // A singular matrix has no Cholesky decomposition, so the eigendecomposition
+  // is used instead.
+  const Eigen::Vector3d v(1., 2., 3.);
+  const Eigen::Matrix3d positive_semidefinite = v * v.transpose();
+  const Eigen::Matrix3d sqrt = CholeskyOrMatrixSqrt(positive_semidefinite);
+  EXPECT_TRUE(
+      (sqrt * sqrt.transpose()).isApprox(positive_semidefinite, 1e-9));
+}
+
 }  // namespace
 }  // namespace kalman_filter
 }  // namespace cartographer
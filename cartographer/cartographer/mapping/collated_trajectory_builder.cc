@@ -80,19 +80,19 @@ void CollatedTrajectoryBuilder::HandleCollatedSensorData(
   switch (data->type) {
     case sensor::Data::Type::kImu:
       wrapped_trajectory_builder_->AddImuData(data->time,
-                                              data->imu.linear_acceleration,
-                                              data->imu.angular_velocity,
-                                              data->imu.orientiation); //mnf
+                                              data->imu().linear_acceleration,
+                                              data->imu().angular_velocity,
+                                              data->imu().orientiation); //mnf
       return;
 
     case sensor::Data::Type::kRangefinder:
       wrapped_trajectory_builder_->AddRangefinderData(
-          data->time, data->rangefinder.origin, data->rangefinder.ranges);
+          data->time, data->rangefinder().origin, data->rangefinder().ranges);
       return;
 
     case sensor::Data::Type::kOdometer:
       wrapped_trajectory_builder_->AddOdometerData(data->time,
-                                                   data->odometer_pose);
+                                                   data->odometer_pose());
       return;
   }
   LOG(FATAL);
@@ -16,15 +16,20 @@
 
 #include "cartographer/mapping/map_builder.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "cartographer/common/make_unique.h"
 #include "cartographer/mapping/collated_trajectory_builder.h"
 #include "cartographer/mapping_2d/global_trajectory_builder.h"
+#include "cartographer/mapping_2d/sparse_pose_graph/constraint_builder.h"
 #include "cartographer/mapping_3d/global_trajectory_builder.h"
 #include "cartographer/sensor/range_data.h"
 #include "cartographer/sensor/voxel_filter.h"
@@ -35,6 +40,238 @@
 namespace cartographer {
 namespace mapping {
 
+namespace {
+
+// Keys of the records in the index of a serialized state.
+constexpr char kPoseGraphKey[] = "pose_graph";
+
+string SubmapKey(const int trajectory_id, const int submap_index) {
+  return "submap/" + std::to_string(trajectory_id) + "/" +
+         std::to_string(submap_index);
+}
+
+string RangeDataKey(const int trajectory_id, const int node_index) {
+  return "range_data/" + std::to_string(trajectory_id) + "/" +
+         std::to_string(node_index);
+}
+
+double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Decodes the records of submaps on the thread pool while further records are
+// read. 2D submaps are also constructed there, and if requested their
+// precomputation grids are computed.
+class ParallelSubmapLoader {
+ public:
+  // Submaps are constructed on the thread pool if the 'sparse_pose_graph_2d'
+  // is given. Otherwise, they are added to the pose graph from their protos.
+  ParallelSubmapLoader(const proto::MapBuilderOptions& options,
+                       mapping_2d::SparsePoseGraph* const sparse_pose_graph_2d,
+                       common::ThreadPool* const thread_pool)
+      : precompute_(options.precompute_loaded_submaps()),
+        fast_correlative_scan_matcher_options_(
+            options.sparse_pose_graph_options()
+                .constraint_builder_options()
+                .fast_correlative_scan_matcher_options()),
+        max_num_pending_(kMaxNumPendingTasksPerThread *
+                         std::max(1, options.num_background_threads())),
+        sparse_pose_graph_2d_(sparse_pose_graph_2d),
+        thread_pool_(thread_pool),
+        state_(std::make_shared<State>()) {}
+
+  // Schedules decoding the 'record' of the submap at 'pose', whose contents
+  // are taken, and the construction of the submap.
+  void Schedule(const transform::Rigid3d& pose,
+                io::ProtoStreamReader::CompressedRecord* const record) {
+    const auto loaded_submap = std::make_shared<LoadedSubmap>();
+    loaded_submap->pose = pose;
+    loaded_submaps_.push_back(loaded_submap);
+    const auto taken_record = TakeRecord(record);
+    const auto construct = GetConstructFunction();
+    ScheduleTask([taken_record, construct, loaded_submap]() {
+      std::shared_ptr<proto::Submap> submap_proto = Decode(*taken_record);
+      CHECK(submap_proto != nullptr) << "Record is not a submap.";
+      construct(submap_proto, loaded_submap.get());
+    });
+  }
+
+  // Like Schedule(), but for a submap which was already decoded.
+  void Schedule(const transform::Rigid3d& pose,
+                const std::shared_ptr<proto::Submap>& submap_proto) {
+    const auto loaded_submap = std::make_shared<LoadedSubmap>();
+    loaded_submap->pose = pose;
+    loaded_submaps_.push_back(loaded_submap);
+    const auto construct = GetConstructFunction();
+    ScheduleTask([submap_proto, construct, loaded_submap]() {
+      construct(submap_proto, loaded_submap.get());
+    });
+  }
+
+  // Schedules decoding a 'record' which is not known to be a submap, as read
+  // from files without an index. Its contents are taken.
+  void ScheduleDecoding(io::ProtoStreamReader::CompressedRecord* const record) {
+    const auto decoded_submap =
+        std::make_shared<std::shared_ptr<proto::Submap>>();
+    decoded_submaps_.push_back(decoded_submap);
+    const auto taken_record = TakeRecord(record);
+    ScheduleTask([taken_record, decoded_submap]() {
+      *decoded_submap = Decode(*taken_record);
+    });
+  }
+
+  // Waits until the records scheduled by ScheduleDecoding() are decoded and
+  // returns the submaps among them in the order they were scheduled.
+  std::vector<std::shared_ptr<proto::Submap>> TakeDecodedSubmaps() {
+    WaitForPendingTasks();
+    std::vector<std::shared_ptr<proto::Submap>> result;
+    for (const auto& decoded_submap : decoded_submaps_) {
+      if (*decoded_submap != nullptr) {
+        result.push_back(std::move(*decoded_submap));
+      }
+    }
+    decoded_submaps_.clear();
+    return result;
+  }
+
+  // Waits until all submaps are constructed and adds them to the
+  // 'sparse_pose_graph' in the order they were scheduled. Returns the number
+  // of submaps added.
+  int AddToSparsePoseGraph(const int trajectory_id,
+                           mapping::SparsePoseGraph* const sparse_pose_graph) {
+    WaitForPendingTasks();
+    int num_submaps = 0;
+    for (const auto& loaded_submap : loaded_submaps_) {
+      if (loaded_submap->submap_2d != nullptr) {
+        sparse_pose_graph_2d_->AddSubmap(trajectory_id, loaded_submap->pose,
+                                         loaded_submap->submap_2d);
+        ++num_submaps;
+      } else if (loaded_submap->submap_proto != nullptr) {
+        sparse_pose_graph->AddSubmapFromProto(
+            trajectory_id, loaded_submap->pose, *loaded_submap->submap_proto);
+        ++num_submaps;
+      }
+    }
+    loaded_submaps_.clear();
+    return num_submaps;
+  }
+
+ private:
+  // Bounds the records held in memory while they wait for a thread.
+  static constexpr int kMaxNumPendingTasksPerThread = 4;
+
+  // Once constructed, either the 'submap_2d' is set, or for 3D pose graphs
+  // the 'submap_proto'. Neither is set for 3D submaps in a 2D pose graph.
+  struct LoadedSubmap {
+    transform::Rigid3d pose;
+    std::shared_ptr<const mapping_2d::Submap> submap_2d;
+    std::shared_ptr<const proto::Submap> submap_proto;
+  };
+
+  // Shared with the work items, which may still hold it while the loader is
+  // destroyed.
+  struct State {
+    common::Mutex mutex;
+    int num_pending GUARDED_BY(mutex) = 0;
+  };
+
+  using ConstructFunction = std::function<void(
+      const std::shared_ptr<proto::Submap>& submap_proto, LoadedSubmap*)>;
+
+  static std::shared_ptr<io::ProtoStreamReader::CompressedRecord> TakeRecord(
+      io::ProtoStreamReader::CompressedRecord* const record) {
+    return std::make_shared<io::ProtoStreamReader::CompressedRecord>(
+        std::move(*record));
+  }
+
+  // Returns the submap in the 'record', or nullptr if it contains other data.
+  static std::shared_ptr<proto::Submap> Decode(
+      const io::ProtoStreamReader::CompressedRecord& record) {
+    proto::SerializedData proto;
+    CHECK(io::ProtoStreamReader::ParseCompressedRecord(record, &proto))
+        << "Failed to parse record.";
+    if (!proto.has_submap()) {
+      return nullptr;
+    }
+    const auto submap_proto = std::make_shared<proto::Submap>();
+    submap_proto->Swap(proto.mutable_submap());
+    return submap_proto;
+  }
+
+  // Returns the function run on the thread pool to construct a decoded submap.
+  // It only captures copies, since the loader may be destroyed first.
+  ConstructFunction GetConstructFunction() const {
+    const bool construct_2d = sparse_pose_graph_2d_ != nullptr;
+    const bool precompute = precompute_;
+    const auto& options = fast_correlative_scan_matcher_options_;
+    const std::shared_ptr<State> state = state_;
+    return [construct_2d, precompute, options, state](
+               const std::shared_ptr<proto::Submap>& submap_proto,
+               LoadedSubmap* const loaded_submap) {
+      if (!construct_2d) {
+        common::MutexLocker locker(&state->mutex);
+        loaded_submap->submap_proto = submap_proto;
+        return;
+      }
+      if (!submap_proto->has_submap_2d()) {
+        return;
+      }
+      auto submap =
+          std::make_shared<const mapping_2d::Submap>(submap_proto->submap_2d());
+      if (precompute && submap->finished()) {
+        // Computes the grids sequentially, since other submaps are loaded in
+        // parallel.
+        mapping_2d::sparse_pose_graph::GetPrecomputationGridStack(
+            *submap, options, nullptr /* thread_pool */);
+      }
+      common::MutexLocker locker(&state->mutex);
+      loaded_submap->submap_2d = std::move(submap);
+    };
+  }
+
+  // Runs the 'task' on the thread pool once fewer than 'max_num_pending_'
+  // tasks are pending.
+  void ScheduleTask(const std::function<void()>& task) {
+    {
+      common::MutexLocker locker(&state_->mutex);
+      locker.Await([this]() REQUIRES(state_->mutex) {
+        return state_->num_pending < max_num_pending_;
+      });
+      ++state_->num_pending;
+    }
+    const std::shared_ptr<State> state = state_;
+    thread_pool_->Schedule([state, task]() {
+      task();
+      common::MutexLocker locker(&state->mutex);
+      --state->num_pending;
+    });
+  }
+
+  void WaitForPendingTasks() {
+    common::MutexLocker locker(&state_->mutex);
+    locker.Await([this]() REQUIRES(state_->mutex) {
+      return state_->num_pending == 0;
+    });
+  }
+
+  const bool precompute_;
+  const mapping_2d::scan_matching::proto::FastCorrelativeScanMatcherOptions
+      fast_correlative_scan_matcher_options_;
+  const int max_num_pending_;
+  mapping_2d::SparsePoseGraph* const sparse_pose_graph_2d_;
+  common::ThreadPool* const thread_pool_;
+  const std::shared_ptr<State> state_;
+  std::vector<std::shared_ptr<LoadedSubmap>> loaded_submaps_;
+  std::vector<std::shared_ptr<std::shared_ptr<proto::Submap>>>
+      decoded_submaps_;
+};
+
+constexpr int ParallelSubmapLoader::kMaxNumPendingTasksPerThread;
+
+}  // namespace
+
 proto::MapBuilderOptions CreateMapBuilderOptions(
     common::LuaParameterDictionary* const parameter_dictionary) {
   proto::MapBuilderOptions options;
@@ -46,6 +283,8 @@ proto::MapBuilderOptions CreateMapBuilderOptions(
       parameter_dictionary->GetNonNegativeInt("num_background_threads"));
   *options.mutable_sparse_pose_graph_options() = CreateSparsePoseGraphOptions(
       parameter_dictionary->GetDictionary("sparse_pose_graph").get());
+  options.set_precompute_loaded_submaps(
+      parameter_dictionary->GetBool("precompute_loaded_submaps"));
   CHECK_NE(options.use_trajectory_builder_2d(),
            options.use_trajectory_builder_3d());
   return options;
@@ -142,7 +381,7 @@ string MapBuilder::SubmapToProto(const mapping::SubmapId& submap_id,
 
 void MapBuilder::SerializeState(io::ProtoStreamWriter* const writer) {
   // We serialize the pose graph followed by all the data referenced in it.
-  writer->WriteProto(sparse_pose_graph_->ToProto());
+  writer->WriteProto(kPoseGraphKey, sparse_pose_graph_->ToProto());
   // Next we serialize all submap data.
   {
     const auto submap_data = sparse_pose_graph_->GetAllSubmapData();
@@ -160,7 +399,7 @@ void MapBuilder::SerializeState(io::ProtoStreamWriter* const writer) {
         submap_data[trajectory_id][submap_index].submap->ToProto(submap_proto);
         // TODO(whess): Only enable optionally? Resulting pbstream files will be
         // a lot larger now.
-        writer->WriteProto(proto);
+        writer->WriteProto(SubmapKey(trajectory_id, submap_index), proto);
       }
     }
   }
@@ -184,14 +423,16 @@ void MapBuilder::SerializeState(io::ProtoStreamWriter* const writer) {
                 data.tracking_to_pose.inverse().cast<float>())));
         // TODO(whess): Only enable optionally? Resulting pbstream files will be
         // a lot larger now.
-        writer->WriteProto(proto);
+        writer->WriteProto(RangeDataKey(trajectory_id, node_index), proto);
       }
     }
     // TODO(whess): Serialize additional sensor data: IMU, odometry.
   }
 }
 
-void MapBuilder::LoadMap(io::ProtoStreamReader* const reader) {
+void MapBuilder::LoadMap(io::ProtoStreamReader* const reader,
+                         const SubmapFilter& submap_filter) {
+  const auto start_time = std::chrono::steady_clock::now();
   proto::SparsePoseGraph pose_graph;
   CHECK(reader->ReadProto(&pose_graph));
 
@@ -211,21 +452,69 @@ void MapBuilder::LoadMap(io::ProtoStreamReader* const reader) {
   FinishTrajectory(map_trajectory_id);
   sparse_pose_graph_->FreezeTrajectory(map_trajectory_id);
 
-  for (;;) {
-    proto::SerializedData proto;
-    if (!reader->ReadProto(&proto)) {
-      break;
+  const auto get_submap_pose = [&pose_graph](const SubmapId& submap_id) {
+    return transform::ToRigid3(pose_graph.trajectory(submap_id.trajectory_id)
+                                   .submap(submap_id.submap_index)
+                                   .pose());
+  };
+
+  ParallelSubmapLoader parallel_submap_loader(
+      options_, sparse_pose_graph_2d_.get(), &thread_pool_);
+  int num_skipped_submaps = 0;
+  if (reader->has_index()) {
+    // Only the records of the submaps that are loaded are read.
+    for (int trajectory_id = 0; trajectory_id != pose_graph.trajectory_size();
+         ++trajectory_id) {
+      for (int submap_index = 0;
+           submap_index != pose_graph.trajectory(trajectory_id).submap_size();
+           ++submap_index) {
+        const SubmapId submap_id{trajectory_id, submap_index};
+        const transform::Rigid3d submap_pose = get_submap_pose(submap_id);
+        if (submap_filter != nullptr &&
+            !submap_filter(submap_id, submap_pose)) {
+          ++num_skipped_submaps;
+          continue;
+        }
+        io::ProtoStreamReader::CompressedRecord record;
+        CHECK(reader->ReadCompressedRecord(
+            SubmapKey(trajectory_id, submap_index), &record))
+            << "Submap " << submap_id << " is missing.";
+        parallel_submap_loader.Schedule(submap_pose, &record);
+      }
     }
-    if (proto.has_submap()) {
-      const transform::Rigid3d submap_pose = transform::ToRigid3(
-          pose_graph.trajectory(proto.submap().submap_id().trajectory_id())
-              .submap(proto.submap().submap_id().submap_index())
-              .pose());
-      sparse_pose_graph_->AddSubmapFromProto(map_trajectory_id, submap_pose,
-                                             proto.submap());
+  } else {
+    // Without an index, all records are decoded to find the submaps.
+    for (;;) {
+      io::ProtoStreamReader::CompressedRecord record;
+      if (!reader->ReadCompressedRecord(&record)) {
+        break;
+      }
+      parallel_submap_loader.ScheduleDecoding(&record);
+    }
+    CHECK(reader->eof());
+    for (const auto& submap_proto :
+         parallel_submap_loader.TakeDecodedSubmaps()) {
+      const SubmapId submap_id{submap_proto->submap_id().trajectory_id(),
+                               submap_proto->submap_id().submap_index()};
+      const transform::Rigid3d submap_pose = get_submap_pose(submap_id);
+      if (submap_filter == nullptr || submap_filter(submap_id, submap_pose)) {
+        parallel_submap_loader.Schedule(submap_pose, submap_proto);
+      } else {
+        ++num_skipped_submaps;
+      }
     }
   }
-  CHECK(reader->eof());
+
+  const double read_seconds = SecondsSince(start_time);
+  const int num_submaps = parallel_submap_loader.AddToSparsePoseGraph(
+      map_trajectory_id, sparse_pose_graph_);
+  LOG(INFO) << "Loaded " << num_submaps << " submaps and skipped "
+            << num_skipped_submaps << " in " << SecondsSince(start_time)
+            << " s, of which " << read_seconds << " s were spent reading "
+            << (reader->has_index() ? "by index" : "sequentially") << ". "
+            << (options_.precompute_loaded_submaps()
+                    ? "Precomputation grids were computed for all submaps."
+                    : "Precomputation grids were not computed.");
 }
 
 int MapBuilder::num_trajectory_builders() const {
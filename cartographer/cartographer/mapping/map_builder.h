@@ -17,6 +17,7 @@
 #ifndef CARTOGRAPHER_MAPPING_MAP_BUILDER_H_
 #define CARTOGRAPHER_MAPPING_MAP_BUILDER_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -38,6 +39,7 @@
 #include "cartographer/mapping_2d/sparse_pose_graph.h"
 #include "cartographer/mapping_3d/sparse_pose_graph.h"
 #include "cartographer/sensor/collator.h"
+#include "cartographer/transform/rigid_transform.h"
 
 namespace cartographer {
 namespace mapping {
@@ -81,8 +83,16 @@ class MapBuilder {
   // Serializes the current state to a proto stream.
   void SerializeState(io::ProtoStreamWriter* writer);
 
-  // Loads submaps from a proto stream into a new frozen trajectory.
-  void LoadMap(io::ProtoStreamReader* reader);
+  // Returns true if the submap with the given ID and global pose is to be
+  // loaded.
+  using SubmapFilter =
+      std::function<bool(const SubmapId&, const transform::Rigid3d&)>;
+
+  // Loads submaps from a proto stream into a new frozen trajectory. If a
+  // 'submap_filter' is given, only the submaps it accepts are loaded. If the
+  // proto stream has an index, only the records of these submaps are read.
+  void LoadMap(io::ProtoStreamReader* reader,
+               const SubmapFilter& submap_filter = nullptr);
 
   int num_trajectory_builders() const;
 
@@ -58,6 +58,28 @@ proto::SparsePoseGraphOptions CreateSparsePoseGraphOptions(
   return options;
 }
 
+SparsePoseGraph::SparsePoseGraph()
+    : snapshot_(std::make_shared<const Snapshot>()) {}
+
+std::shared_ptr<const SparsePoseGraph::Snapshot> SparsePoseGraph::GetSnapshot()
+    const {
+  return std::atomic_load(&snapshot_);
+}
+
+void SparsePoseGraph::PublishSnapshot(
+    std::vector<std::vector<TrajectoryNode>> trajectory_nodes,
+    std::vector<std::vector<SubmapData>> submap_data,
+    std::vector<Constraint> constraints) {
+  auto snapshot = std::make_shared<Snapshot>();
+  // Only this thread stores to 'snapshot_', so it can be read non-atomically.
+  snapshot->version = snapshot_->version + 1;
+  snapshot->trajectory_nodes = std::move(trajectory_nodes);
+  snapshot->submap_data = std::move(submap_data);
+  snapshot->constraints = std::move(constraints);
+  std::atomic_store(&snapshot_,
+                    std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
 proto::SparsePoseGraph SparsePoseGraph::ToProto() {
   proto::SparsePoseGraph proto;
 
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/port.h"
 #include "cartographer/mapping/id.h"
 #include "cartographer/mapping/pose_graph_trimmer.h"
 #include "cartographer/mapping/proto/serialization.pb.h"
@@ -68,7 +69,19 @@ class SparsePoseGraph {
     transform::Rigid3d pose;
   };
 
-  SparsePoseGraph() {}
+  // An immutable copy of the optimized pose graph. A new one is published
+  // after each optimization, so submaps added since, including those of a
+  // loaded map, only appear with the next one.
+  struct Snapshot {
+    // Increases with each published snapshot, starting at 0 for the empty
+    // graph.
+    int64 version = 0;
+    std::vector<std::vector<TrajectoryNode>> trajectory_nodes;
+    std::vector<std::vector<SubmapData>> submap_data;
+    std::vector<Constraint> constraints;
+  };
+
+  SparsePoseGraph();
   virtual ~SparsePoseGraph() {}
 
   SparsePoseGraph(const SparsePoseGraph&) = delete;
@@ -116,6 +129,23 @@ class SparsePoseGraph {
 
   // Returns the collection of constraints.
   virtual std::vector<Constraint> constraints() = 0;
+
+  // Returns the most recently published snapshot. Unlike the methods above,
+  // this does not wait for the pose graph to be unlocked, which makes it
+  // suitable for frequent queries like visualization. Never returns nullptr.
+  std::shared_ptr<const Snapshot> GetSnapshot() const;
+
+ protected:
+  // Publishes the given data as the next snapshot. Must not be called
+  // concurrently, e.g. only with the pose graph locked.
+  void PublishSnapshot(
+      std::vector<std::vector<TrajectoryNode>> trajectory_nodes,
+      std::vector<std::vector<SubmapData>> submap_data,
+      std::vector<Constraint> constraints);
+
+ private:
+  // Only accessed through std::atomic_load() and std::atomic_store().
+  std::shared_ptr<const Snapshot> snapshot_;
 };
 
 }  // namespace mapping
@@ -17,6 +17,7 @@
 #include "cartographer/mapping/sparse_pose_graph/optimization_problem_options.h"
 
 #include "cartographer/common/ceres_solver_options.h"
+#include "glog/logging.h"
 
 namespace cartographer {
 namespace mapping {
@@ -38,6 +39,22 @@ proto::OptimizationProblemOptions CreateOptimizationProblemOptions(
           "consecutive_scan_rotation_penalty_factor"));
   options.set_log_solver_summary(
       parameter_dictionary->GetBool("log_solver_summary"));
+  options.set_incremental(parameter_dictionary->GetBool("incremental"));
+  options.set_local_window_num_hops(
+      parameter_dictionary->GetNonNegativeInt("local_window_num_hops"));
+  options.set_use_analytical_jacobians(
+      parameter_dictionary->GetBool("use_analytical_jacobians"));
+  options.set_use_gps_data(parameter_dictionary->GetBool("use_gps_data"));
+  options.set_gps_translation_stddev(
+      parameter_dictionary->GetDouble("gps_translation_stddev"));
+  options.set_gps_rtk_fixed_translation_stddev(
+      parameter_dictionary->GetDouble("gps_rtk_fixed_translation_stddev"));
+  options.set_gps_huber_scale(
+      parameter_dictionary->GetDouble("gps_huber_scale"));
+  options.set_gps_max_interpolation_gap(
+      parameter_dictionary->GetDouble("gps_max_interpolation_gap"));
+  CHECK_GT(options.gps_translation_stddev(), 0.);
+  CHECK_GT(options.gps_rtk_fixed_translation_stddev(), 0.);
   *options.mutable_ceres_solver_options() =
       common::CreateCeresSolverOptionsProto(
           parameter_dictionary->GetDictionary("ceres_solver_options").get());
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_SPARSE_POSE_GRAPH_SPATIAL_INDEX_H_
+#define CARTOGRAPHER_MAPPING_SPARSE_POSE_GRAPH_SPATIAL_INDEX_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "Eigen/Core"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+namespace sparse_pose_graph {
+
+// Indexes the IDs of nodes or submaps by their position in a hash of cubic
+// cells per trajectory, so that the IDs close to a position can be found
+// without looking at all of them. 'IdType' is NodeId or SubmapId.
+template <typename IdType>
+class SpatialIndex {
+ public:
+  // Queries are fastest for distances of about 'cell_size'.
+  explicit SpatialIndex(const double cell_size) : cell_size_(cell_size) {
+    CHECK_GT(cell_size_, 0.);
+  }
+
+  SpatialIndex(const SpatialIndex&) = delete;
+  SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+  void Insert(const IdType& id, const Eigen::Vector3d& position) {
+    cells_[GetCellKey(id.trajectory_id, position.array())].push_back(id);
+  }
+
+  void Clear() { cells_.clear(); }
+
+  // Returns the sorted IDs of 'trajectory_id' which includes all IDs within
+  // 'distance' of 'position', and possibly some further away.
+  std::vector<IdType> GetCandidates(const int trajectory_id,
+                                    const Eigen::Vector3d& position,
+                                    const double distance) const {
+    // Callers compare distances computed from transforms, so we are generous
+    // with rounding at the border.
+    const double padded_distance = distance + 1e-6 * cell_size_;
+    const CellKey min_key =
+        GetCellKey(trajectory_id, position.array() - padded_distance);
+    const CellKey max_key =
+        GetCellKey(trajectory_id, position.array() + padded_distance);
+    std::vector<IdType> ids;
+    for (CellKey key = min_key; key.x <= max_key.x; ++key.x) {
+      for (key.y = min_key.y; key.y <= max_key.y; ++key.y) {
+        for (key.z = min_key.z; key.z <= max_key.z; ++key.z) {
+          const auto it = cells_.find(key);
+          if (it != cells_.end()) {
+            ids.insert(ids.end(), it->second.begin(), it->second.end());
+          }
+        }
+      }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
+ private:
+  struct CellKey {
+    int trajectory_id;
+    int x;
+    int y;
+    int z;
+
+    bool operator==(const CellKey& other) const {
+      return trajectory_id == other.trajectory_id && x == other.x &&
+             y == other.y && z == other.z;
+    }
+  };
+
+  struct CellKeyHash {
+    size_t operator()(const CellKey& key) const {
+      size_t hash = key.trajectory_id;
+      for (const int value : {key.x, key.y, key.z}) {
+        hash = hash * 73856093 ^ static_cast<size_t>(value);
+      }
+      return hash;
+    }
+  };
+
+  CellKey GetCellKey(const int trajectory_id,
+                     const Eigen::Array3d& position) const {
+    return CellKey{trajectory_id,
+                   static_cast<int>(std::floor(position.x() / cell_size_)),
+                   static_cast<int>(std::floor(position.y() / cell_size_)),
+                   static_cast<int>(std::floor(position.z() / cell_size_))};
+  }
+
+  const double cell_size_;
+  std::unordered_map<CellKey, std::vector<IdType>, CellKeyHash> cells_;
+};
+
+}  // namespace sparse_pose_graph
+}  // namespace mapping
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_SPARSE_POSE_GRAPH_SPATIAL_INDEX_H_
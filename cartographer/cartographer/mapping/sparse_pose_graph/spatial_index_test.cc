@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/sparse_pose_graph/spatial_index.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "cartographer/mapping/id.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace sparse_pose_graph {
+namespace {
+
+TEST(SpatialIndexTest, FindsAllIdsWithinDistance) {
+  constexpr double kDistance = 15.;
+  SpatialIndex<NodeId> spatial_index(kDistance);
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<double> distribution(-100., 100.);
+  std::vector<Eigen::Vector3d> positions;
+  for (int trajectory_id = 0; trajectory_id != 2; ++trajectory_id) {
+    for (int node_index = 0; node_index != 500; ++node_index) {
+      positions.emplace_back(distribution(prng), distribution(prng),
+                             distribution(prng) / 10.);
+      spatial_index.Insert(NodeId{trajectory_id, node_index},
+                           positions.back());
+    }
+  }
+
+  for (int i = 0; i != 100; ++i) {
+    const Eigen::Vector3d position(distribution(prng), distribution(prng), 0.);
+    const std::vector<NodeId> candidates =
+        spatial_index.GetCandidates(1, position, kDistance);
+    EXPECT_TRUE(std::is_sorted(candidates.begin(), candidates.end()));
+    for (const NodeId& node_id : candidates) {
+      EXPECT_EQ(1, node_id.trajectory_id);
+    }
+    for (int node_index = 0; node_index != 500; ++node_index) {
+      if ((positions[500 + node_index] - position).norm() <= kDistance) {
+        EXPECT_TRUE(std::binary_search(candidates.begin(), candidates.end(),
+                                       NodeId{1, node_index}));
+      }
+    }
+  }
+}
+
+TEST(SpatialIndexTest, Clear) {
+  SpatialIndex<SubmapId> spatial_index(1.);
+  spatial_index.Insert(SubmapId{0, 0}, Eigen::Vector3d::Zero());
+  EXPECT_EQ(1, spatial_index.GetCandidates(0, Eigen::Vector3d::Zero(), 1.)
+                   .size());
+  spatial_index.Clear();
+  EXPECT_TRUE(
+      spatial_index.GetCandidates(0, Eigen::Vector3d::Zero(), 1.).empty());
+}
+
+}  // namespace
+}  // namespace sparse_pose_graph
+}  // namespace mapping
+}  // namespace cartographer
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the cost functions with analytical Jacobians against their
+// automatically differentiated counterparts, using a serialized state as
+// written by MapBuilder::SerializeState(). Times CeresScanMatcher::Match() for
+// the range data of nodes against a 2D submap and OptimizationProblem::Solve()
+// on the full pose graph.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cartographer/common/make_unique.h"
+#include "cartographer/common/port.h"
+#include "cartographer/common/time.h"
+#include "cartographer/io/proto_stream.h"
+#include "cartographer/mapping/proto/serialization.pb.h"
+#include "cartographer/mapping/proto/sparse_pose_graph.pb.h"
+#include "cartographer/mapping_2d/probability_grid.h"
+#include "cartographer/mapping_2d/scan_matching/ceres_scan_matcher.h"
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
+#include "cartographer/mapping_2d/sparse_pose_graph/optimization_problem.h"
+#include "cartographer/sensor/point_cloud.h"
+#include "cartographer/sensor/range_data.h"
+#include "cartographer/sensor/voxel_filter.h"
+#include "cartographer/transform/transform.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(pbstream_filename, "",
+              "Proto stream file containing the serialized state.");
+DEFINE_int32(trajectory_id, 0, "Trajectory of the submap and nodes.");
+DEFINE_int32(submap_index, 0, "Index of the 2D submap to match against.");
+DEFINE_int32(max_num_nodes, 100, "Maximum number of nodes matched.");
+DEFINE_double(voxel_filter_size, 0.05,
+              "Voxel filter size applied to the range data before matching.");
+DEFINE_double(initial_translation_error, 0.05,
+              "Translation added to the initial pose estimates in meters.");
+DEFINE_double(initial_rotation_error, 0.01,
+              "Rotation added to the initial pose estimates in radians.");
+DEFINE_int32(num_iterations, 3, "Number of optimizations timed per variant.");
+
+namespace cartographer {
+namespace mapping_2d {
+namespace {
+
+double ToSeconds(const std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+// The defaults of 'trajectory_builder_2d.lua'.
+scan_matching::proto::CeresScanMatcherOptions CreateCeresScanMatcherOptions(
+    const bool use_analytical_jacobians) {
+  scan_matching::proto::CeresScanMatcherOptions options;
+  options.set_occupied_space_weight(1e1);
+  options.set_translation_weight(1e1);
+  options.set_rotation_weight(1e2);
+  options.set_use_analytical_jacobians(use_analytical_jacobians);
+  options.mutable_ceres_solver_options()->set_use_nonmonotonic_steps(false);
+  options.mutable_ceres_solver_options()->set_max_num_iterations(20);
+  options.mutable_ceres_solver_options()->set_num_threads(1);
+  return options;
+}
+
+// The defaults of 'sparse_pose_graph.lua'.
+mapping::sparse_pose_graph::proto::OptimizationProblemOptions
+CreateOptimizationProblemOptions(const bool use_analytical_jacobians) {
+  mapping::sparse_pose_graph::proto::OptimizationProblemOptions options;
+  options.set_huber_scale(1e1);
+  options.set_consecutive_scan_translation_penalty_factor(1e5);
+  options.set_consecutive_scan_rotation_penalty_factor(1e5);
+  options.set_use_analytical_jacobians(use_analytical_jacobians);
+  options.mutable_ceres_solver_options()->set_use_nonmonotonic_steps(false);
+  options.mutable_ceres_solver_options()->set_max_num_iterations(50);
+  options.mutable_ceres_solver_options()->set_num_threads(7);
+  return options;
+}
+
+struct Scan {
+  sensor::PointCloud point_cloud;
+  transform::Rigid2d pose;
+};
+
+void BenchmarkCeresScanMatcher(const ProbabilityGrid& probability_grid,
+                               const std::vector<Scan>& scans) {
+  const transform::Rigid2d initial_error(
+      {FLAGS_initial_translation_error, FLAGS_initial_translation_error},
+      FLAGS_initial_rotation_error);
+  // Like the LocalTrajectoryBuilder, match against a grid prepared once.
+  const scan_matching::InterpolationGrid interpolation_grid(probability_grid);
+  std::vector<transform::Rigid2d> auto_diff_pose_estimates;
+  for (const bool use_analytical_jacobians : {false, true}) {
+    const scan_matching::CeresScanMatcher ceres_scan_matcher(
+        CreateCeresScanMatcherOptions(use_analytical_jacobians));
+    std::vector<transform::Rigid2d> pose_estimates(scans.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i != scans.size(); ++i) {
+      ceres::Solver::Summary summary;
+      ceres_scan_matcher.Match(scans[i].pose, scans[i].pose * initial_error,
+                               scans[i].point_cloud, interpolation_grid,
+                               &pose_estimates[i], &summary);
+    }
+    const double seconds_per_scan =
+        ToSeconds(std::chrono::steady_clock::now() - start) / scans.size();
+    std::cout << std::fixed << std::setprecision(6) << "Match, "
+              << (use_analytical_jacobians ? "analytical" : "autodiff") << ": "
+              << seconds_per_scan << " s per scan";
+    if (use_analytical_jacobians) {
+      double max_translation_difference = 0.;
+      double max_rotation_difference = 0.;
+      for (size_t i = 0; i != scans.size(); ++i) {
+        const transform::Rigid2d difference =
+            auto_diff_pose_estimates[i].inverse() * pose_estimates[i];
+        max_translation_difference = std::max(
+            max_translation_difference, difference.translation().norm());
+        max_rotation_difference = std::max(
+            max_rotation_difference, std::abs(difference.normalized_angle()));
+      }
+      std::cout << ", max difference to autodiff "
+                << max_translation_difference << " m, "
+                << max_rotation_difference << " rad";
+    }
+    std::cout << "\n";
+    auto_diff_pose_estimates = pose_estimates;
+  }
+}
+
+void BenchmarkOptimizationProblem(
+    const mapping::proto::SparsePoseGraph& pose_graph) {
+  std::vector<sparse_pose_graph::OptimizationProblem::Constraint> constraints;
+  for (const auto& constraint : pose_graph.constraint()) {
+    constraints.push_back(sparse_pose_graph::OptimizationProblem::Constraint{
+        mapping::SubmapId{constraint.submap_id().trajectory_id(),
+                          constraint.submap_id().submap_index()},
+        mapping::NodeId{constraint.node_id().trajectory_id(),
+                        constraint.node_id().node_index()},
+        {transform::ToRigid3(constraint.relative_pose()),
+         constraint.translation_weight(), constraint.rotation_weight()},
+        constraint.tag() == mapping::proto::SparsePoseGraph::Constraint::
+                                INTRA_SUBMAP
+            ? sparse_pose_graph::OptimizationProblem::Constraint::INTRA_SUBMAP
+            : sparse_pose_graph::OptimizationProblem::Constraint::
+                  INTER_SUBMAP});
+  }
+  for (const bool use_analytical_jacobians : {false, true}) {
+    std::chrono::steady_clock::duration duration{};
+    for (int i = 0; i != FLAGS_num_iterations; ++i) {
+      // Every iteration starts from the poses of the serialized state.
+      sparse_pose_graph::OptimizationProblem optimization_problem(
+          CreateOptimizationProblemOptions(use_analytical_jacobians));
+      for (int trajectory_id = 0;
+           trajectory_id != pose_graph.trajectory_size(); ++trajectory_id) {
+        const auto& trajectory = pose_graph.trajectory(trajectory_id);
+        for (const auto& submap : trajectory.submap()) {
+          optimization_problem.AddSubmap(
+              trajectory_id,
+              transform::Project2D(transform::ToRigid3(submap.pose())));
+        }
+        for (const auto& node : trajectory.node()) {
+          const transform::Rigid2d pose =
+              transform::Project2D(transform::ToRigid3(node.pose()));
+          optimization_problem.AddTrajectoryNode(
+              trajectory_id, common::FromUniversal(node.timestamp()), pose,
+              pose);
+        }
+      }
+      const auto start = std::chrono::steady_clock::now();
+      optimization_problem.Solve(constraints, {});
+      duration += std::chrono::steady_clock::now() - start;
+    }
+    std::cout << std::fixed << std::setprecision(6) << "Solve, "
+              << (use_analytical_jacobians ? "analytical" : "autodiff") << ": "
+              << ToSeconds(duration) / FLAGS_num_iterations << " s for "
+              << constraints.size() << " constraints\n";
+  }
+}
+
+void Run(const string& pbstream_filename) {
+  io::ProtoStreamReader reader(pbstream_filename);
+  mapping::proto::SparsePoseGraph pose_graph;
+  CHECK(reader.ReadProto(&pose_graph));
+  CHECK_LT(FLAGS_trajectory_id, pose_graph.trajectory_size());
+  const auto& trajectory = pose_graph.trajectory(FLAGS_trajectory_id);
+  CHECK_LT(FLAGS_submap_index, trajectory.submap_size());
+
+  std::unique_ptr<ProbabilityGrid> probability_grid;
+  transform::Rigid3d submap_local_pose;
+  std::map<int, sensor::PointCloud> point_clouds;
+  mapping::proto::SerializedData proto;
+  while (reader.ReadProto(&proto)) {
+    if (proto.has_submap() &&
+        proto.submap().submap_id().trajectory_id() == FLAGS_trajectory_id &&
+        proto.submap().submap_id().submap_index() == FLAGS_submap_index) {
+      CHECK(proto.submap().has_submap_2d()) << "Only 2D submaps are supported.";
+      probability_grid = common::make_unique<ProbabilityGrid>(
+          proto.submap().submap_2d().probability_grid());
+      submap_local_pose =
+          transform::ToRigid3(proto.submap().submap_2d().local_pose());
+    }
+    if (proto.has_range_data() &&
+        proto.range_data().node_id().trajectory_id() == FLAGS_trajectory_id &&
+        static_cast<int>(point_clouds.size()) < FLAGS_max_num_nodes) {
+      point_clouds[proto.range_data().node_id().node_index()] =
+          sensor::VoxelFiltered(
+              sensor::Decompress(
+                  sensor::FromProto(proto.range_data().range_data()))
+                  .returns,
+              FLAGS_voxel_filter_size);
+    }
+  }
+  CHECK(probability_grid != nullptr)
+      << "Submap " << FLAGS_submap_index << " not found.";
+  CHECK(!point_clouds.empty()) << "No range data found.";
+
+  // Node poses in the frame of the submap's probability grid.
+  const transform::Rigid3d global_to_local =
+      submap_local_pose *
+      transform::ToRigid3(trajectory.submap(FLAGS_submap_index).pose())
+          .inverse();
+  std::vector<Scan> scans;
+  for (auto& entry : point_clouds) {
+    CHECK_LT(entry.first, trajectory.node_size());
+    scans.push_back(Scan{
+        std::move(entry.second),
+        transform::Project2D(global_to_local *
+                             transform::ToRigid3(
+                                 trajectory.node(entry.first).pose()))});
+  }
+  LOG(INFO) << "Matching " << scans.size() << " nodes against a "
+            << probability_grid->limits().cell_limits().num_x_cells << "x"
+            << probability_grid->limits().cell_limits().num_y_cells
+            << " grid.";
+  BenchmarkCeresScanMatcher(*probability_grid, scans);
+  BenchmarkOptimizationProblem(pose_graph);
+}
+
+}  // namespace
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  google::SetUsageMessage(
+      "\n\n"
+      "Benchmarks the 2D cost functions with analytical Jacobians against\n"
+      "their automatically differentiated versions.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_pbstream_filename.empty()) {
+    google::ShowUsageWithFlagsRestrict(argv[0],
+                                       "analytical_jacobians_benchmark");
+    return EXIT_FAILURE;
+  }
+  ::cartographer::mapping_2d::Run(FLAGS_pbstream_filename);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/front_end_policy.h"
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping_2d {
+
+proto::FrontEndPolicyOptions CreateFrontEndPolicyOptions(
+    common::LuaParameterDictionary* const parameter_dictionary) {
+  proto::FrontEndPolicyOptions options;
+  options.set_mode_a_min_num_returns(
+      parameter_dictionary->GetNonNegativeInt("mode_a_min_num_returns"));
+  options.set_mode_c_min_squared_distance(
+      parameter_dictionary->GetDouble("mode_c_min_squared_distance"));
+  options.set_mode_c_num_updates(
+      parameter_dictionary->GetNonNegativeInt("mode_c_num_updates"));
+  options.set_skip_scan_matching_max_translation_stddev(
+      parameter_dictionary->GetDouble(
+          "skip_scan_matching_max_translation_stddev"));
+  options.set_ceres_only_max_translation_stddev(
+      parameter_dictionary->GetDouble("ceres_only_max_translation_stddev"));
+  options.set_max_prediction_age(
+      parameter_dictionary->GetDouble("max_prediction_age"));
+  CHECK_GE(options.max_prediction_age(), 0.);
+  return options;
+}
+
+FrontEndPolicy::FrontEndPolicy(const proto::FrontEndPolicyOptions& options)
+    : options_(options) {}
+
+void FrontEndPolicy::AddRangeData(const int num_returns) {
+  num_returns_ = num_returns;
+}
+
+void FrontEndPolicy::AddPrediction(const common::Time time,
+                                   const double translation_stddev,
+                                   const bool rtk_fixed) {
+  prediction_time_ = time;
+  prediction_translation_stddev_ = translation_stddev;
+  rtk_fixed_ = rtk_fixed;
+}
+
+FrontEndPolicy::Mode FrontEndPolicy::UpdateMode(
+    const double squared_distance) {
+  if (num_returns_ > options_.mode_a_min_num_returns()) {
+    mode_ = Mode::kA;
+  } else if (squared_distance > options_.mode_c_min_squared_distance()) {
+    mode_c_updates_left_ = options_.mode_c_num_updates();
+    mode_ = Mode::kC;
+  } else if (mode_c_updates_left_ > 1) {
+    --mode_c_updates_left_;
+    mode_ = Mode::kC;
+  } else {
+    mode_ = Mode::kB;
+  }
+  return mode_;
+}
+
+FrontEndPolicy::ScanMatching FrontEndPolicy::SelectScanMatching(
+    const common::Time time) const {
+  // In mode A the pose is tracked by scan matching alone.
+  if (mode_ == Mode::kA || prediction_time_ == common::Time::min() ||
+      time - prediction_time_ >
+          common::FromSeconds(options_.max_prediction_age())) {
+    return ScanMatching::kFull;
+  }
+  if (rtk_fixed_ && prediction_translation_stddev_ <
+                        options_.skip_scan_matching_max_translation_stddev()) {
+    return ScanMatching::kSkipped;
+  }
+  if (prediction_translation_stddev_ <
+      options_.ceres_only_max_translation_stddev()) {
+    return ScanMatching::kCeresOnly;
+  }
+  return ScanMatching::kFull;
+}
+
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_2D_FRONT_END_POLICY_H_
+#define CARTOGRAPHER_MAPPING_2D_FRONT_END_POLICY_H_
+
+#include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/time.h"
+#include "cartographer/mapping_2d/proto/front_end_policy_options.pb.h"
+
+namespace cartographer {
+namespace mapping_2d {
+
+proto::FrontEndPolicyOptions CreateFrontEndPolicyOptions(
+    common::LuaParameterDictionary* parameter_dictionary);
+
+// Decides how the 2D local trajectory builder combines odometry (i.e. GPS)
+// with scan matching, and how much scan matching effort is spent on each
+// accumulated range data.
+class FrontEndPolicy {
+ public:
+  // How odometry is used for the pose prediction, see FrontEndPolicyOptions.
+  enum class Mode { kA, kB, kC };
+
+  // How much effort is spent on scan matching.
+  enum class ScanMatching { kFull, kCeresOnly, kSkipped };
+
+  explicit FrontEndPolicy(const proto::FrontEndPolicyOptions& options);
+
+  FrontEndPolicy(const FrontEndPolicy&) = delete;
+  FrontEndPolicy& operator=(const FrontEndPolicy&) = delete;
+
+  // Records the number of returns of the latest accumulated range data.
+  void AddRangeData(int num_returns);
+
+  // Records the translational standard deviation of the odometry/IMU
+  // prediction at 'time' and whether the odometry was RTK fixed.
+  void AddPrediction(common::Time time, double translation_stddev,
+                     bool rtk_fixed);
+
+  // Updates the mode from an odometry pose which is 'squared_distance' away
+  // from the current pose estimate, and returns it.
+  Mode UpdateMode(double squared_distance);
+
+  // Returns the scan matching effort for range data at 'time'.
+  ScanMatching SelectScanMatching(common::Time time) const;
+
+  Mode mode() const { return mode_; }
+
+  // Number of odometry updates mode C is still kept for.
+  int mode_c_updates_left() const { return mode_c_updates_left_; }
+
+  // Translational standard deviation of the latest prediction.
+  double prediction_translation_stddev() const {
+    return prediction_translation_stddev_;
+  }
+
+ private:
+  const proto::FrontEndPolicyOptions options_;
+  Mode mode_ = Mode::kA;
+  int num_returns_ = 0;
+  int mode_c_updates_left_ = 0;
+  common::Time prediction_time_ = common::Time::min();
+  double prediction_translation_stddev_ = 0.;
+  bool rtk_fixed_ = false;
+};
+
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_2D_FRONT_END_POLICY_H_
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/front_end_policy.h"
+
+#include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
+#include "gmock/gmock.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace {
+
+class FrontEndPolicyTest : public ::testing::Test {
+ protected:
+  FrontEndPolicyTest() {
+    auto parameter_dictionary = common::MakeDictionary(
+        "return {"
+        "mode_a_min_num_returns = 100, "
+        "mode_c_min_squared_distance = 5., "
+        "mode_c_num_updates = 3, "
+        "skip_scan_matching_max_translation_stddev = 0.01, "
+        "ceres_only_max_translation_stddev = 0.05, "
+        "max_prediction_age = 0.5, "
+        "}");
+    options_ = CreateFrontEndPolicyOptions(parameter_dictionary.get());
+  }
+
+  common::Time SecondsSinceEpoch(const double seconds) {
+    return common::FromUniversal(0) + common::FromSeconds(seconds);
+  }
+
+  proto::FrontEndPolicyOptions options_;
+};
+
+TEST_F(FrontEndPolicyTest, ModeSelection) {
+  FrontEndPolicy policy(options_);
+  policy.AddRangeData(200);
+  EXPECT_EQ(FrontEndPolicy::Mode::kA, policy.UpdateMode(10.));
+  policy.AddRangeData(50);
+  EXPECT_EQ(FrontEndPolicy::Mode::kB, policy.UpdateMode(1.));
+  EXPECT_EQ(FrontEndPolicy::Mode::kC, policy.UpdateMode(10.));
+  EXPECT_EQ(3, policy.mode_c_updates_left());
+  EXPECT_EQ(FrontEndPolicy::Mode::kC, policy.UpdateMode(1.));
+  EXPECT_EQ(FrontEndPolicy::Mode::kC, policy.UpdateMode(1.));
+  EXPECT_EQ(FrontEndPolicy::Mode::kB, policy.UpdateMode(1.));
+}
+
+TEST_F(FrontEndPolicyTest, ScanMatchingSelection) {
+  FrontEndPolicy policy(options_);
+  policy.AddRangeData(50);
+  policy.UpdateMode(1.);
+  // Without a prediction, scan matching is never reduced.
+  EXPECT_EQ(FrontEndPolicy::ScanMatching::kFull,
+            policy.SelectScanMatching(SecondsSinceEpoch(1.)));
+
+  policy.AddPrediction(SecondsSinceEpoch(1.), 0.005, true /* rtk_fixed */);
+  EXPECT_EQ(FrontEndPolicy::ScanMatching::kSkipped,
+            policy.SelectScanMatching(SecondsSinceEpoch(1.1)));
+  // Stale predictions are not trusted.
+  EXPECT_EQ(FrontEndPolicy::ScanMatching::kFull,
+            policy.SelectScanMatching(SecondsSinceEpoch(2.)));
+
+  policy.AddPrediction(SecondsSinceEpoch(1.), 0.005, false /* rtk_fixed */);
+  EXPECT_EQ(FrontEndPolicy::ScanMatching::kCeresOnly,
+            policy.SelectScanMatching(SecondsSinceEpoch(1.1)));
+
+  policy.AddPrediction(SecondsSinceEpoch(1.), 0.1, true /* rtk_fixed */);
+  EXPECT_EQ(FrontEndPolicy::ScanMatching::kFull,
+            policy.SelectScanMatching(SecondsSinceEpoch(1.1)));
+
+  // Mode A always relies on full scan matching.
+  policy.AddPrediction(SecondsSinceEpoch(1.), 0.005, true /* rtk_fixed */);
+  policy.AddRangeData(200);
+  policy.UpdateMode(1.);
+  EXPECT_EQ(FrontEndPolicy::ScanMatching::kFull,
+            policy.SelectScanMatching(SecondsSinceEpoch(1.1)));
+}
+
+}  // namespace
+}  // namespace mapping_2d
+}  // namespace cartographer
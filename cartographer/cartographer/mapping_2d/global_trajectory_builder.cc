@@ -60,6 +60,10 @@ void GlobalTrajectoryBuilder::AddImuData(
 void GlobalTrajectoryBuilder::AddOdometerData(const common::Time time,
                                               const transform::Rigid3d& pose) {
   local_trajectory_builder_.AddOdometerData(time, pose);
+  // Odometer data carries the GPS fixes, with the RTK fixed flag in z.
+  sparse_pose_graph_->AddGpsData(trajectory_id_, time,
+                                 pose.translation().head<2>(),
+                                 pose.translation().z() == 1.);
 }
 
 const mapping::GlobalTrajectoryBuilderInterface::PoseEstimate&
@@ -16,9 +16,12 @@
 
 #include "cartographer/mapping_2d/local_trajectory_builder.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include "cartographer/common/make_unique.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/sensor/range_data.h"
 
 #include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
@@ -34,6 +37,46 @@ using namespace cv;
 namespace cartographer {
 namespace mapping_2d {
 
+namespace {
+
+// Translational variances in m^2 of an RTK fixed and of any other odometry
+// (i.e. GPS) fix when observed by the pose tracker.
+constexpr double kRtkFixedTranslationVariance = 1e-6;
+constexpr double kRtkFloatTranslationVariance = 1.;
+
+// Time to match and insert accumulated range data in each front-end mode.
+common::HistogramMetric* GetModeMetric(const FrontEndPolicy::Mode mode) {
+  static common::HistogramMetric* const metrics[] = {
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_mode_a_seconds",
+          "Time to match and insert accumulated range data in mode A."),
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_mode_b_seconds",
+          "Time to match and insert accumulated range data in mode B."),
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_mode_c_seconds",
+          "Time to match and insert accumulated range data in mode C.")};
+  return metrics[static_cast<int>(mode)];
+}
+
+// Time of scan matching for each scan matching effort.
+common::HistogramMetric* GetScanMatchingMetric(
+    const FrontEndPolicy::ScanMatching scan_matching) {
+  static common::HistogramMetric* const metrics[] = {
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_full_scan_matching_seconds",
+          "Time of scan matching with all scan matchers."),
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_ceres_only_scan_matching_seconds",
+          "Time of scan matching with only the Ceres scan matcher."),
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_skipped_scan_matching_seconds",
+          "Time spent on range data for which scan matching was skipped.")};
+  return metrics[static_cast<int>(scan_matching)];
+}
+
+}  // namespace
+
 LocalTrajectoryBuilder::LocalTrajectoryBuilder(
     const proto::LocalTrajectoryBuilderOptions& options)
     : options_(options),
@@ -42,7 +85,8 @@ LocalTrajectoryBuilder::LocalTrajectoryBuilder(
       real_time_correlative_scan_matcher_(
           options_.real_time_correlative_scan_matcher_options()),
       ceres_scan_matcher_(options_.ceres_scan_matcher_options()),
-      odometry_state_tracker_(options_.num_odometry_states()) {}
+      odometry_state_tracker_(options_.num_odometry_states()),
+      front_end_policy_(options_.front_end_policy_options()) {}
 
 LocalTrajectoryBuilder::~LocalTrajectoryBuilder() {}
 
@@ -62,22 +106,42 @@ void LocalTrajectoryBuilder::ScanMatch(
     common::Time time, const transform::Rigid3d& pose_prediction,
     const transform::Rigid3d& tracking_to_tracking_2d,
     const sensor::RangeData& range_data_in_tracking_2d,
+    const FrontEndPolicy::ScanMatching scan_matching,
     transform::Rigid3d* pose_observation) {
+  common::ScopedLatency scan_matching_latency(
+      GetScanMatchingMetric(scan_matching));
+  static common::HistogramMetric* const real_time_correlative_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_real_time_correlative_seconds",
+          "Time of the real-time correlative scan matcher.");
+  static common::HistogramMetric* const ceres_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_ceres_seconds",
+          "Time of the Ceres scan matcher.");
   std::shared_ptr<const Submap> matching_submap =
       active_submaps_.submaps().front();
   transform::Rigid2d pose_prediction_2d = //tracking_2d_to_map  [x,y,r]
       transform::Project2D(pose_prediction * tracking_to_tracking_2d.inverse());
+  if (scan_matching == FrontEndPolicy::ScanMatching::kSkipped) {
+    *pose_observation =
+        transform::Embed3D(pose_prediction_2d) * tracking_to_tracking_2d;
+    return;
+  }
   // The online correlative scan matcher will refine the initial estimate for
   // the Ceres scan matcher.
   transform::Rigid2d initial_ceres_pose = pose_prediction_2d;
   sensor::AdaptiveVoxelFilter adaptive_voxel_filter(
       options_.adaptive_voxel_filter_options());
-  //const sensor::PointCloud filtered_point_cloud_in_tracking_2d =
-  //    adaptive_voxel_filter.Filter(range_data_in_tracking_2d.returns);
-  const sensor::PointCloud filtered_point_cloud_in_tracking_2d = range_data_in_tracking_2d.returns;
+  // All returns are used unless the scan matching effort is reduced.
+  const sensor::PointCloud filtered_point_cloud_in_tracking_2d =
+      scan_matching == FrontEndPolicy::ScanMatching::kCeresOnly
+          ? adaptive_voxel_filter.Filter(range_data_in_tracking_2d.returns)
+          : range_data_in_tracking_2d.returns;
   //mnf returns and misses :=  RELATE TO pose_now
   double score_real_time = 0;
-  if (options_.use_online_correlative_scan_matching()) {
+  if (options_.use_online_correlative_scan_matching() &&
+      scan_matching == FrontEndPolicy::ScanMatching::kFull) {
+    common::ScopedLatency latency(real_time_correlative_metric);
     score_real_time = real_time_correlative_scan_matcher_.Match(
         pose_prediction_2d, filtered_point_cloud_in_tracking_2d,
         matching_submap->probability_grid(), &initial_ceres_pose);
@@ -87,10 +151,13 @@ void LocalTrajectoryBuilder::ScanMatch(
 
   transform::Rigid2d tracking_2d_to_map;
   ceres::Solver::Summary summary;
-  ceres_scan_matcher_.Match(pose_prediction_2d, initial_ceres_pose,
-                            filtered_point_cloud_in_tracking_2d,
-                            matching_submap->probability_grid(),
-                            &tracking_2d_to_map, &summary);
+  {
+    common::ScopedLatency latency(ceres_metric);
+    ceres_scan_matcher_.Match(pose_prediction_2d, initial_ceres_pose,
+                              filtered_point_cloud_in_tracking_2d,
+                              *matching_submap->interpolation_grid(),
+                              &tracking_2d_to_map, &summary);
+  }
   // mnf sumary could be used for judgement
 
   *pose_observation =
@@ -164,13 +231,17 @@ LocalTrajectoryBuilder::AddHorizontalRangeData(
 std::unique_ptr<LocalTrajectoryBuilder::InsertionResult>
 LocalTrajectoryBuilder::AddAccumulatedRangeData(
     const common::Time time, const sensor::RangeData& range_data) {
+  static common::HistogramMetric* const accumulated_range_data_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_2d_accumulated_range_data_seconds",
+          "Time to match and insert accumulated range data.");
+  common::ScopedLatency latency(accumulated_range_data_metric);
+  common::ScopedLatency mode_latency(GetModeMetric(front_end_policy_.mode()));
   const transform::Rigid3d odometry_prediction =
       pose_estimate_ * odometry_correction_;
 
   //mnf record returns for choose MODE_A and MODE_B
-  int num_returns = range_data.returns.size();
-  returns_now_ = num_returns;
-  returns_pre_ = returns_now_;
+  front_end_policy_.AddRangeData(range_data.returns.size());
 
 
       //odometry_correction_ = transform::Rigid3d::Identity();
@@ -200,7 +271,8 @@ LocalTrajectoryBuilder::AddAccumulatedRangeData(
   }
 
   ScanMatch(time, pose_prediction, tracking_to_tracking_2d,
-            range_data_in_tracking_2d, &pose_estimate_);
+            range_data_in_tracking_2d,
+            front_end_policy_.SelectScanMatching(time), &pose_estimate_);
   odometry_correction_ = transform::Rigid3d::Identity();
 
   if (!odometry_state_tracker_.empty()) {
@@ -215,7 +287,9 @@ LocalTrajectoryBuilder::AddAccumulatedRangeData(
 
   // Improve the velocity estimate.
   if (last_scan_match_time_ > common::Time::min() &&
-      time > last_scan_match_time_  && times_ != (mode_c_times_-1) ) {
+      time > last_scan_match_time_ &&
+      front_end_policy_.mode_c_updates_left() !=
+          options_.front_end_policy_options().mode_c_num_updates() - 1) {
     const double delta_t = common::ToSeconds(time - last_scan_match_time_);
     // This adds the observed difference in velocity that would have reduced the
     // error to zero.
@@ -332,13 +406,22 @@ void LocalTrajectoryBuilder::AddOdometerData(
   transform::Rigid3d odometer_pose = transform::Rigid3d({odometer_pose_translation.x(),odometer_pose_translation.y(),0},
           {1.0,0,0,0});
 
-  pose_tracker_->AddPoseObservation(
-      time, odometer_pose,
-      Eigen::Matrix<double, 6, 6>::Identity() * 1e-6);
-
+  // The policy needs the uncertainty of the prediction, so it is taken before
+  // the odometry fix is observed.
   transform::Rigid3d actual;
   kalman_filter::PoseCovariance covariance;
-  pose_tracker_->GetPoseEstimateMeanAndCovariance(time , &actual, &covariance);
+  pose_tracker_->GetPoseEstimateMeanAndCovariance(time, &actual, &covariance);
+  front_end_policy_.AddPrediction(
+      time, std::sqrt(std::max(covariance(0, 0), covariance(1, 1))), rtk == 1);
+
+  kalman_filter::PoseCovariance observation_covariance =
+      kalman_filter::PoseCovariance::Identity() * 1e-6;
+  observation_covariance.block<3, 3>(0, 0) =
+      Eigen::Matrix3d::Identity() * (rtk == 1 ? kRtkFixedTranslationVariance
+                                              : kRtkFloatTranslationVariance);
+  pose_tracker_->AddPoseObservation(time, odometer_pose,
+                                    observation_covariance);
+  pose_tracker_->GetPoseEstimateMeanAndCovariance(time, &actual, &covariance);
 
   transform::Rigid3d odometer_pose_with_imu;
   //mnf use kalman 
@@ -396,69 +479,18 @@ void LocalTrajectoryBuilder::AddOdometerData(
     //LOG(WARNING) <<  " pose_estimate_.translation() " << pose_estimate_.translation().x() <<"and"<< pose_estimate_.translation().y();
     //LOG(WARNING) <<  " dist = " << dist<< " times_ = "<<times_; 
 
-/*
-    if(times_ > 1)
-    {
-      times_--;
-      MODE = MODE_C;
-    }
-    else
-    {
-      if(dist > mode_c_distance_)
-      {
-        times_ = mode_c_times_;
-        MODE = MODE_C;
-      }
-      else
-      {
-        if( (returns_now_ > mode_b_threshold_returns_) && (returns_pre_ > mode_b_threshold_returns_) )
-        {
-          MODE = MODE_B;
-        }
-        else
-        {
-          MODE = MODE_B;
-        }
-      }
-    }
-*/
-
-    if((returns_now_ > mode_b_threshold_returns_) && (returns_pre_ > mode_b_threshold_returns_))
-    {
-      MODE = MODE_A;
-    }
-    else
-    {
-      if(dist > mode_c_distance_)
-      {
-        times_ = mode_c_times_;
-        MODE = MODE_C;
-      }
-      else
-      {
-        if( times_ > 1 )
-        {
-          MODE = MODE_C;
-          times_--;
-        }
-        else
-        {
-          MODE = MODE_B;
-        }
-      }
-    }
-
-    if( MODE == MODE_A )
+    const FrontEndPolicy::Mode mode = front_end_policy_.UpdateMode(dist);
+    if( mode == FrontEndPolicy::Mode::kA )
     {
       odometry_correction_ = transform::Rigid3d::Identity();
       LOG(WARNING) <<  " MODE == MODE_A " ; 
     }
-    if( MODE == MODE_B )
+    if( mode == FrontEndPolicy::Mode::kB )
     {
       odometry_correction_ = pose_estimate_.inverse() * new_pose;
       //LOG(WARNING) <<  " MODE == MODE_B " ; 
     }
-    if( MODE == MODE_C )
+    if( mode == FrontEndPolicy::Mode::kC )
     {
       odometry_correction_ = pose_estimate_.inverse() * odometer_pose_with_imu;
     }
@@ -23,6 +23,7 @@
 #include "cartographer/mapping/global_trajectory_builder_interface.h"
 #include "cartographer/mapping/imu_tracker.h"
 #include "cartographer/mapping/odometry_state_tracker.h"
+#include "cartographer/mapping_2d/front_end_policy.h"
 #include "cartographer/mapping_2d/proto/local_trajectory_builder_options.pb.h"
 #include "cartographer/mapping_2d/scan_matching/ceres_scan_matcher.h"
 #include "cartographer/mapping_2d/scan_matching/real_time_correlative_scan_matcher.h"
@@ -62,6 +63,7 @@ class LocalTrajectoryBuilder {
   LocalTrajectoryBuilder& operator=(const LocalTrajectoryBuilder&) = delete;
 
   const PoseEstimate& pose_estimate() const;
+  const FrontEndPolicy& front_end_policy() const { return front_end_policy_; }
   std::unique_ptr<InsertionResult> AddHorizontalRangeData(
       common::Time, const sensor::RangeData& range_data);
   void AddImuData(common::Time time, const Eigen::Vector3d& linear_acceleration,
@@ -75,11 +77,12 @@ class LocalTrajectoryBuilder {
       const transform::Rigid3f& tracking_to_tracking_2d,
       const sensor::RangeData& range_data) const;
 
-  // Scan matches 'range_data_in_tracking_2d' and fill in the 'pose_observation'
-  // with the result.
+  // Scan matches 'range_data_in_tracking_2d' with the effort given by
+  // 'scan_matching' and fill in the 'pose_observation' with the result.
   void ScanMatch(common::Time time, const transform::Rigid3d& pose_prediction,
                  const transform::Rigid3d& tracking_to_tracking_2d,
                  const sensor::RangeData& range_data_in_tracking_2d,
+                 FrontEndPolicy::ScanMatching scan_matching,
                  transform::Rigid3d* pose_observation);
 
   // Lazily constructs an ImuTracker.
@@ -120,22 +123,7 @@ class LocalTrajectoryBuilder {
 
   std::unique_ptr<kalman_filter::PoseTracker> pose_tracker_;
 
-  int MODE_A = 0;
-  int MODE_B = 1;
-  int MODE_C = 2;
-
-  int MODE = 0;
-
-  int mode_c_times_ = 100;
-  int mode_c_distance_ = 5;
-  int mode_b_threshold_returns_ = 1500;
-
-  int returns_pre_ = 0;
-  int returns_now_ = 0;
-  
-  int times_ = 0;
-
-
+  FrontEndPolicy front_end_policy_;
 };
 
 }  // namespace mapping_2d
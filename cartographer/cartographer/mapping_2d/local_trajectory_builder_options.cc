@@ -16,6 +16,7 @@
 
 #include "cartographer/mapping_2d/local_trajectory_builder_options.h"
 
+#include "cartographer/mapping_2d/front_end_policy.h"
 #include "cartographer/mapping_2d/scan_matching/ceres_scan_matcher.h"
 #include "cartographer/mapping_2d/scan_matching/real_time_correlative_scan_matcher.h"
 #include "cartographer/mapping_2d/submaps.h"
@@ -54,6 +55,8 @@ proto::LocalTrajectoryBuilderOptions CreateLocalTrajectoryBuilderOptions(
   *options.mutable_motion_filter_options() =
       mapping_3d::CreateMotionFilterOptions(
           parameter_dictionary->GetDictionary("motion_filter").get());
+  *options.mutable_front_end_policy_options() = CreateFrontEndPolicyOptions(
+      parameter_dictionary->GetDictionary("front_end_policy").get());
   options.set_imu_gravity_time_constant(
       parameter_dictionary->GetDouble("imu_gravity_time_constant"));
   options.set_num_odometry_states(
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/local_trajectory_builder.h"
+
+#include "Eigen/Core"
+#include "Eigen/Geometry"
+#include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
+#include "cartographer/common/time.h"
+#include "cartographer/mapping_2d/local_trajectory_builder_options.h"
+#include "cartographer/transform/rigid_transform.h"
+#include "gmock/gmock.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace {
+
+class LocalTrajectoryBuilderTest : public ::testing::Test {
+ protected:
+  LocalTrajectoryBuilderTest()
+      : local_trajectory_builder_(CreateTrajectoryBuilderOptions()) {}
+
+  proto::LocalTrajectoryBuilderOptions CreateTrajectoryBuilderOptions() {
+    auto parameter_dictionary = common::MakeDictionary(R"text(
+        return {
+          use_imu_data = true,
+          min_range = 0.,
+          max_range = 50.,
+          min_z = -0.8,
+          max_z = 2.,
+          missing_data_ray_length = 5.,
+          scans_per_accumulation = 1,
+          voxel_filter_size = 0.025,
+
+          adaptive_voxel_filter = {
+            max_length = 0.5,
+            min_num_points = 200,
+            max_range = 50.,
+          },
+
+          use_online_correlative_scan_matching = false,
+          real_time_correlative_scan_matcher = {
+            linear_search_window = 0.1,
+            angular_search_window = math.rad(20.),
+            translation_delta_cost_weight = 1e-1,
+            rotation_delta_cost_weight = 1e-1,
+            multi_resolution_depth = 1,
+            multi_resolution_num_greedy_candidates = 0,
+          },
+
+          ceres_scan_matcher = {
+            occupied_space_weight = 1e1,
+            translation_weight = 1e1,
+            rotation_weight = 1e2,
+            use_analytical_jacobians = false,
+            ceres_solver_options = {
+              use_nonmonotonic_steps = false,
+              max_num_iterations = 20,
+              num_threads = 1,
+            },
+          },
+
+          motion_filter = {
+            max_time_seconds = 5.,
+            max_distance_meters = 0.2,
+            max_angle_radians = math.rad(1.),
+          },
+
+          front_end_policy = {
+            mode_a_min_num_returns = 1500,
+            mode_c_min_squared_distance = 5.,
+            mode_c_num_updates = 100,
+            skip_scan_matching_max_translation_stddev = 0.01,
+            ceres_only_max_translation_stddev = 0.05,
+            max_prediction_age = 0.5,
+          },
+
+          imu_gravity_time_constant = 10.,
+          num_odometry_states = 1,
+
+          submaps = {
+            resolution = 0.05,
+            num_range_data = 30,
+            range_data_inserter = {
+              insert_free_space = true,
+              hit_probability = 0.55,
+              miss_probability = 0.49,
+            },
+          },
+        }
+        )text");
+    return CreateLocalTrajectoryBuilderOptions(parameter_dictionary.get());
+  }
+
+  // Adds IMU data of a robot at rest every 0.1 s until 'end_time'.
+  void AddImuDataUntil(const common::Time end_time) {
+    for (; imu_time_ <= end_time; imu_time_ += common::FromSeconds(0.1)) {
+      local_trajectory_builder_.AddImuData(
+          imu_time_, Eigen::Vector3d(0., 0., 9.81), Eigen::Vector3d::Zero(),
+          Eigen::Quaterniond::Identity());
+    }
+  }
+
+  // Adds an odometry fix at the origin, whose z coordinate is 1 if it is RTK
+  // fixed.
+  void AddOdometerData(const common::Time time, const bool rtk_fixed) {
+    AddImuDataUntil(time);
+    local_trajectory_builder_.AddOdometerData(
+        time, transform::Rigid3d::Translation(
+                  Eigen::Vector3d(0., 0., rtk_fixed ? 1. : 0.)));
+  }
+
+  double prediction_translation_stddev() const {
+    return local_trajectory_builder_.front_end_policy()
+        .prediction_translation_stddev();
+  }
+
+  common::Time imu_time_ = common::FromUniversal(1000);
+  LocalTrajectoryBuilder local_trajectory_builder_;
+};
+
+TEST_F(LocalTrajectoryBuilderTest, PredictionStddevIsTakenBeforeTheFix) {
+  // Without odometry the uncertainty of the prediction grows.
+  AddOdometerData(common::FromUniversal(1000) + common::FromSeconds(100.),
+                  true /* rtk_fixed */);
+  EXPECT_GT(prediction_translation_stddev(), 0.01);
+  // An RTK fixed odometry pose narrows it down.
+  AddOdometerData(common::FromUniversal(1000) + common::FromSeconds(100.1),
+                  true /* rtk_fixed */);
+  EXPECT_LT(prediction_translation_stddev(), 0.01);
+}
+
+TEST_F(LocalTrajectoryBuilderTest, PredictionStddevStaysLargeWithoutRtkFix) {
+  AddOdometerData(common::FromUniversal(1000) + common::FromSeconds(100.),
+                  false /* rtk_fixed */);
+  EXPECT_GT(prediction_translation_stddev(), 0.01);
+  AddOdometerData(common::FromUniversal(1000) + common::FromSeconds(100.1),
+                  false /* rtk_fixed */);
+  EXPECT_GT(prediction_translation_stddev(), 0.01);
+}
+
+}  // namespace
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -52,11 +52,13 @@ class ProbabilityGrid {
           Eigen::AlignedBox2i(Eigen::Vector2i(proto.min_x(), proto.min_y()),
                               Eigen::Vector2i(proto.max_x(), proto.max_y()));
     }
-    cells_.reserve(proto.cells_size());
-    for (const auto cell : proto.cells()) {
-      CHECK_LE(cell, std::numeric_limits<uint16>::max());
-      cells_.push_back(cell);
+    // Checking all cells at once lets both loops be vectorized.
+    uint32 all_bits = 0;
+    for (const uint32 cell : proto.cells()) {
+      all_bits |= cell;
     }
+    CHECK_LE(all_bits, std::numeric_limits<uint16>::max());
+    cells_.assign(proto.cells().begin(), proto.cells().end());
   }
 
   // Returns the limits of this ProbabilityGrid.
@@ -64,11 +66,19 @@ class ProbabilityGrid {
 
   // Finishes the update sequence.
   void FinishUpdate() {
-    while (!update_indices_.empty()) {
-      DCHECK_GE(cells_[update_indices_.back()], mapping::kUpdateMarker);
-      cells_[update_indices_.back()] -= mapping::kUpdateMarker;
-      update_indices_.pop_back();
+    for (const int flat_index : update_indices_) {
+      DCHECK_GE(cells_[flat_index], mapping::kUpdateMarker);
+      cells_[flat_index] -= mapping::kUpdateMarker;
     }
+    last_update_indices_.swap(update_indices_);
+    update_indices_.clear();
+  }
+
+  // Returns the indices into the cells, in row-major order with
+  // 'num_x_cells' columns, of the cells changed by the last update sequence.
+  // Growing the limits clears them.
+  const std::vector<int>& last_update_indices() const {
+    return last_update_indices_;
   }
 
   // Sets the probability of the cell at 'cell_index' to the given
@@ -103,6 +113,32 @@ class ProbabilityGrid {
     return true;
   }
 
+  // Like calling ApplyLookupTable() for each cell, but the cells are given by
+  // their 'flat_indices' in row-major order with 'num_x_cells' columns. These
+  // are not checked to be inside the limits, and the bounding box of known
+  // cells is not extended, which has to be done by ExtendKnownCellsBox().
+  void ApplyLookupTable(const std::vector<int>& flat_indices,
+                        const std::vector<uint16>& table) {
+    DCHECK_EQ(table.size(), mapping::kUpdateMarker);
+    for (const int flat_index : flat_indices) {
+      DCHECK_GE(flat_index, 0);
+      DCHECK_LT(flat_index, static_cast<int>(cells_.size()));
+      uint16& cell = cells_[flat_index];
+      if (cell < mapping::kUpdateMarker) {
+        update_indices_.push_back(flat_index);
+        cell = table[cell];
+      }
+    }
+  }
+
+  // Extends the bounding box of known cells by 'cell_box', which has to be
+  // inside the limits.
+  void ExtendKnownCellsBox(const Eigen::AlignedBox2i& cell_box) {
+    CHECK(limits_.Contains(cell_box.min().array()));
+    CHECK(limits_.Contains(cell_box.max().array()));
+    known_cells_box_.extend(cell_box);
+  }
+
   // Returns the probability of the cell with 'cell_index'.
   float GetProbability(const Eigen::Array2i& cell_index) const {
     if (limits_.Contains(cell_index)) {
@@ -159,12 +195,40 @@ class ProbabilityGrid {
       }
       cells_ = new_cells;
       limits_ = new_limits;
+      last_update_indices_.clear();
       if (!known_cells_box_.isEmpty()) {
         known_cells_box_.translate(Eigen::Vector2i(x_offset, y_offset));
       }
     }
   }
 
+  // Replaces the cells inside 'cell_box' (inclusive) by the cells of 'other',
+  // which must have the same limits. Must not be called during an update.
+  void CopyCellsFrom(const ProbabilityGrid& other,
+                     const Eigen::AlignedBox2i& cell_box) {
+    CHECK(update_indices_.empty());
+    CHECK(other.update_indices_.empty());
+    CHECK_EQ(limits_.cell_limits().num_x_cells,
+             other.limits_.cell_limits().num_x_cells);
+    CHECK_EQ(limits_.cell_limits().num_y_cells,
+             other.limits_.cell_limits().num_y_cells);
+    CHECK(limits_.Contains(cell_box.min().array()));
+    CHECK(limits_.Contains(cell_box.max().array()));
+    const int stride = limits_.cell_limits().num_x_cells;
+    for (int y = cell_box.min().y(); y <= cell_box.max().y(); ++y) {
+      std::copy(other.cells_.begin() + stride * y + cell_box.min().x(),
+                other.cells_.begin() + stride * y + cell_box.max().x() + 1,
+                cells_.begin() + stride * y + cell_box.min().x());
+    }
+    if (!other.known_cells_box_.isEmpty()) {
+      const Eigen::AlignedBox2i copied_known_cells_box =
+          other.known_cells_box_.intersection(cell_box);
+      if (!copied_known_cells_box.isEmpty()) {
+        known_cells_box_.extend(copied_known_cells_box);
+      }
+    }
+  }
+
   proto::ProbabilityGrid ToProto() const {
     proto::ProbabilityGrid result;
     *result.mutable_limits() = cartographer::mapping_2d::ToProto(limits_);
@@ -193,6 +257,7 @@ class ProbabilityGrid {
   MapLimits limits_;
   std::vector<uint16> cells_;  // Highest bit is update marker.
   std::vector<int> update_indices_;
+  std::vector<int> last_update_indices_;
 
   // Bounding box of known cells to efficiently compute cropping limits.
   Eigen::AlignedBox2i known_cells_box_;
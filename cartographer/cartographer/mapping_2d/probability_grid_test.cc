@@ -191,6 +191,85 @@ TEST(ProbabilityGridTest, CorrectCropping) {
   EXPECT_EQ(limits.num_y_cells, 200);
 }
 
+TEST(ProbabilityGridTest, CopyCellsFrom) {
+  const MapLimits limits(1., Eigen::Vector2d(10., 10.), CellLimits(10, 10));
+  ProbabilityGrid source(limits);
+  ProbabilityGrid destination(limits);
+  source.SetProbability(Eigen::Array2i(2, 3), 0.7);
+  source.SetProbability(Eigen::Array2i(8, 8), 0.3);
+  destination.SetProbability(Eigen::Array2i(3, 3), 0.6);
+  destination.SetProbability(Eigen::Array2i(9, 9), 0.2);
+  destination.CopyCellsFrom(source, Eigen::AlignedBox2i(Eigen::Vector2i(1, 1),
+                                                        Eigen::Vector2i(4, 4)));
+  EXPECT_NEAR(0.7, destination.GetProbability(Eigen::Array2i(2, 3)), 1e-3);
+  EXPECT_FALSE(destination.IsKnown(Eigen::Array2i(3, 3)));
+  EXPECT_FALSE(destination.IsKnown(Eigen::Array2i(8, 8)));
+  EXPECT_NEAR(0.2, destination.GetProbability(Eigen::Array2i(9, 9)), 1e-3);
+  Eigen::Array2i offset;
+  CellLimits cropped_limits;
+  destination.ComputeCroppedLimits(&offset, &cropped_limits);
+  EXPECT_TRUE((offset == Eigen::Array2i(2, 3)).all());
+  EXPECT_EQ(8, cropped_limits.num_x_cells);
+  EXPECT_EQ(7, cropped_limits.num_y_cells);
+}
+
+TEST(ProbabilityGridTest, LastUpdateIndices) {
+  ProbabilityGrid probability_grid(
+      MapLimits(1., Eigen::Vector2d(1., 1.), CellLimits(2, 3)));
+  const std::vector<uint16> table =
+      mapping::ComputeLookupTableToApplyOdds(mapping::Odds(0.9));
+  EXPECT_TRUE(probability_grid.last_update_indices().empty());
+
+  probability_grid.ApplyLookupTable(Eigen::Array2i(1, 0), table);
+  probability_grid.ApplyLookupTable(Eigen::Array2i(0, 2), table);
+  probability_grid.ApplyLookupTable(Eigen::Array2i(1, 0), table);
+  EXPECT_TRUE(probability_grid.last_update_indices().empty());
+  probability_grid.FinishUpdate();
+  EXPECT_EQ(std::vector<int>({1, 4}), probability_grid.last_update_indices());
+
+  probability_grid.ApplyLookupTable(Eigen::Array2i(1, 1), table);
+  probability_grid.FinishUpdate();
+  EXPECT_EQ(std::vector<int>({3}), probability_grid.last_update_indices());
+
+  probability_grid.GrowLimits(Eigen::Vector2f(-3.f, -3.f));
+  EXPECT_TRUE(probability_grid.last_update_indices().empty());
+}
+
+TEST(ProbabilityGridTest, ApplyLookupTableToFlatIndices) {
+  ProbabilityGrid probability_grid(
+      MapLimits(1., Eigen::Vector2d(1., 1.), CellLimits(3, 2)));
+  ProbabilityGrid expected_probability_grid(probability_grid.limits());
+  const std::vector<uint16> table =
+      mapping::ComputeLookupTableToApplyOdds(mapping::Odds(0.9));
+
+  // Cells (1, 0) and (1, 1), the former twice.
+  probability_grid.ApplyLookupTable(std::vector<int>({1, 4, 1}), table);
+  probability_grid.ExtendKnownCellsBox(
+      Eigen::AlignedBox2i(Eigen::Vector2i(1, 0), Eigen::Vector2i(1, 1)));
+  probability_grid.FinishUpdate();
+  expected_probability_grid.ApplyLookupTable(Eigen::Array2i(1, 0), table);
+  expected_probability_grid.ApplyLookupTable(Eigen::Array2i(1, 1), table);
+  expected_probability_grid.ApplyLookupTable(Eigen::Array2i(1, 0), table);
+  expected_probability_grid.FinishUpdate();
+
+  EXPECT_EQ(std::vector<int>({1, 4}), probability_grid.last_update_indices());
+  for (int x = 0; x != 3; ++x) {
+    for (int y = 0; y != 2; ++y) {
+      const Eigen::Array2i cell_index(x, y);
+      EXPECT_EQ(expected_probability_grid.IsKnown(cell_index),
+                probability_grid.IsKnown(cell_index));
+      EXPECT_EQ(expected_probability_grid.GetProbability(cell_index),
+                probability_grid.GetProbability(cell_index));
+    }
+  }
+  Eigen::Array2i offset;
+  CellLimits limits;
+  probability_grid.ComputeCroppedLimits(&offset, &limits);
+  EXPECT_TRUE((offset == Eigen::Array2i(1, 0)).all());
+  EXPECT_EQ(1, limits.num_x_cells);
+  EXPECT_EQ(2, limits.num_y_cells);
+}
+
 }  // namespace
 }  // namespace mapping_2d
 }  // namespace cartographer
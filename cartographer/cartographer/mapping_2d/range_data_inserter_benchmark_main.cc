@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the insertion of range data into a ProbabilityGrid. Scans of a
+// square room are simulated from poses along a circle, with beams longer than
+// the maximum range inserted as misses.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "cartographer/common/port.h"
+#include "cartographer/mapping_2d/probability_grid.h"
+#include "cartographer/mapping_2d/range_data_inserter.h"
+#include "cartographer/sensor/range_data.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_int32(num_beams, 1080, "Number of beams per scan.");
+DEFINE_double(max_range, 30., "Maximum range of the beams in meters.");
+DEFINE_double(room_size, 50., "Side length of the simulated room in meters.");
+DEFINE_double(resolution, 0.05, "Resolution of the grid in meters.");
+DEFINE_int32(num_scans, 200, "Number of scans inserted.");
+
+namespace cartographer {
+namespace mapping_2d {
+namespace {
+
+// The defaults of 'trajectory_builder_2d.lua'.
+proto::RangeDataInserterOptions CreateRangeDataInserterOptions() {
+  proto::RangeDataInserterOptions options;
+  options.set_hit_probability(0.55);
+  options.set_miss_probability(0.49);
+  options.set_insert_free_space(true);
+  return options;
+}
+
+sensor::RangeData SimulateScan(const Eigen::Vector2f& origin) {
+  const float half_size = FLAGS_room_size / 2.;
+  sensor::RangeData range_data{Eigen::Vector3f(origin.x(), origin.y(), 0.f),
+                               {},
+                               {}};
+  for (int i = 0; i != FLAGS_num_beams; ++i) {
+    const float angle = 2. * M_PI * i / FLAGS_num_beams;
+    const Eigen::Vector2f direction(std::cos(angle), std::sin(angle));
+    // Distance to the closest wall along 'direction'.
+    float range = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis != 2; ++axis) {
+      if (direction[axis] != 0.f) {
+        const float wall = direction[axis] > 0.f ? half_size : -half_size;
+        range = std::min(range, (wall - origin[axis]) / direction[axis]);
+      }
+    }
+    if (range <= FLAGS_max_range) {
+      const Eigen::Vector2f hit = origin + range * direction;
+      range_data.returns.emplace_back(hit.x(), hit.y(), 0.f);
+    } else {
+      const Eigen::Vector2f miss =
+          origin + static_cast<float>(FLAGS_max_range) * direction;
+      range_data.misses.emplace_back(miss.x(), miss.y(), 0.f);
+    }
+  }
+  return range_data;
+}
+
+void Run() {
+  std::vector<sensor::RangeData> scans;
+  for (int i = 0; i != FLAGS_num_scans; ++i) {
+    const float angle = 2. * M_PI * i / FLAGS_num_scans;
+    scans.push_back(SimulateScan(0.25f * FLAGS_room_size *
+                                 Eigen::Vector2f(std::cos(angle),
+                                                 std::sin(angle))));
+  }
+
+  const RangeDataInserter range_data_inserter(
+      CreateRangeDataInserterOptions());
+  // Start with a grid covering the room, so that growing it is not timed.
+  const int num_cells =
+      common::RoundToInt(FLAGS_room_size / FLAGS_resolution) + 2;
+  ProbabilityGrid probability_grid(MapLimits(
+      FLAGS_resolution,
+      Eigen::Vector2d(FLAGS_room_size / 2. + FLAGS_resolution,
+                      FLAGS_room_size / 2. + FLAGS_resolution),
+      CellLimits(num_cells, num_cells)));
+
+  int64 num_updated_cells = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const sensor::RangeData& range_data : scans) {
+    range_data_inserter.Insert(range_data, &probability_grid);
+    num_updated_cells += probability_grid.last_update_indices().size();
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << std::fixed << std::setprecision(6)
+            << seconds / FLAGS_num_scans << " s per scan, "
+            << std::setprecision(1) << FLAGS_num_scans / seconds
+            << " scans per second, " << num_updated_cells / seconds / 1e6
+            << " million updated cells per second\n";
+}
+
+}  // namespace
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  google::SetUsageMessage(
+      "\n\n"
+      "Benchmarks the insertion of simulated 2D range data into a\n"
+      "probability grid.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_GT(FLAGS_num_beams, 0);
+  CHECK_GT(FLAGS_num_scans, 0);
+  ::cartographer::mapping_2d::Run();
+}
@@ -26,13 +26,14 @@ constexpr int kSubpixelScale = 1000;
 
 // We divide each pixel in kSubpixelScale x kSubpixelScale subpixels. 'begin'
 // and 'end' are coordinates at subpixel precision. We compute all pixels in
-// which some part of the line segment connecting 'begin' and 'end' lies.
+// which some part of the line segment connecting 'begin' and 'end' lies and
+// append their indices in row-major order with 'num_x_cells' columns to
+// 'cells'.
 void CastRay(const Eigen::Array2i& begin, const Eigen::Array2i& end,
-             const std::vector<uint16>& miss_table,
-             ProbabilityGrid* const probability_grid) {
+             const int num_x_cells, std::vector<int>* const cells) {
   // For simplicity, we order 'begin' and 'end' by their x coordinate.
   if (begin.x() > end.x()) {
-    CastRay(end, begin, miss_table, probability_grid);
+    CastRay(end, begin, num_x_cells, cells);
     return;
   }
 
@@ -47,7 +48,7 @@ void CastRay(const Eigen::Array2i& begin, const Eigen::Array2i& end,
                            std::min(begin.y(), end.y()) / kSubpixelScale);
     const int end_y = std::max(begin.y(), end.y()) / kSubpixelScale;
     for (; current.y() <= end_y; ++current.y()) {
-      probability_grid->ApplyLookupTable(current, miss_table);
+      cells->push_back(current.x() + current.y() * num_x_cells);
     }
     return;
   }
@@ -87,11 +88,11 @@ void CastRay(const Eigen::Array2i& begin, const Eigen::Array2i& end,
   sub_y += dy * first_pixel;
   if (dy > 0) {
     while (true) {
-      probability_grid->ApplyLookupTable(current, miss_table);
+      cells->push_back(current.x() + current.y() * num_x_cells);
       while (sub_y > denominator) {
         sub_y -= denominator;
         ++current.y();
-        probability_grid->ApplyLookupTable(current, miss_table);
+        cells->push_back(current.x() + current.y() * num_x_cells);
       }
       ++current.x();
       if (sub_y == denominator) {
@@ -106,11 +107,11 @@ void CastRay(const Eigen::Array2i& begin, const Eigen::Array2i& end,
     }
     // Move from the pixel border on the right to 'end'.
     sub_y += dy * last_pixel;
-    probability_grid->ApplyLookupTable(current, miss_table);
+    cells->push_back(current.x() + current.y() * num_x_cells);
     while (sub_y > denominator) {
       sub_y -= denominator;
       ++current.y();
-      probability_grid->ApplyLookupTable(current, miss_table);
+      cells->push_back(current.x() + current.y() * num_x_cells);
     }
     CHECK_NE(sub_y, denominator);
     CHECK_EQ(current.y(), end.y() / kSubpixelScale);
@@ -119,11 +120,11 @@ void CastRay(const Eigen::Array2i& begin, const Eigen::Array2i& end,
 
   // Same for lines non-ascending in y coordinates.
   while (true) {
-    probability_grid->ApplyLookupTable(current, miss_table);
+    cells->push_back(current.x() + current.y() * num_x_cells);
     while (sub_y < 0) {
       sub_y += denominator;
       --current.y();
-      probability_grid->ApplyLookupTable(current, miss_table);
+      cells->push_back(current.x() + current.y() * num_x_cells);
     }
     ++current.x();
     if (sub_y == 0) {
@@ -136,11 +137,11 @@ void CastRay(const Eigen::Array2i& begin, const Eigen::Array2i& end,
     sub_y += dy * 2 * kSubpixelScale;
   }
   sub_y += dy * last_pixel;
-  probability_grid->ApplyLookupTable(current, miss_table);
+  cells->push_back(current.x() + current.y() * num_x_cells);
   while (sub_y < 0) {
     sub_y += denominator;
     --current.y();
-    probability_grid->ApplyLookupTable(current, miss_table);
+    cells->push_back(current.x() + current.y() * num_x_cells);
   }
   CHECK_NE(sub_y, 0);
   CHECK_EQ(current.y(), end.y() / kSubpixelScale);
@@ -172,6 +173,7 @@ void CastRays(const sensor::RangeData& range_data,
   GrowAsNeeded(range_data, probability_grid);
 
   const MapLimits& limits = probability_grid->limits();
+  const int num_x_cells = limits.cell_limits().num_x_cells;
   const double superscaled_resolution = limits.resolution() / kSubpixelScale;
   const MapLimits superscaled_limits(
       superscaled_resolution, limits.max(),
@@ -179,28 +181,48 @@ void CastRays(const sensor::RangeData& range_data,
                  limits.cell_limits().num_y_cells * kSubpixelScale));
   const Eigen::Array2i begin =
       superscaled_limits.GetCellIndex(range_data.origin.head<2>());
-  // Compute and add the end points.
+  // Compute and add the end points. Rays only touch cells within the bounding
+  // box of their end points, so the box of known cells is extended once.
   std::vector<Eigen::Array2i> ends;
   ends.reserve(range_data.returns.size());
+  std::vector<int> cells;
+  cells.reserve(range_data.returns.size());
+  Eigen::AlignedBox2i cell_box;
   for (const Eigen::Vector3f& hit : range_data.returns) {
     ends.push_back(superscaled_limits.GetCellIndex(hit.head<2>()));
-    probability_grid->ApplyLookupTable(ends.back() / kSubpixelScale, hit_table);
+    const Eigen::Array2i cell = ends.back() / kSubpixelScale;
+    cells.push_back(cell.x() + cell.y() * num_x_cells);
+    cell_box.extend(cell.matrix());
   }
+  probability_grid->ApplyLookupTable(cells, hit_table);
 
-  if (!insert_free_space) {
+  if (!insert_free_space ||
+      (range_data.returns.empty() && range_data.misses.empty())) {
+    if (!cell_box.isEmpty()) {
+      probability_grid->ExtendKnownCellsBox(cell_box);
+    }
     return;
   }
+  cell_box.extend((begin / kSubpixelScale).matrix());
 
-  // Now add the misses.
+  // Now add the misses. Each ray is rasterized into 'cells' first, so that the
+  // lookup table is applied in a tight loop.
   for (const Eigen::Array2i& end : ends) {
-    CastRay(begin, end, miss_table, probability_grid);
+    cells.clear();
+    CastRay(begin, end, num_x_cells, &cells);
+    probability_grid->ApplyLookupTable(cells, miss_table);
   }
 
   // Finally, compute and add empty rays based on misses in the scan.
   for (const Eigen::Vector3f& missing_echo : range_data.misses) {
-    CastRay(begin, superscaled_limits.GetCellIndex(missing_echo.head<2>()),
-            miss_table, probability_grid);
+    const Eigen::Array2i end =
+        superscaled_limits.GetCellIndex(missing_echo.head<2>());
+    cell_box.extend((end / kSubpixelScale).matrix());
+    cells.clear();
+    CastRay(begin, end, num_x_cells, &cells);
+    probability_grid->ApplyLookupTable(cells, miss_table);
   }
+  probability_grid->ExtendKnownCellsBox(cell_box);
 }
 
 }  // namespace mapping_2d
@@ -43,6 +43,8 @@ proto::CeresScanMatcherOptions CreateCeresScanMatcherOptions(
       parameter_dictionary->GetDouble("translation_weight"));
   options.set_rotation_weight(
       parameter_dictionary->GetDouble("rotation_weight"));
+  options.set_use_analytical_jacobians(
+      parameter_dictionary->GetBool("use_analytical_jacobians"));
   *options.mutable_ceres_solver_options() =
       common::CreateCeresSolverOptionsProto(
           parameter_dictionary->GetDictionary("ceres_solver_options").get());
@@ -65,19 +67,35 @@ void CeresScanMatcher::Match(const transform::Rigid2d& previous_pose,
                              const ProbabilityGrid& probability_grid,
                              transform::Rigid2d* const pose_estimate,
                              ceres::Solver::Summary* const summary) const {
+  Match(previous_pose, initial_pose_estimate, point_cloud,
+        InterpolationGrid(probability_grid), pose_estimate, summary);
+}
+
+void CeresScanMatcher::Match(const transform::Rigid2d& previous_pose,
+                             const transform::Rigid2d& initial_pose_estimate,
+                             const sensor::PointCloud& point_cloud,
+                             const InterpolationGrid& interpolation_grid,
+                             transform::Rigid2d* const pose_estimate,
+                             ceres::Solver::Summary* const summary) const {
   double ceres_pose_estimate[3] = {initial_pose_estimate.translation().x(),
                                    initial_pose_estimate.translation().y(),
                                    initial_pose_estimate.rotation().angle()};
   ceres::Problem problem;
   CHECK_GT(options_.occupied_space_weight(), 0.);
+  const double occupied_space_scaling_factor =
+      options_.occupied_space_weight() /
+      std::sqrt(static_cast<double>(point_cloud.size()));
   problem.AddResidualBlock(
-      new ceres::AutoDiffCostFunction<OccupiedSpaceCostFunctor, ceres::DYNAMIC,
-                                      3>(
-          new OccupiedSpaceCostFunctor(
-              options_.occupied_space_weight() /
-                  std::sqrt(static_cast<double>(point_cloud.size())),
-              point_cloud, probability_grid),
-          point_cloud.size()),
+      options_.use_analytical_jacobians()
+          ? static_cast<ceres::CostFunction*>(
+                new AnalyticalOccupiedSpaceCostFunction(
+                    occupied_space_scaling_factor, point_cloud,
+                    interpolation_grid))
+          : new ceres::AutoDiffCostFunction<OccupiedSpaceCostFunctor,
+                                            ceres::DYNAMIC, 3>(
+                new OccupiedSpaceCostFunctor(occupied_space_scaling_factor,
+                                             point_cloud, interpolation_grid),
+                point_cloud.size()),
       nullptr, ceres_pose_estimate);
   CHECK_GT(options_.translation_weight(), 0.);
   problem.AddResidualBlock(
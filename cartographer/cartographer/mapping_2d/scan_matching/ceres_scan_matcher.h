@@ -23,6 +23,7 @@
 #include "Eigen/Core"
 #include "cartographer/common/lua_parameter_dictionary.h"
 #include "cartographer/mapping_2d/probability_grid.h"
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
 #include "cartographer/mapping_2d/scan_matching/proto/ceres_scan_matcher_options.pb.h"
 #include "cartographer/sensor/point_cloud.h"
 #include "ceres/ceres.h"
@@ -53,6 +54,16 @@ class CeresScanMatcher {
              transform::Rigid2d* pose_estimate,
              ceres::Solver::Summary* summary) const;
 
+  // Same as above, but matches against an 'interpolation_grid' which can be
+  // reused for many scans instead of converting the 'probability_grid' each
+  // time.
+  void Match(const transform::Rigid2d& previous_pose,
+             const transform::Rigid2d& initial_pose_estimate,
+             const sensor::PointCloud& point_cloud,
+             const InterpolationGrid& interpolation_grid,
+             transform::Rigid2d* pose_estimate,
+             ceres::Solver::Summary* summary) const;
+
  private:
   const proto::CeresScanMatcherOptions options_;
   ceres::Solver::Options ceres_solver_options_;
@@ -47,15 +47,15 @@ class CeresScanMatcherTest : public ::testing::Test {
           occupied_space_weight = 1.,
           translation_weight = 0.1,
           rotation_weight = 1.5,
+          use_analytical_jacobians = false,
           ceres_solver_options = {
             use_nonmonotonic_steps = true,
             max_num_iterations = 50,
             num_threads = 1,
           },
         })text");
-    const proto::CeresScanMatcherOptions options =
-        CreateCeresScanMatcherOptions(parameter_dictionary.get());
-    ceres_scan_matcher_ = common::make_unique<CeresScanMatcher>(options);
+    options_ = CreateCeresScanMatcherOptions(parameter_dictionary.get());
+    ceres_scan_matcher_ = common::make_unique<CeresScanMatcher>(options_);
   }
 
   void TestFromInitialPose(const transform::Rigid2d& initial_pose) {
@@ -73,6 +73,7 @@ class CeresScanMatcherTest : public ::testing::Test {
 
   ProbabilityGrid probability_grid_;
   sensor::PointCloud point_cloud_;
+  proto::CeresScanMatcherOptions options_;
   std::unique_ptr<CeresScanMatcher> ceres_scan_matcher_;
 };
 
@@ -92,6 +93,12 @@ TEST_F(CeresScanMatcherTest, testOptimizeAlongXY) {
   TestFromInitialPose(transform::Rigid2d::Translation({-0.3, 0.3}));
 }
 
+TEST_F(CeresScanMatcherTest, testOptimizeAlongXYWithAnalyticalJacobians) {
+  options_.set_use_analytical_jacobians(true);
+  ceres_scan_matcher_ = common::make_unique<CeresScanMatcher>(options_);
+  TestFromInitialPose(transform::Rigid2d::Translation({-0.3, 0.3}));
+}
+
 }  // namespace
 }  // namespace scan_matching
 }  // namespace mapping_2d
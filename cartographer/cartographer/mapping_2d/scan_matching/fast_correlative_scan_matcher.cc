@@ -18,9 +18,9 @@
 
 #include <algorithm>
 #include <cmath>
-#include <deque>
 #include <functional>
 #include <limits>
+#include <memory>
 
 #include "Eigen/Geometry"
 #include "cartographer/common/math.h"
@@ -37,42 +37,71 @@ namespace {
 
 // A collection of values which can be added and later removed, and the maximum
 // of the current values in the collection can be retrieved.
-// All of it in (amortized) O(1).
+// All of it in (amortized) O(1). Since at most 'max_num_values' values are in
+// the collection at any time, a fixed ring buffer holds the maxima.
 class SlidingWindowMaximum {
  public:
+  explicit SlidingWindowMaximum(const int max_num_values)
+      : non_ascending_maxima_(max_num_values) {}
+
   void AddValue(const float value) {
-    while (!non_ascending_maxima_.empty() &&
-           value > non_ascending_maxima_.back()) {
-      non_ascending_maxima_.pop_back();
+    while (size_ > 0 && value > non_ascending_maxima_[ToIndex(size_ - 1)]) {
+      --size_;
     }
-    non_ascending_maxima_.push_back(value);
+    DCHECK_LT(size_, static_cast<int>(non_ascending_maxima_.size()));
+    non_ascending_maxima_[ToIndex(size_)] = value;
+    ++size_;
   }
 
   void RemoveValue(const float value) {
     // DCHECK for performance, since this is done for every value in the
     // precomputation grid.
-    DCHECK(!non_ascending_maxima_.empty());
-    DCHECK_LE(value, non_ascending_maxima_.front());
-    if (value == non_ascending_maxima_.front()) {
-      non_ascending_maxima_.pop_front();
+    DCHECK_GT(size_, 0);
+    DCHECK_LE(value, non_ascending_maxima_[begin_]);
+    if (value == non_ascending_maxima_[begin_]) {
+      begin_ = ToIndex(1);
+      --size_;
     }
   }
 
   float GetMaximum() const {
     // DCHECK for performance, since this is done for every value in the
     // precomputation grid.
-    DCHECK_GT(non_ascending_maxima_.size(), 0);
-    return non_ascending_maxima_.front();
+    DCHECK_GT(size_, 0);
+    return non_ascending_maxima_[begin_];
   }
 
-  void CheckIsEmpty() const { CHECK_EQ(non_ascending_maxima_.size(), 0); }
+  void CheckIsEmpty() const { CHECK_EQ(size_, 0); }
 
  private:
-  // Maximum of the current sliding window at the front. Then the maximum of the
-  // remaining window that came after this values first occurence, and so on.
-  std::deque<float> non_ascending_maxima_;
+  // Returns the index into 'non_ascending_maxima_' of the 'i'-th maximum.
+  int ToIndex(const int i) const {
+    const int index = begin_ + i;
+    const int capacity = non_ascending_maxima_.size();
+    return index < capacity ? index : index - capacity;
+  }
+
+  // Ring buffer of 'size_' values starting at 'begin_'. Maximum of the current
+  // sliding window at the front. Then the maximum of the remaining window that
+  // came after this values first occurence, and so on.
+  std::vector<float> non_ascending_maxima_;
+  int begin_ = 0;
+  int size_ = 0;
 };
 
+// Calls 'function' for all rows in [0, num_rows), in parallel if 'thread_pool'
+// is not null.
+void ForEachRow(const int num_rows, common::ThreadPool* const thread_pool,
+                const std::function<void(int)>& function) {
+  if (thread_pool == nullptr) {
+    for (int y = 0; y != num_rows; ++y) {
+      function(y);
+    }
+    return;
+  }
+  thread_pool->ParallelFor(num_rows, function);
+}
+
 }  // namespace
 
 proto::FastCorrelativeScanMatcherOptions
@@ -94,7 +123,8 @@ PrecomputationGrid::PrecomputationGrid(
     : offset_(-width + 1, -width + 1),
       wide_limits_(limits.num_x_cells + width - 1,
                    limits.num_y_cells + width - 1),
-      cells_(wide_limits_.num_x_cells * wide_limits_.num_y_cells) {
+      cells_(wide_limits_.num_x_cells * wide_limits_.num_y_cells +
+             kScoringKernelCellPadding) {
   CHECK_GE(width, 1);
   CHECK_GE(limits.num_x_cells, 1);
   CHECK_GE(limits.num_y_cells, 1);
@@ -103,8 +133,8 @@ PrecomputationGrid::PrecomputationGrid(
   // span defined by x0 <= x < x0 + width.
   std::vector<float>& intermediate = *reusable_intermediate_grid;
   intermediate.resize(wide_limits_.num_x_cells * limits.num_y_cells);
+  SlidingWindowMaximum current_values(width);
   for (int y = 0; y != limits.num_y_cells; ++y) {
-    SlidingWindowMaximum current_values;
     current_values.AddValue(
         probability_grid.GetProbability(Eigen::Array2i(0, y)));
     for (int x = -width + 1; x != 0; ++x) {
@@ -133,7 +163,6 @@ PrecomputationGrid::PrecomputationGrid(
   // region starting at each (x, y) and precompute the resulting bound on the
   // score.
   for (int x = 0; x != wide_limits_.num_x_cells; ++x) {
-    SlidingWindowMaximum current_values;
     current_values.AddValue(intermediate[x]);
     for (int y = -width + 1; y != 0; ++y) {
       cells_[x + (y + width - 1) * stride] =
@@ -158,6 +187,75 @@ PrecomputationGrid::PrecomputationGrid(
   }
 }
 
+PrecomputationGrid::PrecomputationGrid(
+    const ProbabilityGrid& probability_grid,
+    common::ThreadPool* const thread_pool)
+    : offset_(0, 0),
+      wide_limits_(probability_grid.limits().cell_limits()),
+      cells_(wide_limits_.num_x_cells * wide_limits_.num_y_cells +
+             kScoringKernelCellPadding) {
+  const int stride = wide_limits_.num_x_cells;
+  ForEachRow(wide_limits_.num_y_cells, thread_pool, [&](const int y) {
+    for (int x = 0; x != stride; ++x) {
+      cells_[x + y * stride] = ComputeCellValue(
+          probability_grid.GetProbability(Eigen::Array2i(x, y)));
+    }
+  });
+}
+
+PrecomputationGrid::PrecomputationGrid(const PrecomputationGrid& finer_grid,
+                                       common::ThreadPool* const thread_pool)
+    : offset_(2 * finer_grid.offset_ - 1),
+      wide_limits_(finer_grid.wide_limits_.num_x_cells + finer_grid.width(),
+                   finer_grid.wide_limits_.num_y_cells + finer_grid.width()),
+      cells_(wide_limits_.num_x_cells * wide_limits_.num_y_cells +
+             kScoringKernelCellPadding) {
+  // The square of our width at a cell is covered by the four squares of the
+  // finer grid at the same cell and 'finer_width' cells further in x and y.
+  // In local indices, these are the cells (x - finer_width, y - finer_width),
+  // (x, y - finer_width), (x - finer_width, y) and (x, y) of 'finer_grid'.
+  const int finer_width = finer_grid.width();
+  const int finer_stride = finer_grid.wide_limits_.num_x_cells;
+  const int finer_num_rows = finer_grid.wide_limits_.num_y_cells;
+  const int stride = wide_limits_.num_x_cells;
+  ForEachRow(wide_limits_.num_y_cells, thread_pool, [&](const int y) {
+    std::vector<uint8> row_maxima(finer_stride, 0);
+    for (const int finer_y : {y - finer_width, y}) {
+      if (finer_y < 0 || finer_y >= finer_num_rows) {
+        continue;
+      }
+      const uint8* const finer_row = &finer_grid.cells_[finer_y * finer_stride];
+      for (int x = 0; x != finer_stride; ++x) {
+        row_maxima[x] = std::max(row_maxima[x], finer_row[x]);
+      }
+    }
+    uint8* const row = &cells_[y * stride];
+    for (int x = 0; x != stride; ++x) {
+      row[x] = std::max(x >= finer_width ? row_maxima[x - finer_width] : 0,
+                        x < finer_stride ? row_maxima[x] : 0);
+    }
+  });
+}
+
+PrecomputationGrid::PrecomputationGrid(const proto::PrecomputationGrid& proto)
+    : offset_(-proto.width() + 1, -proto.width() + 1),
+      wide_limits_(proto.wide_limits()),
+      cells_(proto.cells().begin(), proto.cells().end()) {
+  CHECK_GE(proto.width(), 1);
+  CHECK_EQ(static_cast<int>(cells_.size()),
+           wide_limits_.num_x_cells * wide_limits_.num_y_cells);
+  cells_.resize(cells_.size() + kScoringKernelCellPadding);
+}
+
+proto::PrecomputationGrid PrecomputationGrid::ToProto() const {
+  proto::PrecomputationGrid result;
+  result.set_width(width());
+  *result.mutable_wide_limits() = mapping_2d::ToProto(wide_limits_);
+  result.set_cells(reinterpret_cast<const char*>(cells_.data()),
+                   cells_.size() - kScoringKernelCellPadding);
+  return result;
+}
+
 uint8 PrecomputationGrid::ComputeCellValue(const float probability) const {
   const int cell_value = common::RoundToInt(
       (probability - mapping::kMinProbability) *
@@ -167,42 +265,64 @@ uint8 PrecomputationGrid::ComputeCellValue(const float probability) const {
   return cell_value;
 }
 
-class PrecomputationGridStack {
- public:
-  PrecomputationGridStack(
-      const ProbabilityGrid& probability_grid,
-      const proto::FastCorrelativeScanMatcherOptions& options) {
-    CHECK_GE(options.branch_and_bound_depth(), 1);
-    const int max_width = 1 << (options.branch_and_bound_depth() - 1);
-    precomputation_grids_.reserve(options.branch_and_bound_depth());
-    std::vector<float> reusable_intermediate_grid;
-    const CellLimits limits = probability_grid.limits().cell_limits();
-    reusable_intermediate_grid.reserve((limits.num_x_cells + max_width - 1) *
-                                       limits.num_y_cells);
-    for (int i = 0; i != options.branch_and_bound_depth(); ++i) {
-      const int width = 1 << i;
-      precomputation_grids_.emplace_back(probability_grid, limits, width,
-                                         &reusable_intermediate_grid);
-    }
+PrecomputationGridStack::PrecomputationGridStack(
+    const ProbabilityGrid& probability_grid,
+    const proto::FastCorrelativeScanMatcherOptions& options,
+    common::ThreadPool* const thread_pool)
+    : limits_(probability_grid.limits()) {
+  CHECK_GE(options.branch_and_bound_depth(), 1);
+  // Reserving ensures that references to the previous grid stay valid.
+  precomputation_grids_.reserve(options.branch_and_bound_depth());
+  precomputation_grids_.emplace_back(probability_grid, thread_pool);
+  for (int i = 1; i != options.branch_and_bound_depth(); ++i) {
+    precomputation_grids_.emplace_back(precomputation_grids_.back(),
+                                       thread_pool);
   }
+}
 
-  const PrecomputationGrid& Get(int index) {
-    return precomputation_grids_[index];
+PrecomputationGridStack::PrecomputationGridStack(
+    const proto::PrecomputationGridStack& proto)
+    : limits_(proto.limits()) {
+  CHECK_GE(proto.precomputation_grids_size(), 1);
+  precomputation_grids_.reserve(proto.precomputation_grids_size());
+  for (const auto& precomputation_grid : proto.precomputation_grids()) {
+    precomputation_grids_.emplace_back(precomputation_grid);
+    CHECK_EQ(precomputation_grids_.back().width(),
+             1 << (precomputation_grids_.size() - 1));
   }
+}
 
-  int max_depth() const { return precomputation_grids_.size() - 1; }
-
- private:
-  std::vector<PrecomputationGrid> precomputation_grids_;
-};
+proto::PrecomputationGridStack PrecomputationGridStack::ToProto() const {
+  proto::PrecomputationGridStack result;
+  *result.mutable_limits() = mapping_2d::ToProto(limits_);
+  for (const PrecomputationGrid& precomputation_grid : precomputation_grids_) {
+    *result.add_precomputation_grids() = precomputation_grid.ToProto();
+  }
+  return result;
+}
 
 FastCorrelativeScanMatcher::FastCorrelativeScanMatcher(
     const ProbabilityGrid& probability_grid,
-    const proto::FastCorrelativeScanMatcherOptions& options)
+    const proto::FastCorrelativeScanMatcherOptions& options,
+    const ScoringKernel scoring_kernel)
+    : FastCorrelativeScanMatcher(
+          std::make_shared<const PrecomputationGridStack>(
+              probability_grid, options, nullptr /* thread_pool */),
+          options, scoring_kernel) {}
+
+FastCorrelativeScanMatcher::FastCorrelativeScanMatcher(
+    std::shared_ptr<const PrecomputationGridStack> precomputation_grid_stack,
+    const proto::FastCorrelativeScanMatcherOptions& options,
+    const ScoringKernel scoring_kernel)
     : options_(options),
-      limits_(probability_grid.limits()),
-      precomputation_grid_stack_(
-          new PrecomputationGridStack(probability_grid, options)) {}
+      scoring_kernel_(scoring_kernel),
+      limits_(precomputation_grid_stack->limits()),
+      precomputation_grid_stack_(std::move(precomputation_grid_stack)) {
+  CHECK_EQ(precomputation_grid_stack_->max_depth() + 1,
+           options_.branch_and_bound_depth());
+  CHECK(IsScoringKernelSupported(scoring_kernel_))
+      << ScoringKernelToString(scoring_kernel_);
+}
 
 FastCorrelativeScanMatcher::~FastCorrelativeScanMatcher() {}
 
@@ -214,12 +334,22 @@ bool FastCorrelativeScanMatcher::Match(
                                            options_.angular_search_window(),
                                            point_cloud, limits_.resolution());
   return MatchWithSearchParameters(search_parameters, initial_pose_estimate,
-                                   point_cloud, min_score, score,
+                                   point_cloud, min_score,
+                                   nullptr /* shared_min_score */, score,
                                    pose_estimate);
 }
 
 bool FastCorrelativeScanMatcher::MatchFullSubmap(
-    const sensor::PointCloud& point_cloud, float min_score, float* score,
+    const sensor::PointCloud& point_cloud, const float min_score, float* score,
+    transform::Rigid2d* pose_estimate) const {
+  const std::atomic<float> shared_min_score(min_score);
+  return MatchFullSubmap(point_cloud, min_score, shared_min_score, score,
+                         pose_estimate);
+}
+
+bool FastCorrelativeScanMatcher::MatchFullSubmap(
+    const sensor::PointCloud& point_cloud, const float min_score,
+    const std::atomic<float>& shared_min_score, float* score,
     transform::Rigid2d* pose_estimate) const {
   // Compute a search window around the center of the submap that includes it
   // fully.
@@ -232,13 +362,15 @@ bool FastCorrelativeScanMatcher::MatchFullSubmap(
                           Eigen::Vector2d(limits_.cell_limits().num_y_cells,
                                           limits_.cell_limits().num_x_cells));
   return MatchWithSearchParameters(search_parameters, center, point_cloud,
-                                   min_score, score, pose_estimate);
+                                   min_score, &shared_min_score, score,
+                                   pose_estimate);
 }
 
 bool FastCorrelativeScanMatcher::MatchWithSearchParameters(
     SearchParameters search_parameters,
     const transform::Rigid2d& initial_pose_estimate,
-    const sensor::PointCloud& point_cloud, float min_score, float* score,
+    const sensor::PointCloud& point_cloud, float min_score,
+    const std::atomic<float>* const shared_min_score, float* score,
     transform::Rigid2d* pose_estimate) const {
   CHECK_NOTNULL(score);
   CHECK_NOTNULL(pose_estimate);
@@ -255,13 +387,18 @@ bool FastCorrelativeScanMatcher::MatchWithSearchParameters(
       Eigen::Translation2f(initial_pose_estimate.translation().x(),
                            initial_pose_estimate.translation().y()));
   search_parameters.ShrinkToFit(discrete_scans, limits_.cell_limits());
+  const std::vector<PackedDiscreteScan> packed_discrete_scans(
+      discrete_scans.begin(), discrete_scans.end());
 
   const std::vector<Candidate> lowest_resolution_candidates =
-      ComputeLowestResolutionCandidates(discrete_scans, search_parameters);
+      ComputeLowestResolutionCandidates(packed_discrete_scans,
+                                        search_parameters);
   const Candidate best_candidate = BranchAndBound(
-      discrete_scans, search_parameters, lowest_resolution_candidates,
-      precomputation_grid_stack_->max_depth(), min_score);
-  if (best_candidate.score > min_score) {
+      packed_discrete_scans, search_parameters, lowest_resolution_candidates,
+      precomputation_grid_stack_->max_depth(), min_score, shared_min_score);
+  if (best_candidate.score > min_score &&
+      (shared_min_score == nullptr ||
+       best_candidate.score > shared_min_score->load())) {
     *score = best_candidate.score;
     *pose_estimate = transform::Rigid2d(
         {initial_pose_estimate.translation().x() + best_candidate.x,
@@ -274,7 +411,7 @@ bool FastCorrelativeScanMatcher::MatchWithSearchParameters(
 
 std::vector<Candidate>
 FastCorrelativeScanMatcher::ComputeLowestResolutionCandidates(
-    const std::vector<DiscreteScan>& discrete_scans,
+    const std::vector<PackedDiscreteScan>& discrete_scans,
     const SearchParameters& search_parameters) const {
   std::vector<Candidate> lowest_resolution_candidates =
       GenerateLowestResolutionCandidates(search_parameters);
@@ -324,18 +461,13 @@ FastCorrelativeScanMatcher::GenerateLowestResolutionCandidates(
 
 void FastCorrelativeScanMatcher::ScoreCandidates(
     const PrecomputationGrid& precomputation_grid,
-    const std::vector<DiscreteScan>& discrete_scans,
+    const std::vector<PackedDiscreteScan>& discrete_scans,
     const SearchParameters& search_parameters,
     std::vector<Candidate>* const candidates) const {
   for (Candidate& candidate : *candidates) {
-    int sum = 0;
-    for (const Eigen::Array2i& xy_index :
-         discrete_scans[candidate.scan_index]) {
-      const Eigen::Array2i proposed_xy_index(
-          xy_index.x() + candidate.x_index_offset,
-          xy_index.y() + candidate.y_index_offset);
-      sum += precomputation_grid.GetValue(proposed_xy_index);
-    }
+    const int sum = precomputation_grid.SumValues(
+        scoring_kernel_, discrete_scans[candidate.scan_index],
+        Eigen::Array2i(candidate.x_index_offset, candidate.y_index_offset));
     candidate.score = PrecomputationGrid::ToProbability(
         sum / static_cast<float>(discrete_scans[candidate.scan_index].size()));
   }
@@ -343,10 +475,10 @@ void FastCorrelativeScanMatcher::ScoreCandidates(
 }
 
 Candidate FastCorrelativeScanMatcher::BranchAndBound(
-    const std::vector<DiscreteScan>& discrete_scans,
+    const std::vector<PackedDiscreteScan>& discrete_scans,
     const SearchParameters& search_parameters,
     const std::vector<Candidate>& candidates, const int candidate_depth,
-    float min_score) const {
+    float min_score, const std::atomic<float>* const shared_min_score) const {
   if (candidate_depth == 0) {
     // Return the best candidate.
     return *candidates.begin();
@@ -355,7 +487,9 @@ Candidate FastCorrelativeScanMatcher::BranchAndBound(
   Candidate best_high_resolution_candidate(0, 0, 0, search_parameters);
   best_high_resolution_candidate.score = min_score;
   for (const Candidate& candidate : candidates) {
-    if (candidate.score <= min_score) {
+    if (candidate.score <= min_score ||
+        (shared_min_score != nullptr &&
+         candidate.score <= shared_min_score->load())) {
       break;
     }
     std::vector<Candidate> higher_resolution_candidates;
@@ -382,7 +516,8 @@ Candidate FastCorrelativeScanMatcher::BranchAndBound(
         best_high_resolution_candidate,
         BranchAndBound(discrete_scans, search_parameters,
                        higher_resolution_candidates, candidate_depth - 1,
-                       best_high_resolution_candidate.score));
+                       best_high_resolution_candidate.score,
+                       shared_min_score));
   }
   return best_high_resolution_candidate;
 }
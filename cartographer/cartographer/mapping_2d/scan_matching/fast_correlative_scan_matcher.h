@@ -25,14 +25,18 @@
 #ifndef CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_FAST_CORRELATIVE_SCAN_MATCHER_H_
 #define CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_FAST_CORRELATIVE_SCAN_MATCHER_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
 #include "Eigen/Core"
 #include "cartographer/common/port.h"
+#include "cartographer/common/thread_pool.h"
 #include "cartographer/mapping_2d/probability_grid.h"
 #include "cartographer/mapping_2d/scan_matching/correlative_scan_matcher.h"
 #include "cartographer/mapping_2d/scan_matching/proto/fast_correlative_scan_matcher_options.pb.h"
+#include "cartographer/mapping_2d/scan_matching/proto/precomputation_grid.pb.h"
+#include "cartographer/mapping_2d/scan_matching/scoring_kernels.h"
 #include "cartographer/sensor/point_cloud.h"
 
 namespace cartographer {
@@ -52,6 +56,23 @@ class PrecomputationGrid {
                      const CellLimits& limits, int width,
                      std::vector<float>* reusable_intermediate_grid);
 
+  // Computes the grid of width 1 for 'probability_grid'. If 'thread_pool' is
+  // not null, rows are computed in parallel.
+  PrecomputationGrid(const ProbabilityGrid& probability_grid,
+                     common::ThreadPool* thread_pool);
+
+  // Computes the grid of twice the width of 'finer_grid' from the maximum of
+  // four of its cells each. If 'thread_pool' is not null, rows are computed in
+  // parallel.
+  PrecomputationGrid(const PrecomputationGrid& finer_grid,
+                     common::ThreadPool* thread_pool);
+
+  explicit PrecomputationGrid(const proto::PrecomputationGrid& proto);
+
+  proto::PrecomputationGrid ToProto() const;
+
+  int width() const { return 1 - offset_.x(); }
+
   // Returns a value between 0 and 255 to represent probabilities between
   // kMinProbability and kMaxProbability.
   int GetValue(const Eigen::Array2i& xy_index) const {
@@ -71,6 +92,14 @@ class PrecomputationGrid {
     return cells_[local_xy_index.x() + local_xy_index.y() * stride];
   }
 
+  // Returns the sum of GetValue() over the cells of 'scan' translated by
+  // 'offset', computed by 'kernel'.
+  int SumValues(const ScoringKernel kernel, const PackedDiscreteScan& scan,
+                const Eigen::Array2i& offset) const {
+    return SumCellValues(kernel, cells_.data(), wide_limits_, scan,
+                         offset - offset_);
+  }
+
   // Maps values from [0, 255] to [kMinProbability, kMaxProbability].
   static float ToProbability(float value) {
     return mapping::kMinProbability +
@@ -88,18 +117,58 @@ class PrecomputationGrid {
   // Size of the precomputation grid.
   const CellLimits wide_limits_;
 
-  // Probabilites mapped to 0 to 255.
+  // Probabilites mapped to 0 to 255, followed by
+  // 'kScoringKernelCellPadding' unused bytes.
   std::vector<uint8> cells_;
 };
 
-class PrecomputationGridStack;
+// The precomputation grids of widths 1, 2, 4, ... used by the
+// FastCorrelativeScanMatcher. Each grid is derived from the previous one.
+class PrecomputationGridStack {
+ public:
+  // If 'thread_pool' is not null, the grids are computed on it. This may be
+  // called from within work items of 'thread_pool'.
+  PrecomputationGridStack(
+      const ProbabilityGrid& probability_grid,
+      const proto::FastCorrelativeScanMatcherOptions& options,
+      common::ThreadPool* thread_pool);
+  explicit PrecomputationGridStack(const proto::PrecomputationGridStack& proto);
+
+  PrecomputationGridStack(const PrecomputationGridStack&) = delete;
+  PrecomputationGridStack& operator=(const PrecomputationGridStack&) = delete;
+
+  const PrecomputationGrid& Get(int index) const {
+    return precomputation_grids_[index];
+  }
+
+  int max_depth() const { return precomputation_grids_.size() - 1; }
+
+  // Limits of the probability grid this stack was computed from.
+  const MapLimits& limits() const { return limits_; }
+
+  proto::PrecomputationGridStack ToProto() const;
+
+ private:
+  MapLimits limits_;
+  std::vector<PrecomputationGrid> precomputation_grids_;
+};
 
 // An implementation of "Real-Time Correlative Scan Matching" by Olson.
 class FastCorrelativeScanMatcher {
  public:
+  // Candidates are scored using 'scoring_kernel', by default the fastest one
+  // supported by the CPU.
   FastCorrelativeScanMatcher(
       const ProbabilityGrid& probability_grid,
-      const proto::FastCorrelativeScanMatcherOptions& options);
+      const proto::FastCorrelativeScanMatcherOptions& options,
+      ScoringKernel scoring_kernel = GetFastestSupportedScoringKernel());
+
+  // Uses an existing 'precomputation_grid_stack', which must have been
+  // computed with the same 'options'.
+  FastCorrelativeScanMatcher(
+      std::shared_ptr<const PrecomputationGridStack> precomputation_grid_stack,
+      const proto::FastCorrelativeScanMatcherOptions& options,
+      ScoringKernel scoring_kernel = GetFastestSupportedScoringKernel());
   ~FastCorrelativeScanMatcher();
 
   FastCorrelativeScanMatcher(const FastCorrelativeScanMatcher&) = delete;
@@ -121,32 +190,47 @@ class FastCorrelativeScanMatcher {
   bool MatchFullSubmap(const sensor::PointCloud& point_cloud, float min_score,
                        float* score, transform::Rigid2d* pose_estimate) const;
 
+  // As above, but candidates are additionally pruned against
+  // 'shared_min_score', which may be raised concurrently, e.g. by matchers of
+  // other submaps searching for the same 'point_cloud'. True is only returned
+  // if the score is also above the last value read from 'shared_min_score'.
+  bool MatchFullSubmap(const sensor::PointCloud& point_cloud, float min_score,
+                       const std::atomic<float>& shared_min_score, float* score,
+                       transform::Rigid2d* pose_estimate) const;
+
+  // Limits of the probability grid this matcher searches in.
+  const MapLimits& limits() const { return limits_; }
+
  private:
   // The actual implementation of the scan matcher, called by Match() and
   // MatchFullSubmap() with appropriate 'initial_pose_estimate' and
-  // 'search_parameters'.
+  // 'search_parameters'. 'shared_min_score' may be null.
   bool MatchWithSearchParameters(
       SearchParameters search_parameters,
       const transform::Rigid2d& initial_pose_estimate,
-      const sensor::PointCloud& point_cloud, float min_score, float* score,
+      const sensor::PointCloud& point_cloud, float min_score,
+      const std::atomic<float>* shared_min_score, float* score,
       transform::Rigid2d* pose_estimate) const;
   std::vector<Candidate> ComputeLowestResolutionCandidates(
-      const std::vector<DiscreteScan>& discrete_scans,
+      const std::vector<PackedDiscreteScan>& discrete_scans,
       const SearchParameters& search_parameters) const;
   std::vector<Candidate> GenerateLowestResolutionCandidates(
       const SearchParameters& search_parameters) const;
   void ScoreCandidates(const PrecomputationGrid& precomputation_grid,
-                       const std::vector<DiscreteScan>& discrete_scans,
+                       const std::vector<PackedDiscreteScan>& discrete_scans,
                        const SearchParameters& search_parameters,
                        std::vector<Candidate>* const candidates) const;
-  Candidate BranchAndBound(const std::vector<DiscreteScan>& discrete_scans,
+  Candidate BranchAndBound(
+      const std::vector<PackedDiscreteScan>& discrete_scans,
                            const SearchParameters& search_parameters,
                            const std::vector<Candidate>& candidates,
-                           int candidate_depth, float min_score) const;
+                           int candidate_depth, float min_score,
+                           const std::atomic<float>* shared_min_score) const;
 
   const proto::FastCorrelativeScanMatcherOptions options_;
+  const ScoringKernel scoring_kernel_;
   MapLimits limits_;
-  std::unique_ptr<PrecomputationGridStack> precomputation_grid_stack_;
+  std::shared_ptr<const PrecomputationGridStack> precomputation_grid_stack_;
 };
 
 }  // namespace scan_matching
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks FastCorrelativeScanMatcher::MatchFullSubmap() with every scoring
+// kernel supported by this CPU on a 2D submap and the range data of a node
+// taken from a serialized state, as written by MapBuilder::SerializeState().
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "cartographer/common/make_unique.h"
+#include "cartographer/common/port.h"
+#include "cartographer/io/proto_stream.h"
+#include "cartographer/mapping/proto/serialization.pb.h"
+#include "cartographer/mapping/proto/sparse_pose_graph.pb.h"
+#include "cartographer/mapping_2d/probability_grid.h"
+#include "cartographer/mapping_2d/scan_matching/fast_correlative_scan_matcher.h"
+#include "cartographer/mapping_2d/scan_matching/scoring_kernels.h"
+#include "cartographer/sensor/point_cloud.h"
+#include "cartographer/sensor/range_data.h"
+#include "cartographer/sensor/voxel_filter.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(pbstream_filename, "",
+              "Proto stream file containing the serialized state.");
+DEFINE_int32(trajectory_id, 0, "Trajectory of the submap and node.");
+DEFINE_int32(submap_index, 0, "Index of the 2D submap to match against.");
+DEFINE_int32(node_index, 0, "Index of the node whose range data is matched.");
+DEFINE_double(voxel_filter_size, 0.05,
+              "Voxel filter size applied to the range data before matching.");
+DEFINE_int32(branch_and_bound_depth, 7,
+             "Branch and bound depth of the scan matcher.");
+DEFINE_double(min_score, 0.6, "Minimum score for a match.");
+DEFINE_int32(num_iterations, 10, "Number of matches timed per kernel.");
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+namespace {
+
+void Run(const string& pbstream_filename) {
+  io::ProtoStreamReader reader(pbstream_filename);
+  mapping::proto::SparsePoseGraph pose_graph;
+  CHECK(reader.ReadProto(&pose_graph));
+
+  std::unique_ptr<ProbabilityGrid> probability_grid;
+  sensor::PointCloud point_cloud;
+  mapping::proto::SerializedData proto;
+  while (reader.ReadProto(&proto)) {
+    if (proto.has_submap() &&
+        proto.submap().submap_id().trajectory_id() == FLAGS_trajectory_id &&
+        proto.submap().submap_id().submap_index() == FLAGS_submap_index) {
+      CHECK(proto.submap().has_submap_2d()) << "Only 2D submaps are supported.";
+      probability_grid = common::make_unique<ProbabilityGrid>(
+          proto.submap().submap_2d().probability_grid());
+    }
+    if (proto.has_range_data() &&
+        proto.range_data().node_id().trajectory_id() == FLAGS_trajectory_id &&
+        proto.range_data().node_id().node_index() == FLAGS_node_index) {
+      point_cloud = sensor::VoxelFiltered(
+          sensor::Decompress(
+              sensor::FromProto(proto.range_data().range_data()))
+              .returns,
+          FLAGS_voxel_filter_size);
+    }
+  }
+  CHECK(probability_grid != nullptr)
+      << "Submap " << FLAGS_submap_index << " not found.";
+  CHECK(!point_cloud.empty()) << "Node " << FLAGS_node_index << " not found.";
+  LOG(INFO) << "Matching " << point_cloud.size() << " points against a "
+            << probability_grid->limits().cell_limits().num_x_cells << "x"
+            << probability_grid->limits().cell_limits().num_y_cells
+            << " grid.";
+
+  proto::FastCorrelativeScanMatcherOptions options;
+  options.set_branch_and_bound_depth(FLAGS_branch_and_bound_depth);
+  for (const ScoringKernel kernel :
+       {ScoringKernel::kScalar, ScoringKernel::kSse41, ScoringKernel::kAvx2}) {
+    if (!IsScoringKernelSupported(kernel)) {
+      std::cout << ScoringKernelToString(kernel) << ": not supported\n";
+      continue;
+    }
+    const FastCorrelativeScanMatcher scan_matcher(*probability_grid, options,
+                                                  kernel);
+    float score = 0.f;
+    transform::Rigid2d pose_estimate;
+    bool success = false;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i != FLAGS_num_iterations; ++i) {
+      success = scan_matcher.MatchFullSubmap(point_cloud, FLAGS_min_score,
+                                             &score, &pose_estimate);
+    }
+    const double seconds_per_match =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      start)
+            .count() /
+        FLAGS_num_iterations;
+    std::cout << std::fixed << std::setprecision(4)
+              << ScoringKernelToString(kernel) << ": " << seconds_per_match
+              << " s per match, ";
+    if (success) {
+      std::cout << "score " << score << " at " << pose_estimate << "\n";
+    } else {
+      std::cout << "no match\n";
+    }
+  }
+}
+
+}  // namespace
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  google::SetUsageMessage(
+      "\n\n"
+      "Benchmarks the scoring kernels of the 2D FastCorrelativeScanMatcher by\n"
+      "matching the range data of a node against a full submap.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_pbstream_filename.empty()) {
+    google::ShowUsageWithFlagsRestrict(
+        argv[0], "fast_correlative_scan_matcher_benchmark");
+    return EXIT_FAILURE;
+  }
+  ::cartographer::mapping_2d::scan_matching::Run(FLAGS_pbstream_filename);
+}
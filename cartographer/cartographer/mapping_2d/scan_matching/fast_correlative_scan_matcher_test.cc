@@ -23,6 +23,7 @@
 #include <string>
 
 #include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
+#include "cartographer/common/thread_pool.h"
 #include "cartographer/mapping_2d/probability_grid.h"
 #include "cartographer/mapping_2d/range_data_inserter.h"
 #include "cartographer/transform/rigid_transform_test_helpers.h"
@@ -104,6 +105,46 @@ TEST(PrecomputationGridTest, TinyProbabilityGrid) {
   }
 }
 
+TEST(PrecomputationGridStackTest, MatchesDirectComputation) {
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  ProbabilityGrid probability_grid(
+      MapLimits(0.05, Eigen::Vector2d(5., 5.), CellLimits(37, 53)));
+  for (const Eigen::Array2i& xy_index :
+       XYIndexRangeIterator(Eigen::Array2i(3, 5), Eigen::Array2i(30, 50))) {
+    probability_grid.SetProbability(
+        xy_index, PrecomputationGrid::ToProbability(distribution(prng)));
+  }
+
+  proto::FastCorrelativeScanMatcherOptions options;
+  options.set_branch_and_bound_depth(7);
+  common::ThreadPool thread_pool(4);
+  const PrecomputationGridStack serial_stack(probability_grid, options,
+                                             nullptr /* thread_pool */);
+  const PrecomputationGridStack parallel_stack(probability_grid, options,
+                                               &thread_pool);
+  const PrecomputationGridStack deserialized_stack(serial_stack.ToProto());
+  ASSERT_EQ(6, serial_stack.max_depth());
+  ASSERT_EQ(6, deserialized_stack.max_depth());
+  std::vector<float> reusable_intermediate_grid;
+  for (int depth = 0; depth <= serial_stack.max_depth(); ++depth) {
+    const int width = 1 << depth;
+    const PrecomputationGrid expected(probability_grid,
+                                      probability_grid.limits().cell_limits(),
+                                      width, &reusable_intermediate_grid);
+    EXPECT_EQ(width, serial_stack.Get(depth).width());
+    for (const Eigen::Array2i& xy_index :
+         XYIndexRangeIterator(Eigen::Array2i(-width - 1, -width - 1),
+                              Eigen::Array2i(38, 54))) {
+      const int expected_value = expected.GetValue(xy_index);
+      EXPECT_EQ(expected_value, serial_stack.Get(depth).GetValue(xy_index));
+      EXPECT_EQ(expected_value, parallel_stack.Get(depth).GetValue(xy_index));
+      EXPECT_EQ(expected_value,
+                deserialized_stack.Get(depth).GetValue(xy_index));
+    }
+  }
+}
+
 proto::FastCorrelativeScanMatcherOptions
 CreateFastCorrelativeScanMatcherTestOptions(const int branch_and_bound_depth) {
   auto parameter_dictionary =
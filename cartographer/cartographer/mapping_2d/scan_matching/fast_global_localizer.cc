@@ -16,12 +16,57 @@
 
 #include "cartographer/mapping_2d/scan_matching/fast_global_localizer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+
+#include "cartographer/common/metrics.h"
+#include "cartographer/common/mutex.h"
 #include "glog/logging.h"
 
 namespace cartographer {
 namespace mapping_2d {
 namespace scan_matching {
 
+namespace {
+
+// Returns the indices into 'matchers' in the order in which they are searched.
+std::vector<int> ComputeSearchOrder(
+    const GlobalLocalizationOptions& options,
+    const std::vector<FastCorrelativeScanMatcher*>& matchers) {
+  std::vector<int> search_order(matchers.size());
+  std::iota(search_order.begin(), search_order.end(), 0);
+  if (!options.has_prior_position) {
+    return search_order;
+  }
+  std::vector<double> squared_distances;
+  squared_distances.reserve(matchers.size());
+  for (const FastCorrelativeScanMatcher* const matcher : matchers) {
+    const MapLimits& limits = matcher->limits();
+    const Eigen::Vector2d center =
+        limits.max() -
+        0.5 * limits.resolution() *
+            Eigen::Vector2d(limits.cell_limits().num_y_cells,
+                            limits.cell_limits().num_x_cells);
+    squared_distances.push_back(
+        (center - options.prior_position).squaredNorm());
+  }
+  std::stable_sort(search_order.begin(), search_order.end(),
+                   [&squared_distances](const int lhs, const int rhs) {
+                     return squared_distances[lhs] < squared_distances[rhs];
+                   });
+  return search_order;
+}
+
+common::Duration ElapsedSince(
+    const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<common::Duration>(
+      std::chrono::steady_clock::now() - start);
+}
+
+}  // namespace
+
 bool PerformGlobalLocalization(
     const float cutoff,
     const cartographer::sensor::AdaptiveVoxelFilter& voxel_filter,
@@ -33,27 +78,97 @@ bool PerformGlobalLocalization(
   CHECK(best_pose_estimate != nullptr)
       << "Need a non-null output_pose_estimate!";
   CHECK(best_score != nullptr) << "Need a non-null best_score!";
+  GlobalLocalizationOptions options;
+  options.cutoff = cutoff;
+  const GlobalLocalizationResult result = PerformGlobalLocalization(
+      options, voxel_filter, matchers, point_cloud, nullptr /* thread_pool */);
   *best_score = cutoff;
-  transform::Rigid2d pose_estimate;
-  const sensor::PointCloud filtered_point_cloud =
-      voxel_filter.Filter(point_cloud);
-  bool success = false;
+  if (result.success) {
+    *best_score = result.score;
+    *best_pose_estimate = result.pose_estimate;
+  }
+  return result.success;
+}
+
+GlobalLocalizationResult PerformGlobalLocalization(
+    const GlobalLocalizationOptions& options,
+    const cartographer::sensor::AdaptiveVoxelFilter& voxel_filter,
+    const std::vector<
+        cartographer::mapping_2d::scan_matching::FastCorrelativeScanMatcher*>&
+        matchers,
+    const cartographer::sensor::PointCloud& point_cloud,
+    common::ThreadPool* const thread_pool) {
+  static common::HistogramMetric* const time_to_first_fix_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "global_localization_2d_time_to_first_fix_seconds",
+          "Time until global localization first found a score above the "
+          "cutoff.");
+  static common::HistogramMetric* const total_time_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "global_localization_2d_seconds", "Time of global localization.");
+  const auto start = std::chrono::steady_clock::now();
+  GlobalLocalizationResult result;
   if (matchers.size() == 0) {
     LOG(WARNING) << "Map not yet large enough to localize in!";
-    return false;
+    return result;
   }
-  for (auto& matcher : matchers) {
+  const sensor::PointCloud filtered_point_cloud =
+      voxel_filter.Filter(point_cloud);
+  const std::vector<int> search_order = ComputeSearchOrder(options, matchers);
+
+  // 'best_score' is only raised while holding 'mutex', together with updating
+  // 'result', but read without it by all searches to prune candidates.
+  common::Mutex mutex;
+  std::atomic<float> best_score(options.cutoff);
+  std::atomic<bool> stop(false);
+  std::atomic<int> num_matchers_searched(0);
+  const auto search = [&](const int index) {
+    if (stop) {
+      return;
+    }
+    ++num_matchers_searched;
+    const int matcher_index = search_order[index];
     float score = -1;
     transform::Rigid2d pose_estimate;
-    if (matcher->MatchFullSubmap(filtered_point_cloud, *best_score, &score,
-                                 &pose_estimate)) {
-      CHECK_GT(score, *best_score) << "MatchFullSubmap lied!";
-      *best_score = score;
-      *best_pose_estimate = pose_estimate;
-      success = true;
+    if (!matchers[matcher_index]->MatchFullSubmap(filtered_point_cloud,
+                                                  options.cutoff, best_score,
+                                                  &score, &pose_estimate)) {
+      return;
+    }
+    common::MutexLocker locker(&mutex);
+    CHECK_GT(score, options.cutoff) << "MatchFullSubmap lied!";
+    // Another search might have found a better score in the meantime.
+    if (result.success && score <= result.score) {
+      return;
+    }
+    if (!result.success) {
+      result.time_to_first_fix = ElapsedSince(start);
+    }
+    result.success = true;
+    result.pose_estimate = pose_estimate;
+    result.score = score;
+    result.matcher_index = matcher_index;
+    best_score = score;
+    if (score >= options.stop_score) {
+      stop = true;
     }
+  };
+  if (thread_pool == nullptr) {
+    for (int index = 0; index != static_cast<int>(matchers.size()); ++index) {
+      search(index);
+    }
+  } else {
+    thread_pool->ParallelFor(matchers.size(), search);
+  }
+
+  result.num_matchers_searched = num_matchers_searched;
+  result.total_time = ElapsedSince(start);
+  if (result.success) {
+    time_to_first_fix_metric->Observe(
+        common::ToSeconds(result.time_to_first_fix));
   }
-  return success;
+  total_time_metric->Observe(common::ToSeconds(result.total_time));
+  return result;
 }
 
 }  // namespace scan_matching
@@ -20,6 +20,8 @@
 #include <vector>
 
 #include "Eigen/Geometry"
+#include "cartographer/common/thread_pool.h"
+#include "cartographer/common/time.h"
 #include "cartographer/mapping_2d/scan_matching/fast_correlative_scan_matcher.h"
 #include "cartographer/sensor/voxel_filter.h"
 
@@ -44,6 +46,49 @@ bool PerformGlobalLocalization(
     const cartographer::sensor::PointCloud& point_cloud,
     transform::Rigid2d* best_pose_estimate, float* best_score);
 
+struct GlobalLocalizationOptions {
+  // Minimum correlation that will be accepted, in the range [0.0, 1.0].
+  float cutoff = 0.f;
+
+  // Once a score of at least 'stop_score' is found, submaps whose search has
+  // not yet started are skipped. Values above 1.0 search all submaps.
+  float stop_score = 2.f;
+
+  // If set, submaps are searched in order of the distance of their centers to
+  // this position, e.g. the last known pose or a GPS fix, in the frame of the
+  // probability grids.
+  bool has_prior_position = false;
+  Eigen::Vector2d prior_position = Eigen::Vector2d::Zero();
+};
+
+struct GlobalLocalizationResult {
+  bool success = false;
+  transform::Rigid2d pose_estimate;
+  float score = 0.f;
+  // Index into 'matchers' of the submap in which 'pose_estimate' was found.
+  int matcher_index = -1;
+  // Number of submaps searched, the others were skipped due to 'stop_score'.
+  int num_matchers_searched = 0;
+  // Wall time until the first score above 'cutoff' was found, if any, and
+  // until the search finished.
+  common::Duration time_to_first_fix = common::Duration::zero();
+  common::Duration total_time = common::Duration::zero();
+};
+
+// Performs global localization against the provided 'matchers' like the
+// function above, but distributes the submaps over the calling thread and
+// 'thread_pool', if not null. The best score found so far is shared between
+// all searches, so that branch and bound also prunes against the results
+// found in other submaps.
+GlobalLocalizationResult PerformGlobalLocalization(
+    const GlobalLocalizationOptions& options,
+    const cartographer::sensor::AdaptiveVoxelFilter& voxel_filter,
+    const std::vector<
+        cartographer::mapping_2d::scan_matching::FastCorrelativeScanMatcher*>&
+        matchers,
+    const cartographer::sensor::PointCloud& point_cloud,
+    common::ThreadPool* thread_pool);
+
 }  // namespace scan_matching
 }  // namespace mapping_2d
 }  // namespace cartographer
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/scan_matching/fast_global_localizer.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
+#include "cartographer/common/make_unique.h"
+#include "cartographer/common/thread_pool.h"
+#include "cartographer/mapping_2d/probability_grid.h"
+#include "cartographer/mapping_2d/range_data_inserter.h"
+#include "cartographer/transform/rigid_transform_test_helpers.h"
+#include "cartographer/transform/transform.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+namespace {
+
+constexpr int kNumSubmaps = 8;
+constexpr int kExpectedMatcherIndex = 5;
+constexpr float kCutoff = 0.1f;
+
+class FastGlobalLocalizerTest : public ::testing::Test {
+ protected:
+  FastGlobalLocalizerTest()
+      : voxel_filter_(sensor::CreateAdaptiveVoxelFilterOptions(
+            common::MakeDictionary(R"text(
+                return {
+                  max_length = 0.5,
+                  min_num_points = 200,
+                  max_range = 50.,
+                })text")
+                .get())) {
+    auto parameter_dictionary = common::MakeDictionary(R"text(
+        return {
+          linear_search_window = 3.,
+          angular_search_window = 1.,
+          branch_and_bound_depth = 6,
+        })text");
+    const auto options =
+        CreateFastCorrelativeScanMatcherOptions(parameter_dictionary.get());
+    RangeDataInserter range_data_inserter(CreateRangeDataInserterOptions(
+        common::MakeDictionary(R"text(
+            return {
+              insert_free_space = true,
+              hit_probability = 0.7,
+              miss_probability = 0.4,
+            })text")
+            .get()));
+
+    // Each submap covers a different 10x10 m square and contains a different
+    // random point cloud. The point cloud of one of them is localized.
+    std::mt19937 prng(42);
+    std::uniform_real_distribution<float> distribution(-3.f, 3.f);
+    for (int i = 0; i != kNumSubmaps; ++i) {
+      const Eigen::Vector2f center(10.f * i, 0.f);
+      sensor::PointCloud point_cloud;
+      for (int j = 0; j != 20; ++j) {
+        point_cloud.emplace_back(distribution(prng), distribution(prng), 0.f);
+      }
+      const transform::Rigid2f pose({center.x() + 0.3f, center.y() - 0.2f},
+                                    0.4f);
+      probability_grids_.push_back(common::make_unique<ProbabilityGrid>(
+          MapLimits(0.05, (center + Eigen::Vector2f(5.f, 5.f)).cast<double>(),
+                    CellLimits(200, 200))));
+      range_data_inserter.Insert(
+          sensor::RangeData{transform::Embed3D(pose).translation(),
+                            sensor::TransformPointCloud(
+                                point_cloud, transform::Embed3D(pose)),
+                            {}},
+          probability_grids_.back().get());
+      probability_grids_.back()->FinishUpdate();
+      matchers_.push_back(common::make_unique<FastCorrelativeScanMatcher>(
+          *probability_grids_.back(), options));
+      matcher_pointers_.push_back(matchers_.back().get());
+      if (i == kExpectedMatcherIndex) {
+        point_cloud_ = point_cloud;
+        expected_pose_ = pose;
+      }
+    }
+  }
+
+  sensor::AdaptiveVoxelFilter voxel_filter_;
+  std::vector<std::unique_ptr<ProbabilityGrid>> probability_grids_;
+  std::vector<std::unique_ptr<FastCorrelativeScanMatcher>> matchers_;
+  std::vector<FastCorrelativeScanMatcher*> matcher_pointers_;
+  sensor::PointCloud point_cloud_;
+  transform::Rigid2f expected_pose_;
+};
+
+TEST_F(FastGlobalLocalizerTest, ParallelMatchesSerialLocalization) {
+  transform::Rigid2d serial_pose_estimate;
+  float serial_score;
+  ASSERT_TRUE(PerformGlobalLocalization(kCutoff, voxel_filter_,
+                                        matcher_pointers_, point_cloud_,
+                                        &serial_pose_estimate, &serial_score));
+  EXPECT_THAT(expected_pose_,
+              transform::IsNearly(serial_pose_estimate.cast<float>(), 0.03f));
+
+  common::ThreadPool thread_pool(4);
+  GlobalLocalizationOptions options;
+  options.cutoff = kCutoff;
+  const GlobalLocalizationResult result = PerformGlobalLocalization(
+      options, voxel_filter_, matcher_pointers_, point_cloud_, &thread_pool);
+  ASSERT_TRUE(result.success);
+  EXPECT_EQ(kExpectedMatcherIndex, result.matcher_index);
+  EXPECT_EQ(serial_score, result.score);
+  EXPECT_THAT(serial_pose_estimate,
+              transform::IsNearly(result.pose_estimate, 1e-9));
+  EXPECT_EQ(kNumSubmaps, result.num_matchers_searched);
+  EXPECT_LE(result.time_to_first_fix, result.total_time);
+}
+
+TEST_F(FastGlobalLocalizerTest, StopsAtScoreSearchingClosestToPriorFirst) {
+  GlobalLocalizationOptions options;
+  options.cutoff = kCutoff;
+  options.stop_score = 0.5f;
+  options.has_prior_position = true;
+  options.prior_position = Eigen::Vector2d(10. * kExpectedMatcherIndex, 1.);
+  const GlobalLocalizationResult result =
+      PerformGlobalLocalization(options, voxel_filter_, matcher_pointers_,
+                                point_cloud_, nullptr /* thread_pool */);
+  ASSERT_TRUE(result.success);
+  EXPECT_LE(options.stop_score, result.score);
+  EXPECT_EQ(kExpectedMatcherIndex, result.matcher_index);
+  EXPECT_EQ(1, result.num_matchers_searched);
+  EXPECT_THAT(expected_pose_,
+              transform::IsNearly(result.pose_estimate.cast<float>(), 0.03f));
+}
+
+TEST_F(FastGlobalLocalizerTest, NoMatchers) {
+  const GlobalLocalizationResult result = PerformGlobalLocalization(
+      GlobalLocalizationOptions(), voxel_filter_, {}, point_cloud_,
+      nullptr /* thread_pool */);
+  EXPECT_FALSE(result.success);
+  EXPECT_EQ(0, result.num_matchers_searched);
+}
+
+}  // namespace
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
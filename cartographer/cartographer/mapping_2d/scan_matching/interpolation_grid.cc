@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
+
+#include <cmath>
+
+#include "Eigen/Core"
+#include "cartographer/common/math.h"
+#include "cartographer/mapping/probability_values.h"
+#include "cartographer/mapping_2d/xy_index.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+
+namespace {
+
+bool SameLimits(const MapLimits& a, const MapLimits& b) {
+  return a.resolution() == b.resolution() && a.max() == b.max() &&
+         a.cell_limits().num_x_cells == b.cell_limits().num_x_cells &&
+         a.cell_limits().num_y_cells == b.cell_limits().num_y_cells;
+}
+
+// Evaluates the cubic through 'p[1]' and 'p[2]' with Catmull-Rom tangents
+// at 'x' in [0, 1] and, if requested, its derivative.
+void CubicHermiteSpline(const double* const p, const double x,
+                        double* const f, double* const dfdx) {
+  const double a = 0.5 * (-p[0] + 3. * p[1] - 3. * p[2] + p[3]);
+  const double b = 0.5 * (2. * p[0] - 5. * p[1] + 4. * p[2] - p[3]);
+  const double c = 0.5 * (-p[0] + p[2]);
+  *f = p[1] + x * (c + x * (b + x * a));
+  if (dfdx != nullptr) {
+    *dfdx = c + x * (2. * b + 3. * a * x);
+  }
+}
+
+}  // namespace
+
+InterpolationGrid::InterpolationGrid(const ProbabilityGrid& probability_grid)
+    : limits_(probability_grid.limits()),
+      num_rows_(limits_.cell_limits().num_y_cells + 2 * kPadding),
+      num_columns_(limits_.cell_limits().num_x_cells + 2 * kPadding),
+      cells_(num_rows_ * num_columns_, mapping::kMinProbability) {
+  for (const Eigen::Array2i& xy_index :
+       XYIndexRangeIterator(limits_.cell_limits())) {
+    cells_[(xy_index.y() + kPadding) * num_columns_ + xy_index.x() +
+           kPadding] = probability_grid.GetProbability(xy_index);
+  }
+}
+
+bool InterpolationGrid::Update(const ProbabilityGrid& probability_grid) {
+  if (!SameLimits(limits_, probability_grid.limits())) {
+    return false;
+  }
+  const int num_x_cells = limits_.cell_limits().num_x_cells;
+  for (const int flat_index : probability_grid.last_update_indices()) {
+    const Eigen::Array2i xy_index(flat_index % num_x_cells,
+                                  flat_index / num_x_cells);
+    cells_[(xy_index.y() + kPadding) * num_columns_ + xy_index.x() +
+           kPadding] = probability_grid.GetProbability(xy_index);
+  }
+  return true;
+}
+
+void InterpolationGrid::Interpolate(const double row, const double column,
+                                    double* const value,
+                                    double* const dvalue_drow,
+                                    double* const dvalue_dcolumn) const {
+  const int row_index = std::floor(row);
+  const int column_index = std::floor(column);
+  // The 4x4 samples around the point start one cell before it.
+  const int first_row = row_index - 1 + kPadding;
+  const int first_column = column_index - 1 + kPadding;
+  double samples[4][4];
+  if (first_row >= 0 && first_row + 4 <= num_rows_ && first_column >= 0 &&
+      first_column + 4 <= num_columns_) {
+    const float* const first_sample =
+        cells_.data() + first_row * num_columns_ + first_column;
+    for (int i = 0; i != 4; ++i) {
+      for (int j = 0; j != 4; ++j) {
+        samples[i][j] = first_sample[i * num_columns_ + j];
+      }
+    }
+  } else {
+    // Only points near or beyond the border get here.
+    for (int i = 0; i != 4; ++i) {
+      for (int j = 0; j != 4; ++j) {
+        samples[i][j] =
+            GetValue(common::Clamp(first_row + i, 0, num_rows_ - 1),
+                     common::Clamp(first_column + j, 0, num_columns_ - 1));
+      }
+    }
+  }
+  double values_in_rows[4];
+  double dvalues_dcolumn_in_rows[4];
+  for (int i = 0; i != 4; ++i) {
+    CubicHermiteSpline(samples[i], column - column_index, &values_in_rows[i],
+                       &dvalues_dcolumn_in_rows[i]);
+  }
+  CubicHermiteSpline(values_in_rows, row - row_index, value, dvalue_drow);
+  CubicHermiteSpline(dvalues_dcolumn_in_rows, row - row_index, dvalue_dcolumn,
+                     nullptr);
+}
+
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_INTERPOLATION_GRID_H_
+#define CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_INTERPOLATION_GRID_H_
+
+#include <vector>
+
+#include "cartographer/mapping_2d/map_limits.h"
+#include "cartographer/mapping_2d/probability_grid.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+
+// The probabilities of a ProbabilityGrid as floats, laid out for the bicubic
+// interpolation of the CeresScanMatcher. Rows are along the y and columns
+// along the x axis of the cell indices. The cells are surrounded by a border
+// of kMinProbability, so that sampling them needs neither bounds checks nor
+// conversions of the uint16 cell values.
+class InterpolationGrid {
+ public:
+  // Width of the border. Clamping samples outside of the padded grid to it
+  // gives kMinProbability like outside of the ProbabilityGrid.
+  static constexpr int kPadding = 2;
+
+  explicit InterpolationGrid(const ProbabilityGrid& probability_grid);
+
+  InterpolationGrid(const InterpolationGrid&) = delete;
+  InterpolationGrid& operator=(const InterpolationGrid&) = delete;
+
+  const MapLimits& limits() const { return limits_; }
+
+  // Number of rows and columns including the border.
+  int num_rows() const { return num_rows_; }
+  int num_columns() const { return num_columns_; }
+
+  // Copies the cells changed by the last update of 'probability_grid', which
+  // has to be the grid this was created from and must not have been updated
+  // more than once since. Returns false without changing anything if the
+  // limits of 'probability_grid' have changed, in which case a new
+  // InterpolationGrid has to be created.
+  bool Update(const ProbabilityGrid& probability_grid);
+
+  // Returns the value at 'row' and 'column' including the border, i.e. the
+  // probability of the cell (column - kPadding, row - kPadding).
+  float GetValue(const int row, const int column) const {
+    return cells_[row * num_columns_ + column];
+  }
+
+  // Evaluates the bicubic interpolation of the probabilities at 'row' and
+  // 'column' in cell coordinates, i.e. excluding the border, and its
+  // derivatives. The result is the same as that of ceres::BiCubicInterpolator.
+  void Interpolate(double row, double column, double* value,
+                   double* dvalue_drow, double* dvalue_dcolumn) const;
+
+ private:
+  MapLimits limits_;
+  int num_rows_;
+  int num_columns_;
+  std::vector<float> cells_;
+};
+
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_INTERPOLATION_GRID_H_
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
+
+#include <climits>
+#include <random>
+
+#include "cartographer/mapping/probability_values.h"
+#include "cartographer/mapping_2d/range_data_inserter.h"
+#include "cartographer/mapping_2d/xy_index.h"
+#include "ceres/cubic_interpolation.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+namespace {
+
+// Interpolates a ProbabilityGrid like the CeresScanMatcher did before the
+// InterpolationGrid was introduced.
+class ProbabilityGridAdapter {
+ public:
+  enum { DATA_DIMENSION = 1 };
+  static constexpr int kPadding = INT_MAX / 4;
+
+  explicit ProbabilityGridAdapter(const ProbabilityGrid& probability_grid)
+      : probability_grid_(probability_grid) {}
+
+  void GetValue(const int row, const int column, double* const value) const {
+    if (row < kPadding || column < kPadding || row >= NumRows() - kPadding ||
+        column >= NumCols() - kPadding) {
+      *value = mapping::kMinProbability;
+    } else {
+      *value = probability_grid_.GetProbability(
+          Eigen::Array2i(column - kPadding, row - kPadding));
+    }
+  }
+
+  int NumRows() const {
+    return probability_grid_.limits().cell_limits().num_y_cells + 2 * kPadding;
+  }
+
+  int NumCols() const {
+    return probability_grid_.limits().cell_limits().num_x_cells + 2 * kPadding;
+  }
+
+ private:
+  const ProbabilityGrid& probability_grid_;
+};
+
+proto::RangeDataInserterOptions CreateRangeDataInserterOptions() {
+  proto::RangeDataInserterOptions options;
+  options.set_hit_probability(0.7);
+  options.set_miss_probability(0.4);
+  options.set_insert_free_space(true);
+  return options;
+}
+
+void ExpectEqualCells(const InterpolationGrid& expected,
+                      const InterpolationGrid& actual) {
+  ASSERT_EQ(expected.num_rows(), actual.num_rows());
+  ASSERT_EQ(expected.num_columns(), actual.num_columns());
+  for (int row = 0; row != expected.num_rows(); ++row) {
+    for (int column = 0; column != expected.num_columns(); ++column) {
+      EXPECT_EQ(expected.GetValue(row, column), actual.GetValue(row, column));
+    }
+  }
+}
+
+TEST(InterpolationGridTest, CopiesProbabilities) {
+  ProbabilityGrid probability_grid(
+      MapLimits(0.1, Eigen::Vector2d(1., 2.), CellLimits(3, 4)));
+  probability_grid.SetProbability(Eigen::Array2i(0, 0), 0.3f);
+  probability_grid.SetProbability(Eigen::Array2i(2, 1), 0.8f);
+  const InterpolationGrid interpolation_grid(probability_grid);
+  EXPECT_EQ(4 + 2 * InterpolationGrid::kPadding, interpolation_grid.num_rows());
+  EXPECT_EQ(3 + 2 * InterpolationGrid::kPadding,
+            interpolation_grid.num_columns());
+  for (int row = 0; row != interpolation_grid.num_rows(); ++row) {
+    for (int column = 0; column != interpolation_grid.num_columns();
+         ++column) {
+      EXPECT_EQ(probability_grid.GetProbability(
+                    Eigen::Array2i(column - InterpolationGrid::kPadding,
+                                   row - InterpolationGrid::kPadding)),
+                interpolation_grid.GetValue(row, column));
+    }
+  }
+}
+
+TEST(InterpolationGridTest, InterpolateMatchesBiCubicInterpolator) {
+  std::mt19937 prng(42);
+  ProbabilityGrid probability_grid(
+      MapLimits(0.1, Eigen::Vector2d(1., 2.), CellLimits(30, 40)));
+  std::uniform_real_distribution<float> probability_distribution(
+      mapping::kMinProbability, mapping::kMaxProbability);
+  for (const Eigen::Array2i& xy_index :
+       XYIndexRangeIterator(probability_grid.limits().cell_limits())) {
+    if ((xy_index.x() + xy_index.y()) % 7 != 0) {
+      probability_grid.SetProbability(xy_index,
+                                      probability_distribution(prng));
+    }
+  }
+  const ProbabilityGridAdapter adapter(probability_grid);
+  const ceres::BiCubicInterpolator<ProbabilityGridAdapter> interpolator(
+      adapter);
+  const InterpolationGrid interpolation_grid(probability_grid);
+
+  // Covers the inside, the border and points far outside of the grid.
+  std::uniform_real_distribution<double> row_distribution(-10., 50.);
+  std::uniform_real_distribution<double> column_distribution(-10., 40.);
+  for (int i = 0; i != 1000; ++i) {
+    const double row = row_distribution(prng);
+    const double column = column_distribution(prng);
+    double expected_value;
+    double expected_dvalue_drow;
+    double expected_dvalue_dcolumn;
+    interpolator.Evaluate(row + ProbabilityGridAdapter::kPadding,
+                          column + ProbabilityGridAdapter::kPadding,
+                          &expected_value, &expected_dvalue_drow,
+                          &expected_dvalue_dcolumn);
+    double value;
+    double dvalue_drow;
+    double dvalue_dcolumn;
+    interpolation_grid.Interpolate(row, column, &value, &dvalue_drow,
+                                   &dvalue_dcolumn);
+    EXPECT_NEAR(expected_value, value, 1e-6);
+    EXPECT_NEAR(expected_dvalue_drow, dvalue_drow, 1e-6);
+    EXPECT_NEAR(expected_dvalue_dcolumn, dvalue_dcolumn, 1e-6);
+  }
+}
+
+TEST(InterpolationGridTest, UpdateCopiesChangedCells) {
+  const RangeDataInserter range_data_inserter(CreateRangeDataInserterOptions());
+  ProbabilityGrid probability_grid(
+      MapLimits(0.1, Eigen::Vector2d(1., 1.), CellLimits(20, 20)));
+  range_data_inserter.Insert(
+      {Eigen::Vector3f::Zero(), {Eigen::Vector3f(0.5f, 0.5f, 0.f)}, {}},
+      &probability_grid);
+  InterpolationGrid interpolation_grid(probability_grid);
+  for (const Eigen::Vector3f& point :
+       {Eigen::Vector3f(-0.5f, 0.5f, 0.f), Eigen::Vector3f(0.5f, -0.7f, 0.f),
+        Eigen::Vector3f(0.5f, 0.5f, 0.f)}) {
+    range_data_inserter.Insert({Eigen::Vector3f::Zero(), {point}, {}},
+                               &probability_grid);
+    ASSERT_TRUE(interpolation_grid.Update(probability_grid));
+    ExpectEqualCells(InterpolationGrid(probability_grid), interpolation_grid);
+  }
+}
+
+TEST(InterpolationGridTest, UpdateFailsAfterGrowingLimits) {
+  const RangeDataInserter range_data_inserter(CreateRangeDataInserterOptions());
+  ProbabilityGrid probability_grid(
+      MapLimits(0.1, Eigen::Vector2d(1., 1.), CellLimits(20, 20)));
+  InterpolationGrid interpolation_grid(probability_grid);
+  range_data_inserter.Insert(
+      {Eigen::Vector3f::Zero(), {Eigen::Vector3f(5.f, 0.f, 0.f)}, {}},
+      &probability_grid);
+  EXPECT_FALSE(interpolation_grid.Update(probability_grid));
+  EXPECT_EQ(20 + 2 * InterpolationGrid::kPadding,
+            interpolation_grid.num_rows());
+}
+
+}  // namespace
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -17,9 +17,12 @@
 #ifndef CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_OCCUPIED_SPACE_COST_FUNCTOR_H_
 #define CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_OCCUPIED_SPACE_COST_FUNCTOR_H_
 
+#include <cmath>
+
 #include "Eigen/Core"
 #include "Eigen/Geometry"
-#include "cartographer/mapping_2d/probability_grid.h"
+#include "cartographer/common/math.h"
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
 #include "cartographer/sensor/point_cloud.h"
 #include "ceres/ceres.h"
 #include "ceres/cubic_interpolation.h"
@@ -37,10 +40,10 @@ class OccupiedSpaceCostFunctor {
   // level, and point cloud.
   OccupiedSpaceCostFunctor(const double scaling_factor,
                            const sensor::PointCloud& point_cloud,
-                           const ProbabilityGrid& probability_grid)
+                           const InterpolationGrid& interpolation_grid)
       : scaling_factor_(scaling_factor),
         point_cloud_(point_cloud),
-        probability_grid_(probability_grid) {}
+        interpolation_grid_(interpolation_grid) {}
 
   OccupiedSpaceCostFunctor(const OccupiedSpaceCostFunctor&) = delete;
   OccupiedSpaceCostFunctor& operator=(const OccupiedSpaceCostFunctor&) = delete;
@@ -53,9 +56,9 @@ class OccupiedSpaceCostFunctor {
     Eigen::Matrix<T, 3, 3> transform;
     transform << rotation_matrix, translation, T(0.), T(0.), T(1.);
 
-    const GridArrayAdapter adapter(probability_grid_);
+    const GridArrayAdapter adapter(interpolation_grid_);
     ceres::BiCubicInterpolator<GridArrayAdapter> interpolator(adapter);
-    const MapLimits& limits = probability_grid_.limits();
+    const MapLimits& limits = interpolation_grid_.limits();
 
     for (size_t i = 0; i < point_cloud_.size(); ++i) {
       // Note that this is a 2D point. The third component is a scaling factor.
@@ -64,9 +67,9 @@ class OccupiedSpaceCostFunctor {
       const Eigen::Matrix<T, 3, 1> world = transform * point;
       interpolator.Evaluate(
           (limits.max().x() - world[0]) / limits.resolution() - 0.5 +
-              T(kPadding),
+              T(InterpolationGrid::kPadding),
           (limits.max().y() - world[1]) / limits.resolution() - 0.5 +
-              T(kPadding),
+              T(InterpolationGrid::kPadding),
           &residual[i]);
       residual[i] = scaling_factor_ * (1. - residual[i]);
     }
@@ -74,41 +77,95 @@ class OccupiedSpaceCostFunctor {
   }
 
  private:
-  static constexpr int kPadding = INT_MAX / 4;
+  // Samples outside of the padded grid are clamped to its border, which only
+  // costs comparisons instead of the lookups of ProbabilityGrid.
   class GridArrayAdapter {
    public:
     enum { DATA_DIMENSION = 1 };
 
-    explicit GridArrayAdapter(const ProbabilityGrid& probability_grid)
-        : probability_grid_(probability_grid) {}
+    explicit GridArrayAdapter(const InterpolationGrid& interpolation_grid)
+        : interpolation_grid_(interpolation_grid) {}
 
     void GetValue(const int row, const int column, double* const value) const {
-      if (row < kPadding || column < kPadding || row >= NumRows() - kPadding ||
-          column >= NumCols() - kPadding) {
-        *value = mapping::kMinProbability;
-      } else {
-        *value = static_cast<double>(probability_grid_.GetProbability(
-            Eigen::Array2i(column - kPadding, row - kPadding)));
-      }
+      *value = interpolation_grid_.GetValue(
+          common::Clamp(row, 0, NumRows() - 1),
+          common::Clamp(column, 0, NumCols() - 1));
     }
 
-    int NumRows() const {
-      return probability_grid_.limits().cell_limits().num_y_cells +
-             2 * kPadding;
-    }
+    int NumRows() const { return interpolation_grid_.num_rows(); }
 
-    int NumCols() const {
-      return probability_grid_.limits().cell_limits().num_x_cells +
-             2 * kPadding;
-    }
+    int NumCols() const { return interpolation_grid_.num_columns(); }
 
    private:
-    const ProbabilityGrid& probability_grid_;
+    const InterpolationGrid& interpolation_grid_;
   };
 
   const double scaling_factor_;
   const sensor::PointCloud& point_cloud_;
-  const ProbabilityGrid& probability_grid_;
+  const InterpolationGrid& interpolation_grid_;
+};
+
+// Computes the same cost as OccupiedSpaceCostFunctor, but evaluates the
+// Jacobian in closed form instead of using automatic differentiation. The
+// interpolation is the same as in ceres::BiCubicInterpolator.
+class AnalyticalOccupiedSpaceCostFunction
+    : public ceres::SizedCostFunction<ceres::DYNAMIC, 3> {
+ public:
+  AnalyticalOccupiedSpaceCostFunction(
+      const double scaling_factor, const sensor::PointCloud& point_cloud,
+      const InterpolationGrid& interpolation_grid)
+      : scaling_factor_(scaling_factor),
+        point_cloud_(point_cloud),
+        interpolation_grid_(interpolation_grid) {
+    set_num_residuals(point_cloud_.size());
+  }
+
+  AnalyticalOccupiedSpaceCostFunction(
+      const AnalyticalOccupiedSpaceCostFunction&) = delete;
+  AnalyticalOccupiedSpaceCostFunction& operator=(
+      const AnalyticalOccupiedSpaceCostFunction&) = delete;
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    const double* const pose = parameters[0];
+    const double cos_theta = std::cos(pose[2]);
+    const double sin_theta = std::sin(pose[2]);
+    const MapLimits& limits = interpolation_grid_.limits();
+    double* const jacobian = jacobians == nullptr ? nullptr : jacobians[0];
+
+    for (size_t i = 0; i < point_cloud_.size(); ++i) {
+      const double x = point_cloud_[i].x();
+      const double y = point_cloud_[i].y();
+      const double world_x = cos_theta * x - sin_theta * y + pose[0];
+      const double world_y = sin_theta * x + cos_theta * y + pose[1];
+      double value;
+      double dvalue_drow;
+      double dvalue_dcolumn;
+      interpolation_grid_.Interpolate(
+          (limits.max().x() - world_x) / limits.resolution() - 0.5,
+          (limits.max().y() - world_y) / limits.resolution() - 0.5, &value,
+          &dvalue_drow, &dvalue_dcolumn);
+      residuals[i] = scaling_factor_ * (1. - value);
+      if (jacobian != nullptr) {
+        // Derivatives with respect to the position of the point in the map.
+        // Rows and columns decrease as x and y increase.
+        const double dresidual_dx =
+            scaling_factor_ * dvalue_drow / limits.resolution();
+        const double dresidual_dy =
+            scaling_factor_ * dvalue_dcolumn / limits.resolution();
+        jacobian[3 * i] = dresidual_dx;
+        jacobian[3 * i + 1] = dresidual_dy;
+        jacobian[3 * i + 2] = -dresidual_dx * (world_y - pose[1]) +
+                              dresidual_dy * (world_x - pose[0]);
+      }
+    }
+    return true;
+  }
+
+ private:
+  const double scaling_factor_;
+  const sensor::PointCloud& point_cloud_;
+  const InterpolationGrid& interpolation_grid_;
 };
 
 }  // namespace scan_matching
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/scan_matching/occupied_space_cost_functor.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+namespace {
+
+TEST(OccupiedSpaceCostFunctorTest, AnalyticalJacobianMatchesAutoDiff) {
+  std::mt19937 prng(42);
+  ProbabilityGrid probability_grid(
+      MapLimits(0.1, Eigen::Vector2d(1., 2.), CellLimits(30, 40)));
+  std::uniform_real_distribution<float> probability_distribution(
+      mapping::kMinProbability, mapping::kMaxProbability);
+  for (int x = 0; x != 30; ++x) {
+    for (int y = 0; y != 40; ++y) {
+      if ((x + y) % 7 != 0) {
+        probability_grid.SetProbability(Eigen::Array2i(x, y),
+                                        probability_distribution(prng));
+      }
+    }
+  }
+  // Some points fall outside of the grid.
+  std::uniform_real_distribution<float> point_distribution(-2.5f, 2.5f);
+  sensor::PointCloud point_cloud;
+  for (int i = 0; i != 100; ++i) {
+    point_cloud.emplace_back(point_distribution(prng),
+                             point_distribution(prng), 0.f);
+  }
+
+  const InterpolationGrid interpolation_grid(probability_grid);
+  const ceres::AutoDiffCostFunction<OccupiedSpaceCostFunctor, ceres::DYNAMIC,
+                                    3>
+      auto_diff_cost_function(
+          new OccupiedSpaceCostFunctor(2., point_cloud, interpolation_grid),
+          point_cloud.size());
+  const AnalyticalOccupiedSpaceCostFunction analytical_cost_function(
+      2., point_cloud, interpolation_grid);
+  ASSERT_EQ(auto_diff_cost_function.num_residuals(),
+            analytical_cost_function.num_residuals());
+
+  std::uniform_real_distribution<double> pose_distribution(-0.5, 0.5);
+  for (int i = 0; i != 10; ++i) {
+    const double pose[3] = {pose_distribution(prng), pose_distribution(prng),
+                            pose_distribution(prng)};
+    const double* const parameters[1] = {pose};
+    std::vector<double> expected_residuals(point_cloud.size());
+    std::vector<double> expected_jacobian(3 * point_cloud.size());
+    double* expected_jacobian_pointer = expected_jacobian.data();
+    ASSERT_TRUE(auto_diff_cost_function.Evaluate(
+        parameters, expected_residuals.data(), &expected_jacobian_pointer));
+    std::vector<double> residuals(point_cloud.size());
+    std::vector<double> jacobian(3 * point_cloud.size());
+    double* jacobian_pointer = jacobian.data();
+    ASSERT_TRUE(analytical_cost_function.Evaluate(parameters, residuals.data(),
+                                                  &jacobian_pointer));
+    for (size_t j = 0; j != residuals.size(); ++j) {
+      EXPECT_NEAR(expected_residuals[j], residuals[j], 1e-5);
+    }
+    for (size_t j = 0; j != jacobian.size(); ++j) {
+      EXPECT_NEAR(expected_jacobian[j], jacobian[j], 1e-4);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -20,6 +20,7 @@
 #include <cmath>
 #include <functional>
 #include <limits>
+#include <utility>
 
 #include "Eigen/Geometry"
 #include "cartographer/common/lua_parameter_dictionary.h"
@@ -33,6 +34,291 @@ namespace cartographer {
 namespace mapping_2d {
 namespace scan_matching {
 
+namespace {
+
+// Returns the score of 'discrete_scan' translated by 'offset', i.e., the mean
+// of 'get_probability' over its cells weighted by the 'distance' and
+// 'orientation' from the initial pose.
+template <typename GetProbability>
+float ScoreDiscreteScan(
+    const GetProbability& get_probability, const DiscreteScan& discrete_scan,
+    const Eigen::Array2i& offset, const double distance,
+    const double orientation,
+    const proto::RealTimeCorrelativeScanMatcherOptions& options) {
+  float score = 0.f;
+  for (const Eigen::Array2i& xy_index : discrete_scan) {
+    score += get_probability(xy_index + offset);
+  }
+  score /= static_cast<float>(discrete_scan.size());
+  score *= std::exp(-common::Pow2(
+      distance * options.translation_delta_cost_weight() +
+      std::abs(orientation) * options.rotation_delta_cost_weight()));
+  return score;
+}
+
+// Returns the smallest absolute value in [min, max].
+int MinAbs(const int min, const int max) {
+  if (min <= 0 && max >= 0) {
+    return 0;
+  }
+  return std::min(std::abs(min), std::abs(max));
+}
+
+// Grids of widths 1, 2, 4, ... which contain in each cell (x0, y0) the maximum
+// probability in the width x width area starting at (x0, y0), like the
+// PrecomputationGridStack of the FastCorrelativeScanMatcher. Since the submap
+// changes with every insertion, they are computed for each match, only for the
+// cells the scan can reach within the search window. Probabilities are kept as
+// floats, so that scores at width 1 are exactly the exhaustive search scores.
+class MaxPooledGridStack {
+ public:
+  MaxPooledGridStack(const ProbabilityGrid& probability_grid,
+                     const std::vector<DiscreteScan>& discrete_scans,
+                     const SearchParameters& search_parameters,
+                     const int depth) {
+    const int max_width = 1 << (depth - 1);
+    // The cells reached by any scan at any offset in the search window.
+    Eigen::Array2i min(std::numeric_limits<int>::max(),
+                       std::numeric_limits<int>::max());
+    Eigen::Array2i max(std::numeric_limits<int>::min(),
+                       std::numeric_limits<int>::min());
+    for (int scan_index = 0; scan_index != search_parameters.num_scans;
+         ++scan_index) {
+      const auto& linear_bounds = search_parameters.linear_bounds[scan_index];
+      for (const Eigen::Array2i& xy_index : discrete_scans[scan_index]) {
+        min = min.min(xy_index +
+                      Eigen::Array2i(linear_bounds.min_x, linear_bounds.min_y));
+        max = max.max(xy_index +
+                      Eigen::Array2i(linear_bounds.max_x, linear_bounds.max_y));
+      }
+    }
+    // Wider areas starting at these cells extend beyond them. Only known cells
+    // can have a probability above the minimum.
+    max += max_width - 1;
+    Eigen::Array2i known_offset;
+    CellLimits known_limits;
+    probability_grid.ComputeCroppedLimits(&known_offset, &known_limits);
+    offset_ = min.max(known_offset - (max_width - 1));
+    max = max.min(known_offset + Eigen::Array2i(known_limits.num_x_cells - 1,
+                                                known_limits.num_y_cells - 1));
+    limits_ = CellLimits(std::max(0, max.x() - offset_.x() + 1),
+                         std::max(0, max.y() - offset_.y() + 1));
+
+    const int stride = limits_.num_x_cells;
+    grids_.reserve(depth);
+    grids_.emplace_back(limits_.num_x_cells * limits_.num_y_cells);
+    for (int y = 0; y != limits_.num_y_cells; ++y) {
+      for (int x = 0; x != stride; ++x) {
+        grids_[0][x + y * stride] =
+            probability_grid.GetProbability(offset_ + Eigen::Array2i(x, y));
+      }
+    }
+    // The area of each cell is covered by the areas of half the width at the
+    // same cell and 'finer_width' cells further in x and y.
+    for (int i = 1; i != depth; ++i) {
+      const std::vector<float>& finer_grid = grids_.back();
+      const int finer_width = 1 << (i - 1);
+      std::vector<float> grid(finer_grid);
+      for (int y = 0; y != limits_.num_y_cells; ++y) {
+        for (int x = 0; x != stride; ++x) {
+          float& value = grid[x + y * stride];
+          const bool has_x = x + finer_width < stride;
+          const bool has_y = y + finer_width < limits_.num_y_cells;
+          if (has_x) {
+            value = std::max(value, finer_grid[x + finer_width + y * stride]);
+          }
+          if (has_y) {
+            value =
+                std::max(value, finer_grid[x + (y + finer_width) * stride]);
+          }
+          if (has_x && has_y) {
+            value = std::max(value, finer_grid[x + finer_width +
+                                               (y + finer_width) * stride]);
+          }
+        }
+      }
+      grids_.push_back(std::move(grid));
+    }
+  }
+
+  MaxPooledGridStack(const MaxPooledGridStack&) = delete;
+  MaxPooledGridStack& operator=(const MaxPooledGridStack&) = delete;
+
+  // Returns the maximum probability in the area of width 2^'depth' starting at
+  // 'xy_index'.
+  float Get(const int depth, const Eigen::Array2i& xy_index) const {
+    const Eigen::Array2i local_xy_index = xy_index - offset_;
+    if (static_cast<unsigned>(local_xy_index.x()) >=
+            static_cast<unsigned>(limits_.num_x_cells) ||
+        static_cast<unsigned>(local_xy_index.y()) >=
+            static_cast<unsigned>(limits_.num_y_cells)) {
+      return mapping::kMinProbability;
+    }
+    return grids_[depth][local_xy_index.x() +
+                         local_xy_index.y() * limits_.num_x_cells];
+  }
+
+ private:
+  Eigen::Array2i offset_;
+  CellLimits limits_;
+  std::vector<std::vector<float>> grids_;
+};
+
+// Searches the window by scoring candidates covering 2^depth x 2^depth offsets
+// on the coarsest grid first and only refining the promising ones.
+class MultiResolutionSearch {
+ public:
+  MultiResolutionSearch(
+      const ProbabilityGrid& probability_grid,
+      const std::vector<DiscreteScan>& discrete_scans,
+      const SearchParameters& search_parameters,
+      const proto::RealTimeCorrelativeScanMatcherOptions& options)
+      : discrete_scans_(discrete_scans),
+        search_parameters_(search_parameters),
+        options_(options),
+        grid_stack_(probability_grid, discrete_scans, search_parameters,
+                    options.multi_resolution_depth()) {}
+
+  Candidate Search() const {
+    const int max_depth = options_.multi_resolution_depth() - 1;
+    std::vector<Candidate> candidates = GenerateCoarsestCandidates(max_depth);
+    ScoreCandidates(max_depth, &candidates);
+    if (options_.multi_resolution_num_greedy_candidates() > 0) {
+      return GreedySearch(candidates, max_depth);
+    }
+    Candidate best_candidate(0, 0, 0, search_parameters_);
+    best_candidate.score = -std::numeric_limits<float>::infinity();
+    return BranchAndBound(candidates, max_depth, best_candidate);
+  }
+
+ private:
+  std::vector<Candidate> GenerateCoarsestCandidates(const int depth) const {
+    const int linear_step_size = 1 << depth;
+    std::vector<Candidate> candidates;
+    for (int scan_index = 0; scan_index != search_parameters_.num_scans;
+         ++scan_index) {
+      const auto& linear_bounds = search_parameters_.linear_bounds[scan_index];
+      for (int x_index_offset = linear_bounds.min_x;
+           x_index_offset <= linear_bounds.max_x;
+           x_index_offset += linear_step_size) {
+        for (int y_index_offset = linear_bounds.min_y;
+             y_index_offset <= linear_bounds.max_y;
+             y_index_offset += linear_step_size) {
+          candidates.emplace_back(scan_index, x_index_offset, y_index_offset,
+                                  search_parameters_);
+        }
+      }
+    }
+    return candidates;
+  }
+
+  // Appends the up to four candidates of the next finer grid covered by
+  // 'candidate' at 'depth' to 'children'.
+  void AppendChildren(const Candidate& candidate, const int depth,
+                      std::vector<Candidate>* const children) const {
+    const auto& linear_bounds =
+        search_parameters_.linear_bounds[candidate.scan_index];
+    const int half_width = 1 << (depth - 1);
+    for (int x_offset : {0, half_width}) {
+      if (candidate.x_index_offset + x_offset > linear_bounds.max_x) {
+        break;
+      }
+      for (int y_offset : {0, half_width}) {
+        if (candidate.y_index_offset + y_offset > linear_bounds.max_y) {
+          break;
+        }
+        children->emplace_back(
+            candidate.scan_index, candidate.x_index_offset + x_offset,
+            candidate.y_index_offset + y_offset, search_parameters_);
+      }
+    }
+  }
+
+  // Scores 'candidates' at 'depth' with an upper bound of the scores of all
+  // offsets they cover, and sorts them by decreasing score. At depth 0, these
+  // are the exact scores.
+  void ScoreCandidates(const int depth,
+                       std::vector<Candidate>* const candidates) const {
+    const int width = 1 << depth;
+    for (Candidate& candidate : *candidates) {
+      double distance = std::hypot(candidate.x, candidate.y);
+      if (depth > 0) {
+        // The smallest distance of any covered offset bounds the weight.
+        const auto& linear_bounds =
+            search_parameters_.linear_bounds[candidate.scan_index];
+        distance =
+            search_parameters_.resolution *
+            std::hypot(MinAbs(candidate.x_index_offset,
+                              std::min(candidate.x_index_offset + width - 1,
+                                       linear_bounds.max_x)),
+                       MinAbs(candidate.y_index_offset,
+                              std::min(candidate.y_index_offset + width - 1,
+                                       linear_bounds.max_y)));
+      }
+      candidate.score = ScoreDiscreteScan(
+          [this, depth](const Eigen::Array2i& xy_index) {
+            return grid_stack_.Get(depth, xy_index);
+          },
+          discrete_scans_[candidate.scan_index],
+          Eigen::Array2i(candidate.x_index_offset, candidate.y_index_offset),
+          distance, candidate.orientation, options_);
+    }
+    std::sort(candidates->begin(), candidates->end(),
+              std::greater<Candidate>());
+  }
+
+  // Returns the best candidate covered by 'candidates' at 'depth' if it scores
+  // higher than 'best_candidate', otherwise 'best_candidate'. Since scores at
+  // coarser depths are upper bounds, this is the result of the exhaustive
+  // search.
+  Candidate BranchAndBound(const std::vector<Candidate>& candidates,
+                           const int depth, Candidate best_candidate) const {
+    if (depth == 0) {
+      return candidates.front().score > best_candidate.score
+                 ? candidates.front()
+                 : best_candidate;
+    }
+    for (const Candidate& candidate : candidates) {
+      if (candidate.score <= best_candidate.score) {
+        break;
+      }
+      std::vector<Candidate> children;
+      AppendChildren(candidate, depth, &children);
+      ScoreCandidates(depth - 1, &children);
+      best_candidate = BranchAndBound(children, depth - 1, best_candidate);
+    }
+    return best_candidate;
+  }
+
+  // Refines only the best candidates at each depth. This is faster than
+  // BranchAndBound() but might miss the best candidate.
+  Candidate GreedySearch(std::vector<Candidate> candidates,
+                         const int max_depth) const {
+    const size_t num_candidates =
+        options_.multi_resolution_num_greedy_candidates();
+    for (int depth = max_depth; depth > 0; --depth) {
+      if (candidates.size() > num_candidates) {
+        candidates.erase(candidates.begin() + num_candidates, candidates.end());
+      }
+      std::vector<Candidate> children;
+      children.reserve(4 * candidates.size());
+      for (const Candidate& candidate : candidates) {
+        AppendChildren(candidate, depth, &children);
+      }
+      ScoreCandidates(depth - 1, &children);
+      candidates = std::move(children);
+    }
+    return candidates.front();
+  }
+
+  const std::vector<DiscreteScan>& discrete_scans_;
+  const SearchParameters& search_parameters_;
+  const proto::RealTimeCorrelativeScanMatcherOptions& options_;
+  const MaxPooledGridStack grid_stack_;
+};
+
+}  // namespace
+
 proto::RealTimeCorrelativeScanMatcherOptions
 CreateRealTimeCorrelativeScanMatcherOptions(
     common::LuaParameterDictionary* const parameter_dictionary) {
@@ -45,8 +331,14 @@ CreateRealTimeCorrelativeScanMatcherOptions(
       parameter_dictionary->GetDouble("translation_delta_cost_weight"));
   options.set_rotation_delta_cost_weight(
       parameter_dictionary->GetDouble("rotation_delta_cost_weight"));
+  options.set_multi_resolution_depth(
+      parameter_dictionary->GetInt("multi_resolution_depth"));
+  options.set_multi_resolution_num_greedy_candidates(
+      parameter_dictionary->GetNonNegativeInt(
+          "multi_resolution_num_greedy_candidates"));
   CHECK_GE(options.translation_delta_cost_weight(), 0.);
   CHECK_GE(options.rotation_delta_cost_weight(), 0.);
+  CHECK_GE(options.multi_resolution_depth(), 1);
   return options;
 }
 
@@ -110,13 +402,13 @@ double RealTimeCorrelativeScanMatcher::Match(
       probability_grid.limits(), rotated_scans,
       Eigen::Translation2f(initial_pose_estimate.translation().x(),
                            initial_pose_estimate.translation().y()));
-  std::vector<Candidate> candidates =
-      GenerateExhaustiveSearchCandidates(search_parameters);
-  ScoreCandidates(probability_grid, discrete_scans, search_parameters,
-                  &candidates);
-
-  const Candidate& best_candidate =
-      *std::max_element(candidates.begin(), candidates.end());
+  const Candidate best_candidate =
+      options_.multi_resolution_depth() > 1
+          ? MultiResolutionSearch(probability_grid, discrete_scans,
+                                  search_parameters, options_)
+                .Search()
+          : ExhaustiveSearch(probability_grid, discrete_scans,
+                             search_parameters);
   *pose_estimate = transform::Rigid2d(
       {initial_pose_estimate.translation().x() + best_candidate.x,
        initial_pose_estimate.translation().y() + best_candidate.y},
@@ -124,29 +416,30 @@ double RealTimeCorrelativeScanMatcher::Match(
   return best_candidate.score;
 }
 
+Candidate RealTimeCorrelativeScanMatcher::ExhaustiveSearch(
+    const ProbabilityGrid& probability_grid,
+    const std::vector<DiscreteScan>& discrete_scans,
+    const SearchParameters& search_parameters) const {
+  std::vector<Candidate> candidates =
+      GenerateExhaustiveSearchCandidates(search_parameters);
+  ScoreCandidates(probability_grid, discrete_scans, search_parameters,
+                  &candidates);
+  return *std::max_element(candidates.begin(), candidates.end());
+}
+
 void RealTimeCorrelativeScanMatcher::ScoreCandidates(
     const ProbabilityGrid& probability_grid,
     const std::vector<DiscreteScan>& discrete_scans,
     const SearchParameters& search_parameters,
     std::vector<Candidate>* const candidates) const {
   for (Candidate& candidate : *candidates) {
-    candidate.score = 0.f;
-    for (const Eigen::Array2i& xy_index :
-         discrete_scans[candidate.scan_index]) {
-      const Eigen::Array2i proposed_xy_index(
-          xy_index.x() + candidate.x_index_offset,
-          xy_index.y() + candidate.y_index_offset);
-      const float probability =
-          probability_grid.GetProbability(proposed_xy_index);
-      candidate.score += probability;
-    }
-    candidate.score /=
-        static_cast<float>(discrete_scans[candidate.scan_index].size());
-    candidate.score *=
-        std::exp(-common::Pow2(std::hypot(candidate.x, candidate.y) *
-                                   options_.translation_delta_cost_weight() +
-                               std::abs(candidate.orientation) *
-                                   options_.rotation_delta_cost_weight()));
+    candidate.score = ScoreDiscreteScan(
+        [&probability_grid](const Eigen::Array2i& xy_index) {
+          return probability_grid.GetProbability(xy_index);
+        },
+        discrete_scans[candidate.scan_index],
+        Eigen::Array2i(candidate.x_index_offset, candidate.y_index_offset),
+        std::hypot(candidate.x, candidate.y), candidate.orientation, options_);
     CHECK_GT(candidate.score, 0.f);
   }
 }
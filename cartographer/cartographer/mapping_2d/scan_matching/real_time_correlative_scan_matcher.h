@@ -32,6 +32,11 @@
 //
 // This can be made even faster by transforming the scan exactly once over some
 // discretized range.
+//
+// By default, all candidates are scored at full resolution. With a
+// 'multi_resolution_depth' above 1, the search is done coarse-to-fine on
+// max-pooled grids computed for each match, either by branch and bound, which
+// finds the same result, or greedily.
 
 #ifndef CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_REAL_TIME_CORRELATIVE_SCAN_MATCHER_H_
 #define CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_REAL_TIME_CORRELATIVE_SCAN_MATCHER_H_
@@ -86,6 +91,11 @@ class RealTimeCorrelativeScanMatcher {
   std::vector<Candidate> GenerateExhaustiveSearchCandidates(
       const SearchParameters& search_parameters) const;
 
+  // Scores all candidates at full resolution and returns the best one.
+  Candidate ExhaustiveSearch(const ProbabilityGrid& probability_grid,
+                             const std::vector<DiscreteScan>& discrete_scans,
+                             const SearchParameters& search_parameters) const;
+
   const proto::RealTimeCorrelativeScanMatcherOptions options_;
 };
 
@@ -18,6 +18,8 @@
 
 #include <cmath>
 #include <memory>
+#include <random>
+#include <string>
 
 #include "Eigen/Geometry"
 #include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
@@ -66,6 +68,8 @@ class RealTimeCorrelativeScanMatcherTest : public ::testing::Test {
           "angular_search_window = 0.16, "
           "translation_delta_cost_weight = 0., "
           "rotation_delta_cost_weight = 0., "
+          "multi_resolution_depth = 1, "
+          "multi_resolution_num_greedy_candidates = 0, "
           "}");
       real_time_correlative_scan_matcher_ =
           common::make_unique<RealTimeCorrelativeScanMatcher>(
@@ -74,6 +78,41 @@ class RealTimeCorrelativeScanMatcherTest : public ::testing::Test {
     }
   }
 
+  std::unique_ptr<RealTimeCorrelativeScanMatcher> CreateScanMatcher(
+      const int multi_resolution_depth,
+      const int multi_resolution_num_greedy_candidates) {
+    auto parameter_dictionary = common::MakeDictionary(
+        "return {"
+        "linear_search_window = 0.5, "
+        "angular_search_window = 0.2, "
+        "translation_delta_cost_weight = 0.1, "
+        "rotation_delta_cost_weight = 0.1, "
+        "multi_resolution_depth = " +
+        std::to_string(multi_resolution_depth) +
+        ", "
+        "multi_resolution_num_greedy_candidates = " +
+        std::to_string(multi_resolution_num_greedy_candidates) +
+        ", "
+        "}");
+    return common::make_unique<RealTimeCorrelativeScanMatcher>(
+        CreateRealTimeCorrelativeScanMatcherOptions(
+            parameter_dictionary.get()));
+  }
+
+  // Inserts a random point cloud into a new grid around the origin.
+  void CreateRandomMap(ProbabilityGrid* const probability_grid,
+                       sensor::PointCloud* const point_cloud) {
+    std::mt19937 prng(42);
+    std::uniform_real_distribution<float> distribution(-3.f, 3.f);
+    for (int i = 0; i != 200; ++i) {
+      point_cloud->emplace_back(distribution(prng), distribution(prng), 0.f);
+    }
+    range_data_inserter_->Insert(
+        sensor::RangeData{Eigen::Vector3f::Zero(), *point_cloud, {}},
+        probability_grid);
+    probability_grid->FinishUpdate();
+  }
+
   ProbabilityGrid probability_grid_;
   std::unique_ptr<RangeDataInserter> range_data_inserter_;
   sensor::PointCloud point_cloud_;
@@ -118,6 +157,48 @@ TEST_F(RealTimeCorrelativeScanMatcherTest,
   EXPECT_GT(0.7, candidates[0].score);
 }
 
+TEST_F(RealTimeCorrelativeScanMatcherTest,
+       BranchAndBoundMatchesExhaustiveSearch) {
+  ProbabilityGrid probability_grid(
+      MapLimits(0.05, Eigen::Vector2d(5., 5.), CellLimits(200, 200)));
+  sensor::PointCloud point_cloud;
+  CreateRandomMap(&probability_grid, &point_cloud);
+  const auto exhaustive_scan_matcher = CreateScanMatcher(1, 0);
+  const auto multi_resolution_scan_matcher = CreateScanMatcher(4, 0);
+  std::mt19937 prng(23);
+  std::uniform_real_distribution<double> distribution(-0.2, 0.2);
+  for (int i = 0; i != 10; ++i) {
+    const transform::Rigid2d initial_pose_estimate(
+        Eigen::Vector2d(distribution(prng), distribution(prng)),
+        distribution(prng));
+    transform::Rigid2d exhaustive_pose_estimate;
+    transform::Rigid2d multi_resolution_pose_estimate;
+    const double exhaustive_score = exhaustive_scan_matcher->Match(
+        initial_pose_estimate, point_cloud, probability_grid,
+        &exhaustive_pose_estimate);
+    const double multi_resolution_score = multi_resolution_scan_matcher->Match(
+        initial_pose_estimate, point_cloud, probability_grid,
+        &multi_resolution_pose_estimate);
+    EXPECT_EQ(exhaustive_score, multi_resolution_score);
+  }
+}
+
+TEST_F(RealTimeCorrelativeScanMatcherTest, GreedySearchFindsOffset) {
+  ProbabilityGrid probability_grid(
+      MapLimits(0.05, Eigen::Vector2d(5., 5.), CellLimits(200, 200)));
+  sensor::PointCloud point_cloud;
+  CreateRandomMap(&probability_grid, &point_cloud);
+  const auto scan_matcher = CreateScanMatcher(3, 20);
+  const transform::Rigid2d initial_pose_estimate(Eigen::Vector2d(0.2, -0.15),
+                                                 0.05);
+  transform::Rigid2d pose_estimate;
+  scan_matcher->Match(initial_pose_estimate, point_cloud, probability_grid,
+                      &pose_estimate);
+  EXPECT_NEAR(0., pose_estimate.translation().x(), 0.03);
+  EXPECT_NEAR(0., pose_estimate.translation().y(), 0.03);
+  EXPECT_NEAR(0., pose_estimate.rotation().angle(), 0.02);
+}
+
 }  // namespace
 }  // namespace scan_matching
 }  // namespace mapping_2d
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/scan_matching/scoring_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CARTOGRAPHER_X86_SCORING_KERNELS
+#include <immintrin.h>
+#endif
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+
+namespace {
+
+int SumCellValuesScalar(const uint8* const cells, const int num_x_cells,
+                        const int num_y_cells, const int* const x_indices,
+                        const int* const y_indices, const int begin,
+                        const int end, const int x_offset,
+                        const int y_offset) {
+  int sum = 0;
+  for (int i = begin; i != end; ++i) {
+    const int x = x_indices[i] + x_offset;
+    const int y = y_indices[i] + y_offset;
+    // See PrecomputationGrid::GetValue() for the unsigned comparisons.
+    if (static_cast<unsigned>(x) < static_cast<unsigned>(num_x_cells) &&
+        static_cast<unsigned>(y) < static_cast<unsigned>(num_y_cells)) {
+      sum += cells[x + y * num_x_cells];
+    }
+  }
+  return sum;
+}
+
+#ifdef CARTOGRAPHER_X86_SCORING_KERNELS
+
+// Computes the indices of 4 points and zeroes those outside of the grid. Since
+// all indices are non-negative, the unsigned comparisons of the scalar version
+// become 0 <= x < num_x_cells.
+__attribute__((target("sse4.1"))) int SumCellValuesSse41(
+    const uint8* const cells, const int num_x_cells, const int num_y_cells,
+    const int* const x_indices, const int* const y_indices,
+    const int num_points, const int x_offset, const int y_offset) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i minus_one = _mm_set1_epi32(-1);
+  const __m128i x_offsets = _mm_set1_epi32(x_offset);
+  const __m128i y_offsets = _mm_set1_epi32(y_offset);
+  const __m128i x_limits = _mm_set1_epi32(num_x_cells);
+  const __m128i y_limits = _mm_set1_epi32(num_y_cells);
+  int sum = 0;
+  int i = 0;
+  for (; i + 4 <= num_points; i += 4) {
+    const __m128i x = _mm_add_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(x_indices + i)),
+        x_offsets);
+    const __m128i y = _mm_add_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(y_indices + i)),
+        y_offsets);
+    const __m128i inside = _mm_and_si128(
+        _mm_and_si128(_mm_cmpgt_epi32(x, minus_one),
+                      _mm_cmpgt_epi32(x_limits, x)),
+        _mm_and_si128(_mm_cmpgt_epi32(y, minus_one),
+                      _mm_cmpgt_epi32(y_limits, y)));
+    const __m128i index = _mm_and_si128(
+        _mm_add_epi32(x, _mm_mullo_epi32(y, x_limits)), inside);
+    // Out of bounds lanes read cell 0 and are masked to 0 afterwards.
+    const __m128i values = _mm_and_si128(
+        _mm_setr_epi32(cells[_mm_extract_epi32(index, 0)],
+                       cells[_mm_extract_epi32(index, 1)],
+                       cells[_mm_extract_epi32(index, 2)],
+                       cells[_mm_extract_epi32(index, 3)]),
+        inside);
+    const __m128i pair_sums =
+        _mm_add_epi32(values, _mm_unpackhi_epi64(values, zero));
+    sum += _mm_cvtsi128_si32(pair_sums) + _mm_extract_epi32(pair_sums, 1);
+  }
+  return sum + SumCellValuesScalar(cells, num_x_cells, num_y_cells, x_indices,
+                                   y_indices, i, num_points, x_offset,
+                                   y_offset);
+}
+
+// Gathers 8 cells at a time. Each lane loads 4 bytes starting at the cell,
+// hence the padding of the grids, and keeps the lowest.
+__attribute__((target("avx2"))) int SumCellValuesAvx2(
+    const uint8* const cells, const int num_x_cells, const int num_y_cells,
+    const int* const x_indices, const int* const y_indices,
+    const int num_points, const int x_offset, const int y_offset) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i minus_one = _mm256_set1_epi32(-1);
+  const __m256i byte_mask = _mm256_set1_epi32(0xff);
+  const __m256i x_offsets = _mm256_set1_epi32(x_offset);
+  const __m256i y_offsets = _mm256_set1_epi32(y_offset);
+  const __m256i x_limits = _mm256_set1_epi32(num_x_cells);
+  const __m256i y_limits = _mm256_set1_epi32(num_y_cells);
+  const int* const cells_as_ints = reinterpret_cast<const int*>(cells);
+  __m256i sums = zero;
+  int i = 0;
+  for (; i + 8 <= num_points; i += 8) {
+    const __m256i x = _mm256_add_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x_indices + i)),
+        x_offsets);
+    const __m256i y = _mm256_add_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y_indices + i)),
+        y_offsets);
+    const __m256i inside = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(x, minus_one),
+                         _mm256_cmpgt_epi32(x_limits, x)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(y, minus_one),
+                         _mm256_cmpgt_epi32(y_limits, y)));
+    const __m256i index = _mm256_and_si256(
+        _mm256_add_epi32(x, _mm256_mullo_epi32(y, x_limits)), inside);
+    const __m256i values = _mm256_mask_i32gather_epi32(
+        zero, cells_as_ints, index, inside, 1 /* scale */);
+    sums = _mm256_add_epi32(sums, _mm256_and_si256(values, byte_mask));
+  }
+  __m128i sums_128 = _mm_add_epi32(_mm256_castsi256_si128(sums),
+                                   _mm256_extracti128_si256(sums, 1));
+  sums_128 = _mm_add_epi32(sums_128, _mm_unpackhi_epi64(sums_128, sums_128));
+  sums_128 = _mm_add_epi32(sums_128, _mm_srli_si128(sums_128, 4));
+  return _mm_cvtsi128_si32(sums_128) +
+         SumCellValuesScalar(cells, num_x_cells, num_y_cells, x_indices,
+                             y_indices, i, num_points, x_offset, y_offset);
+}
+
+#endif  // CARTOGRAPHER_X86_SCORING_KERNELS
+
+}  // namespace
+
+PackedDiscreteScan::PackedDiscreteScan(const DiscreteScan& discrete_scan) {
+  x_indices.reserve(discrete_scan.size());
+  y_indices.reserve(discrete_scan.size());
+  for (const Eigen::Array2i& xy_index : discrete_scan) {
+    x_indices.push_back(xy_index.x());
+    y_indices.push_back(xy_index.y());
+  }
+}
+
+bool IsScoringKernelSupported(const ScoringKernel kernel) {
+  switch (kernel) {
+    case ScoringKernel::kScalar:
+      return true;
+#ifdef CARTOGRAPHER_X86_SCORING_KERNELS
+    case ScoringKernel::kSse41:
+      return __builtin_cpu_supports("sse4.1");
+    case ScoringKernel::kAvx2:
+      return __builtin_cpu_supports("avx2");
+#else
+    case ScoringKernel::kSse41:
+    case ScoringKernel::kAvx2:
+      return false;
+#endif
+  }
+  LOG(FATAL) << "Unknown scoring kernel " << static_cast<int>(kernel);
+}
+
+ScoringKernel GetFastestSupportedScoringKernel() {
+  static const ScoringKernel kFastestKernel = []() {
+    for (const ScoringKernel kernel :
+         {ScoringKernel::kAvx2, ScoringKernel::kSse41}) {
+      if (IsScoringKernelSupported(kernel)) {
+        return kernel;
+      }
+    }
+    return ScoringKernel::kScalar;
+  }();
+  return kFastestKernel;
+}
+
+string ScoringKernelToString(const ScoringKernel kernel) {
+  switch (kernel) {
+    case ScoringKernel::kScalar:
+      return "scalar";
+    case ScoringKernel::kSse41:
+      return "sse4.1";
+    case ScoringKernel::kAvx2:
+      return "avx2";
+  }
+  LOG(FATAL) << "Unknown scoring kernel " << static_cast<int>(kernel);
+}
+
+int SumCellValues(const ScoringKernel kernel, const uint8* const cells,
+                  const CellLimits& limits, const PackedDiscreteScan& scan,
+                  const Eigen::Array2i& offset) {
+  switch (kernel) {
+    case ScoringKernel::kScalar:
+      return SumCellValuesScalar(cells, limits.num_x_cells, limits.num_y_cells,
+                                 scan.x_indices.data(), scan.y_indices.data(),
+                                 0, scan.size(), offset.x(), offset.y());
+#ifdef CARTOGRAPHER_X86_SCORING_KERNELS
+    case ScoringKernel::kSse41:
+      return SumCellValuesSse41(cells, limits.num_x_cells, limits.num_y_cells,
+                                scan.x_indices.data(), scan.y_indices.data(),
+                                scan.size(), offset.x(), offset.y());
+    case ScoringKernel::kAvx2:
+      return SumCellValuesAvx2(cells, limits.num_x_cells, limits.num_y_cells,
+                               scan.x_indices.data(), scan.y_indices.data(),
+                               scan.size(), offset.x(), offset.y());
+#else
+    case ScoringKernel::kSse41:
+    case ScoringKernel::kAvx2:
+      break;
+#endif
+  }
+  LOG(FATAL) << "Unsupported scoring kernel " << ScoringKernelToString(kernel);
+}
+
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
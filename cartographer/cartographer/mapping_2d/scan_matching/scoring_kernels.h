@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Kernels summing the values of a PrecomputationGrid at the cells of a
+// translated DiscreteScan. This is the inner loop of the
+// FastCorrelativeScanMatcher. Vectorized kernels are compiled for specific
+// instruction sets and chosen at runtime depending on the CPU.
+
+#ifndef CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_SCORING_KERNELS_H_
+#define CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_SCORING_KERNELS_H_
+
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "cartographer/common/port.h"
+#include "cartographer/mapping_2d/map_limits.h"
+#include "cartographer/mapping_2d/scan_matching/correlative_scan_matcher.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+
+enum class ScoringKernel { kScalar, kSse41, kAvx2 };
+
+// Number of bytes after the last cell which the kernels may read. Grids passed
+// to SumCellValues() must be padded accordingly.
+constexpr int kScoringKernelCellPadding = 3;
+
+// A DiscreteScan with x and y indices stored in separate arrays, so that they
+// can be loaded into vector registers directly.
+struct PackedDiscreteScan {
+  explicit PackedDiscreteScan(const DiscreteScan& discrete_scan);
+
+  int size() const { return x_indices.size(); }
+
+  std::vector<int> x_indices;
+  std::vector<int> y_indices;
+};
+
+// Returns true if 'kernel' can be executed on this CPU.
+bool IsScoringKernelSupported(ScoringKernel kernel);
+
+// Returns the fastest kernel which can be executed on this CPU.
+ScoringKernel GetFastestSupportedScoringKernel();
+
+string ScoringKernelToString(ScoringKernel kernel);
+
+// Returns the sum of 'cells' at the indices of 'scan' translated by 'offset'.
+// 'cells' is in row-major order with 'limits.num_x_cells' columns. Cells
+// outside of 'limits' have value 0.
+int SumCellValues(ScoringKernel kernel, const uint8* cells,
+                  const CellLimits& limits, const PackedDiscreteScan& scan,
+                  const Eigen::Array2i& offset);
+
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_2D_SCAN_MATCHING_SCORING_KERNELS_H_
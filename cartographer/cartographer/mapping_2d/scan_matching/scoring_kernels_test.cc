@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/scan_matching/scoring_kernels.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace scan_matching {
+namespace {
+
+TEST(ScoringKernelsTest, ScalarKernelIsAlwaysSupported) {
+  EXPECT_TRUE(IsScoringKernelSupported(ScoringKernel::kScalar));
+  EXPECT_TRUE(IsScoringKernelSupported(GetFastestSupportedScoringKernel()));
+}
+
+TEST(ScoringKernelsTest, AllKernelsAgree) {
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<int> value_distribution(0, 255);
+  std::uniform_int_distribution<int> index_distribution(-10, 60);
+  const CellLimits limits(37, 50);
+  std::vector<uint8> cells(limits.num_x_cells * limits.num_y_cells +
+                           kScoringKernelCellPadding);
+  for (uint8& cell : cells) {
+    cell = value_distribution(prng);
+  }
+  // Odd sizes exercise the scalar tails of the vectorized kernels.
+  for (const int num_points : {0, 1, 7, 8, 9, 100, 1001}) {
+    DiscreteScan discrete_scan;
+    for (int i = 0; i != num_points; ++i) {
+      discrete_scan.emplace_back(index_distribution(prng),
+                                 index_distribution(prng));
+    }
+    const PackedDiscreteScan scan(discrete_scan);
+    ASSERT_EQ(num_points, scan.size());
+    for (const Eigen::Array2i& offset :
+         {Eigen::Array2i(0, 0), Eigen::Array2i(-5, 3), Eigen::Array2i(12, -8),
+          Eigen::Array2i(100, 100)}) {
+      int expected = 0;
+      for (const Eigen::Array2i& xy_index : discrete_scan) {
+        const Eigen::Array2i shifted = xy_index + offset;
+        if (shifted.x() >= 0 && shifted.x() < limits.num_x_cells &&
+            shifted.y() >= 0 && shifted.y() < limits.num_y_cells) {
+          expected += cells[shifted.x() + shifted.y() * limits.num_x_cells];
+        }
+      }
+      for (const ScoringKernel kernel :
+           {ScoringKernel::kScalar, ScoringKernel::kSse41,
+            ScoringKernel::kAvx2}) {
+        if (!IsScoringKernelSupported(kernel)) {
+          continue;
+        }
+        EXPECT_EQ(expected,
+                  SumCellValues(kernel, cells.data(), limits, scan, offset))
+            << ScoringKernelToString(kernel);
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace scan_matching
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -35,6 +35,7 @@
 #include "cartographer/mapping_2d/probability_grid.h"
 #include "cartographer/common/make_unique.h"
 #include "cartographer/common/math.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/mapping/sparse_pose_graph/proto/constraint_builder_options.pb.h"
 #include "cartographer/sensor/compressed_point_cloud.h"
 #include "cartographer/sensor/voxel_filter.h"
@@ -95,12 +96,26 @@ void WriteProbabilityGridToPgm(const ::cartographer::mapping_2d::ProbabilityGrid
 namespace cartographer {
 namespace mapping_2d {
 
+namespace {
+
+// Spatial index cells match the distance within which constraints are
+// searched for.
+double SpatialIndexCellSize(
+    const mapping::proto::SparsePoseGraphOptions& options) {
+  return std::max(1., options.constraint_builder_options()
+                          .max_constraint_distance());
+}
+
+}  // namespace
+
 SparsePoseGraph::SparsePoseGraph(
     const mapping::proto::SparsePoseGraphOptions& options,
     common::ThreadPool* thread_pool)
     : options_(options),
       optimization_problem_(options_.optimization_problem_options()),
-      constraint_builder_(options_.constraint_builder_options(), thread_pool) {}
+      constraint_builder_(options_.constraint_builder_options(), thread_pool),
+      submap_index_(SpatialIndexCellSize(options_)),
+      node_index_(SpatialIndexCellSize(options_)) {}
 
 SparsePoseGraph::~SparsePoseGraph() {
   WaitForAllComputations();
@@ -117,9 +132,11 @@ std::vector<mapping::SubmapId> SparsePoseGraph::GrowSubmapTransformsAsNeeded(
     // If we don't already have an entry for the first submap, add one.
     if (static_cast<size_t>(trajectory_id) >= submap_data.size() ||
         submap_data[trajectory_id].empty()) {
-      optimization_problem_.AddSubmap(
-          trajectory_id,
-          sparse_pose_graph::ComputeSubmapPose(*insertion_submaps[0]));
+      const transform::Rigid2d submap_pose =
+          sparse_pose_graph::ComputeSubmapPose(*insertion_submaps[0]);
+      optimization_problem_.AddSubmap(trajectory_id, submap_pose);
+      submap_index_.Insert(mapping::SubmapId{trajectory_id, 0},
+                           transform::Embed3D(submap_pose).translation());
     }
     CHECK_EQ(optimization_problem_.num_trimmed_submaps(trajectory_id), 0);
     CHECK_EQ(submap_data[trajectory_id].size(), 1);
@@ -140,14 +157,16 @@ std::vector<mapping::SubmapId> SparsePoseGraph::GrowSubmapTransformsAsNeeded(
         submap_data.at(trajectory_id)
             .at(last_submap_id.submap_index - num_trimmed_submaps)
             .pose;
-    optimization_problem_.AddSubmap(
-        trajectory_id,
+    const transform::Rigid2d submap_pose =
         first_submap_pose *
-            sparse_pose_graph::ComputeSubmapPose(*insertion_submaps[0])
-                .inverse() *
-            sparse_pose_graph::ComputeSubmapPose(*insertion_submaps[1]));
-    return {last_submap_id,
-            mapping::SubmapId{trajectory_id, last_submap_id.submap_index + 1}};
+        sparse_pose_graph::ComputeSubmapPose(*insertion_submaps[0]).inverse() *
+        sparse_pose_graph::ComputeSubmapPose(*insertion_submaps[1]);
+    optimization_problem_.AddSubmap(trajectory_id, submap_pose);
+    const mapping::SubmapId new_submap_id{trajectory_id,
+                                          last_submap_id.submap_index + 1};
+    submap_index_.Insert(new_submap_id,
+                         transform::Embed3D(submap_pose).translation());
+    return {last_submap_id, new_submap_id};
   }
   CHECK(submap_data_.at(last_submap_id).submap == insertion_submaps.back());
   const mapping::SubmapId front_submap_id{trajectory_id,
@@ -255,6 +274,27 @@ void SparsePoseGraph::AddImuData(const int trajectory_id, common::Time time,
   });
 }
 
+void SparsePoseGraph::AddGpsData(const int trajectory_id,
+                                 const common::Time time,
+                                 const Eigen::Vector2d& position,
+                                 const bool rtk_fixed) {
+  const auto& optimization_problem_options =
+      options_.optimization_problem_options();
+  if (!optimization_problem_options.use_gps_data()) {
+    return;
+  }
+  const double stddev =
+      rtk_fixed
+          ? optimization_problem_options.gps_rtk_fixed_translation_stddev()
+          : optimization_problem_options.gps_translation_stddev();
+  const sensor::GpsData gps_data{
+      time, position, Eigen::Matrix2d::Identity() * common::Pow2(stddev)};
+  common::MutexLocker locker(&mutex_);
+  AddWorkItem([=]() REQUIRES(mutex_) {
+    optimization_problem_.AddGpsData(trajectory_id, gps_data);
+  });
+}
+
 void SparsePoseGraph::ComputeConstraint(const mapping::NodeId& node_id,
                                         const mapping::SubmapId& submap_id) {
   CHECK(submap_data_.at(submap_id).state == SubmapState::kFinished);
@@ -299,8 +339,31 @@ void SparsePoseGraph::ComputeConstraintsForOldScans(
     const mapping::SubmapId& submap_id) {
   const auto& submap_data = submap_data_.at(submap_id);
   const auto& node_data = optimization_problem_.node_data();
+  // Nodes of other trajectories might be matched globally, so all of them are
+  // considered. Within the trajectory, only nearby nodes are.
+  const transform::Rigid2d& submap_pose =
+      optimization_problem_.submap_data()
+          .at(submap_id.trajectory_id)
+          .at(submap_id.submap_index -
+              optimization_problem_.num_trimmed_submaps(
+                  submap_id.trajectory_id))
+          .pose;
+  const std::vector<mapping::NodeId> nearby_node_ids =
+      node_index_.GetCandidates(
+          submap_id.trajectory_id,
+          transform::Embed3D(submap_pose).translation(),
+          options_.constraint_builder_options().max_constraint_distance());
   for (size_t trajectory_id = 0; trajectory_id != node_data.size();
        ++trajectory_id) {
+    if (static_cast<int>(trajectory_id) == submap_id.trajectory_id) {
+      for (const mapping::NodeId& node_id : nearby_node_ids) {
+        CHECK(!trajectory_nodes_.at(node_id).trimmed());
+        if (submap_data.node_ids.count(node_id) == 0) {
+          ComputeConstraint(node_id, submap_id);
+        }
+      }
+      continue;
+    }
     for (size_t node_data_index = 0;
          node_data_index != node_data[trajectory_id].size();
          ++node_data_index) {
@@ -356,6 +419,7 @@ void SparsePoseGraph::ComputeConstraintsForScan(
   const auto& scan_data = trajectory_nodes_.at(node_id).constant_data;
   optimization_problem_.AddTrajectoryNode(
       matching_id.trajectory_id, scan_data->time, pose, optimized_pose);
+  node_index_.Insert(node_id, transform::Embed3D(optimized_pose).translation());
   //mnf initial_point_cloud_pose := pose
   //            point_cloud_pose := optimized_pose
 
@@ -377,8 +441,24 @@ void SparsePoseGraph::ComputeConstraintsForScan(
                                       Constraint::INTRA_SUBMAP});
   }
 
+  // Submaps of other trajectories might be matched globally, so all of them
+  // are considered. Within the trajectory, only nearby submaps are.
+  const std::vector<mapping::SubmapId> nearby_submap_ids =
+      submap_index_.GetCandidates(
+          node_id.trajectory_id,
+          transform::Embed3D(optimized_pose).translation(),
+          options_.constraint_builder_options().max_constraint_distance());
   for (int trajectory_id = 0; trajectory_id < submap_data_.num_trajectories();
        ++trajectory_id) {
+    if (trajectory_id == node_id.trajectory_id) {
+      for (const mapping::SubmapId& submap_id : nearby_submap_ids) {
+        if (submap_data_.at(submap_id).state == SubmapState::kFinished) {
+          CHECK_EQ(submap_data_.at(submap_id).node_ids.count(node_id), 0);
+          ComputeConstraint(node_id, submap_id);
+        }
+      }
+      continue;
+    }
     for (int submap_index = 0;
          submap_index < submap_data_.num_indices(trajectory_id);
          ++submap_index) {
@@ -484,9 +564,13 @@ void SparsePoseGraph::AddSubmapFromProto(const int trajectory_id,
   if (!submap.has_submap_2d()) {
     return;
   }
+  AddSubmap(trajectory_id, initial_pose,
+            std::make_shared<const Submap>(submap.submap_2d()));
+}
 
-  std::shared_ptr<const Submap> submap_ptr =
-      std::make_shared<const Submap>(submap.submap_2d());
+void SparsePoseGraph::AddSubmap(const int trajectory_id,
+                                const transform::Rigid3d& initial_pose,
+                                std::shared_ptr<const Submap> submap_ptr) {
   const transform::Rigid2d initial_pose_2d = transform::Project2D(initial_pose);
 
   common::MutexLocker locker(&mutex_);
@@ -509,6 +593,8 @@ void SparsePoseGraph::AddSubmapFromProto(const int trajectory_id,
     CHECK_EQ(frozen_trajectories_.count(submap_id.trajectory_id), 1);
     submap_data_.at(submap_id).state = SubmapState::kFinished;
     optimization_problem_.AddSubmap(submap_id.trajectory_id, initial_pose_2d);
+    submap_index_.Insert(submap_id,
+                         transform::Embed3D(initial_pose_2d).translation());
   });
 }
 
@@ -525,17 +611,25 @@ void SparsePoseGraph::RunFinalOptimization() {
   WaitForAllComputations();
   optimization_problem_.SetMaxNumIterations(
       options_.max_num_final_iterations());
+  optimization_problem_.SetLocalWindowNumHops(0);
   RunOptimization();
   optimization_problem_.SetMaxNumIterations(
       options_.optimization_problem_options()
           .ceres_solver_options()
           .max_num_iterations());
+  optimization_problem_.SetLocalWindowNumHops(
+      options_.optimization_problem_options().local_window_num_hops());
 }
 
 void SparsePoseGraph::RunOptimization() {
+  static common::HistogramMetric* const optimization_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "sparse_pose_graph_2d_optimization_seconds",
+          "Time to solve the 2D optimization problem and update the poses.");
   if (optimization_problem_.submap_data().empty()) {
     return;
   }
+  common::ScopedLatency latency(optimization_metric);
   optimization_problem_.Solve(constraints_, frozen_trajectories_); //mnf here run the true optimization
   common::MutexLocker locker(&mutex_);
 
@@ -595,6 +689,37 @@ void SparsePoseGraph::RunOptimization() {
   for (auto& trimmer : trimmers_) {
     trimmer->Trim(&trimming_handle);
   }
+  RebuildSpatialIndices();
+  UpdateSnapshot();
+}
+
+void SparsePoseGraph::UpdateSnapshot() {
+  PublishSnapshot(trajectory_nodes_.data(), GetAllSubmapDataUnderLock(),
+                  constraints_);
+}
+
+void SparsePoseGraph::RebuildSpatialIndices() {
+  submap_index_.Clear();
+  const auto& submap_data = optimization_problem_.submap_data();
+  for (int trajectory_id = 0;
+       trajectory_id != static_cast<int>(submap_data.size()); ++trajectory_id) {
+    int submap_index = optimization_problem_.num_trimmed_submaps(trajectory_id);
+    for (const auto& submap : submap_data[trajectory_id]) {
+      submap_index_.Insert(mapping::SubmapId{trajectory_id, submap_index++},
+                           transform::Embed3D(submap.pose).translation());
+    }
+  }
+  node_index_.Clear();
+  const auto& node_data = optimization_problem_.node_data();
+  for (int trajectory_id = 0;
+       trajectory_id != static_cast<int>(node_data.size()); ++trajectory_id) {
+    int node_index = optimization_problem_.num_trimmed_nodes(trajectory_id);
+    for (const auto& node : node_data[trajectory_id]) {
+      node_index_.Insert(
+          mapping::NodeId{trajectory_id, node_index++},
+          transform::Embed3D(node.point_cloud_pose).translation());
+    }
+  }
 }
 
 std::vector<std::vector<mapping::TrajectoryNode>>
@@ -638,6 +763,11 @@ mapping::SparsePoseGraph::SubmapData SparsePoseGraph::GetSubmapData(
 std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
 SparsePoseGraph::GetAllSubmapData() {
   common::MutexLocker locker(&mutex_);
+  return GetAllSubmapDataUnderLock();
+}
+
+std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
+SparsePoseGraph::GetAllSubmapDataUnderLock() {
   std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
       all_submap_data(submap_data_.num_trajectories());
   for (int trajectory_id = 0; trajectory_id < submap_data_.num_trajectories();
@@ -33,6 +33,7 @@
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/pose_graph_trimmer.h"
 #include "cartographer/mapping/sparse_pose_graph.h"
+#include "cartographer/mapping/sparse_pose_graph/spatial_index.h"
 #include "cartographer/mapping/trajectory_connectivity.h"
 #include "cartographer/mapping_2d/sparse_pose_graph/constraint_builder.h"
 #include "cartographer/mapping_2d/sparse_pose_graph/optimization_problem.h"
@@ -81,10 +82,20 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
                   const Eigen::Vector3d& angular_velocity,
                   const Eigen::Quaterniond& orientiation);//mnf
 
+  // Adds a GPS fix of the position of the tracking frame to be used in the
+  // optimization. Fixes with an RTK fixed solution are trusted more.
+  void AddGpsData(int trajectory_id, common::Time time,
+                  const Eigen::Vector2d& position, bool rtk_fixed)
+      EXCLUDES(mutex_);
+
   void FreezeTrajectory(int trajectory_id) override;
   void AddSubmapFromProto(int trajectory_id,
                           const transform::Rigid3d& initial_pose,
                           const mapping::proto::Submap& submap) override;
+  // Like AddSubmapFromProto(), but for a 'submap' that was already constructed,
+  // e.g. in parallel with others.
+  void AddSubmap(int trajectory_id, const transform::Rigid3d& initial_pose,
+                 std::shared_ptr<const Submap> submap) EXCLUDES(mutex_);
   void AddTrimmer(std::unique_ptr<mapping::PoseGraphTrimmer> trimmer) override;
   void RunFinalOptimization() override;
   std::vector<std::vector<int>> GetConnectedTrajectories() override;
@@ -140,6 +151,15 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
   void ComputeConstraintsForOldScans(const mapping::SubmapId& submap_id)
       REQUIRES(mutex_);
 
+  // Rebuilds 'submap_index_' and 'node_index_' from the poses in the
+  // 'optimization_problem_'.
+  void RebuildSpatialIndices() REQUIRES(mutex_);
+
+  // Publishes the current trajectory nodes, submaps and constraints as a new
+  // snapshot for GetSnapshot(). This copies the whole graph, so it is only
+  // done after optimizations, not for each scan or submap.
+  void UpdateSnapshot() REQUIRES(mutex_);
+
   // Registers the callback to run the optimization once all constraints have
   // been computed, that will also do all work that queue up in 'scan_queue_'.
   void HandleScanQueue() REQUIRES(mutex_);
@@ -163,6 +183,9 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
   mapping::SparsePoseGraph::SubmapData GetSubmapDataUnderLock(
       const mapping::SubmapId& submap_id) REQUIRES(mutex_);
 
+  std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
+  GetAllSubmapDataUnderLock() REQUIRES(mutex_);
+
   const mapping::proto::SparsePoseGraphOptions options_;
   common::Mutex mutex_;
 
@@ -187,6 +210,14 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
   // Current optimization problem.
   sparse_pose_graph::OptimizationProblem optimization_problem_;
   sparse_pose_graph::ConstraintBuilder constraint_builder_ GUARDED_BY(mutex_);
+
+  // Positions of the submaps and nodes in the 'optimization_problem_'. Pairs
+  // within a trajectory are only matched if close enough, so candidates for
+  // these are found here instead of looking at all submaps or nodes.
+  mapping::sparse_pose_graph::SpatialIndex<mapping::SubmapId> submap_index_
+      GUARDED_BY(mutex_);
+  mapping::sparse_pose_graph::SpatialIndex<mapping::NodeId> node_index_
+      GUARDED_BY(mutex_);
   std::vector<Constraint> constraints_ GUARDED_BY(mutex_);
 
   // Submaps get assigned an ID and state as soon as they are seen, even
@@ -28,6 +28,7 @@
 #include "Eigen/Eigenvalues"
 #include "cartographer/common/make_unique.h"
 #include "cartographer/common/math.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/common/thread_pool.h"
 #include "cartographer/mapping_2d/scan_matching/proto/ceres_scan_matcher_options.pb.h"
 #include "cartographer/mapping_2d/scan_matching/proto/fast_correlative_scan_matcher_options.pb.h"
@@ -42,6 +43,23 @@ transform::Rigid2d ComputeSubmapPose(const Submap& submap) {
   return transform::Project2D(submap.local_pose());
 }
 
+std::shared_ptr<const scan_matching::PrecomputationGridStack>
+GetPrecomputationGridStack(
+    const Submap& submap,
+    const scan_matching::proto::FastCorrelativeScanMatcherOptions& options,
+    common::ThreadPool* const thread_pool) {
+  auto precomputation_grid_stack = submap.precomputation_grid_stack();
+  if (precomputation_grid_stack == nullptr ||
+      precomputation_grid_stack->max_depth() + 1 !=
+          options.branch_and_bound_depth()) {
+    precomputation_grid_stack =
+        std::make_shared<const scan_matching::PrecomputationGridStack>(
+            submap.probability_grid(), options, thread_pool);
+    submap.CachePrecomputationGridStack(precomputation_grid_stack);
+  }
+  return precomputation_grid_stack;
+}
+
 ConstraintBuilder::ConstraintBuilder(
     const mapping::sparse_pose_graph::proto::ConstraintBuilderOptions& options,
     common::ThreadPool* const thread_pool)
@@ -75,7 +93,7 @@ void ConstraintBuilder::MaybeAddConstraint(
     ++pending_computations_[current_computation_];
     const int current_computation = current_computation_;
     ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
-        submap_id, &submap->probability_grid(), [=]() EXCLUDES(mutex_) {
+        submap_id, submap, [=]() EXCLUDES(mutex_) {
           ComputeConstraint(
               submap_id, submap, node_id, false, /* match_full_submap */
               nullptr,                           /* trajectory_connectivity */
@@ -96,7 +114,7 @@ void ConstraintBuilder::MaybeAddGlobalConstraint(
   ++pending_computations_[current_computation_];
   const int current_computation = current_computation_;
   ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
-      submap_id, &submap->probability_grid(), [=]() EXCLUDES(mutex_) {
+      submap_id, submap, [=]() EXCLUDES(mutex_) {
         ComputeConstraint(submap_id, submap, node_id,
                           true, /* match_full_submap */
                           trajectory_connectivity, compressed_point_cloud,
@@ -119,11 +137,12 @@ void ConstraintBuilder::WhenDone(
   ++pending_computations_[current_computation_];
   const int current_computation = current_computation_;
   thread_pool_->Schedule(
-      [this, current_computation] { FinishComputation(current_computation); });
+      [this, current_computation] { FinishComputation(current_computation); },
+      common::ThreadPool::Priority::kHigh);
 }
 
 void ConstraintBuilder::ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
-    const mapping::SubmapId& submap_id, const ProbabilityGrid* const submap,
+    const mapping::SubmapId& submap_id, const Submap* const submap,
     const std::function<void()> work_item) {
   if (submap_scan_matchers_[submap_id].fast_correlative_scan_matcher !=
       nullptr) {
@@ -131,19 +150,31 @@ void ConstraintBuilder::ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
   } else {
     submap_queued_work_items_[submap_id].push_back(work_item);
     if (submap_queued_work_items_[submap_id].size() == 1) {
+      // Constructing the scan matcher unblocks all queued work items for this
+      // submap, so it must not wait behind other constraint searches.
       thread_pool_->Schedule(
-          [=]() { ConstructSubmapScanMatcher(submap_id, submap); });
+          [=]() { ConstructSubmapScanMatcher(submap_id, submap); },
+          common::ThreadPool::Priority::kHigh);
     }
   }
 }
 
 void ConstraintBuilder::ConstructSubmapScanMatcher(
-    const mapping::SubmapId& submap_id, const ProbabilityGrid* const submap) {
+    const mapping::SubmapId& submap_id, const Submap* const submap) {
+  const auto& fast_correlative_scan_matcher_options =
+      options_.fast_correlative_scan_matcher_options();
   auto submap_scan_matcher =
       common::make_unique<scan_matching::FastCorrelativeScanMatcher>(
-          *submap, options_.fast_correlative_scan_matcher_options());
+          GetPrecomputationGridStack(*submap,
+                                     fast_correlative_scan_matcher_options,
+                                     thread_pool_),
+          fast_correlative_scan_matcher_options);
+  auto interpolation_grid =
+      common::make_unique<const scan_matching::InterpolationGrid>(
+          submap->probability_grid());
   common::MutexLocker locker(&mutex_);
-  submap_scan_matchers_[submap_id] = {submap, std::move(submap_scan_matcher)};
+  submap_scan_matchers_[submap_id] = {std::move(interpolation_grid),
+                                      std::move(submap_scan_matcher)};
   for (const std::function<void()>& work_item :
        submap_queued_work_items_[submap_id]) {
     thread_pool_->Schedule(work_item);
@@ -167,6 +198,18 @@ void ConstraintBuilder::ComputeConstraint(
     const sensor::CompressedPointCloud* const compressed_point_cloud,
     const transform::Rigid2d& initial_relative_pose,
     std::unique_ptr<ConstraintBuilder::Constraint>* constraint) {
+  static common::HistogramMetric* const local_match_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "constraint_builder_2d_local_match_seconds",
+          "Time of the fast correlative scan matcher near the current pose.");
+  static common::HistogramMetric* const global_match_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "constraint_builder_2d_global_match_seconds",
+          "Time of the fast correlative scan matcher over full submaps.");
+  static common::Counter* const constraints_metric =
+      common::MetricsRegistry::Global()->GetCounter(
+          "constraint_builder_2d_constraints_found",
+          "Number of scan matches that were good enough for a constraint.");
   const transform::Rigid2d initial_pose =
       ComputeSubmapPose(*submap) * initial_relative_pose;
       // initial_pose := Submap(i).T2L * initial_relative_pose
@@ -190,6 +233,7 @@ void ConstraintBuilder::ComputeConstraint(
   // 2. Prune if the score is too low.
   // 3. Refine.
   if (match_full_submap) {
+    common::ScopedLatency latency(global_match_metric);
     if (submap_scan_matcher->fast_correlative_scan_matcher->MatchFullSubmap(
             filtered_point_cloud, options_.global_localization_min_score(),
             &score, &pose_estimate)) {
@@ -202,6 +246,7 @@ void ConstraintBuilder::ComputeConstraint(
       return;
     }
   } else {
+    common::ScopedLatency latency(local_match_metric);
     if (submap_scan_matcher->fast_correlative_scan_matcher->Match(
             initial_pose, filtered_point_cloud, options_.min_score(), &score,
             &pose_estimate)) {
@@ -211,6 +256,7 @@ void ConstraintBuilder::ComputeConstraint(
       return;
     }
   }
+  constraints_metric->Increment();
   {
     common::MutexLocker locker(&mutex_);
     score_histogram_.Add(score);
@@ -221,7 +267,7 @@ void ConstraintBuilder::ComputeConstraint(
   // CSM estimate.
   ceres::Solver::Summary unused_summary;
   ceres_scan_matcher_.Match(pose_estimate, pose_estimate, filtered_point_cloud,
-                            *submap_scan_matcher->probability_grid,
+                            *submap_scan_matcher->interpolation_grid,
                             &pose_estimate, &unused_summary);
 
   const transform::Rigid2d constraint_transform =
@@ -281,6 +327,7 @@ void ConstraintBuilder::FinishComputation(const int computation_index) {
           LOG(INFO) << constraints_.size() << " computations resulted in "
                     << result.size() << " additional constraints.";
           LOG(INFO) << "Score histogram:\n" << score_histogram_.ToString(10);
+          LOG(INFO) << "Thread pool:\n" << thread_pool_->StatisticsToString();
         }
         constraints_.clear();
         callback = std::move(when_done_);
@@ -21,6 +21,7 @@
 #include <deque>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <vector>
 
 #include "Eigen/Core"
@@ -35,6 +36,7 @@
 #include "cartographer/mapping/trajectory_connectivity.h"
 #include "cartographer/mapping_2d/scan_matching/ceres_scan_matcher.h"
 #include "cartographer/mapping_2d/scan_matching/fast_correlative_scan_matcher.h"
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
 #include "cartographer/mapping_2d/submaps.h"
 #include "cartographer/mapping_3d/scan_matching/ceres_scan_matcher.h"
 #include "cartographer/mapping_3d/scan_matching/fast_correlative_scan_matcher.h"
@@ -49,6 +51,16 @@ namespace sparse_pose_graph {
 // of the Submap.
 transform::Rigid2d ComputeSubmapPose(const Submap& submap);
 
+// Returns the precomputation grids for matching against the finished 'submap'
+// with 'options'. They are taken from the 'submap' if it has them cached,
+// otherwise they are computed, in parallel if a 'thread_pool' is given, and
+// cached.
+std::shared_ptr<const scan_matching::PrecomputationGridStack>
+GetPrecomputationGridStack(
+    const Submap& submap,
+    const scan_matching::proto::FastCorrelativeScanMatcherOptions& options,
+    common::ThreadPool* thread_pool);
+
 // Asynchronously computes constraints.
 //
 // Intermingle an arbitrary number of calls to MaybeAddConstraint() or
@@ -112,7 +124,7 @@ class ConstraintBuilder {
 
  private:
   struct SubmapScanMatcher {
-    const ProbabilityGrid* probability_grid;
+    std::unique_ptr<const scan_matching::InterpolationGrid> interpolation_grid;
     std::unique_ptr<scan_matching::FastCorrelativeScanMatcher>
         fast_correlative_scan_matcher;
   };
@@ -120,13 +132,14 @@ class ConstraintBuilder {
   // Either schedules the 'work_item', or if needed, schedules the scan matcher
   // construction and queues the 'work_item'.
   void ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
-      const mapping::SubmapId& submap_id, const ProbabilityGrid* submap,
+      const mapping::SubmapId& submap_id, const Submap* submap,
       std::function<void()> work_item) REQUIRES(mutex_);
 
   // Constructs the scan matcher for a 'submap', then schedules its work items.
+  // The precomputation grids are taken from the 'submap' if it has them
+  // cached, otherwise they are computed in parallel and cached.
   void ConstructSubmapScanMatcher(const mapping::SubmapId& submap_id,
-                                  const ProbabilityGrid* submap)
-      EXCLUDES(mutex_);
+                                  const Submap* submap) EXCLUDES(mutex_);
 
   // Returns the scan matcher for a submap, which has to exist.
   const SubmapScanMatcher* GetSubmapScanMatcher(
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_2D_SPARSE_POSE_GRAPH_GPS_COST_FUNCTION_H_
+#define CARTOGRAPHER_MAPPING_2D_SPARSE_POSE_GRAPH_GPS_COST_FUNCTION_H_
+
+#include "Eigen/Cholesky"
+#include "Eigen/Core"
+#include "ceres/ceres.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace sparse_pose_graph {
+
+// Computes the error between the position of a node and a GPS fix, weighted by
+// the inverse covariance of the fix. The fix is mapped from the GPS frame into
+// the global frame by the pose of the GPS frame, which is optimized as well.
+class GpsCostFunction {
+ public:
+  static ceres::CostFunction* Create(const Eigen::Vector2d& position,
+                                     const Eigen::Matrix2d& covariance) {
+    return new ceres::AutoDiffCostFunction<GpsCostFunction, 2, 3, 3>(
+        new GpsCostFunction(position, covariance));
+  }
+
+  // 'node_pose' and 'gps_frame_pose' are in the global frame and in the format
+  // used for Ceres, i.e. x, y and the rotation angle.
+  template <typename T>
+  bool operator()(const T* const node_pose, const T* const gps_frame_pose,
+                  T* const e) const {
+    const T cos_theta = cos(gps_frame_pose[2]);
+    const T sin_theta = sin(gps_frame_pose[2]);
+    const T delta_x = node_pose[0] - (gps_frame_pose[0] +
+                                      cos_theta * T(position_.x()) -
+                                      sin_theta * T(position_.y()));
+    const T delta_y = node_pose[1] - (gps_frame_pose[1] +
+                                      sin_theta * T(position_.x()) +
+                                      cos_theta * T(position_.y()));
+    e[0] = T(sqrt_information_(0, 0)) * delta_x +
+           T(sqrt_information_(0, 1)) * delta_y;
+    e[1] = T(sqrt_information_(1, 0)) * delta_x +
+           T(sqrt_information_(1, 1)) * delta_y;
+    return true;
+  }
+
+ private:
+  // The squared norm of the error is the Mahalanobis distance, since the
+  // information matrix is the product of the transposed square root and the
+  // square root.
+  GpsCostFunction(const Eigen::Vector2d& position,
+                  const Eigen::Matrix2d& covariance)
+      : position_(position),
+        sqrt_information_(
+            Eigen::Matrix2d(covariance.inverse()).llt().matrixU()) {}
+
+  const Eigen::Vector2d position_;
+  const Eigen::Matrix2d sqrt_information_;
+};
+
+}  // namespace sparse_pose_graph
+}  // namespace mapping_2d
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_2D_SPARSE_POSE_GRAPH_GPS_COST_FUNCTION_H_
@@ -18,7 +18,10 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
@@ -26,7 +29,9 @@
 
 #include "cartographer/common/ceres_solver_options.h"
 #include "cartographer/common/histogram.h"
+#include "cartographer/common/make_unique.h"
 #include "cartographer/common/math.h"
+#include "cartographer/mapping_2d/sparse_pose_graph/gps_cost_function.h"
 #include "cartographer/mapping_2d/sparse_pose_graph/spa_cost_function.h"
 #include "cartographer/transform/transform.h"
 #include "ceres/ceres.h"
@@ -51,12 +56,46 @@ transform::Rigid2d ToPose(const std::array<double, 3>& values) {
   return transform::Rigid2d({values[0], values[1]}, values[2]);
 }
 
+ceres::CostFunction* CreateSpaCostFunction(
+    const mapping::SparsePoseGraph::Constraint::Pose& pose,
+    const bool use_analytical_jacobians) {
+  if (use_analytical_jacobians) {
+    return new AnalyticalSpaCostFunction(pose);
+  }
+  return new ceres::AutoDiffCostFunction<SpaCostFunction, 3, 3, 3>(
+      new SpaCostFunction(pose));
+}
+
+// Linearly interpolates the GPS fixes 'start' and 'end' to 'time'.
+sensor::GpsData Interpolate(const sensor::GpsData& start,
+                            const sensor::GpsData& end,
+                            const common::Time time) {
+  const double factor = common::ToSeconds(time - start.time) /
+                        common::ToSeconds(end.time - start.time);
+  return sensor::GpsData{
+      time, start.position + factor * (end.position - start.position),
+      start.covariance + factor * (end.covariance - start.covariance)};
+}
+
+void SetParameterBlockConstant(const bool constant, double* const values,
+                               ceres::Problem* const problem) {
+  if (constant) {
+    problem->SetParameterBlockConstant(values);
+  } else {
+    problem->SetParameterBlockVariable(values);
+  }
+}
+
 }  // namespace
 
 OptimizationProblem::OptimizationProblem(
     const mapping::sparse_pose_graph::proto::OptimizationProblemOptions&
         options)
-    : options_(options) {}
+    : options_(options),
+      huber_loss_(
+          common::make_unique<ceres::HuberLoss>(options.huber_scale())),
+      gps_huber_loss_(
+          common::make_unique<ceres::HuberLoss>(options.gps_huber_scale())) {}
 
 OptimizationProblem::~OptimizationProblem() {}
 
@@ -72,6 +111,27 @@ void OptimizationProblem::AddImuData(const int trajectory_id,
       sensor::ImuData{time, linear_acceleration, angular_velocity, orientiation}); //mnf
 }
 
+void OptimizationProblem::AddGpsData(const int trajectory_id,
+                                     const sensor::GpsData& gps_data) {
+  CHECK_GE(trajectory_id, 0);
+  if (!options_.use_gps_data()) {
+    return;
+  }
+  gps_data_.resize(
+      std::max(gps_data_.size(), static_cast<size_t>(trajectory_id) + 1));
+  auto& trajectory_gps_data = gps_data_[trajectory_id];
+  if (!trajectory_gps_data.empty() &&
+      gps_data.time <= trajectory_gps_data.back().time) {
+    // GPS drivers may repeat the last fix, which adds no information.
+    LOG_EVERY_N(WARNING, 100)
+        << "Dropped GPS data at " << gps_data.time
+        << ", which is not after the previous GPS data at "
+        << trajectory_gps_data.back().time << ".";
+    return;
+  }
+  trajectory_gps_data.push_back(gps_data);
+}
+
 void OptimizationProblem::AddTrajectoryNode(
     const int trajectory_id, const common::Time time,
     const transform::Rigid2d& initial_point_cloud_pose,
@@ -97,8 +157,30 @@ void OptimizationProblem::TrimTrajectoryNode(const mapping::NodeId& node_id) {
       imu_data.pop_front();
     }
   }
+  if (node_id.trajectory_id < static_cast<int>(gps_data_.size())) {
+    const common::Time node_time = node_data.front().time;
+    auto& gps_data = gps_data_.at(node_id.trajectory_id);
+    while (gps_data.size() > 1 && gps_data[1].time <= node_time) {
+      gps_data.pop_front();
+    }
+  }
   node_data.pop_front();
   ++trajectory_data.num_trimmed_nodes;
+
+  if (node_id.trajectory_id < static_cast<int>(C_nodes_.size()) &&
+      !C_nodes_[node_id.trajectory_id].empty()) {
+    // Removing the parameter block also removes all residuals depending on it.
+    auto& C_nodes = C_nodes_[node_id.trajectory_id];
+    problem_->RemoveParameterBlock(C_nodes.front().data());
+    C_nodes.pop_front();
+    for (auto it = constraints_in_problem_.lower_bound(ConstraintKey{
+             node_id, mapping::SubmapId{std::numeric_limits<int>::min(), 0}});
+         it != constraints_in_problem_.end() &&
+         it->first.trajectory_id == node_id.trajectory_id &&
+         it->first.node_index == node_id.node_index;) {
+      it = constraints_in_problem_.erase(it);
+    }
+  }
 }
 
 void OptimizationProblem::AddSubmap(const int trajectory_id,
@@ -119,6 +201,21 @@ void OptimizationProblem::TrimSubmap(const mapping::SubmapId& submap_id) {
   CHECK(!submap_data.empty());
   submap_data.pop_front();
   ++trajectory_data.num_trimmed_submaps;
+
+  if (submap_id.trajectory_id < static_cast<int>(C_submaps_.size()) &&
+      !C_submaps_[submap_id.trajectory_id].empty()) {
+    auto& C_submaps = C_submaps_[submap_id.trajectory_id];
+    problem_->RemoveParameterBlock(C_submaps.front().data());
+    C_submaps.pop_front();
+    for (auto it = constraints_in_problem_.begin();
+         it != constraints_in_problem_.end();) {
+      if (it->second == submap_id) {
+        it = constraints_in_problem_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
 }
 
 void OptimizationProblem::SetMaxNumIterations(const int32 max_num_iterations) {
@@ -126,6 +223,10 @@ void OptimizationProblem::SetMaxNumIterations(const int32 max_num_iterations) {
       max_num_iterations);
 }
 
+void OptimizationProblem::SetLocalWindowNumHops(const int32 num_hops) {
+  options_.set_local_window_num_hops(num_hops);
+}
+
 void OptimizationProblem::Solve(const std::vector<Constraint>& constraints,
                                 const std::set<int>& frozen_trajectories) {
   if (node_data_.empty()) {
@@ -133,96 +234,180 @@ void OptimizationProblem::Solve(const std::vector<Constraint>& constraints,
     return;
   }
 
-  ceres::Problem::Options problem_options;
-  ceres::Problem problem(problem_options);
+  const auto start_time = std::chrono::steady_clock::now();
+  if (!options_.incremental() || problem_ == nullptr) {
+    ResetProblem();
+  }
+  const int num_residual_blocks_before = problem_->NumResidualBlocks();
 
-  // Set the starting point.
-  // TODO(hrapp): Move ceres data into SubmapData.
-  std::vector<std::vector<std::array<double, 3>>> C_submaps(
-      submap_data_.size());
-  std::vector<std::vector<std::array<double, 3>>> C_nodes(node_data_.size());
-  bool first_submap = true;
+  // Poses touched by anything added in this call. If the optimization is
+  // restricted to a local window, it is grown from these.
+  LocalWindow window;
+
+  // Add the submaps and nodes which are not yet part of the problem, starting
+  // at their current poses. Everything else keeps the previous solution.
+  C_submaps_.resize(submap_data_.size());
   for (size_t trajectory_id = 0; trajectory_id != submap_data_.size();
        ++trajectory_id) {
-    const bool frozen = frozen_trajectories.count(trajectory_id);
-    // Reserve guarantees that data does not move, so the pointers for Ceres
-    // stay valid.
-    C_submaps[trajectory_id].reserve(submap_data_[trajectory_id].size());
-    for (const SubmapData& submap_data : submap_data_[trajectory_id]) {
-      C_submaps[trajectory_id].push_back(FromPose(submap_data.pose));
-      problem.AddParameterBlock(C_submaps[trajectory_id].back().data(), 3);
-      if (first_submap || frozen) {
-        first_submap = false;
-        // Fix the pose of the first submap or all submaps of a frozen
-        // trajectory.
-        problem.SetParameterBlockConstant(
-            C_submaps[trajectory_id].back().data());
-      }
+    auto& C_submaps = C_submaps_[trajectory_id];
+    const int num_trimmed_submaps =
+        trajectory_data_.at(trajectory_id).num_trimmed_submaps;
+    for (size_t submap_data_index = C_submaps.size();
+         submap_data_index != submap_data_[trajectory_id].size();
+         ++submap_data_index) {
+      C_submaps.push_back(
+          FromPose(submap_data_[trajectory_id][submap_data_index].pose));
+      problem_->AddParameterBlock(C_submaps.back().data(), 3);
+      window.submap_ids.insert(mapping::SubmapId{
+          static_cast<int>(trajectory_id),
+          num_trimmed_submaps + static_cast<int>(submap_data_index)});
     }
   }
+  C_nodes_.resize(node_data_.size());
   for (size_t trajectory_id = 0; trajectory_id != node_data_.size();
        ++trajectory_id) {
-    // Reserve guarantees that data does not move, so the pointers for Ceres
-    // stay valid.
-    C_nodes[trajectory_id].reserve(node_data_[trajectory_id].size());
-    for (const NodeData& node_data : node_data_[trajectory_id]) {
-      C_nodes[trajectory_id].push_back(FromPose(node_data.point_cloud_pose));
-      problem.AddParameterBlock(C_nodes[trajectory_id].back().data(), 3);
+    auto& C_nodes = C_nodes_[trajectory_id];
+    const auto& node_data = node_data_[trajectory_id];
+    const int num_trimmed_nodes =
+        trajectory_data_.at(trajectory_id).num_trimmed_nodes;
+    for (size_t node_data_index = C_nodes.size();
+         node_data_index != node_data.size(); ++node_data_index) {
+      C_nodes.push_back(FromPose(node_data[node_data_index].point_cloud_pose));
+      problem_->AddParameterBlock(C_nodes.back().data(), 3);
+      window.node_ids.insert(mapping::NodeId{
+          static_cast<int>(trajectory_id),
+          num_trimmed_nodes + static_cast<int>(node_data_index)});
+      if (node_data_index == 0) {
+        continue;
+      }
+      // Add a penalty for changes between this and the previous scan.
+      problem_->AddResidualBlock(
+          CreateSpaCostFunction(
+              Constraint::Pose{
+                  transform::Embed3D(
+                      node_data[node_data_index - 1]
+                          .initial_point_cloud_pose.inverse() *
+                      node_data[node_data_index].initial_point_cloud_pose),
+                  options_.consecutive_scan_translation_penalty_factor(),
+                  options_.consecutive_scan_rotation_penalty_factor()},
+              options_.use_analytical_jacobians()),
+          nullptr /* loss function */,
+          C_nodes[node_data_index - 1].data(), C_nodes[node_data_index].data());
     }
   }
 
-  // Add cost functions for intra- and inter-submap constraints.
+  // Add cost functions for new intra- and inter-submap constraints.
   for (const Constraint& constraint : constraints) {
-    problem.AddResidualBlock(
-        new ceres::AutoDiffCostFunction<SpaCostFunction, 3, 3, 3>(
-            new SpaCostFunction(constraint.pose)),
+    if (!constraints_in_problem_
+             .emplace(constraint.node_id, constraint.submap_id)
+             .second) {
+      continue;
+    }
+    problem_->AddResidualBlock(
+        CreateSpaCostFunction(constraint.pose,
+                              options_.use_analytical_jacobians()),
         // Only loop closure constraints should have a loss function.
-        constraint.tag == Constraint::INTER_SUBMAP
-            ? new ceres::HuberLoss(options_.huber_scale())
-            : nullptr,
-        C_submaps.at(constraint.submap_id.trajectory_id)
+        constraint.tag == Constraint::INTER_SUBMAP ? huber_loss_.get()
+                                                   : nullptr,
+        C_submaps_.at(constraint.submap_id.trajectory_id)
             .at(constraint.submap_id.submap_index -
                 trajectory_data_.at(constraint.submap_id.trajectory_id)
                     .num_trimmed_submaps)
             .data(),
-        C_nodes.at(constraint.node_id.trajectory_id)
+        C_nodes_.at(constraint.node_id.trajectory_id)
             .at(constraint.node_id.node_index -
                 trajectory_data_.at(constraint.node_id.trajectory_id)
                     .num_trimmed_nodes)
             .data());
+    window.node_ids.insert(constraint.node_id);
+    window.submap_ids.insert(constraint.submap_id);
   }
+  AddGpsResiduals(&window);
+  const int num_new_residual_blocks =
+      problem_->NumResidualBlocks() - num_residual_blocks_before;
 
-  // Add penalties for changes between consecutive scans.
-  for (size_t trajectory_id = 0; trajectory_id != node_data_.size();
+  // Fix the pose of the first submap, all submaps of frozen trajectories and,
+  // if the optimization is restricted to a local window, all poses outside of
+  // it. The constant blocks may differ between calls.
+  const bool use_local_window =
+      options_.incremental() && options_.local_window_num_hops() > 0;
+  if (use_local_window) {
+    window = ExpandLocalWindow(constraints, std::move(window),
+                               options_.local_window_num_hops());
+  }
+  int num_poses = 0;
+  int num_variable_poses = 0;
+  bool first_submap = true;
+  for (size_t trajectory_id = 0; trajectory_id != C_submaps_.size();
        ++trajectory_id) {
-    for (size_t node_data_index = 1;
-         node_data_index < node_data_[trajectory_id].size();
+    const bool frozen = frozen_trajectories.count(trajectory_id);
+    const int num_trimmed_submaps =
+        trajectory_data_.at(trajectory_id).num_trimmed_submaps;
+    for (size_t submap_data_index = 0;
+         submap_data_index != C_submaps_[trajectory_id].size();
+         ++submap_data_index) {
+      const bool constant =
+          first_submap || frozen ||
+          (use_local_window &&
+           window.submap_ids.count(mapping::SubmapId{
+               static_cast<int>(trajectory_id),
+               num_trimmed_submaps + static_cast<int>(submap_data_index)}) ==
+               0);
+      first_submap = false;
+      SetParameterBlockConstant(
+          constant, C_submaps_[trajectory_id][submap_data_index].data(),
+          problem_.get());
+      ++num_poses;
+      num_variable_poses += constant ? 0 : 1;
+    }
+  }
+  for (size_t trajectory_id = 0; trajectory_id != C_nodes_.size();
+       ++trajectory_id) {
+    const int num_trimmed_nodes =
+        trajectory_data_.at(trajectory_id).num_trimmed_nodes;
+    for (size_t node_data_index = 0;
+         node_data_index != C_nodes_[trajectory_id].size();
          ++node_data_index) {
-      problem.AddResidualBlock(
-          new ceres::AutoDiffCostFunction<SpaCostFunction, 3, 3, 3>(
-              new SpaCostFunction(Constraint::Pose{
-                  transform::Embed3D(
-                      node_data_[trajectory_id][node_data_index - 1]
-                          .initial_point_cloud_pose.inverse() *
-                      node_data_[trajectory_id][node_data_index]
-                          .initial_point_cloud_pose),
-                  options_.consecutive_scan_translation_penalty_factor(),
-                  options_.consecutive_scan_rotation_penalty_factor()})),
-          nullptr /* loss function */,
-          C_nodes[trajectory_id][node_data_index - 1].data(),
-          C_nodes[trajectory_id][node_data_index].data());
+      const bool constant =
+          use_local_window &&
+          window.node_ids.count(mapping::NodeId{
+              static_cast<int>(trajectory_id),
+              num_trimmed_nodes + static_cast<int>(node_data_index)}) == 0;
+      SetParameterBlockConstant(
+          constant, C_nodes_[trajectory_id][node_data_index].data(),
+          problem_.get());
+      ++num_poses;
+      num_variable_poses += constant ? 0 : 1;
+    }
+  }
+  for (auto& entry : C_gps_frames_) {
+    if (gps_frames_in_problem_.count(entry.first)) {
+      SetParameterBlockConstant(frozen_trajectories.count(entry.first),
+                                entry.second.data(), problem_.get());
     }
   }
+  const auto solve_start_time = std::chrono::steady_clock::now();
 
   // Solve.
-  ceres::Solver::Summary summary;
-  ceres::Solve(
-      common::CreateCeresSolverOptions(options_.ceres_solver_options()),
-      &problem, &summary);
+  if (num_variable_poses > 0) {
+    ceres::Solver::Summary summary;
+    ceres::Solve(
+        common::CreateCeresSolverOptions(options_.ceres_solver_options()),
+        problem_.get(), &summary);
 
-  if (options_.log_solver_summary()) {
-    LOG(INFO) << summary.FullReport();
+    if (options_.log_solver_summary()) {
+      LOG(INFO) << summary.FullReport();
+    }
   }
+  const auto end_time = std::chrono::steady_clock::now();
+  LOG(INFO) << "Optimized " << num_variable_poses << " of " << num_poses
+            << " poses with " << problem_->NumResidualBlocks()
+            << " residual blocks (" << num_new_residual_blocks << " new) in "
+            << std::chrono::duration<double>(end_time - start_time).count()
+            << " s, "
+            << std::chrono::duration<double>(solve_start_time - start_time)
+                   .count()
+            << " s of which setting up the problem.";
 
   // Store the result.
   for (size_t trajectory_id = 0; trajectory_id != submap_data_.size();
@@ -231,7 +416,7 @@ void OptimizationProblem::Solve(const std::vector<Constraint>& constraints,
          submap_data_index != submap_data_[trajectory_id].size();
          ++submap_data_index) {
       submap_data_[trajectory_id][submap_data_index].pose =
-          ToPose(C_submaps[trajectory_id][submap_data_index]);
+          ToPose(C_submaps_[trajectory_id][submap_data_index]);
     }
   }
   for (size_t trajectory_id = 0; trajectory_id != node_data_.size();
@@ -240,9 +425,147 @@ void OptimizationProblem::Solve(const std::vector<Constraint>& constraints,
          node_data_index != node_data_[trajectory_id].size();
          ++node_data_index) {
       node_data_[trajectory_id][node_data_index].point_cloud_pose =
-          ToPose(C_nodes[trajectory_id][node_data_index]);
+          ToPose(C_nodes_[trajectory_id][node_data_index]);
+    }
+  }
+}
+
+void OptimizationProblem::ResetProblem() {
+  ceres::Problem::Options problem_options;
+  // Parameter blocks are removed whenever nodes or submaps are trimmed.
+  problem_options.enable_fast_removal = true;
+  problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  problem_ = common::make_unique<ceres::Problem>(problem_options);
+  C_submaps_.clear();
+  C_nodes_.clear();
+  constraints_in_problem_.clear();
+  gps_frames_in_problem_.clear();
+  for (TrajectoryData& trajectory_data : trajectory_data_) {
+    trajectory_data.next_gps_node_index = 0;
+  }
+}
+
+void OptimizationProblem::AddGpsResiduals(LocalWindow* const window) {
+  for (size_t trajectory_id = 0;
+       trajectory_id < std::min(gps_data_.size(), C_nodes_.size());
+       ++trajectory_id) {
+    const auto& gps_data = gps_data_[trajectory_id];
+    if (gps_data.empty()) {
+      continue;
+    }
+    const auto& node_data = node_data_[trajectory_id];
+    auto& C_nodes = C_nodes_[trajectory_id];
+    TrajectoryData& trajectory_data = trajectory_data_.at(trajectory_id);
+    trajectory_data.next_gps_node_index =
+        std::max(trajectory_data.next_gps_node_index,
+                 trajectory_data.num_trimmed_nodes);
+    for (; trajectory_data.next_gps_node_index -
+               trajectory_data.num_trimmed_nodes <
+           static_cast<int>(C_nodes.size());
+         ++trajectory_data.next_gps_node_index) {
+      const int node_data_index = trajectory_data.next_gps_node_index -
+                                  trajectory_data.num_trimmed_nodes;
+      const common::Time node_time = node_data[node_data_index].time;
+      if (node_time > gps_data.back().time) {
+        // Wait for GPS data after this node.
+        break;
+      }
+      const auto end = std::lower_bound(
+          gps_data.begin(), gps_data.end(), node_time,
+          [](const sensor::GpsData& gps_data, const common::Time time) {
+            return gps_data.time < time;
+          });
+      sensor::GpsData interpolated_gps_data = *end;
+      if (end->time != node_time) {
+        if (end == gps_data.begin() ||
+            common::ToSeconds(end->time - std::prev(end)->time) >
+                options_.gps_max_interpolation_gap()) {
+          continue;
+        }
+        interpolated_gps_data = Interpolate(*std::prev(end), *end, node_time);
+      }
+
+      double* const C_node = C_nodes[node_data_index].data();
+      if (gps_frames_in_problem_.insert(trajectory_id).second) {
+        // The GPS frame of a new trajectory starts out aligned to the global
+        // frame, with its origin placed such that it agrees with this node.
+        auto insertion_result = C_gps_frames_.emplace(
+            trajectory_id,
+            std::array<double, 3>{
+                {C_node[0] - interpolated_gps_data.position.x(),
+                 C_node[1] - interpolated_gps_data.position.y(), 0.}});
+        problem_->AddParameterBlock(insertion_result.first->second.data(), 3);
+      }
+      problem_->AddResidualBlock(
+          GpsCostFunction::Create(interpolated_gps_data.position,
+                                  interpolated_gps_data.covariance),
+          gps_huber_loss_.get(), C_node,
+          C_gps_frames_.at(trajectory_id).data());
+      window->node_ids.insert(
+          mapping::NodeId{static_cast<int>(trajectory_id),
+                          trajectory_data.next_gps_node_index});
+    }
+  }
+}
+
+OptimizationProblem::LocalWindow OptimizationProblem::ExpandLocalWindow(
+    const std::vector<Constraint>& constraints, LocalWindow window,
+    const int num_hops) const {
+  std::map<mapping::NodeId, std::vector<mapping::SubmapId>> submaps_by_node;
+  std::map<mapping::SubmapId, std::vector<mapping::NodeId>> nodes_by_submap;
+  for (const Constraint& constraint : constraints) {
+    submaps_by_node[constraint.node_id].push_back(constraint.submap_id);
+    nodes_by_submap[constraint.submap_id].push_back(constraint.node_id);
+  }
+
+  std::vector<mapping::NodeId> node_frontier(window.node_ids.begin(),
+                                             window.node_ids.end());
+  std::vector<mapping::SubmapId> submap_frontier(window.submap_ids.begin(),
+                                                 window.submap_ids.end());
+  for (int hop = 0; hop != num_hops; ++hop) {
+    std::vector<mapping::NodeId> next_node_frontier;
+    std::vector<mapping::SubmapId> next_submap_frontier;
+    const auto visit_node = [this, &window,
+                             &next_node_frontier](const mapping::NodeId& id) {
+      const int num_trimmed_nodes =
+          trajectory_data_.at(id.trajectory_id).num_trimmed_nodes;
+      if (id.node_index >= num_trimmed_nodes &&
+          id.node_index <
+              num_trimmed_nodes +
+                  static_cast<int>(node_data_.at(id.trajectory_id).size()) &&
+          window.node_ids.insert(id).second) {
+        next_node_frontier.push_back(id);
+      }
+    };
+    for (const mapping::NodeId& node_id : node_frontier) {
+      // Consecutive nodes are connected by the scan-to-scan penalties.
+      visit_node(
+          mapping::NodeId{node_id.trajectory_id, node_id.node_index - 1});
+      visit_node(
+          mapping::NodeId{node_id.trajectory_id, node_id.node_index + 1});
+      const auto it = submaps_by_node.find(node_id);
+      if (it == submaps_by_node.end()) {
+        continue;
+      }
+      for (const mapping::SubmapId& submap_id : it->second) {
+        if (window.submap_ids.insert(submap_id).second) {
+          next_submap_frontier.push_back(submap_id);
+        }
+      }
+    }
+    for (const mapping::SubmapId& submap_id : submap_frontier) {
+      const auto it = nodes_by_submap.find(submap_id);
+      if (it == nodes_by_submap.end()) {
+        continue;
+      }
+      for (const mapping::NodeId& node_id : it->second) {
+        visit_node(node_id);
+      }
     }
+    node_frontier = std::move(next_node_frontier);
+    submap_frontier = std::move(next_submap_frontier);
   }
+  return window;
 }
 
 const std::vector<std::deque<NodeData>>& OptimizationProblem::node_data()
@@ -20,6 +20,9 @@
 #include <array>
 #include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <utility>
 #include <vector>
 
 #include "Eigen/Core"
@@ -28,7 +31,9 @@
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/sparse_pose_graph.h"
 #include "cartographer/mapping/sparse_pose_graph/proto/optimization_problem_options.pb.h"
+#include "cartographer/sensor/gps_data.h"
 #include "cartographer/sensor/imu_data.h"
+#include "ceres/ceres.h"
 
 namespace cartographer {
 namespace mapping_2d {
@@ -45,6 +50,11 @@ struct SubmapData {
 };
 
 // Implements the SPA loop closure method.
+//
+// If 'incremental' is set in the options, the Ceres problem is kept between
+// calls to Solve(). Only parameter blocks and residuals for nodes, submaps and
+// constraints added since the last call are added to it, and poses already in
+// the problem start from the previous solution.
 class OptimizationProblem {
  public:
   using Constraint = mapping::SparsePoseGraph::Constraint;
@@ -61,6 +71,10 @@ class OptimizationProblem {
                   const Eigen::Vector3d& linear_acceleration,
                   const Eigen::Vector3d& angular_velocity,
                   const Eigen::Quaterniond& orientiation);
+  // GPS data of a trajectory should be added in time order, data which is not
+  // after the previous data is dropped. It is ignored unless 'use_gps_data' is
+  // set in the options.
+  void AddGpsData(int trajectory_id, const sensor::GpsData& gps_data);
   void AddTrajectoryNode(int trajectory_id, common::Time time,
                          const transform::Rigid2d& initial_point_cloud_pose,
                          const transform::Rigid2d& point_cloud_pose);
@@ -70,7 +84,14 @@ class OptimizationProblem {
 
   void SetMaxNumIterations(int32 max_num_iterations);
 
+  // Restricts incremental optimizations to poses within 'num_hops' constraints
+  // of new nodes and constraints. 0 optimizes all poses.
+  void SetLocalWindowNumHops(int32 num_hops);
+
   // Computes the optimized poses.
+  //
+  // Constraints are identified by their node and submap. Once passed in, a
+  // constraint must stay in 'constraints' until its node or submap is trimmed.
   void Solve(const std::vector<Constraint>& constraints,
              const std::set<int>& frozen_trajectories);
 
@@ -85,12 +106,57 @@ class OptimizationProblem {
     // TODO(hrapp): Remove, once we can relabel constraints.
     int num_trimmed_nodes = 0;
     int num_trimmed_submaps = 0;
+    // Index of the first node which was not yet constrained to the GPS data,
+    // or found to have no GPS data close enough in time.
+    int next_gps_node_index = 0;
+  };
+
+  // Poses which are optimized when restricting the optimization to a local
+  // window.
+  struct LocalWindow {
+    std::set<mapping::NodeId> node_ids;
+    std::set<mapping::SubmapId> submap_ids;
   };
+
+  using ConstraintKey = std::pair<mapping::NodeId, mapping::SubmapId>;
+
+  // Replaces the Ceres problem by an empty one.
+  void ResetProblem();
+
+  // Returns the poses reachable from 'window' by following at most 'num_hops'
+  // constraints or consecutive nodes.
+  LocalWindow ExpandLocalWindow(const std::vector<Constraint>& constraints,
+                                LocalWindow window, int num_hops) const;
+
+  // Adds residuals for the nodes in 'problem_' which the GPS data now covers,
+  // and adds these nodes to 'window'.
+  void AddGpsResiduals(LocalWindow* window);
+
   mapping::sparse_pose_graph::proto::OptimizationProblemOptions options_;
   std::vector<std::deque<sensor::ImuData>> imu_data_;
+  std::vector<std::deque<sensor::GpsData>> gps_data_;
   std::vector<std::deque<NodeData>> node_data_;
   std::vector<std::deque<SubmapData>> submap_data_;
   std::vector<TrajectoryData> trajectory_data_;
+
+  // Loss function shared by all loop closure residuals.
+  std::unique_ptr<ceres::LossFunction> huber_loss_;
+  std::unique_ptr<ceres::LossFunction> gps_huber_loss_;
+  std::unique_ptr<ceres::Problem> problem_;
+  // Parameter blocks of 'problem_', indexed like 'submap_data_' and
+  // 'node_data_'. They hold a prefix of the submaps and nodes, the remaining
+  // ones are added by the next call to Solve(). Deques do not move their
+  // elements when adding or removing at either end, so the pointers held by
+  // Ceres stay valid.
+  std::deque<std::deque<std::array<double, 3>>> C_submaps_;
+  std::deque<std::deque<std::array<double, 3>>> C_nodes_;
+  // Constraints with residuals in 'problem_'.
+  std::set<ConstraintKey> constraints_in_problem_;
+  // Poses of the GPS frames in the global frame by trajectory ID. They are
+  // kept when the problem is reset, so that they start from the previous
+  // solution.
+  std::map<int, std::array<double, 3>> C_gps_frames_;
+  std::set<int> gps_frames_in_problem_;
 };
 
 }  // namespace sparse_pose_graph
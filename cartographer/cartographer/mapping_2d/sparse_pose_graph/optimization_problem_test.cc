@@ -0,0 +1,390 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/sparse_pose_graph/optimization_problem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "cartographer/common/lua_parameter_dictionary_test_helpers.h"
+#include "cartographer/common/time.h"
+#include "cartographer/mapping/sparse_pose_graph/optimization_problem_options.h"
+#include "cartographer/sensor/gps_data.h"
+#include "cartographer/transform/transform.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace sparse_pose_graph {
+namespace {
+
+using Constraint = OptimizationProblem::Constraint;
+
+constexpr int kNumNodesPerSubmap = 10;
+
+mapping::sparse_pose_graph::proto::OptimizationProblemOptions CreateOptions(
+    const bool incremental, const int local_window_num_hops) {
+  auto parameter_dictionary = common::MakeDictionary(R"text(
+      return {
+        huber_scale = 1.,
+        acceleration_weight = 1.,
+        rotation_weight = 1.,
+        consecutive_scan_translation_penalty_factor = 1.,
+        consecutive_scan_rotation_penalty_factor = 1.,
+        log_solver_summary = false,
+        incremental = false,
+        local_window_num_hops = 0,
+        use_analytical_jacobians = false,
+        use_gps_data = false,
+        gps_translation_stddev = 3.,
+        gps_rtk_fixed_translation_stddev = 0.05,
+        gps_huber_scale = 1.,
+        gps_max_interpolation_gap = 1.,
+        ceres_solver_options = {
+          use_nonmonotonic_steps = false,
+          max_num_iterations = 200,
+          num_threads = 1,
+        },
+      })text");
+  auto options = mapping::sparse_pose_graph::CreateOptimizationProblemOptions(
+      parameter_dictionary.get());
+  options.set_incremental(incremental);
+  options.set_local_window_num_hops(local_window_num_hops);
+  return options;
+}
+
+// Builds a trajectory along a circle with submaps every 'kNumNodesPerSubmap'
+// nodes. Each node is constrained to its submap and to a loop closure submap.
+class OptimizationProblemTest : public ::testing::Test {
+ protected:
+  OptimizationProblemTest() : rng_(42) {}
+
+  transform::Rigid2d GroundTruthPose(const int index) {
+    const double angle = 0.1 * index;
+    return transform::Rigid2d({10. * std::cos(angle), 10. * std::sin(angle)},
+                              angle + M_PI / 2.);
+  }
+
+  transform::Rigid2d Noise(const double translation_size,
+                           const double rotation_size) {
+    std::uniform_real_distribution<double> translation_distribution(
+        -translation_size, translation_size);
+    std::uniform_real_distribution<double> rotation_distribution(
+        -rotation_size, rotation_size);
+    const double x = translation_distribution(rng_);
+    const double y = translation_distribution(rng_);
+    return transform::Rigid2d({x, y}, rotation_distribution(rng_));
+  }
+
+  // Adds nodes up to 'num_nodes' to all 'problems', together with their
+  // submaps and constraints.
+  void AddNodes(const int num_nodes,
+                const std::vector<OptimizationProblem*>& problems) {
+    for (; num_nodes_ != num_nodes; ++num_nodes_) {
+      const int submap_index = num_nodes_ / kNumNodesPerSubmap;
+      const transform::Rigid2d submap_pose =
+          GroundTruthPose(submap_index * kNumNodesPerSubmap);
+      const transform::Rigid2d node_pose = GroundTruthPose(num_nodes_);
+      const transform::Rigid2d noisy_node_pose = node_pose * Noise(0.3, 0.1);
+      const transform::Rigid2d noisy_submap_pose =
+          submap_pose * Noise(0.3, 0.1);
+      const mapping::NodeId node_id{0, num_nodes_};
+      const Constraint intra_submap_constraint{
+          mapping::SubmapId{0, submap_index}, node_id,
+          Constraint::Pose{transform::Embed3D(submap_pose.inverse() *
+                                              node_pose * Noise(0.05, 0.01)),
+                           1e2, 1e2},
+          Constraint::INTRA_SUBMAP};
+      const Constraint inter_submap_constraint =
+          LoopClosure(node_id, node_pose * Noise(0.05, 0.01));
+      for (OptimizationProblem* const problem : problems) {
+        if (num_nodes_ % kNumNodesPerSubmap == 0) {
+          problem->AddSubmap(0, noisy_submap_pose);
+        }
+        problem->AddTrajectoryNode(0, common::FromUniversal(num_nodes_),
+                                   noisy_node_pose, noisy_node_pose);
+      }
+      constraints_.push_back(intra_submap_constraint);
+      if (submap_index > loop_closure_submap_index_) {
+        constraints_.push_back(inter_submap_constraint);
+      }
+    }
+  }
+
+  Constraint LoopClosure(const mapping::NodeId& node_id,
+                         const transform::Rigid2d& node_pose) {
+    return Constraint{
+        mapping::SubmapId{0, loop_closure_submap_index_}, node_id,
+        Constraint::Pose{
+            transform::Embed3D(
+                GroundTruthPose(loop_closure_submap_index_ *
+                                kNumNodesPerSubmap)
+                    .inverse() *
+                node_pose),
+            1., 1.},
+        Constraint::INTER_SUBMAP};
+  }
+
+  static void ExpectPosesNear(const OptimizationProblem& expected,
+                              const OptimizationProblem& actual) {
+    ASSERT_EQ(expected.node_data().size(), actual.node_data().size());
+    for (size_t trajectory_id = 0;
+         trajectory_id != expected.node_data().size(); ++trajectory_id) {
+      const auto& expected_nodes = expected.node_data()[trajectory_id];
+      const auto& actual_nodes = actual.node_data()[trajectory_id];
+      ASSERT_EQ(expected_nodes.size(), actual_nodes.size());
+      for (size_t i = 0; i != expected_nodes.size(); ++i) {
+        EXPECT_NEAR(expected_nodes[i].point_cloud_pose.translation().x(),
+                    actual_nodes[i].point_cloud_pose.translation().x(), 1e-4);
+        EXPECT_NEAR(expected_nodes[i].point_cloud_pose.translation().y(),
+                    actual_nodes[i].point_cloud_pose.translation().y(), 1e-4);
+        EXPECT_NEAR(expected_nodes[i].point_cloud_pose.normalized_angle(),
+                    actual_nodes[i].point_cloud_pose.normalized_angle(), 1e-4);
+      }
+      const auto& expected_submaps = expected.submap_data()[trajectory_id];
+      const auto& actual_submaps = actual.submap_data()[trajectory_id];
+      ASSERT_EQ(expected_submaps.size(), actual_submaps.size());
+      for (size_t i = 0; i != expected_submaps.size(); ++i) {
+        EXPECT_NEAR(expected_submaps[i].pose.translation().x(),
+                    actual_submaps[i].pose.translation().x(), 1e-4);
+        EXPECT_NEAR(expected_submaps[i].pose.translation().y(),
+                    actual_submaps[i].pose.translation().y(), 1e-4);
+        EXPECT_NEAR(expected_submaps[i].pose.normalized_angle(),
+                    actual_submaps[i].pose.normalized_angle(), 1e-4);
+      }
+    }
+  }
+
+  std::mt19937 rng_;
+  int num_nodes_ = 0;
+  int loop_closure_submap_index_ = 0;
+  std::vector<Constraint> constraints_;
+};
+
+TEST_F(OptimizationProblemTest, IncrementalSolveMatchesFullSolve) {
+  OptimizationProblem full_problem(CreateOptions(false, 0));
+  OptimizationProblem incremental_problem(CreateOptions(true, 0));
+  for (const int num_nodes : {15, 32, 50}) {
+    AddNodes(num_nodes, {&full_problem, &incremental_problem});
+    full_problem.Solve(constraints_, {});
+    incremental_problem.Solve(constraints_, {});
+    ExpectPosesNear(full_problem, incremental_problem);
+  }
+}
+
+TEST_F(OptimizationProblemTest, IncrementalSolveHandlesTrimming) {
+  OptimizationProblem full_problem(CreateOptions(false, 0));
+  OptimizationProblem incremental_problem(CreateOptions(true, 0));
+  AddNodes(35, {&full_problem, &incremental_problem});
+  full_problem.Solve(constraints_, {});
+  incremental_problem.Solve(constraints_, {});
+
+  // Trim the first submap and its nodes as done by the SparsePoseGraph. This
+  // removes all constraints of the submap and the trimmed nodes.
+  const mapping::SubmapId submap_id{0, 0};
+  std::vector<Constraint> constraints;
+  for (const Constraint& constraint : constraints_) {
+    if (constraint.submap_id != submap_id &&
+        constraint.node_id.node_index >= kNumNodesPerSubmap) {
+      constraints.push_back(constraint);
+    }
+  }
+  constraints_ = constraints;
+  for (OptimizationProblem* const problem :
+       {&full_problem, &incremental_problem}) {
+    problem->TrimSubmap(submap_id);
+    for (int node_index = 0; node_index != kNumNodesPerSubmap; ++node_index) {
+      problem->TrimTrajectoryNode(mapping::NodeId{0, node_index});
+    }
+  }
+  // Replace the lost loop closures.
+  loop_closure_submap_index_ = 1;
+  for (int node_index = 2 * kNumNodesPerSubmap; node_index != 35;
+       ++node_index) {
+    constraints_.push_back(LoopClosure(mapping::NodeId{0, node_index},
+                                       GroundTruthPose(node_index)));
+  }
+  AddNodes(45, {&full_problem, &incremental_problem});
+  full_problem.Solve(constraints_, {});
+  incremental_problem.Solve(constraints_, {});
+  EXPECT_EQ(1, incremental_problem.num_trimmed_submaps(0));
+  EXPECT_EQ(kNumNodesPerSubmap, incremental_problem.num_trimmed_nodes(0));
+  ExpectPosesNear(full_problem, incremental_problem);
+}
+
+TEST_F(OptimizationProblemTest, LocalWindowKeepsDistantPosesConstant) {
+  OptimizationProblem problem(CreateOptions(true, 1));
+  // Only add intra-submap constraints, so that the graph is a chain.
+  loop_closure_submap_index_ = std::numeric_limits<int>::max();
+  AddNodes(31, {&problem});
+  problem.Solve(constraints_, {});
+  const std::deque<NodeData> node_data_before = problem.node_data().at(0);
+  const std::deque<SubmapData> submap_data_before =
+      problem.submap_data().at(0);
+
+  // The new node is constrained to submap 3 and node 30. Within one hop, only
+  // those are optimized.
+  AddNodes(32, {&problem});
+  problem.Solve(constraints_, {});
+  const auto& node_data = problem.node_data().at(0);
+  const auto& submap_data = problem.submap_data().at(0);
+  for (int i = 0; i != 30; ++i) {
+    EXPECT_EQ(node_data_before[i].point_cloud_pose.translation(),
+              node_data[i].point_cloud_pose.translation());
+  }
+  for (int i = 0; i != 3; ++i) {
+    EXPECT_EQ(submap_data_before[i].pose.translation(),
+              submap_data[i].pose.translation());
+  }
+  EXPECT_NE(node_data_before[30].point_cloud_pose.translation(),
+            node_data[30].point_cloud_pose.translation());
+
+  // Without a local window, a loop closure moves all poses.
+  problem.SetLocalWindowNumHops(0);
+  loop_closure_submap_index_ = 0;
+  constraints_.push_back(LoopClosure(mapping::NodeId{0, 31},
+                                     GroundTruthPose(31) * Noise(1., 0.1)));
+  problem.Solve(constraints_, {});
+  EXPECT_NE(node_data_before[15].point_cloud_pose.translation(),
+            node_data[15].point_cloud_pose.translation());
+}
+
+// Nodes are only constrained to consecutive nodes, whose relative poses drift
+// in rotation. GPS fixes between the nodes, given in a rotated and shifted
+// frame, pull the nodes back to the ground truth.
+TEST(OptimizationProblemGpsTest, GpsDataCorrectsDrift) {
+  constexpr int kNumNodes = 30;
+  const auto ground_truth = [](const double t) {
+    return transform::Rigid2d({t, 0.02 * t * t}, std::atan(0.04 * t));
+  };
+  const transform::Rigid2d gps_frame_in_global({5., -3.}, 0.3);
+  for (const bool use_gps_data : {false, true}) {
+    auto options = CreateOptions(false /* incremental */,
+                                 0 /* local_window_num_hops */);
+    options.set_use_gps_data(use_gps_data);
+    options.set_gps_huber_scale(1.);
+    options.set_gps_max_interpolation_gap(1.5);
+    OptimizationProblem problem(options);
+    problem.AddSubmap(0, ground_truth(0.));
+    transform::Rigid2d node_pose = ground_truth(0.);
+    for (int i = 0; i != kNumNodes; ++i) {
+      if (i != 0) {
+        node_pose = node_pose * ground_truth(i - 1).inverse() *
+                    ground_truth(i) * transform::Rigid2d::Rotation(0.01);
+      }
+      problem.AddTrajectoryNode(0, common::FromUniversal(i * 10000000),
+                                node_pose, node_pose);
+    }
+    for (int i = 0; i <= kNumNodes; ++i) {
+      const double t = i - 0.5;
+      problem.AddGpsData(
+          0, sensor::GpsData{common::FromUniversal((2 * i - 1) * 5000000),
+                             gps_frame_in_global.inverse() *
+                                 ground_truth(t).translation(),
+                             Eigen::Matrix2d::Identity() * 1e-4});
+    }
+    const Constraint anchor{
+        mapping::SubmapId{0, 0}, mapping::NodeId{0, 0},
+        Constraint::Pose{transform::Rigid3d::Identity(), 1e2, 1e2},
+        Constraint::INTRA_SUBMAP};
+    problem.Solve({anchor}, {});
+
+    // The rotation of the GPS frame is only determined by the drifting
+    // rotations of the nodes, so the nodes are compared to the ground truth
+    // after rotating them to align the last node.
+    const auto& node_data = problem.node_data()[0];
+    const Eigen::Vector2d last_node =
+        node_data.back().point_cloud_pose.translation();
+    const Eigen::Vector2d last_ground_truth =
+        ground_truth(kNumNodes - 1).translation();
+    const Eigen::Rotation2Dd alignment(
+        std::atan2(last_ground_truth.y(), last_ground_truth.x()) -
+        std::atan2(last_node.y(), last_node.x()));
+    double max_error = 0.;
+    for (int i = 0; i != kNumNodes; ++i) {
+      max_error = std::max(
+          max_error,
+          (alignment * node_data[i].point_cloud_pose.translation() -
+           ground_truth(i).translation())
+              .norm());
+    }
+    if (use_gps_data) {
+      EXPECT_LT(max_error, 0.05);
+    } else {
+      EXPECT_GT(max_error, 1.);
+    }
+  }
+}
+
+// GPS drivers may repeat fixes. Fixes which are not after the previous one are
+// dropped instead of being added to the problem.
+TEST(OptimizationProblemGpsTest, DropsGpsDataWhichIsNotAfterThePreviousData) {
+  constexpr int kNumNodes = 10;
+  auto options =
+      CreateOptions(false /* incremental */, 0 /* local_window_num_hops */);
+  options.set_use_gps_data(true);
+  options.set_gps_huber_scale(1.);
+  options.set_gps_max_interpolation_gap(1.5);
+  OptimizationProblem problem(options);
+  OptimizationProblem problem_with_repeated_data(options);
+  for (OptimizationProblem* const p : {&problem, &problem_with_repeated_data}) {
+    p->AddSubmap(0, transform::Rigid2d::Identity());
+    for (int i = 0; i != kNumNodes; ++i) {
+      const transform::Rigid2d node_pose({1. * i, 0.}, 0.01 * i);
+      p->AddTrajectoryNode(0, common::FromUniversal(i * 10000000), node_pose,
+                           node_pose);
+    }
+  }
+  for (int i = 0; i <= kNumNodes; ++i) {
+    const sensor::GpsData gps_data{
+        common::FromUniversal((2 * i - 1) * 5000000),
+        Eigen::Vector2d(i - 0.5, 0.1 * i), Eigen::Matrix2d::Identity() * 1e-4};
+    problem.AddGpsData(0, gps_data);
+    problem_with_repeated_data.AddGpsData(0, gps_data);
+    // A repeated timestamp and an older one, both with a different position.
+    for (const int64 delta : {0, -1000}) {
+      problem_with_repeated_data.AddGpsData(
+          0, sensor::GpsData{gps_data.time + common::Duration(delta),
+                             Eigen::Vector2d(100., 100.),
+                             Eigen::Matrix2d::Identity() * 1e-4});
+    }
+  }
+  const Constraint anchor{
+      mapping::SubmapId{0, 0}, mapping::NodeId{0, 0},
+      Constraint::Pose{transform::Rigid3d::Identity(), 1e2, 1e2},
+      Constraint::INTRA_SUBMAP};
+  problem.Solve({anchor}, {});
+  problem_with_repeated_data.Solve({anchor}, {});
+
+  const auto& expected_nodes = problem.node_data()[0];
+  const auto& actual_nodes = problem_with_repeated_data.node_data()[0];
+  ASSERT_EQ(expected_nodes.size(), actual_nodes.size());
+  for (size_t i = 0; i != expected_nodes.size(); ++i) {
+    EXPECT_NEAR(expected_nodes[i].point_cloud_pose.translation().x(),
+                actual_nodes[i].point_cloud_pose.translation().x(), 1e-9);
+    EXPECT_NEAR(expected_nodes[i].point_cloud_pose.translation().y(),
+                actual_nodes[i].point_cloud_pose.translation().y(), 1e-9);
+  }
+}
+
+}  // namespace
+}  // namespace sparse_pose_graph
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -18,6 +18,7 @@
 #define CARTOGRAPHER_MAPPING_2D_SPARSE_POSE_GRAPH_SPA_COST_FUNCTION_H_
 
 #include <array>
+#include <cmath>
 
 #include "Eigen/Core"
 #include "Eigen/Geometry"
@@ -81,6 +82,75 @@ class SpaCostFunction {
   const Constraint::Pose pose_;
 };
 
+// Computes the same error as SpaCostFunction, but evaluates the Jacobians in
+// closed form instead of using automatic differentiation.
+class AnalyticalSpaCostFunction : public ceres::SizedCostFunction<3, 3, 3> {
+ public:
+  using Constraint = mapping::SparsePoseGraph::Constraint;
+
+  explicit AnalyticalSpaCostFunction(const Constraint::Pose& pose)
+      : zbar_ij_(transform::Project2D(pose.zbar_ij)),
+        translation_weight_(pose.translation_weight),
+        rotation_weight_(pose.rotation_weight) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    const double* const c_i = parameters[0];
+    const double* const c_j = parameters[1];
+    const std::array<double, 3> e_ij =
+        SpaCostFunction::ComputeUnscaledError(zbar_ij_, c_i, c_j);
+    residuals[0] = e_ij[0] * translation_weight_;
+    residuals[1] = e_ij[1] * translation_weight_;
+    residuals[2] = e_ij[2] * rotation_weight_;
+    if (jacobians == nullptr) {
+      return true;
+    }
+
+    const double cos_theta_i = std::cos(c_i[2]);
+    const double sin_theta_i = std::sin(c_i[2]);
+    const double delta_x = c_j[0] - c_i[0];
+    const double delta_y = c_j[1] - c_i[1];
+    // The translation of 'c_j' in the frame of 'c_i', i.e. 'h' in
+    // ComputeUnscaledError(). Its derivative with respect to the angle of 'c_i'
+    // is (h_y, -h_x).
+    const double h_x = cos_theta_i * delta_x + sin_theta_i * delta_y;
+    const double h_y = -sin_theta_i * delta_x + cos_theta_i * delta_y;
+    const double a = translation_weight_ * cos_theta_i;
+    const double b = translation_weight_ * sin_theta_i;
+    // Jacobians are in row-major order, one row per residual.
+    if (jacobians[0] != nullptr) {
+      double* const jacobian = jacobians[0];
+      jacobian[0] = a;
+      jacobian[1] = b;
+      jacobian[2] = -translation_weight_ * h_y;
+      jacobian[3] = -b;
+      jacobian[4] = a;
+      jacobian[5] = translation_weight_ * h_x;
+      jacobian[6] = 0.;
+      jacobian[7] = 0.;
+      jacobian[8] = rotation_weight_;
+    }
+    if (jacobians[1] != nullptr) {
+      double* const jacobian = jacobians[1];
+      jacobian[0] = -a;
+      jacobian[1] = -b;
+      jacobian[2] = 0.;
+      jacobian[3] = b;
+      jacobian[4] = -a;
+      jacobian[5] = 0.;
+      jacobian[6] = 0.;
+      jacobian[7] = 0.;
+      jacobian[8] = -rotation_weight_;
+    }
+    return true;
+  }
+
+ private:
+  const transform::Rigid2d zbar_ij_;
+  const double translation_weight_;
+  const double rotation_weight_;
+};
+
 }  // namespace sparse_pose_graph
 }  // namespace mapping_2d
 }  // namespace cartographer
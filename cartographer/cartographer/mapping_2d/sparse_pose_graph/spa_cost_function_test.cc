@@ -0,0 +1,69 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_2d/sparse_pose_graph/spa_cost_function.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_2d {
+namespace sparse_pose_graph {
+namespace {
+
+TEST(SpaCostFunctionTest, AnalyticalJacobiansMatchAutoDiff) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<double> distribution(-M_PI, M_PI);
+  for (int i = 0; i != 100; ++i) {
+    const SpaCostFunction::Constraint::Pose pose{
+        transform::Embed3D(transform::Rigid2d(
+            {distribution(prng), distribution(prng)}, distribution(prng))),
+        1. + distribution(prng), 2. + distribution(prng)};
+    const ceres::AutoDiffCostFunction<SpaCostFunction, 3, 3, 3>
+        auto_diff_cost_function(new SpaCostFunction(pose));
+    const AnalyticalSpaCostFunction analytical_cost_function(pose);
+
+    const double c_i[3] = {distribution(prng), distribution(prng),
+                           distribution(prng)};
+    const double c_j[3] = {distribution(prng), distribution(prng),
+                           distribution(prng)};
+    const double* const parameters[2] = {c_i, c_j};
+    double expected_residuals[3];
+    double expected_jacobians[2][9];
+    double* expected_jacobian_pointers[2] = {expected_jacobians[0],
+                                             expected_jacobians[1]};
+    ASSERT_TRUE(auto_diff_cost_function.Evaluate(
+        parameters, expected_residuals, expected_jacobian_pointers));
+    double residuals[3];
+    double jacobians[2][9];
+    double* jacobian_pointers[2] = {jacobians[0], jacobians[1]};
+    ASSERT_TRUE(analytical_cost_function.Evaluate(parameters, residuals,
+                                                  jacobian_pointers));
+    for (int j = 0; j != 3; ++j) {
+      EXPECT_NEAR(expected_residuals[j], residuals[j], 1e-9);
+    }
+    for (int j = 0; j != 9; ++j) {
+      EXPECT_NEAR(expected_jacobians[0][j], jacobians[0][j], 1e-6);
+      EXPECT_NEAR(expected_jacobians[1][j], jacobians[1][j], 1e-6);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace sparse_pose_graph
+}  // namespace mapping_2d
+}  // namespace cartographer
@@ -88,6 +88,7 @@ class SparsePoseGraphTest : public ::testing::Test {
                 occupied_space_weight = 20.,
                 translation_weight = 10.,
                 rotation_weight = 1.,
+                use_analytical_jacobians = false,
                 ceres_solver_options = {
                   use_nonmonotonic_steps = true,
                   max_num_iterations = 50,
@@ -134,6 +135,14 @@ class SparsePoseGraphTest : public ::testing::Test {
               consecutive_scan_translation_penalty_factor = 0.,
               consecutive_scan_rotation_penalty_factor = 0.,
               log_solver_summary = true,
+              incremental = false,
+              local_window_num_hops = 0,
+              use_analytical_jacobians = false,
+              use_gps_data = false,
+              gps_translation_stddev = 3.,
+              gps_rtk_fixed_translation_stddev = 0.05,
+              gps_huber_scale = 1.,
+              gps_max_interpolation_gap = 1.,
               ceres_solver_options = {
                 use_nonmonotonic_steps = false,
                 max_num_iterations = 200,
@@ -206,6 +215,32 @@ TEST_F(SparsePoseGraphTest, NoMovement) {
               transform::IsNearly(transform::Rigid3d::Identity(), 1e-2));
 }
 
+TEST_F(SparsePoseGraphTest, Snapshot) {
+  const auto empty_snapshot = sparse_pose_graph_->GetSnapshot();
+  EXPECT_THAT(empty_snapshot->version, ::testing::Eq(0));
+  EXPECT_THAT(empty_snapshot->trajectory_nodes.size(), ::testing::Eq(0));
+  for (int i = 0; i != 3; ++i) {
+    MoveRelative(transform::Rigid2d({0., 2.}, 0.));
+  }
+  sparse_pose_graph_->RunFinalOptimization();
+  const auto snapshot = sparse_pose_graph_->GetSnapshot();
+  EXPECT_THAT(snapshot->version, ::testing::Gt(empty_snapshot->version));
+  const auto nodes = sparse_pose_graph_->GetTrajectoryNodes();
+  ASSERT_THAT(snapshot->trajectory_nodes.size(), ::testing::Eq(nodes.size()));
+  ASSERT_THAT(snapshot->trajectory_nodes[0].size(),
+              ::testing::Eq(nodes[0].size()));
+  for (size_t i = 0; i != nodes[0].size(); ++i) {
+    EXPECT_THAT(snapshot->trajectory_nodes[0][i].pose,
+                transform::IsNearly(nodes[0][i].pose, 1e-9));
+  }
+  EXPECT_THAT(snapshot->submap_data.size(),
+              ::testing::Eq(sparse_pose_graph_->GetAllSubmapData().size()));
+  EXPECT_THAT(snapshot->constraints.size(),
+              ::testing::Eq(sparse_pose_graph_->constraints().size()));
+  // The empty snapshot is not modified by publishing new ones.
+  EXPECT_THAT(empty_snapshot->trajectory_nodes.size(), ::testing::Eq(0));
+}
+
 TEST_F(SparsePoseGraphTest, NoOverlappingScans) {
   std::mt19937 rng(0);
   std::uniform_real_distribution<double> distribution(-1., 1.);
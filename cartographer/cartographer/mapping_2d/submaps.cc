@@ -72,6 +72,12 @@ Submap::Submap(const mapping::proto::Submap2D& proto)
       probability_grid_(ProbabilityGrid(proto.probability_grid())) {
   SetNumRangeData(proto.num_range_data());
   finished_ = proto.finished();
+  if (proto.has_precomputation_grid_stack()) {
+    CHECK(finished_);
+    precomputation_grid_stack_ =
+        std::make_shared<const scan_matching::PrecomputationGridStack>(
+            proto.precomputation_grid_stack());
+  }
 }
 
 void Submap::ToProto(mapping::proto::Submap* const proto) const {
@@ -80,6 +86,11 @@ void Submap::ToProto(mapping::proto::Submap* const proto) const {
   submap_2d->set_num_range_data(num_range_data());
   submap_2d->set_finished(finished_);
   *submap_2d->mutable_probability_grid() = probability_grid_.ToProto();
+  const auto precomputation_grid_stack = this->precomputation_grid_stack();
+  if (precomputation_grid_stack != nullptr) {
+    *submap_2d->mutable_precomputation_grid_stack() =
+        precomputation_grid_stack->ToProto();
+  }
 }
 
 void Submap::ToResponseProto(
@@ -182,12 +193,44 @@ void Submap::InsertRangeData(const sensor::RangeData& range_data,
   CHECK(!finished_);
   range_data_inserter.Insert(range_data, &probability_grid_);
   SetNumRangeData(num_range_data() + 1);
+  common::MutexLocker locker(&mutex_);
+  if (interpolation_grid_ != nullptr &&
+      (interpolation_grid_.use_count() > 1 ||
+       !interpolation_grid_->Update(probability_grid_))) {
+    interpolation_grid_.reset();
+  }
 }
 
 void Submap::Finish() {
   CHECK(!finished_);
   probability_grid_ = ComputeCroppedProbabilityGrid(probability_grid_);
   finished_ = true;
+  common::MutexLocker locker(&mutex_);
+  interpolation_grid_.reset();
+}
+
+std::shared_ptr<const scan_matching::PrecomputationGridStack>
+Submap::precomputation_grid_stack() const {
+  common::MutexLocker locker(&mutex_);
+  return precomputation_grid_stack_;
+}
+
+void Submap::CachePrecomputationGridStack(
+    std::shared_ptr<const scan_matching::PrecomputationGridStack>
+        precomputation_grid_stack) const {
+  CHECK(finished_);
+  common::MutexLocker locker(&mutex_);
+  precomputation_grid_stack_ = std::move(precomputation_grid_stack);
+}
+
+std::shared_ptr<const scan_matching::InterpolationGrid>
+Submap::interpolation_grid() const {
+  common::MutexLocker locker(&mutex_);
+  if (interpolation_grid_ == nullptr) {
+    interpolation_grid_ =
+        std::make_shared<scan_matching::InterpolationGrid>(probability_grid_);
+  }
+  return interpolation_grid_;
 }
 
 ActiveSubmaps::ActiveSubmaps(const proto::SubmapsOptions& options)
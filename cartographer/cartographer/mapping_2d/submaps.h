@@ -22,6 +22,7 @@
 
 #include "Eigen/Core"
 #include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/mutex.h"
 #include "cartographer/mapping/proto/serialization.pb.h"
 #include "cartographer/mapping/proto/submap_visualization.pb.h"
 #include "cartographer/mapping/submaps.h"
@@ -30,6 +31,8 @@
 #include "cartographer/mapping_2d/probability_grid.h"
 #include "cartographer/mapping_2d/proto/submaps_options.pb.h"
 #include "cartographer/mapping_2d/range_data_inserter.h"
+#include "cartographer/mapping_2d/scan_matching/fast_correlative_scan_matcher.h"
+#include "cartographer/mapping_2d/scan_matching/interpolation_grid.h"
 #include "cartographer/sensor/range_data.h"
 #include "cartographer/transform/rigid_transform.h"
 
@@ -64,9 +67,33 @@ class Submap : public mapping::Submap {
                        const RangeDataInserter& range_data_inserter);
   void Finish();
 
+  // Returns the precomputation grids of the FastCorrelativeScanMatcher for
+  // this submap if they were cached before, or nullptr. They are serialized
+  // with the submap so that loading a map does not require recomputing them.
+  std::shared_ptr<const scan_matching::PrecomputationGridStack>
+  precomputation_grid_stack() const EXCLUDES(mutex_);
+
+  // Caches 'precomputation_grid_stack' computed for this finished submap.
+  void CachePrecomputationGridStack(
+      std::shared_ptr<const scan_matching::PrecomputationGridStack>
+          precomputation_grid_stack) const EXCLUDES(mutex_);
+
+  // Returns the probability grid prepared for the CeresScanMatcher. It is
+  // computed on first use and cached. Inserting range data updates the cached
+  // grid in place if it is not in use elsewhere, otherwise it is recomputed
+  // on the next call.
+  std::shared_ptr<const scan_matching::InterpolationGrid> interpolation_grid()
+      const EXCLUDES(mutex_);
+
  private:
   ProbabilityGrid probability_grid_;
   bool finished_ = false;
+
+  mutable common::Mutex mutex_;
+  mutable std::shared_ptr<const scan_matching::PrecomputationGridStack>
+      precomputation_grid_stack_ GUARDED_BY(mutex_);
+  mutable std::shared_ptr<scan_matching::InterpolationGrid>
+      interpolation_grid_ GUARDED_BY(mutex_);
 };
 
 // Except during initialization when only a single submap exists, there are
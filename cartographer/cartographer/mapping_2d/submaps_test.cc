@@ -74,7 +74,7 @@ TEST(SubmapsTest, ToFromProto) {
   expected.ToProto(&proto);
   EXPECT_TRUE(proto.has_submap_2d());
   EXPECT_FALSE(proto.has_submap_3d());
-  const auto actual = Submap(proto.submap_2d());
+  const Submap actual(proto.submap_2d());
   EXPECT_TRUE(expected.local_pose().translation().isApprox(
       actual.local_pose().translation(), 1e-6));
   EXPECT_TRUE(expected.local_pose().rotation().isApprox(
@@ -87,6 +87,76 @@ TEST(SubmapsTest, ToFromProto) {
       actual.probability_grid().limits().max(), 1e-6));
   EXPECT_EQ(expected.probability_grid().limits().cell_limits().num_x_cells,
             actual.probability_grid().limits().cell_limits().num_x_cells);
+  EXPECT_EQ(nullptr, actual.precomputation_grid_stack());
+}
+
+TEST(SubmapsTest, ToFromProtoWithPrecomputationGridStack) {
+  Submap expected(MapLimits(1., Eigen::Vector2d(2., 3.), CellLimits(100, 110)),
+                  Eigen::Vector2f(4.f, 5.f));
+  expected.Finish();
+  scan_matching::proto::FastCorrelativeScanMatcherOptions options;
+  options.set_branch_and_bound_depth(3);
+  expected.CachePrecomputationGridStack(
+      std::make_shared<const scan_matching::PrecomputationGridStack>(
+          expected.probability_grid(), options, nullptr /* thread_pool */));
+  mapping::proto::Submap proto;
+  expected.ToProto(&proto);
+  EXPECT_TRUE(proto.submap_2d().has_precomputation_grid_stack());
+  const Submap actual(proto.submap_2d());
+  ASSERT_NE(nullptr, actual.precomputation_grid_stack());
+  EXPECT_EQ(2, actual.precomputation_grid_stack()->max_depth());
+  EXPECT_EQ(4, actual.precomputation_grid_stack()->Get(2).width());
+}
+
+TEST(SubmapsTest, InterpolationGridIsKeptUpToDate) {
+  proto::RangeDataInserterOptions range_data_inserter_options;
+  range_data_inserter_options.set_hit_probability(0.7);
+  range_data_inserter_options.set_miss_probability(0.4);
+  range_data_inserter_options.set_insert_free_space(true);
+  const RangeDataInserter range_data_inserter(range_data_inserter_options);
+  Submap submap(MapLimits(0.1, Eigen::Vector2d(1., 1.), CellLimits(20, 20)),
+                Eigen::Vector2f::Zero());
+  const scan_matching::InterpolationGrid* const cached_interpolation_grid =
+      submap.interpolation_grid().get();
+  const auto expect_up_to_date = [&submap]() {
+    const scan_matching::InterpolationGrid expected(submap.probability_grid());
+    const auto actual = submap.interpolation_grid();
+    ASSERT_EQ(expected.num_rows(), actual->num_rows());
+    ASSERT_EQ(expected.num_columns(), actual->num_columns());
+    for (int row = 0; row != expected.num_rows(); ++row) {
+      for (int column = 0; column != expected.num_columns(); ++column) {
+        EXPECT_EQ(expected.GetValue(row, column),
+                  actual->GetValue(row, column));
+      }
+    }
+  };
+
+  submap.InsertRangeData(
+      {Eigen::Vector3f::Zero(), {Eigen::Vector3f(0.5f, 0.5f, 0.f)}, {}},
+      range_data_inserter);
+  // The grid was updated in place.
+  EXPECT_EQ(cached_interpolation_grid, submap.interpolation_grid().get());
+  expect_up_to_date();
+
+  // Grids in use elsewhere do not change.
+  const auto interpolation_grid_in_use = submap.interpolation_grid();
+  submap.InsertRangeData(
+      {Eigen::Vector3f::Zero(), {Eigen::Vector3f(-0.5f, 0.2f, 0.f)}, {}},
+      range_data_inserter);
+  EXPECT_NE(interpolation_grid_in_use, submap.interpolation_grid());
+  expect_up_to_date();
+
+  // Growing the grid requires a new one.
+  submap.InsertRangeData(
+      {Eigen::Vector3f::Zero(), {Eigen::Vector3f(3.f, 0.f, 0.f)}, {}},
+      range_data_inserter);
+  expect_up_to_date();
+  EXPECT_EQ(submap.probability_grid().limits().cell_limits().num_y_cells +
+                2 * scan_matching::InterpolationGrid::kPadding,
+            submap.interpolation_grid()->num_rows());
+
+  submap.Finish();
+  expect_up_to_date();
 }
 
 }  // namespace
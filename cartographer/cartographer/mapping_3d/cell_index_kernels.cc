@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_3d/cell_index_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CARTOGRAPHER_X86_CELL_INDEX_KERNELS
+#include <immintrin.h>
+#endif
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping_3d {
+
+namespace {
+
+// The kernels treat the points and cell indices as flat arrays of coordinates,
+// since all three coordinates are handled the same.
+static_assert(sizeof(Eigen::Vector3f) == 3 * sizeof(float),
+              "Points are not packed.");
+static_assert(sizeof(Eigen::Array3i) == 3 * sizeof(int),
+              "Cell indices are not packed.");
+
+void ComputeCellIndicesScalar(const float* const coordinates,
+                              const float resolution, const int begin,
+                              const int end, int* const indices) {
+  for (int i = begin; i != end; ++i) {
+    indices[i] = common::FastRoundToInt(coordinates[i] / resolution);
+  }
+}
+
+#ifdef CARTOGRAPHER_X86_CELL_INDEX_KERNELS
+
+// Rounds 4 coordinates at a time like common::FastRoundToInt(). The rounding
+// instructions would round halfway cases to even, so the kernels truncate and
+// correct by the fraction instead. Dividing rather than multiplying by the
+// inverse resolution keeps the results identical to the scalar kernel.
+__attribute__((target("sse4.1"))) void ComputeCellIndicesSse41(
+    const float* const coordinates, const float resolution,
+    const int num_coordinates, int* const indices) {
+  const __m128 resolutions = _mm_set1_ps(resolution);
+  const __m128 plus_half = _mm_set1_ps(0.5f);
+  const __m128 minus_half = _mm_set1_ps(-0.5f);
+  int i = 0;
+  for (; i + 4 <= num_coordinates; i += 4) {
+    const __m128 x = _mm_div_ps(_mm_loadu_ps(coordinates + i), resolutions);
+    const __m128i truncated = _mm_cvttps_epi32(x);
+    const __m128 fraction = _mm_sub_ps(x, _mm_cvtepi32_ps(truncated));
+    // Comparisons yield -1 for true, so subtracting rounds up.
+    const __m128i rounded = _mm_add_epi32(
+        _mm_sub_epi32(truncated,
+                      _mm_castps_si128(_mm_cmpge_ps(fraction, plus_half))),
+        _mm_castps_si128(_mm_cmple_ps(fraction, minus_half)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), rounded);
+  }
+  ComputeCellIndicesScalar(coordinates, resolution, i, num_coordinates,
+                           indices);
+}
+
+__attribute__((target("avx2"))) void ComputeCellIndicesAvx2(
+    const float* const coordinates, const float resolution,
+    const int num_coordinates, int* const indices) {
+  const __m256 resolutions = _mm256_set1_ps(resolution);
+  const __m256 plus_half = _mm256_set1_ps(0.5f);
+  const __m256 minus_half = _mm256_set1_ps(-0.5f);
+  int i = 0;
+  for (; i + 8 <= num_coordinates; i += 8) {
+    const __m256 x =
+        _mm256_div_ps(_mm256_loadu_ps(coordinates + i), resolutions);
+    const __m256i truncated = _mm256_cvttps_epi32(x);
+    const __m256 fraction = _mm256_sub_ps(x, _mm256_cvtepi32_ps(truncated));
+    const __m256i rounded = _mm256_add_epi32(
+        _mm256_sub_epi32(truncated, _mm256_castps_si256(_mm256_cmp_ps(
+                                        fraction, plus_half, _CMP_GE_OQ))),
+        _mm256_castps_si256(_mm256_cmp_ps(fraction, minus_half, _CMP_LE_OQ)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i), rounded);
+  }
+  ComputeCellIndicesScalar(coordinates, resolution, i, num_coordinates,
+                           indices);
+}
+
+#endif  // CARTOGRAPHER_X86_CELL_INDEX_KERNELS
+
+}  // namespace
+
+bool IsCellIndexKernelSupported(const CellIndexKernel kernel) {
+  switch (kernel) {
+    case CellIndexKernel::kScalar:
+      return true;
+#ifdef CARTOGRAPHER_X86_CELL_INDEX_KERNELS
+    case CellIndexKernel::kSse41:
+      return __builtin_cpu_supports("sse4.1");
+    case CellIndexKernel::kAvx2:
+      return __builtin_cpu_supports("avx2");
+#else
+    case CellIndexKernel::kSse41:
+    case CellIndexKernel::kAvx2:
+      return false;
+#endif
+  }
+  LOG(FATAL) << "Unknown cell index kernel " << static_cast<int>(kernel);
+}
+
+CellIndexKernel GetFastestSupportedCellIndexKernel() {
+  static const CellIndexKernel kFastestKernel = []() {
+    for (const CellIndexKernel kernel :
+         {CellIndexKernel::kAvx2, CellIndexKernel::kSse41}) {
+      if (IsCellIndexKernelSupported(kernel)) {
+        return kernel;
+      }
+    }
+    return CellIndexKernel::kScalar;
+  }();
+  return kFastestKernel;
+}
+
+string CellIndexKernelToString(const CellIndexKernel kernel) {
+  switch (kernel) {
+    case CellIndexKernel::kScalar:
+      return "scalar";
+    case CellIndexKernel::kSse41:
+      return "sse4.1";
+    case CellIndexKernel::kAvx2:
+      return "avx2";
+  }
+  LOG(FATAL) << "Unknown cell index kernel " << static_cast<int>(kernel);
+}
+
+void ComputeCellIndices(const CellIndexKernel kernel,
+                        const std::vector<Eigen::Vector3f>& points,
+                        const float resolution,
+                        std::vector<Eigen::Array3i>* const cell_indices) {
+  cell_indices->resize(points.size());
+  if (points.empty()) {
+    return;
+  }
+  const float* const coordinates = points.front().data();
+  int* const indices = cell_indices->front().data();
+  const int num_coordinates = 3 * points.size();
+  switch (kernel) {
+    case CellIndexKernel::kScalar:
+      ComputeCellIndicesScalar(coordinates, resolution, 0, num_coordinates,
+                               indices);
+      return;
+#ifdef CARTOGRAPHER_X86_CELL_INDEX_KERNELS
+    case CellIndexKernel::kSse41:
+      ComputeCellIndicesSse41(coordinates, resolution, num_coordinates,
+                              indices);
+      return;
+    case CellIndexKernel::kAvx2:
+      ComputeCellIndicesAvx2(coordinates, resolution, num_coordinates,
+                             indices);
+      return;
+#else
+    case CellIndexKernel::kSse41:
+    case CellIndexKernel::kAvx2:
+      break;
+#endif
+  }
+  LOG(FATAL) << "Unsupported cell index kernel "
+             << CellIndexKernelToString(kernel);
+}
+
+}  // namespace mapping_3d
+}  // namespace cartographer
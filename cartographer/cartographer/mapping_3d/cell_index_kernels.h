@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Kernels computing the HybridGrid cell indices of many points at once. This
+// is the hit pass of the 3D RangeDataInserter. Vectorized kernels are compiled
+// for specific instruction sets and chosen at runtime depending on the CPU.
+
+#ifndef CARTOGRAPHER_MAPPING_3D_CELL_INDEX_KERNELS_H_
+#define CARTOGRAPHER_MAPPING_3D_CELL_INDEX_KERNELS_H_
+
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "cartographer/common/port.h"
+
+namespace cartographer {
+namespace mapping_3d {
+
+enum class CellIndexKernel { kScalar, kSse41, kAvx2 };
+
+// Returns true if 'kernel' can be executed on this CPU.
+bool IsCellIndexKernelSupported(CellIndexKernel kernel);
+
+// Returns the fastest kernel which can be executed on this CPU.
+CellIndexKernel GetFastestSupportedCellIndexKernel();
+
+string CellIndexKernelToString(CellIndexKernel kernel);
+
+// Fills 'cell_indices' with the index of the cell containing each of the
+// 'points' in a grid of the given 'resolution'. All kernels return exactly
+// what HybridGrid::GetCellIndex() returns for each point.
+void ComputeCellIndices(CellIndexKernel kernel,
+                        const std::vector<Eigen::Vector3f>& points,
+                        float resolution,
+                        std::vector<Eigen::Array3i>* cell_indices);
+
+}  // namespace mapping_3d
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_3D_CELL_INDEX_KERNELS_H_
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping_3d/cell_index_kernels.h"
+
+#include <random>
+#include <vector>
+
+#include "cartographer/mapping_3d/hybrid_grid.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping_3d {
+namespace {
+
+TEST(CellIndexKernelsTest, ScalarKernelIsAlwaysSupported) {
+  EXPECT_TRUE(IsCellIndexKernelSupported(CellIndexKernel::kScalar));
+  EXPECT_TRUE(
+      IsCellIndexKernelSupported(GetFastestSupportedCellIndexKernel()));
+}
+
+TEST(CellIndexKernelsTest, AllKernelsAgreeWithGetCellIndex) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<float> coordinate_distribution(-50.f, 50.f);
+  std::uniform_int_distribution<int> halfway_distribution(-500, 500);
+  for (const float resolution : {0.05f, 0.1f, 0.45f, 1.f}) {
+    const HybridGrid hybrid_grid(resolution);
+    // Odd sizes exercise the scalar tails of the vectorized kernels.
+    for (const int num_points : {0, 1, 2, 3, 5, 8, 100, 1001}) {
+      std::vector<Eigen::Vector3f> points;
+      for (int i = 0; i != num_points; ++i) {
+        if (i % 2 == 0) {
+          points.emplace_back(coordinate_distribution(prng),
+                              coordinate_distribution(prng),
+                              coordinate_distribution(prng));
+        } else {
+          // Points halfway between cells, where the rounding matters.
+          points.push_back(
+              (resolution * 0.5f) *
+              Eigen::Vector3f(2 * halfway_distribution(prng) + 1,
+                              2 * halfway_distribution(prng) + 1,
+                              2 * halfway_distribution(prng) + 1));
+        }
+      }
+      for (const CellIndexKernel kernel :
+           {CellIndexKernel::kScalar, CellIndexKernel::kSse41,
+            CellIndexKernel::kAvx2}) {
+        if (!IsCellIndexKernelSupported(kernel)) {
+          continue;
+        }
+        std::vector<Eigen::Array3i> cell_indices;
+        ComputeCellIndices(kernel, points, resolution, &cell_indices);
+        ASSERT_EQ(points.size(), cell_indices.size());
+        for (int i = 0; i != num_points; ++i) {
+          EXPECT_TRUE((hybrid_grid.GetCellIndex(points[i]) ==
+                       cell_indices[i]).all())
+              << CellIndexKernelToString(kernel) << " " << points[i];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mapping_3d
+}  // namespace cartographer
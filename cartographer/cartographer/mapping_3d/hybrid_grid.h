@@ -20,6 +20,8 @@
 #include <array>
 #include <cmath>
 #include <limits>
+#include <memory>
+#include <new>
 #include <utility>
 #include <vector>
 
@@ -28,6 +30,7 @@
 #include "cartographer/common/math.h"
 #include "cartographer/common/port.h"
 #include "cartographer/mapping/probability_values.h"
+#include "cartographer/mapping_3d/cell_index_kernels.h"
 #include "cartographer/mapping_3d/proto/hybrid_grid.pb.h"
 #include "cartographer/transform/transform.h"
 #include "glog/logging.h"
@@ -137,100 +140,130 @@ class FlatGrid {
   std::array<ValueType, 1 << (3 * kBits)> cells_;
 };
 
+// Storage for grids of type 'GridType' which are addressed by index and freed
+// all at once. Grids are constructed one after another in chunks of contiguous
+// memory. Chunks are never moved, so pointers into the grids stay valid, and
+// only the memory of constructed grids is touched. The index of the first cell
+// of each grid is kept, so that all grids can be iterated linearly.
+template <typename TGridType>
+class GridPool {
+ public:
+  using GridType = TGridType;
+
+  GridPool() = default;
+  GridPool(GridPool&& other) { *this = std::move(other); }
+  GridPool& operator=(GridPool&& other) {
+    if (this != &other) {
+      Clear();
+      chunks_.swap(other.chunks_);
+      origins_.swap(other.origins_);
+    }
+    return *this;
+  }
+  ~GridPool() { Clear(); }
+
+  // Returns the number of grids.
+  int size() const { return origins_.size(); }
+
+  // Constructs a new grid whose first cell has index 'origin' and returns the
+  // index of the new grid.
+  int Add(const Eigen::Array3i& origin);
+
+  const GridType& operator[](const int index) const {
+    return chunks_[index >> kChunkBits].get()[index & kChunkMask];
+  }
+
+  GridType& operator[](const int index) {
+    return chunks_[index >> kChunkBits].get()[index & kChunkMask];
+  }
+
+  // Returns the index of the first cell of the grid at 'index'.
+  const Eigen::Array3i& origin(const int index) const {
+    return origins_[index];
+  }
+
+ private:
+  // Each chunk has space for 2^kChunkBits grids.
+  static constexpr int kChunkBits = 6;
+  static constexpr int kChunkMask = (1 << kChunkBits) - 1;
+
+  struct ChunkDeleter {
+    void operator()(GridType* const chunk) const { ::operator delete(chunk); }
+  };
+
+  void Clear() {
+    for (int index = 0; index != size(); ++index) {
+      (*this)[index].~GridType();
+    }
+    origins_.clear();
+    chunks_.clear();
+  }
+
+  std::vector<std::unique_ptr<GridType, ChunkDeleter>> chunks_;
+  std::vector<Eigen::Array3i> origins_;
+};
+
+template <typename GridType>
+int GridPool<GridType>::Add(const Eigen::Array3i& origin) {
+  const int index = size();
+  if ((index & kChunkMask) == 0) {
+    chunks_.emplace_back(
+        static_cast<GridType*>(::operator new(sizeof(GridType) << kChunkBits)));
+  }
+  new (chunks_.back().get() + (index & kChunkMask)) GridType();
+  origins_.push_back(origin);
+  return index;
+}
+
 // A grid consisting of '2^kBits' x '2^kBits' x '2^kBits' grids of type
 // 'WrappedGrid'. Wrapped grids are constructed on first access via
-// 'mutable_value()'.
+// 'mutable_value()' in a 'Pool' shared by all nested grids of a DynamicGrid,
+// and referred to by their index in it.
 template <typename WrappedGrid, int kBits>
 class NestedGrid {
  public:
   using ValueType = typename WrappedGrid::ValueType;
+  using Pool = GridPool<WrappedGrid>;
+
+  // 'origin' is the index of the first cell of this grid as reported when
+  // iterating over the pool.
+  explicit NestedGrid(const Eigen::Array3i& origin) : origin_(origin) {
+    meta_cells_.fill(kUnallocated);
+  }
 
   // Returns the number of voxels per dimension.
   static int grid_size() { return WrappedGrid::grid_size() << kBits; }
 
   // Returns the value stored at 'index', each dimension of 'index' being
-  // between 0 and grid_size() - 1.
-  ValueType value(const Eigen::Array3i& index) const {
+  // between 0 and grid_size() - 1. Wrapped grids are looked up in 'pool'.
+  ValueType value(const Pool& pool, const Eigen::Array3i& index) const {
     const Eigen::Array3i meta_index = GetMetaIndex(index);
-    const WrappedGrid* const meta_cell =
-        meta_cells_[ToFlatIndex(meta_index, kBits)].get();
-    if (meta_cell == nullptr) {
+    const int32 pool_index = meta_cells_[ToFlatIndex(meta_index, kBits)];
+    if (pool_index == kUnallocated) {
       return ValueType();
     }
     const Eigen::Array3i inner_index =
         index - meta_index * WrappedGrid::grid_size();
-    return meta_cell->value(inner_index);
+    return pool[pool_index].value(inner_index);
   }
 
   // Returns a pointer to the value at 'index' to allow changing it. If
-  // necessary a new wrapped grid is constructed to contain that value.
-  ValueType* mutable_value(const Eigen::Array3i& index) {
+  // necessary a new wrapped grid is constructed in 'pool' to contain that
+  // value.
+  ValueType* mutable_value(const Eigen::Array3i& index, Pool* const pool) {
     const Eigen::Array3i meta_index = GetMetaIndex(index);
-    std::unique_ptr<WrappedGrid>& meta_cell =
-        meta_cells_[ToFlatIndex(meta_index, kBits)];
-    if (meta_cell == nullptr) {
-      meta_cell = common::make_unique<WrappedGrid>();
+    int32 pool_index = meta_cells_[ToFlatIndex(meta_index, kBits)];
+    if (pool_index == kUnallocated) {
+      pool_index = AddWrappedGrid(meta_index, pool);
     }
     const Eigen::Array3i inner_index =
         index - meta_index * WrappedGrid::grid_size();
-    return meta_cell->mutable_value(inner_index);
+    return (*pool)[pool_index].mutable_value(inner_index);
   }
 
-  // An iterator for iterating over all values not comparing equal to the
-  // default constructed value.
-  class Iterator {
-   public:
-    Iterator() : current_(nullptr), end_(nullptr), nested_iterator_() {}
-
-    explicit Iterator(const NestedGrid& nested_grid)
-        : current_(nested_grid.meta_cells_.data()),
-          end_(nested_grid.meta_cells_.data() + nested_grid.meta_cells_.size()),
-          nested_iterator_() {
-      AdvanceToValidNestedIterator();
-    }
-
-    void Next() {
-      DCHECK(!Done());
-      nested_iterator_.Next();
-      if (!nested_iterator_.Done()) {
-        return;
-      }
-      ++current_;
-      AdvanceToValidNestedIterator();
-    }
-
-    bool Done() const { return current_ == end_; }
-
-    Eigen::Array3i GetCellIndex() const {
-      DCHECK(!Done());
-      const int index = (1 << (3 * kBits)) - (end_ - current_);
-      return To3DIndex(index, kBits) * WrappedGrid::grid_size() +
-             nested_iterator_.GetCellIndex();
-    }
-
-    const ValueType& GetValue() const {
-      DCHECK(!Done());
-      return nested_iterator_.GetValue();
-    }
-
-   private:
-    void AdvanceToValidNestedIterator() {
-      for (; !Done(); ++current_) {
-        if (*current_ != nullptr) {
-          nested_iterator_ = typename WrappedGrid::Iterator(**current_);
-          if (!nested_iterator_.Done()) {
-            break;
-          }
-        }
-      }
-    }
-
-    const std::unique_ptr<WrappedGrid>* current_;
-    const std::unique_ptr<WrappedGrid>* end_;
-    typename WrappedGrid::Iterator nested_iterator_;
-  };
-
  private:
+  static constexpr int32 kUnallocated = -1;
+
   // Returns the Eigen::Array3i (meta) index of the meta cell containing
   // 'index'.
   Eigen::Array3i GetMetaIndex(const Eigen::Array3i& index) const {
@@ -240,19 +273,40 @@ class NestedGrid {
     return meta_index;
   }
 
-  std::array<std::unique_ptr<WrappedGrid>, 1 << (3 * kBits)> meta_cells_;
+  // Constructs the wrapped grid at 'meta_index' in 'pool' and returns its
+  // index in 'pool'.
+  int32 AddWrappedGrid(const Eigen::Array3i& meta_index, Pool* pool);
+
+  Eigen::Array3i origin_;
+  std::array<int32, 1 << (3 * kBits)> meta_cells_;
 };
 
+template <typename WrappedGrid, int kBits>
+constexpr int32 NestedGrid<WrappedGrid, kBits>::kUnallocated;
+
+// Defined outside of the class, so that it is not inlined into the lookups.
+template <typename WrappedGrid, int kBits>
+int32 NestedGrid<WrappedGrid, kBits>::AddWrappedGrid(
+    const Eigen::Array3i& meta_index, Pool* const pool) {
+  int32& pool_index = meta_cells_[ToFlatIndex(meta_index, kBits)];
+  DCHECK_EQ(pool_index, kUnallocated);
+  pool_index = pool->Add(origin_ + meta_index * WrappedGrid::grid_size());
+  return pool_index;
+}
+
 // A grid consisting of 2x2x2 grids of type 'WrappedGrid' initially. Wrapped
 // grids are constructed on first access via 'mutable_value()'. If necessary,
 // the grid grows to twice the size in each dimension. The range of indices is
 // (almost) symmetric around the origin, i.e. negative indices are allowed.
+//
+// The grids wrapped by all 'WrappedGrid's are kept in a single pool, so that
+// they are freed together and iteration is linear over the pool.
 template <typename WrappedGrid>
 class DynamicGrid {
  public:
   using ValueType = typename WrappedGrid::ValueType;
 
-  DynamicGrid() : bits_(1), meta_cells_(8) {}
+  DynamicGrid() : bits_(1), meta_cells_(8, kUnallocated) {}
   DynamicGrid(DynamicGrid&&) = default;
   DynamicGrid& operator=(DynamicGrid&&) = default;
 
@@ -268,14 +322,14 @@ class DynamicGrid {
       return ValueType();
     }
     const Eigen::Array3i meta_index = GetMetaIndex(shifted_index);
-    const WrappedGrid* const meta_cell =
-        meta_cells_[ToFlatIndex(meta_index, bits_)].get();
-    if (meta_cell == nullptr) {
+    const int32 wrapped_grid_index =
+        meta_cells_[ToFlatIndex(meta_index, bits_)];
+    if (wrapped_grid_index == kUnallocated) {
       return ValueType();
     }
     const Eigen::Array3i inner_index =
         shifted_index - meta_index * WrappedGrid::grid_size();
-    return meta_cell->value(inner_index);
+    return wrapped_grids_[wrapped_grid_index].value(pool_, inner_index);
   }
 
   // Returns a pointer to the value at 'index' to allow changing it, dynamically
@@ -289,25 +343,27 @@ class DynamicGrid {
       return mutable_value(index);
     }
     const Eigen::Array3i meta_index = GetMetaIndex(shifted_index);
-    std::unique_ptr<WrappedGrid>& meta_cell =
-        meta_cells_[ToFlatIndex(meta_index, bits_)];
-    if (meta_cell == nullptr) {
-      meta_cell = common::make_unique<WrappedGrid>();
-    }
     const Eigen::Array3i inner_index =
         shifted_index - meta_index * WrappedGrid::grid_size();
-    return meta_cell->mutable_value(inner_index);
+    int32 wrapped_grid_index = meta_cells_[ToFlatIndex(meta_index, bits_)];
+    if (wrapped_grid_index == kUnallocated) {
+      // The origin is given in unshifted indices, which do not change in
+      // Grow().
+      wrapped_grid_index = AddWrappedGrid(meta_index, index - inner_index);
+    }
+    return wrapped_grids_[wrapped_grid_index].mutable_value(inner_index,
+                                                            &pool_);
   }
 
   // An iterator for iterating over all values not comparing equal to the
-  // default constructed value.
+  // default constructed value. The innermost grids are visited in the order
+  // they were constructed, i.e. their cells were first accessed.
   class Iterator {
    public:
     explicit Iterator(const DynamicGrid& dynamic_grid)
-        : bits_(dynamic_grid.bits_),
-          current_(dynamic_grid.meta_cells_.data()),
-          end_(dynamic_grid.meta_cells_.data() +
-               dynamic_grid.meta_cells_.size()),
+        : pool_(&dynamic_grid.pool_),
+          current_(0),
+          end_(dynamic_grid.pool_.size()),
           nested_iterator_() {
       AdvanceToValidNestedIterator();
     }
@@ -326,11 +382,7 @@ class DynamicGrid {
 
     Eigen::Array3i GetCellIndex() const {
       DCHECK(!Done());
-      const int outer_index = (1 << (3 * bits_)) - (end_ - current_);
-      const Eigen::Array3i shifted_index =
-          To3DIndex(outer_index, bits_) * WrappedGrid::grid_size() +
-          nested_iterator_.GetCellIndex();
-      return shifted_index - ((1 << (bits_ - 1)) * WrappedGrid::grid_size());
+      return pool_->origin(current_) + nested_iterator_.GetCellIndex();
     }
 
     const ValueType& GetValue() const {
@@ -354,24 +406,27 @@ class DynamicGrid {
     }
 
    private:
+    using Pool = typename WrappedGrid::Pool;
+
     void AdvanceToValidNestedIterator() {
       for (; !Done(); ++current_) {
-        if (*current_ != nullptr) {
-          nested_iterator_ = typename WrappedGrid::Iterator(**current_);
-          if (!nested_iterator_.Done()) {
-            break;
-          }
+        nested_iterator_ =
+            typename Pool::GridType::Iterator((*pool_)[current_]);
+        if (!nested_iterator_.Done()) {
+          break;
         }
       }
     }
 
-    int bits_;
-    const std::unique_ptr<WrappedGrid>* current_;
-    const std::unique_ptr<WrappedGrid>* const end_;
-    typename WrappedGrid::Iterator nested_iterator_;
+    const Pool* pool_;
+    int current_;
+    int end_;
+    typename Pool::GridType::Iterator nested_iterator_;
   };
 
  private:
+  static constexpr int32 kUnallocated = -1;
+
   // Returns the Eigen::Array3i (meta) index of the meta cell containing
   // 'index'.
   Eigen::Array3i GetMetaIndex(const Eigen::Array3i& index) const {
@@ -381,31 +436,52 @@ class DynamicGrid {
     return meta_index;
   }
 
-  // Grows this grid by a factor of 2 in each of the 3 dimensions.
+  // Constructs the wrapped grid at 'meta_index' with its first cell at index
+  // 'origin' and returns its index in 'wrapped_grids_'.
+  int32 AddWrappedGrid(const Eigen::Array3i& meta_index,
+                       const Eigen::Array3i& origin);
+
+  // Grows this grid by a factor of 2 in each of the 3 dimensions. Only the
+  // indices of the wrapped grids are moved.
   void Grow() {
     const int new_bits = bits_ + 1;
     CHECK_LE(new_bits, 8);
-    std::vector<std::unique_ptr<WrappedGrid>> new_meta_cells_(
-        8 * meta_cells_.size());
+    std::vector<int32> new_meta_cells(8 * meta_cells_.size(), kUnallocated);
     for (int z = 0; z != (1 << bits_); ++z) {
       for (int y = 0; y != (1 << bits_); ++y) {
         for (int x = 0; x != (1 << bits_); ++x) {
           const Eigen::Array3i original_meta_index(x, y, z);
           const Eigen::Array3i new_meta_index =
               original_meta_index + (1 << (bits_ - 1));
-          new_meta_cells_[ToFlatIndex(new_meta_index, new_bits)] =
-              std::move(meta_cells_[ToFlatIndex(original_meta_index, bits_)]);
+          new_meta_cells[ToFlatIndex(new_meta_index, new_bits)] =
+              meta_cells_[ToFlatIndex(original_meta_index, bits_)];
         }
       }
     }
-    meta_cells_ = std::move(new_meta_cells_);
+    meta_cells_ = std::move(new_meta_cells);
     bits_ = new_bits;
   }
 
   int bits_;
-  std::vector<std::unique_ptr<WrappedGrid>> meta_cells_;
+  // Indices into 'wrapped_grids_' or 'kUnallocated'.
+  std::vector<int32> meta_cells_;
+  std::vector<WrappedGrid> wrapped_grids_;
+  typename WrappedGrid::Pool pool_;
 };
 
+template <typename WrappedGrid>
+constexpr int32 DynamicGrid<WrappedGrid>::kUnallocated;
+
+template <typename WrappedGrid>
+int32 DynamicGrid<WrappedGrid>::AddWrappedGrid(const Eigen::Array3i& meta_index,
+                                               const Eigen::Array3i& origin) {
+  int32& wrapped_grid_index = meta_cells_[ToFlatIndex(meta_index, bits_)];
+  DCHECK_EQ(wrapped_grid_index, kUnallocated);
+  wrapped_grid_index = wrapped_grids_.size();
+  wrapped_grids_.emplace_back(origin);
+  return wrapped_grid_index;
+}
+
 template <typename ValueType>
 using Grid = DynamicGrid<NestedGrid<FlatGrid<ValueType, 3>, 3>>;
 
@@ -427,9 +503,17 @@ class HybridGridBase : public Grid<ValueType> {
   // multiple of the resolution.
   Eigen::Array3i GetCellIndex(const Eigen::Vector3f& point) const {
     Eigen::Array3f index = point.array() / resolution_;
-    return Eigen::Array3i(common::RoundToInt(index.x()),
-                          common::RoundToInt(index.y()),
-                          common::RoundToInt(index.z()));
+    return Eigen::Array3i(common::FastRoundToInt(index.x()),
+                          common::FastRoundToInt(index.y()),
+                          common::FastRoundToInt(index.z()));
+  }
+
+  // Like GetCellIndex() for each of the 'points', but vectorized if the CPU
+  // supports it.
+  void GetCellIndices(const std::vector<Eigen::Vector3f>& points,
+                      std::vector<Eigen::Array3i>* const cell_indices) const {
+    ComputeCellIndices(GetFastestSupportedCellIndexKernel(), points,
+                       resolution_, cell_indices);
   }
 
   // Returns one of the octants, (0, 0, 0), (1, 0, 0), ..., (1, 1, 1).
@@ -513,6 +597,41 @@ class HybridGrid : public HybridGridBase<uint16> {
     return true;
   }
 
+  // Like ApplyLookupTable() for each of the 'indices' in order. Cells of the
+  // same 8x8x8 block are looked up only once if they follow each other in
+  // 'indices', which is usually the case for consecutive points of a scan.
+  void ApplyLookupTable(const std::vector<Eigen::Array3i>& indices,
+                        const std::vector<uint16>& table) {
+    DCHECK_EQ(table.size(), mapping::kUpdateMarker);
+    // The cells of a block are stored contiguously in z-major order.
+    constexpr int kBlockBits = 3;
+    constexpr int kBlockMask = (1 << kBlockBits) - 1;
+    static_assert(sizeof(FlatGrid<ValueType, kBlockBits>) ==
+                      sizeof(ValueType) << (3 * kBlockBits),
+                  "Cells of a block are not contiguous.");
+    Eigen::Array3i block_corner = Eigen::Array3i::Zero();
+    ValueType* block = nullptr;
+    for (const Eigen::Array3i& index : indices) {
+      const Eigen::Array3i corner(index.x() & ~kBlockMask,
+                                  index.y() & ~kBlockMask,
+                                  index.z() & ~kBlockMask);
+      if (block == nullptr || (corner != block_corner).any()) {
+        // Blocks are never moved, so pointers into them stay valid even if
+        // looking up the next block grows the grid.
+        block = mutable_value(corner);
+        block_corner = corner;
+      }
+      uint16* const cell =
+          block + ToFlatIndex(index - block_corner, kBlockBits);
+      if (*cell >= mapping::kUpdateMarker) {
+        continue;
+      }
+      update_indices_.push_back(cell);
+      *cell = table[*cell];
+      DCHECK_GE(*cell, mapping::kUpdateMarker);
+    }
+  }
+
   // Returns the probability of the cell with 'index'.
   float GetProbability(const Eigen::Array3i& index) const {
     return mapping::ValueToProbability(value(index));
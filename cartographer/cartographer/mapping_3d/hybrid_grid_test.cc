@@ -19,6 +19,7 @@
 #include <map>
 #include <random>
 #include <tuple>
+#include <vector>
 
 #include "gmock/gmock.h"
 
@@ -72,6 +73,31 @@ TEST(HybridGridTest, ApplyOdds) {
   EXPECT_GT(hybrid_grid.GetProbability(Eigen::Array3i(1, 1, 1)), 0.42f);
 }
 
+TEST(HybridGridTest, ApplyLookupTableToIndices) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> index_distribution(-20, 20);
+  std::vector<Eigen::Array3i> indices;
+  for (int i = 0; i != 1000; ++i) {
+    indices.emplace_back(index_distribution(rng), index_distribution(rng),
+                         index_distribution(rng) / 4);
+  }
+  const std::vector<uint16> table =
+      mapping::ComputeLookupTableToApplyOdds(mapping::Odds(0.7f));
+  HybridGrid expected_grid(1.f);
+  HybridGrid hybrid_grid(1.f);
+  for (int i = 0; i != 2; ++i) {
+    for (const Eigen::Array3i& index : indices) {
+      expected_grid.ApplyLookupTable(index, table);
+    }
+    expected_grid.FinishUpdate();
+    hybrid_grid.ApplyLookupTable(indices, table);
+    hybrid_grid.FinishUpdate();
+  }
+  for (const Eigen::Array3i& index : indices) {
+    EXPECT_EQ(expected_grid.value(index), hybrid_grid.value(index));
+  }
+}
+
 TEST(HybridGridTest, GetProbability) {
   HybridGrid hybrid_grid(1.f);
 
@@ -125,6 +151,44 @@ TEST(HybridGridTest, GetCenterOfCell) {
   EXPECT_THAT(hybrid_grid.GetCellIndex(center), AllCwiseEqual(index));
 }
 
+TEST(HybridGridTest, PointersToValuesStayValid) {
+  HybridGridBase<uint16> hybrid_grid(1.f);
+  std::vector<uint16*> values;
+  // Touch more than one chunk of the pool in several nested grids, growing the
+  // grid in between.
+  for (int i = 0; i != 2000; ++i) {
+    const Eigen::Array3i index(8 * (i % 100) - 400, 8 * (i / 100) - 80,
+                               i % 3);
+    values.push_back(hybrid_grid.mutable_value(index));
+    *values.back() = i + 1;
+  }
+  for (int i = 0; i != 2000; ++i) {
+    const Eigen::Array3i index(8 * (i % 100) - 400, 8 * (i / 100) - 80,
+                               i % 3);
+    EXPECT_EQ(i + 1, *values[i]);
+    EXPECT_EQ(i + 1, hybrid_grid.value(index));
+  }
+}
+
+TEST(HybridGridTest, MovedGridKeepsValues) {
+  HybridGridBase<std::vector<int>> hybrid_grid(1.f);
+  for (int i = 0; i != 200; ++i) {
+    hybrid_grid.mutable_value(Eigen::Array3i(10 * i - 1000, i, -i))
+        ->push_back(i);
+  }
+  const HybridGridBase<std::vector<int>> moved_grid(std::move(hybrid_grid));
+  int num_cells = 0;
+  for (HybridGridBase<std::vector<int>>::Iterator it(moved_grid); !it.Done();
+       it.Next()) {
+    ASSERT_EQ(1, it.GetValue().size());
+    const int i = it.GetValue().front();
+    EXPECT_THAT(it.GetCellIndex(),
+                AllCwiseEqual(Eigen::Array3i(10 * i - 1000, i, -i)));
+    ++num_cells;
+  }
+  EXPECT_EQ(200, num_cells);
+}
+
 class RandomHybridGridTest : public ::testing::Test {
  public:
   RandomHybridGridTest() : hybrid_grid_(2.f), values_() {
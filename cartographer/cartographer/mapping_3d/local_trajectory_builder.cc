@@ -17,6 +17,7 @@
 #include "cartographer/mapping_3d/local_trajectory_builder.h"
 
 #include "cartographer/common/make_unique.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/common/time.h"
 #include "cartographer/mapping_2d/scan_matching/proto/real_time_correlative_scan_matcher_options.pb.h"
 #include "cartographer/mapping_3d/proto/local_trajectory_builder_options.pb.h"
@@ -130,6 +131,11 @@ void LocalTrajectoryBuilder::Predict(const common::Time time) {
 std::unique_ptr<LocalTrajectoryBuilder::InsertionResult>
 LocalTrajectoryBuilder::AddAccumulatedRangeData(
     const common::Time time, const sensor::RangeData& range_data_in_tracking) {
+  static common::HistogramMetric* const accumulated_range_data_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "local_trajectory_builder_3d_accumulated_range_data_seconds",
+          "Time to match and insert accumulated range data.");
+  common::ScopedLatency latency(accumulated_range_data_metric);
   const sensor::RangeData filtered_range_data = {
       range_data_in_tracking.origin,
       sensor::VoxelFiltered(range_data_in_tracking.returns,
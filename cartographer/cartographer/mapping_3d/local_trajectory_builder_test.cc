@@ -70,6 +70,8 @@ class LocalTrajectoryBuilderTest : public ::testing::Test {
             angular_search_window = math.rad(1.),
             translation_delta_cost_weight = 1e-1,
             rotation_delta_cost_weight = 1.,
+            multi_resolution_depth = 1,
+            multi_resolution_num_greedy_candidates = 0,
           },
 
           ceres_scan_matcher = {
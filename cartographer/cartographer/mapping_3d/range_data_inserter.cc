@@ -16,6 +16,9 @@
 
 #include "cartographer/mapping_3d/range_data_inserter.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "Eigen/Core"
 #include "cartographer/mapping/probability_values.h"
 #include "glog/logging.h"
@@ -27,13 +30,13 @@ namespace {
 
 void InsertMissesIntoGrid(const std::vector<uint16>& miss_table,
                           const Eigen::Vector3f& origin,
-                          const sensor::PointCloud& returns,
+                          const std::vector<Eigen::Array3i>& hit_cells,
                           HybridGrid* hybrid_grid,
                           const int num_free_space_voxels) {
   const Eigen::Array3i origin_cell = hybrid_grid->GetCellIndex(origin);
-  for (const Eigen::Vector3f& hit : returns) {
-    const Eigen::Array3i hit_cell = hybrid_grid->GetCellIndex(hit);
-
+  std::vector<Eigen::Array3i> miss_cells;
+  miss_cells.reserve(hit_cells.size() * std::max(0, num_free_space_voxels));
+  for (const Eigen::Array3i& hit_cell : hit_cells) {
     const Eigen::Array3i delta = hit_cell - origin_cell;
     const int num_samples = delta.cwiseAbs().maxCoeff();
     CHECK_LT(num_samples, 1 << 15);
@@ -43,13 +46,28 @@ void InsertMissesIntoGrid(const std::vector<uint16>& miss_table,
     // to the next on the fastest changing dimension.
     //
     // Only the last 'num_free_space_voxels' are updated for performance.
-    for (int position = std::max(0, num_samples - num_free_space_voxels);
-         position < num_samples; ++position) {
-      const Eigen::Array3i miss_cell =
-          origin_cell + delta * position / num_samples;
-      hybrid_grid->ApplyLookupTable(miss_cell, miss_table);
+    const int first_position = std::max(0, num_samples - num_free_space_voxels);
+    if (first_position >= num_samples) {
+      continue;
+    }
+    // Sample 'position' is at 'origin_cell + delta * position / num_samples',
+    // rounded towards zero. Instead of dividing for each sample, we keep the
+    // quotient and remainder of 'abs_delta * position / num_samples' and
+    // carry over when stepping to the next sample.
+    const Eigen::Array3i sign = delta.sign();
+    const Eigen::Array3i abs_delta = delta.abs();
+    Eigen::Array3i quotient = abs_delta * first_position / num_samples;
+    Eigen::Array3i remainder =
+        abs_delta * first_position - quotient * num_samples;
+    for (int position = first_position; position < num_samples; ++position) {
+      miss_cells.push_back(origin_cell + sign * quotient);
+      remainder += abs_delta;
+      const Eigen::Array3i carry = (remainder >= num_samples).cast<int>();
+      quotient += carry;
+      remainder -= carry * num_samples;
     }
   }
+  hybrid_grid->ApplyLookupTable(miss_cells, miss_table);
 }
 
 }  // namespace
@@ -80,15 +98,14 @@ void RangeDataInserter::Insert(const sensor::RangeData& range_data,
                                HybridGrid* hybrid_grid) const {
   CHECK_NOTNULL(hybrid_grid);
 
-  for (const Eigen::Vector3f& hit : range_data.returns) {
-    const Eigen::Array3i hit_cell = hybrid_grid->GetCellIndex(hit);
-    hybrid_grid->ApplyLookupTable(hit_cell, hit_table_);
-  }
+  std::vector<Eigen::Array3i> hit_cells;
+  hybrid_grid->GetCellIndices(range_data.returns, &hit_cells);
+  hybrid_grid->ApplyLookupTable(hit_cells, hit_table_);
 
   // By not starting a new update after hits are inserted, we give hits priority
   // (i.e. no hits will be ignored because of a miss in the same cell).
-  InsertMissesIntoGrid(miss_table_, range_data.origin, range_data.returns,
-                       hybrid_grid, options_.num_free_space_voxels());
+  InsertMissesIntoGrid(miss_table_, range_data.origin, hit_cells, hybrid_grid,
+                       options_.num_free_space_voxels());
   hybrid_grid->FinishUpdate();
 }
 
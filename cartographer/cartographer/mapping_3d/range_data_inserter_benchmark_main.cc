@@ -0,0 +1,151 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the insertion of range data into the high and low resolution
+// HybridGrids of 3D submaps. Scans of a box shaped room are simulated for a
+// 32 ring lidar from poses along a circle.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "cartographer/common/port.h"
+#include "cartographer/mapping_3d/hybrid_grid.h"
+#include "cartographer/mapping_3d/range_data_inserter.h"
+#include "cartographer/sensor/range_data.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_int32(num_rings, 32, "Number of rings of the simulated lidar.");
+DEFINE_int32(num_beams_per_ring, 1800, "Number of beams per ring.");
+DEFINE_double(room_size, 60., "Side length of the simulated room in meters.");
+DEFINE_double(room_height, 8., "Height of the simulated room in meters.");
+DEFINE_double(high_resolution, 0.1, "Resolution of the high resolution grid.");
+DEFINE_double(high_resolution_max_range, 20.,
+              "Maximum range of points inserted into the high resolution "
+              "grid.");
+DEFINE_double(low_resolution, 0.45, "Resolution of the low resolution grid.");
+DEFINE_int32(num_scans, 50, "Number of scans inserted.");
+
+namespace cartographer {
+namespace mapping_3d {
+namespace {
+
+// The defaults of 'trajectory_builder_3d.lua'.
+proto::RangeDataInserterOptions CreateRangeDataInserterOptions() {
+  proto::RangeDataInserterOptions options;
+  options.set_hit_probability(0.55);
+  options.set_miss_probability(0.49);
+  options.set_num_free_space_voxels(2);
+  return options;
+}
+
+sensor::RangeData SimulateScan(const Eigen::Vector3f& origin) {
+  const Eigen::Array3f half_size(FLAGS_room_size / 2., FLAGS_room_size / 2.,
+                                 FLAGS_room_height / 2.);
+  sensor::RangeData range_data{origin, {}, {}};
+  for (int ring = 0; ring != FLAGS_num_rings; ++ring) {
+    // Elevations between -25 and +15 degrees as for a VLP-32.
+    const float elevation =
+        (-25.f + 40.f * ring / std::max(1, FLAGS_num_rings - 1)) *
+        static_cast<float>(M_PI) / 180.f;
+    for (int i = 0; i != FLAGS_num_beams_per_ring; ++i) {
+      const float azimuth = 2. * M_PI * i / FLAGS_num_beams_per_ring;
+      const Eigen::Vector3f direction(std::cos(elevation) * std::cos(azimuth),
+                                      std::cos(elevation) * std::sin(azimuth),
+                                      std::sin(elevation));
+      // Distance to the closest wall, floor or ceiling along 'direction'.
+      float range = std::numeric_limits<float>::infinity();
+      for (int axis = 0; axis != 3; ++axis) {
+        if (direction[axis] != 0.f) {
+          const float wall =
+              direction[axis] > 0.f ? half_size[axis] : -half_size[axis];
+          range = std::min(range, (wall - origin[axis]) / direction[axis]);
+        }
+      }
+      range_data.returns.push_back(origin + range * direction);
+    }
+  }
+  return range_data;
+}
+
+sensor::RangeData CropRangeData(const sensor::RangeData& range_data,
+                                const float max_range) {
+  sensor::RangeData result{range_data.origin, {}, {}};
+  for (const Eigen::Vector3f& hit : range_data.returns) {
+    if ((hit - range_data.origin).norm() <= max_range) {
+      result.returns.push_back(hit);
+    }
+  }
+  return result;
+}
+
+void Benchmark(const std::string& name, const float resolution,
+               const std::vector<sensor::RangeData>& scans) {
+  const RangeDataInserter range_data_inserter(
+      CreateRangeDataInserterOptions());
+  HybridGrid hybrid_grid(resolution);
+  int64 num_points = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const sensor::RangeData& range_data : scans) {
+    range_data_inserter.Insert(range_data, &hybrid_grid);
+    num_points += range_data.returns.size();
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << name << ": " << std::fixed << std::setprecision(6)
+            << seconds / scans.size() << " s per scan, "
+            << std::setprecision(3) << num_points / seconds / 1e6
+            << " million points per second\n";
+}
+
+void Run() {
+  std::vector<sensor::RangeData> scans;
+  std::vector<sensor::RangeData> cropped_scans;
+  for (int i = 0; i != FLAGS_num_scans; ++i) {
+    const float angle = 2. * M_PI * i / FLAGS_num_scans;
+    scans.push_back(SimulateScan(
+        0.25f * FLAGS_room_size *
+        Eigen::Vector3f(std::cos(angle), std::sin(angle), 0.f)));
+    cropped_scans.push_back(
+        CropRangeData(scans.back(), FLAGS_high_resolution_max_range));
+  }
+  Benchmark("High resolution", FLAGS_high_resolution, cropped_scans);
+  Benchmark("Low resolution", FLAGS_low_resolution, scans);
+}
+
+}  // namespace
+}  // namespace mapping_3d
+}  // namespace cartographer
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  google::SetUsageMessage(
+      "\n\n"
+      "Benchmarks the insertion of simulated 3D range data into the high and\n"
+      "low resolution hybrid grids.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_GT(FLAGS_num_rings, 0);
+  CHECK_GT(FLAGS_num_beams_per_ring, 0);
+  CHECK_GT(FLAGS_num_scans, 0);
+  ::cartographer::mapping_3d::Run();
+}
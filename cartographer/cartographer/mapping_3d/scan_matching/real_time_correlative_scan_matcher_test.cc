@@ -55,6 +55,8 @@ class RealTimeCorrelativeScanMatcherTest : public ::testing::Test {
           angular_search_window = math.rad(1.),
           translation_delta_cost_weight = 1e-1,
           rotation_delta_cost_weight = 1.,
+          multi_resolution_depth = 1,
+          multi_resolution_num_greedy_candidates = 0,
         })text");
     real_time_correlative_scan_matcher_.reset(
         new RealTimeCorrelativeScanMatcher(
@@ -30,6 +30,7 @@
 #include "Eigen/Eigenvalues"
 #include "cartographer/common/make_unique.h"
 #include "cartographer/common/math.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/mapping/sparse_pose_graph/proto/constraint_builder_options.pb.h"
 #include "cartographer/sensor/compressed_point_cloud.h"
 #include "cartographer/sensor/voxel_filter.h"
@@ -38,13 +39,27 @@
 namespace cartographer {
 namespace mapping_3d {
 
+namespace {
+
+// Spatial index cells match the distance within which constraints are
+// searched for.
+double SpatialIndexCellSize(
+    const mapping::proto::SparsePoseGraphOptions& options) {
+  return std::max(1., options.constraint_builder_options()
+                          .max_constraint_distance());
+}
+
+}  // namespace
+
 SparsePoseGraph::SparsePoseGraph(
     const mapping::proto::SparsePoseGraphOptions& options,
     common::ThreadPool* thread_pool)
     : options_(options),
       optimization_problem_(options_.optimization_problem_options(),
                             sparse_pose_graph::OptimizationProblem::FixZ::kNo),
-      constraint_builder_(options_.constraint_builder_options(), thread_pool) {}
+      constraint_builder_(options_.constraint_builder_options(), thread_pool),
+      submap_index_(SpatialIndexCellSize(options_)),
+      node_index_(SpatialIndexCellSize(options_)) {}
 
 SparsePoseGraph::~SparsePoseGraph() {
   WaitForAllComputations();
@@ -63,6 +78,8 @@ std::vector<mapping::SubmapId> SparsePoseGraph::GrowSubmapTransformsAsNeeded(
         submap_data[trajectory_id].empty()) {
       optimization_problem_.AddSubmap(trajectory_id,
                                       insertion_submaps[0]->local_pose());
+      submap_index_.Insert(mapping::SubmapId{trajectory_id, 0},
+                           insertion_submaps[0]->local_pose().translation());
     }
     const mapping::SubmapId submap_id{
         trajectory_id, static_cast<int>(submap_data[trajectory_id].size()) - 1};
@@ -78,12 +95,14 @@ std::vector<mapping::SubmapId> SparsePoseGraph::GrowSubmapTransformsAsNeeded(
     // and 'insertions_submaps.back()' is new.
     const auto& first_submap_pose =
         submap_data.at(trajectory_id).at(last_submap_id.submap_index).pose;
-    optimization_problem_.AddSubmap(
-        trajectory_id, first_submap_pose *
-                           insertion_submaps[0]->local_pose().inverse() *
-                           insertion_submaps[1]->local_pose());
-    return {last_submap_id,
-            mapping::SubmapId{trajectory_id, last_submap_id.submap_index + 1}};
+    const transform::Rigid3d submap_pose =
+        first_submap_pose * insertion_submaps[0]->local_pose().inverse() *
+        insertion_submaps[1]->local_pose();
+    optimization_problem_.AddSubmap(trajectory_id, submap_pose);
+    const mapping::SubmapId new_submap_id{trajectory_id,
+                                          last_submap_id.submap_index + 1};
+    submap_index_.Insert(new_submap_id, submap_pose.translation());
+    return {last_submap_id, new_submap_id};
   }
   CHECK(submap_data_.at(last_submap_id).submap == insertion_submaps.back());
   const mapping::SubmapId front_submap_id{trajectory_id,
@@ -222,8 +241,26 @@ void SparsePoseGraph::ComputeConstraintsForOldScans(
     const mapping::SubmapId& submap_id) {
   const auto& submap_data = submap_data_.at(submap_id);
   const auto& node_data = optimization_problem_.node_data();
+  // Nodes of other trajectories might be matched globally, so all of them are
+  // considered. Within the trajectory, only nearby nodes are.
+  const std::vector<mapping::NodeId> nearby_node_ids =
+      node_index_.GetCandidates(
+          submap_id.trajectory_id,
+          optimization_problem_.submap_data()
+              .at(submap_id.trajectory_id)
+              .at(submap_id.submap_index)
+              .pose.translation(),
+          options_.constraint_builder_options().max_constraint_distance());
   for (size_t trajectory_id = 0; trajectory_id != node_data.size();
        ++trajectory_id) {
+    if (static_cast<int>(trajectory_id) == submap_id.trajectory_id) {
+      for (const mapping::NodeId& node_id : nearby_node_ids) {
+        if (submap_data.node_ids.count(node_id) == 0) {
+          ComputeConstraint(node_id, submap_id);
+        }
+      }
+      continue;
+    }
     for (size_t node_index = 0; node_index != node_data[trajectory_id].size();
          ++node_index) {
       const mapping::NodeId node_id{static_cast<int>(trajectory_id),
@@ -260,6 +297,7 @@ void SparsePoseGraph::ComputeConstraintsForScan(
   const auto& scan_data = trajectory_nodes_.at(node_id).constant_data;
   optimization_problem_.AddTrajectoryNode(matching_id.trajectory_id,
                                           scan_data->time, optimized_pose);
+  node_index_.Insert(node_id, optimized_pose.translation());
   for (size_t i = 0; i < insertion_submaps.size(); ++i) {
     const mapping::SubmapId submap_id = submap_ids[i];
     // Even if this was the last scan added to 'submap_id', the submap will only
@@ -276,8 +314,23 @@ void SparsePoseGraph::ComputeConstraintsForScan(
                    Constraint::INTRA_SUBMAP});
   }
 
+  // Submaps of other trajectories might be matched globally, so all of them
+  // are considered. Within the trajectory, only nearby submaps are.
+  const std::vector<mapping::SubmapId> nearby_submap_ids =
+      submap_index_.GetCandidates(
+          node_id.trajectory_id, optimized_pose.translation(),
+          options_.constraint_builder_options().max_constraint_distance());
   for (int trajectory_id = 0; trajectory_id < submap_data_.num_trajectories();
        ++trajectory_id) {
+    if (trajectory_id == node_id.trajectory_id) {
+      for (const mapping::SubmapId& submap_id : nearby_submap_ids) {
+        if (submap_data_.at(submap_id).state == SubmapState::kFinished) {
+          CHECK_EQ(submap_data_.at(submap_id).node_ids.count(node_id), 0);
+          ComputeConstraint(node_id, submap_id);
+        }
+      }
+      continue;
+    }
     for (int submap_index = 0;
          submap_index < submap_data_.num_indices(trajectory_id);
          ++submap_index) {
@@ -381,9 +434,14 @@ void SparsePoseGraph::RunFinalOptimization() {
 }
 
 void SparsePoseGraph::RunOptimization() {
+  static common::HistogramMetric* const optimization_metric =
+      common::MetricsRegistry::Global()->GetHistogram(
+          "sparse_pose_graph_3d_optimization_seconds",
+          "Time to solve the 3D optimization problem and update the poses.");
   if (optimization_problem_.submap_data().empty()) {
     return;
   }
+  common::ScopedLatency latency(optimization_metric);
   optimization_problem_.Solve(constraints_);
   common::MutexLocker locker(&mutex_);
 
@@ -419,6 +477,40 @@ void SparsePoseGraph::RunOptimization() {
       reverse_connected_components_.emplace(trajectory_id, i);
     }
   }
+  RebuildSpatialIndices();
+  UpdateSnapshot();
+}
+
+void SparsePoseGraph::UpdateSnapshot() {
+  PublishSnapshot(trajectory_nodes_.data(), GetAllSubmapDataUnderLock(),
+                  constraints_);
+}
+
+void SparsePoseGraph::RebuildSpatialIndices() {
+  submap_index_.Clear();
+  const auto& submap_data = optimization_problem_.submap_data();
+  for (int trajectory_id = 0;
+       trajectory_id != static_cast<int>(submap_data.size()); ++trajectory_id) {
+    for (int submap_index = 0;
+         submap_index != static_cast<int>(submap_data[trajectory_id].size());
+         ++submap_index) {
+      submap_index_.Insert(
+          mapping::SubmapId{trajectory_id, submap_index},
+          submap_data[trajectory_id][submap_index].pose.translation());
+    }
+  }
+  node_index_.Clear();
+  const auto& node_data = optimization_problem_.node_data();
+  for (int trajectory_id = 0;
+       trajectory_id != static_cast<int>(node_data.size()); ++trajectory_id) {
+    for (int node_index = 0;
+         node_index != static_cast<int>(node_data[trajectory_id].size());
+         ++node_index) {
+      node_index_.Insert(
+          mapping::NodeId{trajectory_id, node_index},
+          node_data[trajectory_id][node_index].point_cloud_pose.translation());
+    }
+  }
 }
 
 std::vector<std::vector<mapping::TrajectoryNode>>
@@ -461,6 +553,11 @@ mapping::SparsePoseGraph::SubmapData SparsePoseGraph::GetSubmapData(
 std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
 SparsePoseGraph::GetAllSubmapData() {
   common::MutexLocker locker(&mutex_);
+  return GetAllSubmapDataUnderLock();
+}
+
+std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
+SparsePoseGraph::GetAllSubmapDataUnderLock() {
   std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
       all_submap_data(submap_data_.num_trajectories());
   for (int trajectory_id = 0; trajectory_id < submap_data_.num_trajectories();
@@ -32,6 +32,7 @@
 #include "cartographer/common/thread_pool.h"
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/sparse_pose_graph.h"
+#include "cartographer/mapping/sparse_pose_graph/spatial_index.h"
 #include "cartographer/mapping/trajectory_connectivity.h"
 #include "cartographer/mapping_3d/sparse_pose_graph/constraint_builder.h"
 #include "cartographer/mapping_3d/sparse_pose_graph/optimization_problem.h"
@@ -143,6 +144,15 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
   void ComputeConstraintsForOldScans(const mapping::SubmapId& submap_id)
       REQUIRES(mutex_);
 
+  // Rebuilds 'submap_index_' and 'node_index_' from the poses in the
+  // 'optimization_problem_'.
+  void RebuildSpatialIndices() REQUIRES(mutex_);
+
+  // Publishes the current trajectory nodes, submaps and constraints as a new
+  // snapshot for GetSnapshot(). This copies the whole graph, so it is only
+  // done after optimizations, not for each scan or submap.
+  void UpdateSnapshot() REQUIRES(mutex_);
+
   // Registers the callback to run the optimization once all constraints have
   // been computed, that will also do all work that queue up in 'scan_queue_'.
   void HandleScanQueue() REQUIRES(mutex_);
@@ -165,6 +175,9 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
   mapping::SparsePoseGraph::SubmapData GetSubmapDataUnderLock(
       const mapping::SubmapId& submap_id) REQUIRES(mutex_);
 
+  std::vector<std::vector<mapping::SparsePoseGraph::SubmapData>>
+  GetAllSubmapDataUnderLock() REQUIRES(mutex_);
+
   const mapping::proto::SparsePoseGraphOptions options_;
   common::Mutex mutex_;
 
@@ -189,6 +202,14 @@ class SparsePoseGraph : public mapping::SparsePoseGraph {
   // Current optimization problem.
   sparse_pose_graph::OptimizationProblem optimization_problem_;
   sparse_pose_graph::ConstraintBuilder constraint_builder_ GUARDED_BY(mutex_);
+
+  // Positions of the submaps and nodes in the 'optimization_problem_'. Pairs
+  // within a trajectory are only matched if close enough, so candidates for
+  // these are found here instead of looking at all submaps or nodes.
+  mapping::sparse_pose_graph::SpatialIndex<mapping::SubmapId> submap_index_
+      GUARDED_BY(mutex_);
+  mapping::sparse_pose_graph::SpatialIndex<mapping::NodeId> node_index_
+      GUARDED_BY(mutex_);
   std::vector<Constraint> constraints_ GUARDED_BY(mutex_);
 
   // Submaps get assigned an ID and state as soon as they are seen, even
@@ -117,7 +117,8 @@ void ConstraintBuilder::WhenDone(
   ++pending_computations_[current_computation_];
   const int current_computation = current_computation_;
   thread_pool_->Schedule(
-      [this, current_computation] { FinishComputation(current_computation); });
+      [this, current_computation] { FinishComputation(current_computation); },
+      common::ThreadPool::Priority::kHigh);
 }
 
 void ConstraintBuilder::ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
@@ -130,9 +131,13 @@ void ConstraintBuilder::ScheduleSubmapScanMatcherConstructionAndQueueWorkItem(
   } else {
     submap_queued_work_items_[submap_id].push_back(work_item);
     if (submap_queued_work_items_[submap_id].size() == 1) {
-      thread_pool_->Schedule([=]() {
-        ConstructSubmapScanMatcher(submap_id, submap_nodes, submap);
-      });
+      // Constructing the scan matcher unblocks all queued work items for this
+      // submap, so it must not wait behind other constraint searches.
+      thread_pool_->Schedule(
+          [=]() {
+            ConstructSubmapScanMatcher(submap_id, submap_nodes, submap);
+          },
+          common::ThreadPool::Priority::kHigh);
     }
   }
 }
@@ -285,6 +290,7 @@ void ConstraintBuilder::FinishComputation(const int computation_index) {
           LOG(INFO) << constraints_.size() << " computations resulted in "
                     << result.size() << " additional constraints.";
           LOG(INFO) << "Score histogram:\n" << score_histogram_.ToString(10);
+          LOG(INFO) << "Thread pool:\n" << thread_pool_->StatisticsToString();
           LOG(INFO) << "Rotational score histogram:\n"
                     << rotational_score_histogram_.ToString(10);
         }
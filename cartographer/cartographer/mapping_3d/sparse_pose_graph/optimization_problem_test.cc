@@ -47,6 +47,14 @@ class OptimizationProblemTest : public ::testing::Test {
           consecutive_scan_translation_penalty_factor = 1e-2,
           consecutive_scan_rotation_penalty_factor = 1e-2,
           log_solver_summary = true,
+          incremental = false,
+          local_window_num_hops = 0,
+          use_analytical_jacobians = false,
+          use_gps_data = false,
+          gps_translation_stddev = 3.,
+          gps_rtk_fixed_translation_stddev = 0.05,
+          gps_huber_scale = 1.,
+          gps_max_interpolation_gap = 1.,
           ceres_solver_options = {
             use_nonmonotonic_steps = false,
             max_num_iterations = 200,
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/sensor/data.h"
+
+#include <new>
+#include <vector>
+
+namespace cartographer {
+namespace sensor {
+
+namespace {
+
+// Largest number of free blocks kept per thread.
+constexpr size_t kMaxNumFreeBlocks = 1024;
+
+// Set once the free list of this thread has been destroyed. Data destroyed
+// afterwards, e.g. by static destructors, is deallocated directly.
+thread_local bool free_list_destroyed = false;
+
+// Memory blocks for Data which can be reused. Data destroyed on a different
+// thread than the one it was created on is recycled by the destroying thread.
+class FreeList {
+ public:
+  FreeList() { blocks_.reserve(kMaxNumFreeBlocks); }
+
+  ~FreeList() {
+    for (void* const block : blocks_) {
+      ::operator delete(block);
+    }
+    free_list_destroyed = true;
+  }
+
+  void* Allocate() {
+    if (blocks_.empty()) {
+      return ::operator new(sizeof(Data));
+    }
+    void* const block = blocks_.back();
+    blocks_.pop_back();
+    return block;
+  }
+
+  void Free(void* const block) {
+    if (blocks_.size() == kMaxNumFreeBlocks) {
+      ::operator delete(block);
+      return;
+    }
+    blocks_.push_back(block);
+  }
+
+ private:
+  std::vector<void*> blocks_;
+};
+
+thread_local FreeList free_list;
+
+}  // namespace
+
+Data::Data(const common::Time time, const Imu& imu)
+    : type(Type::kImu), time(time), imu_(imu) {}
+
+Data::Data(const common::Time time, const Rangefinder& rangefinder)
+    : type(Type::kRangefinder), time(time), rangefinder_(rangefinder) {}
+
+Data::Data(const common::Time time, const transform::Rigid3d& odometer_pose)
+    : type(Type::kOdometer), time(time), odometer_pose_(odometer_pose) {}
+
+Data::Data(const Data& other) : type(other.type), time(other.time) {
+  ConstructPayload(other);
+}
+
+Data& Data::operator=(const Data& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (type == other.type) {
+    switch (type) {
+      case Type::kImu:
+        imu_ = other.imu_;
+        break;
+      case Type::kRangefinder:
+        rangefinder_ = other.rangefinder_;
+        break;
+      case Type::kOdometer:
+        odometer_pose_ = other.odometer_pose_;
+        break;
+    }
+  } else {
+    DestroyPayload();
+    type = other.type;
+    ConstructPayload(other);
+  }
+  time = other.time;
+  return *this;
+}
+
+Data::~Data() { DestroyPayload(); }
+
+void* Data::operator new(const size_t size) {
+  if (size != sizeof(Data) || free_list_destroyed) {
+    return ::operator new(size);
+  }
+  return free_list.Allocate();
+}
+
+void Data::operator delete(void* const pointer) {
+  if (pointer == nullptr) {
+    return;
+  }
+  if (free_list_destroyed) {
+    ::operator delete(pointer);
+    return;
+  }
+  free_list.Free(pointer);
+}
+
+void Data::ConstructPayload(const Data& other) {
+  switch (other.type) {
+    case Type::kImu:
+      new (&imu_) Imu(other.imu_);
+      return;
+    case Type::kRangefinder:
+      new (&rangefinder_) Rangefinder(other.rangefinder_);
+      return;
+    case Type::kOdometer:
+      new (&odometer_pose_) transform::Rigid3d(other.odometer_pose_);
+      return;
+  }
+  LOG(FATAL) << "Unknown data type " << static_cast<int>(other.type);
+}
+
+void Data::DestroyPayload() {
+  switch (type) {
+    case Type::kImu:
+      imu_.~Imu();
+      return;
+    case Type::kRangefinder:
+      rangefinder_.~Rangefinder();
+      return;
+    case Type::kOdometer:
+      odometer_pose_.~Rigid3();
+      return;
+  }
+  LOG(FATAL) << "Unknown data type " << static_cast<int>(type);
+}
+
+}  // namespace sensor
+}  // namespace cartographer
@@ -17,17 +17,23 @@
 #ifndef CARTOGRAPHER_MAPPING_DATA_H_
 #define CARTOGRAPHER_MAPPING_DATA_H_
 
+#include <cstddef>
+
 #include "cartographer/common/time.h"
 #include "cartographer/sensor/point_cloud.h"
 #include "cartographer/sensor/range_data.h"
 #include "cartographer/transform/rigid_transform.h"
+#include "glog/logging.h"
 
 namespace cartographer {
 namespace sensor {
 
-// This type is a logical union, i.e. only one type of sensor data is actually
-// filled in. It is only used for time ordering sensor data before passing it
-// on.
+// Sensor data of one of several types, which is only used for time ordering
+// sensor data before passing it on. Only the payload of 'type' is stored, so
+// that e.g. IMU data does not carry a point cloud.
+//
+// Data is created and destroyed for every sensor packet, so its memory is
+// recycled through a per thread free list instead of being allocated anew.
 struct Data {
   enum class Type { kImu, kRangefinder, kOdometer };
 
@@ -42,20 +48,43 @@ struct Data {
     PointCloud ranges;
   };
 
-  Data(const common::Time time, const Imu& imu)
-      : type(Type::kImu), time(time), imu(imu) {}
+  Data(common::Time time, const Imu& imu);
+  Data(common::Time time, const Rangefinder& rangefinder);
+  Data(common::Time time, const transform::Rigid3d& odometer_pose);
+
+  Data(const Data& other);
+  Data& operator=(const Data& other);
+  ~Data();
 
-  Data(const common::Time time, const Rangefinder& rangefinder)
-      : type(Type::kRangefinder), time(time), rangefinder(rangefinder) {}
+  static void* operator new(size_t size);
+  static void operator delete(void* pointer);
 
-  Data(const common::Time time, const transform::Rigid3d& odometer_pose)
-      : type(Type::kOdometer), time(time), odometer_pose(odometer_pose) {}
+  // Return the payload, which must be of the respective type.
+  const Imu& imu() const {
+    CHECK(type == Type::kImu);
+    return imu_;
+  }
+  const Rangefinder& rangefinder() const {
+    CHECK(type == Type::kRangefinder);
+    return rangefinder_;
+  }
+  const transform::Rigid3d& odometer_pose() const {
+    CHECK(type == Type::kOdometer);
+    return odometer_pose_;
+  }
 
   Type type;
   common::Time time;
-  Imu imu;
-  Rangefinder rangefinder;
-  transform::Rigid3d odometer_pose;
+
+ private:
+  void ConstructPayload(const Data& other);
+  void DestroyPayload();
+
+  union {
+    Imu imu_;
+    Rangefinder rangefinder_;
+    transform::Rigid3d odometer_pose_;
+  };
 };
 
 }  // namespace sensor
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/sensor/data.h"
+
+#include <memory>
+
+#include "cartographer/common/make_unique.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace sensor {
+namespace {
+
+TEST(DataTest, CopyAndAssign) {
+  const Data rangefinder(
+      common::FromUniversal(1),
+      Data::Rangefinder{Eigen::Vector3f(1.f, 2.f, 3.f),
+                        {Eigen::Vector3f::UnitX(), Eigen::Vector3f::UnitY()}});
+  const Data odometer(
+      common::FromUniversal(2),
+      transform::Rigid3d::Translation(Eigen::Vector3d(4., 5., 6.)));
+
+  Data data(rangefinder);
+  EXPECT_EQ(Data::Type::kRangefinder, data.type);
+  EXPECT_EQ(common::FromUniversal(1), data.time);
+  EXPECT_EQ(Eigen::Vector3f(1.f, 2.f, 3.f), data.rangefinder().origin);
+  EXPECT_EQ(2, data.rangefinder().ranges.size());
+
+  data = odometer;
+  EXPECT_EQ(Data::Type::kOdometer, data.type);
+  EXPECT_EQ(common::FromUniversal(2), data.time);
+  EXPECT_EQ(Eigen::Vector3d(4., 5., 6.), data.odometer_pose().translation());
+
+  data = Data(common::FromUniversal(3),
+              Data::Imu{Eigen::Vector3d::UnitZ(), Eigen::Vector3d::UnitX(),
+                        Eigen::Quaterniond::Identity()});
+  EXPECT_EQ(Data::Type::kImu, data.type);
+  EXPECT_EQ(common::FromUniversal(3), data.time);
+  EXPECT_EQ(Eigen::Vector3d::UnitZ(), data.imu().linear_acceleration);
+  EXPECT_EQ(Eigen::Vector3d::UnitX(), data.imu().angular_velocity);
+}
+
+TEST(DataTest, ReusesMemory) {
+  const Data::Imu imu{Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(),
+                      Eigen::Quaterniond::Identity()};
+  auto data = common::make_unique<Data>(common::FromUniversal(0), imu);
+  const Data* const first_address = data.get();
+  data.reset();
+  data = common::make_unique<Data>(common::FromUniversal(1), imu);
+  EXPECT_EQ(first_address, data.get());
+}
+
+}  // namespace
+}  // namespace sensor
+}  // namespace cartographer
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_SENSOR_GPS_DATA_H_
+#define CARTOGRAPHER_SENSOR_GPS_DATA_H_
+
+#include "Eigen/Core"
+#include "cartographer/common/time.h"
+
+namespace cartographer {
+namespace sensor {
+
+struct GpsData {
+  common::Time time;
+  // Position of the tracking frame in the frame of the GPS fixes, e.g. a local
+  // ENU frame.
+  Eigen::Vector2d position;
+  // Covariance of 'position', which depends on the quality of the fix.
+  Eigen::Matrix2d covariance;
+};
+
+}  // namespace sensor
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_SENSOR_GPS_DATA_H_
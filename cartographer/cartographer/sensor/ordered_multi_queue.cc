@@ -38,7 +38,15 @@ inline std::ostream& operator<<(std::ostream& out, const QueueKey& key) {
   return out << '(' << key.trajectory_id << ", " << key.sensor_id << ')';
 }
 
-OrderedMultiQueue::OrderedMultiQueue() {}
+OrderedMultiQueue::OrderedMultiQueue()
+    : dispatched_metric_(common::MetricsRegistry::Global()->GetCounter(
+          "ordered_multi_queue_dispatched", "Sensor data dispatched.")),
+      dropped_metric_(common::MetricsRegistry::Global()->GetCounter(
+          "ordered_multi_queue_dropped",
+          "Sensor data dropped before the common start time.")),
+      blocked_metric_(common::MetricsRegistry::Global()->GetCounter(
+          "ordered_multi_queue_blocked",
+          "Number of times dispatching waited for a queue.")) {}
 
 OrderedMultiQueue::~OrderedMultiQueue() {
   for (auto& entry : queues_) {
@@ -127,6 +135,7 @@ void OrderedMultiQueue::Dispatch() {
       // Happy case, we are beyond the 'common_start_time' already.
       last_dispatched_time_ = next_data->time;
       next_queue->callback(next_queue->queue.Pop());
+      dispatched_metric_->Increment();
     } else if (next_queue->queue.Size() < 2) {
       if (!next_queue->finished) {
         // We cannot decide whether to drop or dispatch this yet.
@@ -135,6 +144,7 @@ void OrderedMultiQueue::Dispatch() {
       }
       last_dispatched_time_ = next_data->time;
       next_queue->callback(next_queue->queue.Pop());
+      dispatched_metric_->Increment();
     } else {
       // We take a peek at the time after next data. If it also is not beyond
       // 'common_start_time' we drop 'next_data', otherwise we just found the
@@ -143,6 +153,9 @@ void OrderedMultiQueue::Dispatch() {
       if (next_queue->queue.Peek<Data>()->time > common_start_time) {
         last_dispatched_time_ = next_data->time;
         next_queue->callback(std::move(next_data_owner));
+        dispatched_metric_->Increment();
+      } else {
+        dropped_metric_->Increment();
       }
     }
   }
@@ -150,6 +163,7 @@ void OrderedMultiQueue::Dispatch() {
 
 void OrderedMultiQueue::CannotMakeProgress(const QueueKey& queue_key) {
   blocker_ = queue_key;
+  blocked_metric_->Increment();
   for (auto& entry : queues_) {
     if (entry.second.queue.Size() > kMaxQueueSize) {
       LOG_EVERY_N(WARNING, 60) << "Queue waiting for data: " << queue_key;
@@ -23,8 +23,9 @@
 #include <string>
 #include <tuple>
 
-#include "cartographer/common/blocking_queue.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/common/port.h"
+#include "cartographer/common/ring_buffer.h"
 #include "cartographer/common/time.h"
 #include "cartographer/sensor/data.h"
 
@@ -76,7 +77,9 @@ class OrderedMultiQueue {
 
  private:
   struct Queue {
-    common::BlockingQueue<std::unique_ptr<Data>> queue;
+    // Data is added and dispatched on the same thread, so the queues need no
+    // synchronization.
+    common::RingBuffer<std::unique_ptr<Data>> queue;
     Callback callback;
     bool finished = false;
   };
@@ -91,6 +94,10 @@ class OrderedMultiQueue {
   std::map<int, common::Time> common_start_time_per_trajectory_;
   std::map<QueueKey, Queue> queues_;
   QueueKey blocker_;
+
+  common::Counter* const dispatched_metric_;
+  common::Counter* const dropped_metric_;
+  common::Counter* const blocked_metric_;
 };
 
 }  // namespace sensor
@@ -17,6 +17,7 @@
 #include "cartographer/sensor/voxel_filter.h"
 
 #include <cmath>
+#include <limits>
 
 #include "cartographer/common/math.h"
 
@@ -36,6 +37,17 @@ PointCloud FilterByMaxRange(const PointCloud& point_cloud,
   return result;
 }
 
+// Returns the number of voxels with edge length 'size' occupied by
+// 'point_cloud'. Unlike VoxelFiltered(), no points are copied.
+size_t CountVoxels(const PointCloud& point_cloud, const float size) {
+  thread_local VoxelSet voxel_set;
+  voxel_set.Clear();
+  for (const Eigen::Vector3f& point : point_cloud) {
+    voxel_set.Insert(GetVoxelIndex(point, size));
+  }
+  return voxel_set.size();
+}
+
 PointCloud AdaptivelyVoxelFiltered(
     const proto::AdaptiveVoxelFilterOptions& options,
     const PointCloud& point_cloud) {
@@ -50,47 +62,103 @@ PointCloud AdaptivelyVoxelFiltered(
   }
   // Search for a 'low_length' that is known to result in a sufficiently
   // dense point cloud. We give up and use the full 'point_cloud' if reducing
-  // the edge length by a factor of 1e-2 is not enough.
+  // the edge length by a factor of 1e-2 is not enough. Only the number of
+  // voxels is needed to decide, so points are copied only once at the end.
+  float low_length = options.max_length();
   for (float high_length = options.max_length();
        high_length > 1e-2f * options.max_length(); high_length /= 2.f) {
-    float low_length = high_length / 2.f;
-    result = VoxelFiltered(point_cloud, low_length);
-    if (result.size() >= options.min_num_points()) {
+    low_length = high_length / 2.f;
+    if (CountVoxels(point_cloud, low_length) >= options.min_num_points()) {
       // Binary search to find the right amount of filtering. 'low_length' gave
-      // a sufficiently dense 'result', 'high_length' did not. We stop when the
+      // a sufficiently dense result, 'high_length' did not. We stop when the
       // edge length is at most 10% off.
       while ((high_length - low_length) / low_length > 1e-1f) {
         const float mid_length = (low_length + high_length) / 2.f;
-        const PointCloud candidate = VoxelFiltered(point_cloud, mid_length);
-        if (candidate.size() >= options.min_num_points()) {
+        if (CountVoxels(point_cloud, mid_length) >= options.min_num_points()) {
           low_length = mid_length;
-          result = candidate;
         } else {
           high_length = mid_length;
         }
       }
-      return result;
+      return VoxelFiltered(point_cloud, low_length);
     }
   }
-  return result;
+  return low_length == options.max_length()
+             ? result
+             : VoxelFiltered(point_cloud, low_length);
 }
 
 }  // namespace
 
+VoxelSet::VoxelSet() : slots_(64, Slot{0, 0, 0, 0}) {}
+
+void VoxelSet::Clear() {
+  size_ = 0;
+  if (generation_ == std::numeric_limits<uint32>::max()) {
+    for (Slot& slot : slots_) {
+      slot.generation = 0;
+    }
+    generation_ = 0;
+  }
+  ++generation_;
+}
+
+bool VoxelSet::Insert(const Eigen::Array3i& index) {
+  // Keep the load factor at most 1/2, so that probe sequences stay short.
+  if (2 * (size_ + 1) > slots_.size()) {
+    Grow();
+  }
+  const size_t mask = slots_.size() - 1;
+  uint64 hash = static_cast<uint32>(index.x()) * 0x9E3779B97F4A7C15ull +
+                static_cast<uint32>(index.y()) * 0xC2B2AE3D27D4EB4Full +
+                static_cast<uint32>(index.z()) * 0x165667B19E3779F9ull;
+  // Mix the high bits, which depend on all bits of 'index', into the low bits
+  // used to select the slot.
+  hash ^= hash >> 32;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    Slot& slot = slots_[i];
+    if (slot.generation != generation_) {
+      slot = Slot{index.x(), index.y(), index.z(), generation_};
+      ++size_;
+      return true;
+    }
+    if (slot.x == index.x() && slot.y == index.y() && slot.z == index.z()) {
+      return false;
+    }
+  }
+}
+
+void VoxelSet::Grow() {
+  std::vector<Slot> old_slots(2 * slots_.size(), Slot{0, 0, 0, 0});
+  old_slots.swap(slots_);
+  const uint32 old_generation = generation_;
+  generation_ = 1;
+  size_ = 0;
+  for (const Slot& slot : old_slots) {
+    if (slot.generation == old_generation) {
+      Insert(Eigen::Array3i(slot.x, slot.y, slot.z));
+    }
+  }
+}
+
 PointCloud VoxelFiltered(const PointCloud& point_cloud, const float size) {
-  VoxelFilter voxel_filter(size);
-  voxel_filter.InsertPointCloud(point_cloud);
-  return voxel_filter.point_cloud();
+  thread_local VoxelSet voxel_set;
+  voxel_set.Clear();
+  PointCloud result;
+  for (const Eigen::Vector3f& point : point_cloud) {
+    if (voxel_set.Insert(GetVoxelIndex(point, size))) {
+      result.push_back(point);
+    }
+  }
+  return result;
 }
 
-VoxelFilter::VoxelFilter(const float size) : voxels_(size) {}
+VoxelFilter::VoxelFilter(const float size) : size_(size) {}
 
 void VoxelFilter::InsertPointCloud(const PointCloud& point_cloud) {
   for (const Eigen::Vector3f& point : point_cloud) {
-    auto* const value = voxels_.mutable_value(voxels_.GetCellIndex(point));
-    if (*value == 0) {
+    if (voxels_.Insert(GetVoxelIndex(point, size_))) {
       point_cloud_.push_back(point);
-      *value = 1;
     }
   }
 }
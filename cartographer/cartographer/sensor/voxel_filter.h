@@ -17,14 +17,62 @@
 #ifndef CARTOGRAPHER_SENSOR_VOXEL_FILTER_H_
 #define CARTOGRAPHER_SENSOR_VOXEL_FILTER_H_
 
+#include <cstddef>
+#include <vector>
+
+#include "Eigen/Core"
 #include "cartographer/common/lua_parameter_dictionary.h"
-#include "cartographer/mapping_3d/hybrid_grid.h"
+#include "cartographer/common/port.h"
 #include "cartographer/sensor/point_cloud.h"
 #include "cartographer/sensor/proto/adaptive_voxel_filter_options.pb.h"
 
 namespace cartographer {
 namespace sensor {
 
+// A set of voxel indices in an open addressing hash table. Clearing it is
+// constant time and keeps the allocated memory, so that a single instance can
+// be reused to filter many point clouds.
+class VoxelSet {
+ public:
+  VoxelSet();
+
+  VoxelSet(const VoxelSet&) = delete;
+  VoxelSet& operator=(const VoxelSet&) = delete;
+
+  // Removes all voxels from the set.
+  void Clear();
+
+  // Inserts 'index' and returns true if it was not already in the set.
+  bool Insert(const Eigen::Array3i& index);
+
+  size_t size() const { return size_; }
+
+ private:
+  struct Slot {
+    int x;
+    int y;
+    int z;
+    // The slot is occupied if this equals 'generation_'.
+    uint32 generation;
+  };
+
+  void Grow();
+
+  std::vector<Slot> slots_;
+  uint32 generation_ = 1;
+  size_t size_ = 0;
+};
+
+// Returns the index of the voxel with edge length 'size' containing 'point'.
+// Voxels are centered at integer multiples of 'size'.
+inline Eigen::Array3i GetVoxelIndex(const Eigen::Vector3f& point,
+                                    const float size) {
+  const Eigen::Array3f index = point.array() / size;
+  return Eigen::Array3i(common::FastRoundToInt(index.x()),
+                        common::FastRoundToInt(index.y()),
+                        common::FastRoundToInt(index.z()));
+}
+
 // Returns a voxel filtered copy of 'point_cloud' where 'size' is the length
 // a voxel edge.
 PointCloud VoxelFiltered(const PointCloud& point_cloud, float size);
@@ -47,7 +95,8 @@ class VoxelFilter {
   const PointCloud& point_cloud() const;
 
  private:
-  mapping_3d::HybridGridBase<uint8> voxels_;
+  const float size_;
+  VoxelSet voxels_;
   PointCloud point_cloud_;
 };
 
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2017 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the voxel filters on simulated Hokuyo or Velodyne point clouds
+// of a box shaped room. The HybridGrid based voxel filter is timed as a
+// reference and must give the same results.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "cartographer/mapping_3d/hybrid_grid.h"
+#include "cartographer/sensor/point_cloud.h"
+#include "cartographer/sensor/voxel_filter.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(sensor, "velodyne",
+              "Simulated sensor, either 'hokuyo' (a single ring of 1080 "
+              "beams) or 'velodyne' (16 rings of 1800 beams).");
+DEFINE_double(room_size, 40., "Side length of the simulated room in meters.");
+DEFINE_double(voxel_filter_size, 0.05, "Edge length of the voxels.");
+DEFINE_double(max_length, 0.9, "'max_length' of the adaptive voxel filter.");
+DEFINE_int32(min_num_points, 100,
+             "'min_num_points' of the adaptive voxel filter.");
+DEFINE_double(max_range, 50., "'max_range' of the adaptive voxel filter.");
+DEFINE_int32(num_point_clouds, 100, "Number of point clouds filtered.");
+
+namespace cartographer {
+namespace sensor {
+namespace {
+
+// The voxel filter as it was implemented before VoxelSet.
+PointCloud HybridGridVoxelFiltered(const PointCloud& point_cloud,
+                                   const float size) {
+  mapping_3d::HybridGridBase<uint8> voxels(size);
+  PointCloud result;
+  for (const Eigen::Vector3f& point : point_cloud) {
+    auto* const value = voxels.mutable_value(voxels.GetCellIndex(point));
+    if (*value == 0) {
+      result.push_back(point);
+      *value = 1;
+    }
+  }
+  return result;
+}
+
+PointCloud SimulatePointCloud(const Eigen::Vector3f& origin,
+                              std::mt19937* prng) {
+  const bool hokuyo = FLAGS_sensor == "hokuyo";
+  CHECK(hokuyo || FLAGS_sensor == "velodyne")
+      << "Unknown sensor '" << FLAGS_sensor << "'.";
+  const int num_rings = hokuyo ? 1 : 16;
+  const int num_beams = hokuyo ? 1080 : 1800;
+  const float half_size = FLAGS_room_size / 2.;
+  std::normal_distribution<float> noise(0.f, 0.01f);
+  PointCloud point_cloud;
+  for (int ring = 0; ring != num_rings; ++ring) {
+    // The Velodyne VLP-16 covers +/-15 degrees of elevation.
+    const float elevation =
+        hokuyo ? 0.f : (-15.f + 2.f * ring) * static_cast<float>(M_PI) / 180.f;
+    for (int i = 0; i != num_beams; ++i) {
+      const float azimuth = 2. * M_PI * i / num_beams;
+      const Eigen::Vector3f direction(std::cos(elevation) * std::cos(azimuth),
+                                      std::cos(elevation) * std::sin(azimuth),
+                                      std::sin(elevation));
+      // Distance to the closest wall, floor or ceiling along 'direction'.
+      float range = std::numeric_limits<float>::infinity();
+      for (int axis = 0; axis != 3; ++axis) {
+        if (direction[axis] != 0.f) {
+          const float wall = direction[axis] > 0.f ? half_size : -half_size;
+          range = std::min(range, (wall - origin[axis]) / direction[axis]);
+        }
+      }
+      point_cloud.push_back((range + noise(*prng)) * direction);
+    }
+  }
+  return point_cloud;
+}
+
+template <typename FilterFunction>
+double TimePerPointCloud(const std::vector<PointCloud>& point_clouds,
+                         FilterFunction filter, size_t* num_points) {
+  *num_points = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const PointCloud& point_cloud : point_clouds) {
+    *num_points += filter(point_cloud).size();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+             .count() /
+         point_clouds.size();
+}
+
+void Run() {
+  std::mt19937 prng(42);
+  std::vector<PointCloud> point_clouds;
+  size_t num_input_points = 0;
+  for (int i = 0; i != FLAGS_num_point_clouds; ++i) {
+    const float angle = 2. * M_PI * i / FLAGS_num_point_clouds;
+    point_clouds.push_back(SimulatePointCloud(
+        0.25f * FLAGS_room_size *
+            Eigen::Vector3f(std::cos(angle), std::sin(angle), 0.f),
+        &prng));
+    num_input_points += point_clouds.back().size();
+  }
+  for (const PointCloud& point_cloud : point_clouds) {
+    CHECK(VoxelFiltered(point_cloud, FLAGS_voxel_filter_size) ==
+          HybridGridVoxelFiltered(point_cloud, FLAGS_voxel_filter_size));
+  }
+
+  proto::AdaptiveVoxelFilterOptions options;
+  options.set_max_length(FLAGS_max_length);
+  options.set_min_num_points(FLAGS_min_num_points);
+  options.set_max_range(FLAGS_max_range);
+  const AdaptiveVoxelFilter adaptive_voxel_filter(options);
+
+  size_t num_points = 0;
+  std::cout << std::fixed << std::setprecision(6)
+            << num_input_points / point_clouds.size()
+            << " points per point cloud\n";
+  const double hybrid_grid_seconds = TimePerPointCloud(
+      point_clouds,
+      [](const PointCloud& point_cloud) {
+        return HybridGridVoxelFiltered(point_cloud, FLAGS_voxel_filter_size);
+      },
+      &num_points);
+  std::cout << "HybridGrid voxel filter: " << hybrid_grid_seconds
+            << " s per point cloud, " << num_points / point_clouds.size()
+            << " points kept\n";
+  const double voxel_set_seconds = TimePerPointCloud(
+      point_clouds,
+      [](const PointCloud& point_cloud) {
+        return VoxelFiltered(point_cloud, FLAGS_voxel_filter_size);
+      },
+      &num_points);
+  std::cout << "VoxelSet voxel filter: " << voxel_set_seconds
+            << " s per point cloud, " << num_points / point_clouds.size()
+            << " points kept\n";
+  const double adaptive_seconds = TimePerPointCloud(
+      point_clouds,
+      [&adaptive_voxel_filter](const PointCloud& point_cloud) {
+        return adaptive_voxel_filter.Filter(point_cloud);
+      },
+      &num_points);
+  std::cout << "Adaptive voxel filter: " << adaptive_seconds
+            << " s per point cloud, " << num_points / point_clouds.size()
+            << " points kept\n";
+}
+
+}  // namespace
+}  // namespace sensor
+}  // namespace cartographer
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  google::SetUsageMessage(
+      "\n\n"
+      "Benchmarks the voxel filters on simulated Hokuyo or Velodyne point\n"
+      "clouds.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_GT(FLAGS_num_point_clouds, 0);
+  ::cartographer::sensor::Run();
+}
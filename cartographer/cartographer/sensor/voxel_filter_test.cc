@@ -17,6 +17,9 @@
 #include "cartographer/sensor/voxel_filter.h"
 
 #include <cmath>
+#include <random>
+#include <set>
+#include <tuple>
 
 #include "gmock/gmock.h"
 
@@ -35,6 +38,60 @@ TEST(VoxelFilterTest, ReturnsTheFirstPointInEachVoxel) {
               ContainerEq(PointCloud{point_cloud[0], point_cloud[2]}));
 }
 
+TEST(VoxelFilterTest, GetVoxelIndexRoundsLikeRoundToInt) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<float> distribution(-1e3f, 1e3f);
+  for (int i = 0; i != 1000; ++i) {
+    // Every tenth point is halfway between two voxel centers.
+    const Eigen::Vector3f point =
+        i % 10 == 0 ? Eigen::Vector3f(0.5f * std::round(distribution(prng)),
+                                      -2.5f, 2.5f)
+                    : Eigen::Vector3f(distribution(prng), distribution(prng),
+                                      distribution(prng));
+    const Eigen::Array3i index = GetVoxelIndex(point, 0.5f);
+    for (int j = 0; j != 3; ++j) {
+      EXPECT_EQ(common::RoundToInt(point[j] / 0.5f), index[j]) << point[j];
+    }
+  }
+}
+
+TEST(VoxelSetTest, InsertsEachIndexOnce) {
+  VoxelSet voxel_set;
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<int> distribution(-50, 50);
+  for (int round = 0; round != 3; ++round) {
+    std::set<std::tuple<int, int, int>> expected;
+    for (int i = 0; i != 5000; ++i) {
+      const Eigen::Array3i index(distribution(prng), distribution(prng),
+                                 distribution(prng) / 10);
+      EXPECT_EQ(
+          expected.emplace(index.x(), index.y(), index.z()).second,
+          voxel_set.Insert(index));
+    }
+    EXPECT_EQ(expected.size(), voxel_set.size());
+    voxel_set.Clear();
+    EXPECT_EQ(0, voxel_set.size());
+  }
+}
+
+TEST(AdaptiveVoxelFilterTest, KeepsMinNumPoints) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<float> distribution(-10.f, 10.f);
+  PointCloud point_cloud;
+  for (int i = 0; i != 10000; ++i) {
+    point_cloud.emplace_back(distribution(prng), distribution(prng),
+                             distribution(prng));
+  }
+  proto::AdaptiveVoxelFilterOptions options;
+  options.set_max_length(2.);
+  options.set_min_num_points(500);
+  options.set_max_range(50.);
+  const PointCloud filtered_point_cloud =
+      AdaptiveVoxelFilter(options).Filter(point_cloud);
+  EXPECT_GE(filtered_point_cloud.size(), 500);
+  EXPECT_LT(filtered_point_cloud.size(), point_cloud.size());
+}
+
 }  // namespace
 }  // namespace sensor
 }  // namespace cartographer
@@ -18,5 +18,6 @@ MAP_BUILDER = {
   use_trajectory_builder_2d = false,
   use_trajectory_builder_3d = false,
   num_background_threads = 4,
+  precompute_loaded_submaps = false,
   sparse_pose_graph = SPARSE_POSE_GRAPH,
 }
@@ -36,6 +36,7 @@ SPARSE_POSE_GRAPH = {
       occupied_space_weight = 20.,
       translation_weight = 10.,
       rotation_weight = 1.,
+      use_analytical_jacobians = false,
       ceres_solver_options = {
         use_nonmonotonic_steps = true,
         max_num_iterations = 10,
@@ -83,6 +84,14 @@ SPARSE_POSE_GRAPH = {
     consecutive_scan_translation_penalty_factor = 1e5,
     consecutive_scan_rotation_penalty_factor = 1e5,
     log_solver_summary = false,
+    incremental = false,
+    local_window_num_hops = 0,
+    use_analytical_jacobians = false,
+    use_gps_data = false,
+    gps_translation_stddev = 3.,
+    gps_rtk_fixed_translation_stddev = 0.05,
+    gps_huber_scale = 1.,
+    gps_max_interpolation_gap = 1.,
     ceres_solver_options = {
       use_nonmonotonic_steps = false,
       max_num_iterations = 50,
@@ -34,12 +34,15 @@ TRAJECTORY_BUILDER_2D = {
     angular_search_window = math.rad(20.),
     translation_delta_cost_weight = 1e-1,
     rotation_delta_cost_weight = 1e-1,
+    multi_resolution_depth = 1,
+    multi_resolution_num_greedy_candidates = 0,
   },
 
   ceres_scan_matcher = {
     occupied_space_weight = 1e1,
     translation_weight = 1e1,
     rotation_weight = 1e2,
+    use_analytical_jacobians = false,
     ceres_solver_options = {
       use_nonmonotonic_steps = false,
       max_num_iterations = 20,
@@ -53,6 +56,15 @@ TRAJECTORY_BUILDER_2D = {
     max_angle_radians = math.rad(1.),
   },
 
+  front_end_policy = {
+    mode_a_min_num_returns = 1500,
+    mode_c_min_squared_distance = 5.,
+    mode_c_num_updates = 100,
+    skip_scan_matching_max_translation_stddev = 0.,
+    ceres_only_max_translation_stddev = 0.,
+    max_prediction_age = 0.5,
+  },
+
   imu_gravity_time_constant = 10.,
   num_odometry_states = 1000,
 
@@ -18,12 +18,15 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "cartographer/common/blocking_queue.h"
 #include "cartographer/common/configuration_file_resolver.h"
 #include "cartographer/common/make_unique.h"
 #include "cartographer/common/math.h"
 #include "cartographer/io/file_writer.h"
+#include "cartographer/io/points_batch_cache.h"
 #include "cartographer/io/points_processor.h"
 #include "cartographer/io/points_processor_pipeline_builder.h"
 #include "cartographer/io/proto_stream.h"
@@ -63,11 +66,22 @@ DEFINE_string(pose_graph_filename, "",
               "Proto stream file containing the pose graph.");
 DEFINE_bool(use_bag_transforms, true,
             "Whether to read and use the transforms from the bag.");
+DEFINE_bool(use_points_cache, false,
+            "Whether to cache the points in the map frame while the bags are "
+            "read, so that further passes requested by the pipeline replay "
+            "the cache instead of reading the bags again. Only worth it for "
+            "pipelines with several passes, e.g. with "
+            "'voxel_filter_and_remove_moving_objects', since the cache holds "
+            "every point on disk.");
+DEFINE_string(points_cache_filename, "",
+              "File for the points cache, by default 'pose_graph_filename' "
+              "with the suffix '.points_cache'. It is removed when done.");
 
 namespace cartographer_ros {
 namespace {
 
 constexpr char kTfStaticTopic[] = "/tf_static";
+constexpr int kMaxNumPendingPointsBatches = 64;
 namespace carto = ::cartographer;
 
 // TODO(hrapp): We discovered that using tf_buffer with a large CACHE
@@ -136,6 +150,95 @@ std::unique_ptr<carto::io::PointsBatch> HandleMessage(
   return points_batch;
 }
 
+// Reads the points from all bags, converts them into the map frame and pushes
+// them onto 'points_batches', followed by nullptr once all bags are read.
+void ReadPointsBatches(
+    const carto::mapping::proto::SparsePoseGraph& pose_graph_proto,
+    const std::vector<string>& bag_filenames, const string& tracking_frame,
+    const string& urdf_filename,
+    carto::common::BlockingQueue<std::unique_ptr<carto::io::PointsBatch>>*
+        points_batches) {
+  for (size_t trajectory_id = 0; trajectory_id < bag_filenames.size();
+       ++trajectory_id) {
+    const carto::mapping::proto::Trajectory& trajectory_proto =
+        pose_graph_proto.trajectory(trajectory_id);
+    const string& bag_filename = bag_filenames[trajectory_id];
+    LOG(INFO) << "Processing " << bag_filename << "...";
+    if (trajectory_proto.node_size() == 0) {
+      continue;
+    }
+    tf2_ros::Buffer tf_buffer(::ros::DURATION_MAX);
+    if (FLAGS_use_bag_transforms) {
+      LOG(INFO) << "Pre-loading transforms from bag...";
+      ReadTransformsFromBag(bag_filename, &tf_buffer);
+    }
+
+    if (!urdf_filename.empty()) {
+      ReadStaticTransformsFromUrdf(urdf_filename, &tf_buffer);
+    }
+
+    const auto transform_interpolation_buffer =
+        carto::transform::TransformInterpolationBuffer::FromTrajectory(
+            trajectory_proto);
+    rosbag::Bag bag;
+    bag.open(bag_filename, rosbag::bagmode::Read);
+    rosbag::View view(bag);
+    const ::ros::Time begin_time = view.getBeginTime();
+    const double duration_in_seconds = (view.getEndTime() - begin_time).toSec();
+
+    for (const rosbag::MessageInstance& message : view) {
+      std::unique_ptr<carto::io::PointsBatch> points_batch;
+      if (message.isType<sensor_msgs::PointCloud2>()) {
+        points_batch = HandleMessage(
+            *message.instantiate<sensor_msgs::PointCloud2>(), tracking_frame,
+            tf_buffer, *transform_interpolation_buffer);
+      } else if (message.isType<sensor_msgs::MultiEchoLaserScan>()) {
+        points_batch = HandleMessage(
+            *message.instantiate<sensor_msgs::MultiEchoLaserScan>(),
+            tracking_frame, tf_buffer, *transform_interpolation_buffer);
+      } else if (message.isType<sensor_msgs::LaserScan>()) {
+        points_batch = HandleMessage(
+            *message.instantiate<sensor_msgs::LaserScan>(), tracking_frame,
+            tf_buffer, *transform_interpolation_buffer);
+      }
+      if (points_batch != nullptr) {
+        points_batch->trajectory_id = trajectory_id;
+        points_batches->Push(std::move(points_batch));
+      }
+      LOG_EVERY_N(INFO, 100000)
+          << "Processed " << (message.getTime() - begin_time).toSec() << " of "
+          << duration_in_seconds << " bag time seconds...";
+    }
+    bag.close();
+  }
+  points_batches->Push(nullptr);
+}
+
+// Hands all points from the bags to 'processor'. If 'points_batch_cache' is
+// not nullptr, the points are also added to it.
+void ProcessBags(const carto::mapping::proto::SparsePoseGraph& pose_graph_proto,
+                 const std::vector<string>& bag_filenames,
+                 const string& tracking_frame, const string& urdf_filename,
+                 carto::io::PointsBatchCache* const points_batch_cache,
+                 carto::io::PointsProcessor* const processor) {
+  // The bags are read and converted on a separate thread, while the pipeline
+  // runs on this thread.
+  carto::common::BlockingQueue<std::unique_ptr<carto::io::PointsBatch>>
+      points_batches(kMaxNumPendingPointsBatches);
+  std::thread reader_thread([&]() {
+    ReadPointsBatches(pose_graph_proto, bag_filenames, tracking_frame,
+                      urdf_filename, &points_batches);
+  });
+  while (std::unique_ptr<carto::io::PointsBatch> points_batch =
+             points_batches.Pop()) {
+    if (points_batch_cache != nullptr) {
+      points_batch_cache->Add(*points_batch);
+    }
+    processor->Process(std::move(points_batch));
+  }
+  reader_thread.join();
+}
+
 void Run(const string& pose_graph_filename,
          const std::vector<string>& bag_filenames,
          const string& configuration_directory,
@@ -172,63 +275,32 @@ void Run(const string& pose_graph_filename,
 
   const string tracking_frame =
       lua_parameter_dictionary.GetString("tracking_frame");
-  do {
-    for (size_t trajectory_id = 0; trajectory_id < bag_filenames.size();
-         ++trajectory_id) {
-      const carto::mapping::proto::Trajectory& trajectory_proto =
-          pose_graph_proto.trajectory(trajectory_id);
-      const string& bag_filename = bag_filenames[trajectory_id];
-      LOG(INFO) << "Processing " << bag_filename << "...";
-      if (trajectory_proto.node_size() == 0) {
-        continue;
-      }
-      tf2_ros::Buffer tf_buffer(::ros::DURATION_MAX);
-      if (FLAGS_use_bag_transforms) {
-        LOG(INFO) << "Pre-loading transforms from bag...";
-        ReadTransformsFromBag(bag_filename, &tf_buffer);
-      }
-
-      if (!urdf_filename.empty()) {
-        ReadStaticTransformsFromUrdf(urdf_filename, &tf_buffer);
-      }
-
-      const auto transform_interpolation_buffer =
-          carto::transform::TransformInterpolationBuffer::FromTrajectory(
-              trajectory_proto);
-      rosbag::Bag bag;
-      bag.open(bag_filename, rosbag::bagmode::Read);
-      rosbag::View view(bag);
-      const ::ros::Time begin_time = view.getBeginTime();
-      const double duration_in_seconds =
-          (view.getEndTime() - begin_time).toSec();
-
-      for (const rosbag::MessageInstance& message : view) {
-        std::unique_ptr<carto::io::PointsBatch> points_batch;
-        if (message.isType<sensor_msgs::PointCloud2>()) {
-          points_batch = HandleMessage(
-              *message.instantiate<sensor_msgs::PointCloud2>(), tracking_frame,
-              tf_buffer, *transform_interpolation_buffer);
-        } else if (message.isType<sensor_msgs::MultiEchoLaserScan>()) {
-          points_batch = HandleMessage(
-              *message.instantiate<sensor_msgs::MultiEchoLaserScan>(),
-              tracking_frame, tf_buffer, *transform_interpolation_buffer);
-        } else if (message.isType<sensor_msgs::LaserScan>()) {
-          points_batch = HandleMessage(
-              *message.instantiate<sensor_msgs::LaserScan>(), tracking_frame,
-              tf_buffer, *transform_interpolation_buffer);
-        }
-        if (points_batch != nullptr) {
-          points_batch->trajectory_id = trajectory_id;
-          pipeline.back()->Process(std::move(points_batch));
-        }
-        LOG_EVERY_N(INFO, 100000)
-            << "Processed " << (message.getTime() - begin_time).toSec()
-            << " of " << duration_in_seconds << " bag time seconds...";
-      }
-      bag.close();
+  std::unique_ptr<carto::io::PointsBatchCache> points_batch_cache;
+  if (FLAGS_use_points_cache) {
+    const string points_cache_filename =
+        FLAGS_points_cache_filename.empty()
+            ? pose_graph_filename + ".points_cache"
+            : FLAGS_points_cache_filename;
+    points_batch_cache =
+        carto::common::make_unique<carto::io::PointsBatchCache>(
+            points_cache_filename);
+  }
+  ProcessBags(pose_graph_proto, bag_filenames, tracking_frame, urdf_filename,
+              points_batch_cache.get(), pipeline.back().get());
+  if (points_batch_cache != nullptr) {
+    points_batch_cache->FinishWriting();
+  }
+  while (pipeline.back()->Flush() ==
+         carto::io::PointsProcessor::FlushResult::kRestartStream) {
+    if (points_batch_cache != nullptr) {
+      LOG(INFO) << "Replaying " << points_batch_cache->num_batches()
+                << " cached points batches...";
+      points_batch_cache->Replay(pipeline.back().get());
+    } else {
+      ProcessBags(pose_graph_proto, bag_filenames, tracking_frame,
+                  urdf_filename, nullptr, pipeline.back().get());
     }
-  } while (pipeline.back()->Flush() ==
-           carto::io::PointsProcessor::FlushResult::kRestartStream);
+  }
 }
 
 }  // namespace
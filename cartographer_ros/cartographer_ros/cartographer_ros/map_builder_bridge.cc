@@ -19,7 +19,9 @@
 #include "cartographer/io/proto_stream.h"
 #include "cartographer_ros/assets_writer.h"
 #include "cartographer_ros/color.h"
+#include "cartographer_ros/map_writer.h"
 #include "cartographer_ros/msg_conversion.h"
+#include "cartographer_ros/node_constants.h"
 #include "cartographer_ros/occupancy_grid.h"
 
 namespace cartographer_ros {
@@ -33,10 +35,12 @@ MapBuilderBridge::MapBuilderBridge(const NodeOptions& node_options,
       map_builder_(node_options.map_builder_options),
       tf_buffer_(tf_buffer) {}
 
-void MapBuilderBridge::LoadMap(const std::string& map_filename) {
+void MapBuilderBridge::LoadMap(
+    const std::string& map_filename,
+    const cartographer::mapping::MapBuilder::SubmapFilter& submap_filter) {
   LOG(INFO) << "Loading map '" << map_filename << "'...";
   cartographer::io::ProtoStreamReader stream(map_filename);
-  map_builder_.LoadMap(&stream);
+  map_builder_.LoadMap(&stream, submap_filter);
 }
 
 int MapBuilderBridge::AddTrajectory(
@@ -135,8 +139,8 @@ cartographer_ros_msgs::SubmapList MapBuilderBridge::GetSubmapList() {
   cartographer_ros_msgs::SubmapList submap_list;
   submap_list.header.stamp = ::ros::Time::now();
   submap_list.header.frame_id = node_options_.map_frame;
-  const auto all_submap_data =
-      map_builder_.sparse_pose_graph()->GetAllSubmapData();
+  const auto snapshot = map_builder_.sparse_pose_graph()->GetSnapshot();
+  const auto& all_submap_data = snapshot->submap_data;
   for (size_t trajectory_id = 0; trajectory_id < all_submap_data.size();
        ++trajectory_id) {
     for (size_t submap_index = 0;
@@ -156,29 +160,33 @@ cartographer_ros_msgs::SubmapList MapBuilderBridge::GetSubmapList() {
   return submap_list;
 }
 
-std::unique_ptr<nav_msgs::OccupancyGrid>
-MapBuilderBridge::BuildOccupancyGrid() {
+const IncrementalOccupancyGrid* MapBuilderBridge::UpdateOccupancyGrid() {
   CHECK(node_options_.map_builder_options.use_trajectory_builder_2d())
       << "Publishing OccupancyGrids for 3D data is not yet supported.";
   const auto all_trajectory_nodes =
       map_builder_.sparse_pose_graph()->GetTrajectoryNodes();
-  std::unique_ptr<nav_msgs::OccupancyGrid> occupancy_grid;
-  if (HasNonTrimmedNode(all_trajectory_nodes)) {
-    occupancy_grid =
-        cartographer::common::make_unique<nav_msgs::OccupancyGrid>();
+  if (!HasNonTrimmedNode(all_trajectory_nodes)) {
+    return nullptr;
+  }
+  if (occupancy_grid_ == nullptr) {
     // Make sure there is a trajectory with id = 0.
     CHECK_EQ(trajectory_options_.count(0), 1)
      << "CHECK_EQ(trajectory_options_.count(0), 1).";
-
-    LOG(WARNING) << "BuildOccupancyGrid2D";
-    BuildOccupancyGrid2D(
-        all_trajectory_nodes, node_options_.map_frame,
-        trajectory_options_[0]
-            .trajectory_builder_options.trajectory_builder_2d_options()
-            .submaps_options(),
-        occupancy_grid.get());
+    occupancy_grid_ =
+        cartographer::common::make_unique<IncrementalOccupancyGrid>(
+            trajectory_options_[0]
+                .trajectory_builder_options.trajectory_builder_2d_options()
+                .submaps_options(),
+            kOccupancyGridTranslationThreshold,
+            kOccupancyGridRotationThreshold);
+  }
+  occupancy_grid_->Update(all_trajectory_nodes, node_options_.map_frame);
+  if (occupancy_grid_->limits_changed() ||
+      !occupancy_grid_->updates().empty()) {
+    WriteOccupancyGridToPgmAndYaml(occupancy_grid_->occupancy_grid(),
+                                   "/home/zkma/OUTMAP/outmap");
   }
-  return occupancy_grid;
+  return occupancy_grid_.get();
 }
 
 std::unordered_map<int, MapBuilderBridge::TrajectoryState>
@@ -212,8 +220,8 @@ MapBuilderBridge::GetTrajectoryStates() {
 
 visualization_msgs::MarkerArray MapBuilderBridge::GetTrajectoryNodeList() {
   visualization_msgs::MarkerArray trajectory_node_list;
-  const auto all_trajectory_nodes =
-      map_builder_.sparse_pose_graph()->GetTrajectoryNodes();
+  const auto snapshot = map_builder_.sparse_pose_graph()->GetSnapshot();
+  const auto& all_trajectory_nodes = snapshot->trajectory_nodes;
   int marker_id = 0;
   for (int trajectory_id = 0;
        trajectory_id < static_cast<int>(all_trajectory_nodes.size());
@@ -284,11 +292,12 @@ visualization_msgs::MarkerArray MapBuilderBridge::GetConstraintList() {
   residual_inter_marker.ns = "Inter residuals";
   residual_inter_marker.pose.position.z = 0.1;
 
-  const auto all_trajectory_nodes =
-      map_builder_.sparse_pose_graph()->GetTrajectoryNodes();
-  const auto all_submap_data =
-      map_builder_.sparse_pose_graph()->GetAllSubmapData();
-  const auto constraints = map_builder_.sparse_pose_graph()->constraints();
+  // Nodes, submaps and constraints are taken from the same snapshot, so that
+  // the constraints always refer to existing nodes and submaps.
+  const auto snapshot = map_builder_.sparse_pose_graph()->GetSnapshot();
+  const auto& all_trajectory_nodes = snapshot->trajectory_nodes;
+  const auto& all_submap_data = snapshot->submap_data;
+  const auto& constraints = snapshot->constraints;
 
   for (const auto& constraint : constraints) {
     visualization_msgs::Marker *constraint_marker, *residual_marker;
@@ -25,6 +25,7 @@
 #include "cartographer/mapping/map_builder.h"
 #include "cartographer/mapping/proto/trajectory_builder_options.pb.h"
 #include "cartographer_ros/node_options.h"
+#include "cartographer_ros/occupancy_grid.h"
 #include "cartographer_ros/sensor_bridge.h"
 #include "cartographer_ros/tf_bridge.h"
 #include "cartographer_ros/trajectory_options.h"
@@ -50,7 +51,11 @@ class MapBuilderBridge {
   MapBuilderBridge(const MapBuilderBridge&) = delete;
   MapBuilderBridge& operator=(const MapBuilderBridge&) = delete;
 
-  void LoadMap(const std::string& map_filename);
+  // Loads the submaps accepted by 'submap_filter', or all submaps if it is
+  // nullptr, from 'map_filename'.
+  void LoadMap(const std::string& map_filename,
+               const cartographer::mapping::MapBuilder::SubmapFilter&
+                   submap_filter = nullptr);
   int AddTrajectory(const std::unordered_set<string>& expected_sensor_ids,
                     const TrajectoryOptions& trajectory_options);
   void FinishTrajectory(int trajectory_id);
@@ -62,7 +67,9 @@ class MapBuilderBridge {
       cartographer_ros_msgs::SubmapQuery::Response& response);
 
   cartographer_ros_msgs::SubmapList GetSubmapList();
-  std::unique_ptr<nav_msgs::OccupancyGrid> BuildOccupancyGrid();
+  // Brings the incrementally maintained occupancy grid up to date and returns
+  // it, or nullptr if there is no non-trimmed node yet.
+  const IncrementalOccupancyGrid* UpdateOccupancyGrid();
   std::unordered_map<int, TrajectoryState> GetTrajectoryStates();
   visualization_msgs::MarkerArray GetTrajectoryNodeList();
   visualization_msgs::MarkerArray GetConstraintList();
@@ -77,6 +84,9 @@ class MapBuilderBridge {
   // These are keyed with 'trajectory_id'.
   std::unordered_map<int, TrajectoryOptions> trajectory_options_;
   std::unordered_map<int, std::unique_ptr<SensorBridge>> sensor_bridges_;
+
+  // Created on the first call to UpdateOccupancyGrid().
+  std::unique_ptr<IncrementalOccupancyGrid> occupancy_grid_;
 };
 
 }  // namespace cartographer_ros
@@ -24,6 +24,7 @@
 #include "cartographer/common/configuration_file_resolver.h"
 #include "cartographer/common/lua_parameter_dictionary.h"
 #include "cartographer/common/make_unique.h"
+#include "cartographer/common/metrics.h"
 #include "cartographer/common/port.h"
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/proto/submap_visualization.pb.h"
@@ -36,6 +37,7 @@
 #include "cartographer_ros/tf_bridge.h"
 #include "cartographer_ros/time_conversion.h"
 #include "glog/logging.h"
+#include "map_msgs/OccupancyGridUpdate.h"
 #include "nav_msgs/Odometry.h"
 #include "ros/serialization.h"
 #include "sensor_msgs/PointCloud2.h"
@@ -99,12 +101,17 @@ Node::Node(const NodeOptions& node_options, tf2_ros::Buffer* const tf_buffer)
       kFinishTrajectoryServiceName, &Node::HandleFinishTrajectory, this));
   service_servers_.push_back(node_handle_.advertiseService(
       kWriteAssetsServiceName, &Node::HandleWriteAssets, this));
+  service_servers_.push_back(node_handle_.advertiseService(
+      kReadMetricsServiceName, &Node::HandleReadMetrics, this));
 
   if (node_options_.map_builder_options.use_trajectory_builder_2d()) {
     occupancy_grid_publisher_ =
         node_handle_.advertise<::nav_msgs::OccupancyGrid>(
             kOccupancyGridTopic, kLatestOnlyPublisherQueueSize,
             true /* latched */);
+    occupancy_grid_update_publisher_ =
+        node_handle_.advertise<::map_msgs::OccupancyGridUpdate>(
+            kOccupancyGridUpdatesTopic, kInfiniteSubscriberQueueSize);
     occupancy_grid_thread_ =
         std::thread(&Node::SpinOccupancyGridThreadForever, this);
   }
@@ -232,6 +239,10 @@ void Node::PublishConstraintList(
 }
 
 void Node::SpinOccupancyGridThreadForever() {
+  // Subscribers of 'map_updates' need a full grid to apply updates to. It is
+  // republished whenever its size changed and periodically for subscribers
+  // which only use the latched 'map' topic.
+  ::ros::WallTime last_full_publish_time;
   for (;;) {
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     {
@@ -240,12 +251,25 @@ void Node::SpinOccupancyGridThreadForever() {
         return;
       }
     }
-    if (occupancy_grid_publisher_.getNumSubscribers() == 0) {
+    if (occupancy_grid_publisher_.getNumSubscribers() == 0 &&
+        occupancy_grid_update_publisher_.getNumSubscribers() == 0) {
+      continue;
+    }
+    const IncrementalOccupancyGrid* const occupancy_grid =
+        map_builder_bridge_.UpdateOccupancyGrid();
+    if (occupancy_grid == nullptr) {
+      continue;
+    }
+    const ::ros::WallTime now = ::ros::WallTime::now();
+    if (occupancy_grid->limits_changed() || last_full_publish_time.isZero() ||
+        (now - last_full_publish_time).toSec() >=
+            kOccupancyGridFullPublishPeriodSec) {
+      occupancy_grid_publisher_.publish(occupancy_grid->occupancy_grid());
+      last_full_publish_time = now;
       continue;
     }
-    const auto occupancy_grid = map_builder_bridge_.BuildOccupancyGrid();
-    if (occupancy_grid != nullptr) {
-      occupancy_grid_publisher_.publish(*occupancy_grid);
+    for (const auto& update : occupancy_grid->updates()) {
+      occupancy_grid_update_publisher_.publish(update);
     }
   }
 }
@@ -485,6 +509,14 @@ bool Node::HandleWriteAssets(
   return true;
 }
 
+bool Node::HandleReadMetrics(
+    ::cartographer_ros_msgs::ReadMetrics::Request& request,
+    ::cartographer_ros_msgs::ReadMetrics::Response& response) {
+  // The registry is thread-safe, so 'mutex_' is not needed.
+  response.metrics = carto::common::MetricsRegistry::Global()->ToString();
+  return true;
+}
+
 void Node::FinishAllTrajectories() {
   carto::common::MutexLocker lock(&mutex_);
   for (const auto& entry : is_active_trajectory_) {
@@ -495,8 +527,10 @@ void Node::FinishAllTrajectories() {
   }
 }
 
-void Node::LoadMap(const std::string& map_filename) {
-  map_builder_bridge_.LoadMap(map_filename);
+void Node::LoadMap(
+    const std::string& map_filename,
+    const cartographer::mapping::MapBuilder::SubmapFilter& submap_filter) {
+  map_builder_bridge_.LoadMap(map_filename, submap_filter);
 }
 
 }  // namespace cartographer_ros
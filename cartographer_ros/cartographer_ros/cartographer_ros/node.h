@@ -26,6 +26,7 @@
 #include "cartographer_ros/node_options.h"
 #include "cartographer_ros/trajectory_options.h"
 #include "cartographer_ros_msgs/FinishTrajectory.h"
+#include "cartographer_ros_msgs/ReadMetrics.h"
 #include "cartographer_ros_msgs/SensorTopics.h"
 #include "cartographer_ros_msgs/StartTrajectory.h"
 #include "cartographer_ros_msgs/SubmapEntry.h"
@@ -53,8 +54,11 @@ class Node {
   // Starts the first trajectory with the default topics.
   void StartTrajectoryWithDefaultTopics(const TrajectoryOptions& options);
 
-  // Loads a persisted state to use as a map.
-  void LoadMap(const std::string& map_filename);
+  // Loads a persisted state to use as a map. If 'submap_filter' is given, only
+  // the submaps it accepts are loaded.
+  void LoadMap(const std::string& map_filename,
+               const cartographer::mapping::MapBuilder::SubmapFilter&
+                   submap_filter = nullptr);
 
   ::ros::NodeHandle* node_handle();
   MapBuilderBridge* map_builder_bridge();
@@ -72,6 +76,9 @@ class Node {
   bool HandleWriteAssets(
       cartographer_ros_msgs::WriteAssets::Request& request,
       cartographer_ros_msgs::WriteAssets::Response& response);
+  bool HandleReadMetrics(
+      cartographer_ros_msgs::ReadMetrics::Request& request,
+      cartographer_ros_msgs::ReadMetrics::Response& response);
   int AddTrajectory(const TrajectoryOptions& options,
                     const cartographer_ros_msgs::SensorTopics& topics);
   void LaunchSubscribers(const TrajectoryOptions& options,
@@ -112,6 +119,7 @@ class Node {
       point_cloud_subscribers_;
   std::unordered_map<int, bool> is_active_trajectory_ GUARDED_BY(mutex_);
   ::ros::Publisher occupancy_grid_publisher_;
+  ::ros::Publisher occupancy_grid_update_publisher_;
   std::thread occupancy_grid_thread_;
   bool terminating_ = false GUARDED_BY(mutex_);
 
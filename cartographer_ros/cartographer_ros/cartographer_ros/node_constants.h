@@ -27,15 +27,25 @@ constexpr char kImuTopic[] = "imu";
 constexpr char kOdometryTopic[] = "odom";
 constexpr char kFinishTrajectoryServiceName[] = "finish_trajectory";
 constexpr char kOccupancyGridTopic[] = "map";
+constexpr char kOccupancyGridUpdatesTopic[] = "map_updates";
 constexpr char kScanMatchedPointCloudTopic[] = "scan_matched_points2";
 constexpr char kSubmapListTopic[] = "submap_list";
 constexpr char kSubmapQueryServiceName[] = "submap_query";
 constexpr char kStartTrajectoryServiceName[] = "start_trajectory";
 constexpr char kWriteAssetsServiceName[] = "write_assets";
+constexpr char kReadMetricsServiceName[] = "read_metrics";
 constexpr char kTrajectoryNodeListTopic[] = "trajectory_node_list";
 constexpr char kConstraintListTopic[] = "constraint_list";
 constexpr double kConstraintPublishPeriodSec = 0.5;
 
+// Nodes whose optimized pose moved less than this since they were inserted
+// into the published occupancy grid are not ray cast again.
+constexpr double kOccupancyGridTranslationThreshold = 0.1;
+constexpr double kOccupancyGridRotationThreshold = 0.005;
+// The full occupancy grid is republished at least this often, even if only
+// partial updates were necessary.
+constexpr double kOccupancyGridFullPublishPeriodSec = 10.;
+
 }  // namespace cartographer_ros
 
 #endif  // CARTOGRAPHER_ROS_NODE_CONSTANTS_H_
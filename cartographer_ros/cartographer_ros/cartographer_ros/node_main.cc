@@ -35,6 +35,11 @@ DEFINE_string(configuration_basename, "",
               "Basename, i.e. not containing any directory prefix, of the "
               "configuration file.");
 DEFINE_string(map_filename, "", "If non-empty, filename of a map to load.");
+DEFINE_double(map_load_radius, 0.,
+              "If positive, only submaps of the map within this distance of "
+              "'map_load_center_x' and 'map_load_center_y' are loaded.");
+DEFINE_double(map_load_center_x, 0., "See 'map_load_radius'.");
+DEFINE_double(map_load_center_y, 0., "See 'map_load_radius'.");
 
 namespace cartographer_ros {
 namespace {
@@ -62,7 +67,18 @@ void Run() {
 
   Node node(node_options, &tf_buffer);
   if (!FLAGS_map_filename.empty()) {
-    node.LoadMap(FLAGS_map_filename);
+    cartographer::mapping::MapBuilder::SubmapFilter submap_filter;
+    if (FLAGS_map_load_radius > 0.) {
+      const Eigen::Vector2d center(FLAGS_map_load_center_x,
+                                   FLAGS_map_load_center_y);
+      submap_filter = [center](
+          const cartographer::mapping::SubmapId&,
+          const cartographer::transform::Rigid3d& submap_pose) {
+        return (submap_pose.translation().head<2>() - center).norm() <=
+               FLAGS_map_load_radius;
+      };
+    }
+    node.LoadMap(FLAGS_map_filename, submap_filter);
   }
   node.StartTrajectoryWithDefaultTopics(trajectory_options);
 
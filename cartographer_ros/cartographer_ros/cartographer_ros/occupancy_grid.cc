@@ -20,6 +20,7 @@
 #include "cartographer_ros/map_writer.h"
 #include "cartographer/transform/transform.h"
 
+#include "cartographer/common/make_unique.h"
 #include "cartographer/common/port.h"
 #include "cartographer/mapping_2d/probability_grid.h"
 #include "cartographer/mapping_2d/range_data_inserter.h"
@@ -108,6 +109,29 @@ Eigen::AlignedBox2f ComputeMapBoundingBox2D(
   return bounding_box;
 }
 
+// Edge length of the tiles in which changes are tracked, in cells.
+constexpr int kTileSizeInCells = 64;
+
+// Returns the range data of 'node' in the map frame if the node is at 'pose'.
+::cartographer::sensor::RangeData TransformedRangeData(
+    const ::cartographer::mapping::TrajectoryNode& node,
+    const ::cartographer::transform::Rigid3d& pose) {
+  return ::cartographer::sensor::TransformRangeData(
+      Decompress(node.constant_data->range_data), pose.cast<float>());
+}
+
+Eigen::AlignedBox2f ComputeBoundingBox(
+    const ::cartographer::sensor::RangeData& range_data) {
+  Eigen::AlignedBox2f bounding_box(range_data.origin.head<2>());
+  for (const Eigen::Vector3f& hit : range_data.returns) {
+    bounding_box.extend(hit.head<2>());
+  }
+  for (const Eigen::Vector3f& miss : range_data.misses) {
+    bounding_box.extend(miss.head<2>());
+  }
+  return bounding_box;
+}
+
 }  // namespace
 
 namespace cartographer_ros {
@@ -221,4 +245,318 @@ void BuildOccupancyGrid2D(
           ::cartographer::common::RoundToInt(pixel_sizes.x())));
 }
 
+IncrementalOccupancyGrid::IncrementalOccupancyGrid(
+    const ::cartographer::mapping_2d::proto::SubmapsOptions& submaps_options,
+    const double translation_threshold, const double rotation_threshold)
+    : submaps_options_(submaps_options),
+      translation_threshold_(translation_threshold),
+      rotation_threshold_(rotation_threshold),
+      range_data_inserter_(submaps_options.range_data_inserter_options()) {}
+
+bool IncrementalOccupancyGrid::Update(
+    const std::vector<std::vector<::cartographer::mapping::TrajectoryNode>>&
+        all_trajectory_nodes,
+    const string& map_frame) {
+  namespace carto = ::cartographer;
+  limits_changed_ = false;
+  updates_.clear();
+
+  const carto::mapping::TrajectoryNode* last_node = nullptr;
+  carto::common::Time latest_time = carto::common::Time::min();
+  for (const auto& trajectory_nodes : all_trajectory_nodes) {
+    for (const auto& node : trajectory_nodes) {
+      if (!node.trimmed()) {
+        latest_time = std::max(latest_time, node.time());
+        last_node = &node;
+      }
+    }
+  }
+  if (last_node == nullptr) {
+    return false;
+  }
+
+  if (probability_grid_ == nullptr) {
+    probability_grid_ =
+        carto::common::make_unique<carto::mapping_2d::ProbabilityGrid>(
+            ComputeMapLimits(submaps_options_.resolution(),
+                             all_trajectory_nodes));
+    limits_changed_ = true;
+  }
+
+  // Find the nodes which changed since the last update. Only these require
+  // decompressing their range data.
+  std::vector<std::pair<carto::mapping::NodeId, carto::sensor::RangeData>>
+      new_nodes;
+  std::vector<std::pair<carto::mapping::NodeId, InsertedNode>> moved_nodes;
+  std::vector<carto::mapping::NodeId> removed_nodes;
+  for (int trajectory_id = 0;
+       trajectory_id != static_cast<int>(all_trajectory_nodes.size());
+       ++trajectory_id) {
+    const auto& trajectory_nodes = all_trajectory_nodes[trajectory_id];
+    for (int node_index = 0;
+         node_index != static_cast<int>(trajectory_nodes.size());
+         ++node_index) {
+      const carto::mapping::NodeId node_id{trajectory_id, node_index};
+      const carto::mapping::TrajectoryNode& node = trajectory_nodes[node_index];
+      const auto it = inserted_nodes_.find(node_id);
+      if (node.trimmed()) {
+        if (it != inserted_nodes_.end()) {
+          removed_nodes.push_back(node_id);
+        }
+        continue;
+      }
+      if (it == inserted_nodes_.end()) {
+        new_nodes.emplace_back(node_id, TransformedRangeData(node, node.pose));
+      } else if (HasMoved(it->second, node.pose)) {
+        moved_nodes.emplace_back(
+            node_id,
+            InsertedNode{node.pose, ComputeBoundingBox(TransformedRangeData(
+                                        node, node.pose))});
+      }
+    }
+  }
+
+  // Grow the grid first, so that tile indices stay valid below.
+  const carto::mapping_2d::CellLimits old_cell_limits =
+      probability_grid_->limits().cell_limits();
+  for (const auto& new_node : new_nodes) {
+    GrowToContain(ComputeBoundingBox(new_node.second));
+  }
+  for (const auto& moved_node : moved_nodes) {
+    GrowToContain(moved_node.second.bounding_box);
+  }
+  const carto::mapping_2d::CellLimits& cell_limits =
+      probability_grid_->limits().cell_limits();
+  if (cell_limits.num_x_cells != old_cell_limits.num_x_cells ||
+      cell_limits.num_y_cells != old_cell_limits.num_y_cells) {
+    limits_changed_ = true;
+  }
+
+  // Cells touched by moved or removed nodes cannot be updated in place, since
+  // odds cannot be taken back out of a cell. These tiles are rebuilt.
+  std::set<TileIndex> rebuild_tiles;
+  for (const auto& moved_node : moved_nodes) {
+    InsertedNode& inserted_node = inserted_nodes_.at(moved_node.first);
+    AddTiles(inserted_node.bounding_box, &rebuild_tiles);
+    AddTiles(moved_node.second.bounding_box, &rebuild_tiles);
+    inserted_node = moved_node.second;
+  }
+  for (const carto::mapping::NodeId& node_id : removed_nodes) {
+    AddTiles(inserted_nodes_.at(node_id).bounding_box, &rebuild_tiles);
+    inserted_nodes_.erase(node_id);
+  }
+
+  std::set<TileIndex> dirty_tiles;
+  for (const auto& new_node : new_nodes) {
+    const carto::mapping::TrajectoryNode& node =
+        all_trajectory_nodes[new_node.first.trajectory_id]
+                            [new_node.first.node_index];
+    range_data_inserter_.Insert(new_node.second, probability_grid_.get());
+    const Eigen::AlignedBox2f bounding_box =
+        ComputeBoundingBox(new_node.second);
+    AddTiles(bounding_box, &dirty_tiles);
+    inserted_nodes_[new_node.first] = InsertedNode{node.pose, bounding_box};
+  }
+  if (!rebuild_tiles.empty()) {
+    RebuildTiles(all_trajectory_nodes, rebuild_tiles);
+    dirty_tiles.insert(rebuild_tiles.begin(), rebuild_tiles.end());
+  }
+  if (!moved_nodes.empty() || !removed_nodes.empty()) {
+    VLOG(1) << "Rebuilt " << rebuild_tiles.size() << " tiles for "
+            << moved_nodes.size() << " moved and " << removed_nodes.size()
+            << " trimmed nodes.";
+  }
+
+  const carto::mapping_2d::MapLimits& limits = probability_grid_->limits();
+  const double resolution = limits.resolution();
+  occupancy_grid_.header.stamp = ToRos(latest_time);
+  occupancy_grid_.header.frame_id = map_frame;
+  occupancy_grid_.info.map_load_time = occupancy_grid_.header.stamp;
+  occupancy_grid_.info.resolution = resolution;
+  occupancy_grid_.info.width = cell_limits.num_y_cells;
+  occupancy_grid_.info.height = cell_limits.num_x_cells;
+
+  // Like BuildOccupancyGrid2D(), the origin carries the cell of the most
+  // recent range data origin relative to the lower corner of the map, and the
+  // orientation of its node.
+  const Eigen::Vector3f lidar_location =
+      last_node->pose.cast<float>() *
+      last_node->constant_data->range_data.origin;
+  const double min_x = limits.max().x() - cell_limits.num_y_cells * resolution;
+  const double min_y = limits.max().y() - cell_limits.num_x_cells * resolution;
+  occupancy_grid_.info.origin.position.x =
+      carto::common::RoundToInt((lidar_location.x() - min_x) / resolution);
+  occupancy_grid_.info.origin.position.y =
+      cell_limits.num_x_cells -
+      carto::common::RoundToInt((lidar_location.y() - min_y) / resolution);
+  occupancy_grid_.info.origin.position.z =
+      carto::transform::GetYaw(last_node->pose.rotation());
+  occupancy_grid_.info.origin.orientation.w = last_node->pose.rotation().w();
+  occupancy_grid_.info.origin.orientation.x = last_node->pose.rotation().x();
+  occupancy_grid_.info.origin.orientation.y = last_node->pose.rotation().y();
+  occupancy_grid_.info.origin.orientation.z = last_node->pose.rotation().z();
+
+  if (limits_changed_) {
+    occupancy_grid_.data.assign(
+        cell_limits.num_x_cells * cell_limits.num_y_cells, -1);
+    UpdateCells(Eigen::AlignedBox2i(
+        Eigen::Vector2i::Zero(), Eigen::Vector2i(cell_limits.num_x_cells - 1,
+                                                 cell_limits.num_y_cells - 1)));
+  } else {
+    for (const TileIndex& tile_index : dirty_tiles) {
+      const Eigen::AlignedBox2i cell_box = GetTileCellBox(tile_index);
+      UpdateCells(cell_box);
+      updates_.push_back(ExtractUpdate(cell_box));
+    }
+  }
+  return true;
+}
+
+bool IncrementalOccupancyGrid::HasMoved(
+    const InsertedNode& inserted_node,
+    const ::cartographer::transform::Rigid3d& pose) const {
+  const ::cartographer::transform::Rigid3d delta =
+      inserted_node.pose.inverse() * pose;
+  return delta.translation().norm() > translation_threshold_ ||
+         ::cartographer::transform::GetAngle(delta) > rotation_threshold_;
+}
+
+void IncrementalOccupancyGrid::GrowToContain(
+    const Eigen::AlignedBox2f& bounding_box) {
+  // Add some padding to ensure all rays are still contained in the map after
+  // discretization.
+  const float padding = 3.f * submaps_options_.resolution();
+  probability_grid_->GrowLimits(bounding_box.min() -
+                                padding * Eigen::Vector2f::Ones());
+  probability_grid_->GrowLimits(bounding_box.max() +
+                                padding * Eigen::Vector2f::Ones());
+}
+
+void IncrementalOccupancyGrid::AddTiles(
+    const Eigen::AlignedBox2f& bounding_box,
+    std::set<TileIndex>* const tiles) const {
+  const ::cartographer::mapping_2d::MapLimits& limits =
+      probability_grid_->limits();
+  const Eigen::Array2i first_corner = limits.GetCellIndex(bounding_box.min());
+  const Eigen::Array2i second_corner = limits.GetCellIndex(bounding_box.max());
+  // The cells of the bounding box corners are extended by one to account for
+  // discretization of the rays.
+  const Eigen::Array2i max_cell_index(limits.cell_limits().num_x_cells - 1,
+                                      limits.cell_limits().num_y_cells - 1);
+  const Eigen::Array2i min_tile =
+      (first_corner.min(second_corner) - Eigen::Array2i::Ones())
+          .max(Eigen::Array2i::Zero())
+          .min(max_cell_index) /
+      kTileSizeInCells;
+  const Eigen::Array2i max_tile =
+      (first_corner.max(second_corner) + Eigen::Array2i::Ones())
+          .max(Eigen::Array2i::Zero())
+          .min(max_cell_index) /
+      kTileSizeInCells;
+  for (int x = min_tile.x(); x <= max_tile.x(); ++x) {
+    for (int y = min_tile.y(); y <= max_tile.y(); ++y) {
+      tiles->emplace(x, y);
+    }
+  }
+}
+
+bool IncrementalOccupancyGrid::IntersectsTiles(
+    const Eigen::AlignedBox2f& bounding_box,
+    const std::set<TileIndex>& tiles) const {
+  std::set<TileIndex> node_tiles;
+  AddTiles(bounding_box, &node_tiles);
+  for (const TileIndex& tile_index : node_tiles) {
+    if (tiles.count(tile_index) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Eigen::AlignedBox2i IncrementalOccupancyGrid::GetTileCellBox(
+    const TileIndex& tile_index) const {
+  const ::cartographer::mapping_2d::CellLimits& cell_limits =
+      probability_grid_->limits().cell_limits();
+  const Eigen::Vector2i min(tile_index.first * kTileSizeInCells,
+                            tile_index.second * kTileSizeInCells);
+  const Eigen::Vector2i max(
+      std::min(min.x() + kTileSizeInCells, cell_limits.num_x_cells) - 1,
+      std::min(min.y() + kTileSizeInCells, cell_limits.num_y_cells) - 1);
+  return Eigen::AlignedBox2i(min, max);
+}
+
+void IncrementalOccupancyGrid::RebuildTiles(
+    const std::vector<std::vector<::cartographer::mapping::TrajectoryNode>>&
+        all_trajectory_nodes,
+    const std::set<TileIndex>& tiles) {
+  namespace carto = ::cartographer;
+  // All inserted nodes are contained in the current limits, so the scratch grid
+  // will not grow and its cells line up with 'probability_grid_'.
+  carto::mapping_2d::ProbabilityGrid scratch_grid(probability_grid_->limits());
+  for (const auto& entry : inserted_nodes_) {
+    if (!IntersectsTiles(entry.second.bounding_box, tiles)) {
+      continue;
+    }
+    const carto::mapping::TrajectoryNode& node =
+        all_trajectory_nodes[entry.first.trajectory_id]
+                            [entry.first.node_index];
+    range_data_inserter_.Insert(TransformedRangeData(node, entry.second.pose),
+                                &scratch_grid);
+  }
+  CHECK_EQ(scratch_grid.limits().cell_limits().num_x_cells,
+           probability_grid_->limits().cell_limits().num_x_cells);
+  CHECK_EQ(scratch_grid.limits().cell_limits().num_y_cells,
+           probability_grid_->limits().cell_limits().num_y_cells);
+  for (const TileIndex& tile_index : tiles) {
+    probability_grid_->CopyCellsFrom(scratch_grid, GetTileCellBox(tile_index));
+  }
+}
+
+void IncrementalOccupancyGrid::UpdateCells(
+    const Eigen::AlignedBox2i& cell_box) {
+  namespace carto = ::cartographer;
+  const carto::mapping_2d::CellLimits& cell_limits =
+      probability_grid_->limits().cell_limits();
+  for (const Eigen::Array2i& xy_index :
+       carto::mapping_2d::XYIndexRangeIterator(cell_box.min().array(),
+                                               cell_box.max().array())) {
+    int value = -1;
+    if (probability_grid_->IsKnown(xy_index)) {
+      value = carto::common::RoundToInt(
+          (probability_grid_->GetProbability(xy_index) -
+           carto::mapping::kMinProbability) *
+          100. /
+          (carto::mapping::kMaxProbability - carto::mapping::kMinProbability));
+      CHECK_LE(0, value);
+      CHECK_GE(100, value);
+    }
+    occupancy_grid_.data[(cell_limits.num_x_cells - xy_index.x()) *
+                             cell_limits.num_y_cells -
+                         xy_index.y() - 1] = value;
+  }
+}
+
+::map_msgs::OccupancyGridUpdate IncrementalOccupancyGrid::ExtractUpdate(
+    const Eigen::AlignedBox2i& cell_box) const {
+  const ::cartographer::mapping_2d::CellLimits& cell_limits =
+      probability_grid_->limits().cell_limits();
+  // Cell (x, y) is stored in row 'num_x_cells - 1 - x' and column
+  // 'num_y_cells - 1 - y' of the OccupancyGrid.
+  ::map_msgs::OccupancyGridUpdate update;
+  update.header = occupancy_grid_.header;
+  update.x = cell_limits.num_y_cells - 1 - cell_box.max().y();
+  update.y = cell_limits.num_x_cells - 1 - cell_box.max().x();
+  update.width = cell_box.max().y() - cell_box.min().y() + 1;
+  update.height = cell_box.max().x() - cell_box.min().x() + 1;
+  update.data.reserve(update.width * update.height);
+  for (int row = 0; row != static_cast<int>(update.height); ++row) {
+    const auto row_begin = occupancy_grid_.data.begin() +
+                           (update.y + row) * cell_limits.num_y_cells +
+                           update.x;
+    update.data.insert(update.data.end(), row_begin,
+                       row_begin + update.width);
+  }
+  return update;
+}
+
 }  // namespace cartographer_ros
@@ -17,13 +17,22 @@
 #ifndef CARTOGRAPHER_ROS_OCCUPANCY_GRID_H_
 #define CARTOGRAPHER_ROS_OCCUPANCY_GRID_H_
 
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
 #include <vector>
 
 #include "Eigen/Core"
 #include "Eigen/Geometry"
+#include "cartographer/mapping/id.h"
 #include "cartographer/mapping/trajectory_node.h"
 #include "cartographer/mapping_2d/map_limits.h"
+#include "cartographer/mapping_2d/probability_grid.h"
 #include "cartographer/mapping_2d/proto/submaps_options.pb.h"
+#include "cartographer/mapping_2d/range_data_inserter.h"
+#include "cartographer/transform/rigid_transform.h"
+#include "map_msgs/OccupancyGridUpdate.h"
 #include "nav_msgs/OccupancyGrid.h"
 
 namespace cartographer_ros {
@@ -42,6 +51,85 @@ void BuildOccupancyGrid2D(
     const std::vector<std::vector<::cartographer::mapping::TrajectoryNode>>&
         all_trajectory_nodes);
 
+// Maintains a global ProbabilityGrid across calls to Update(), so that only
+// nodes which are new, trimmed, or whose optimized pose changed by more than
+// the given thresholds since they were last inserted cause ray casting. The
+// grid is divided into square tiles; tiles touched by changed nodes are rebuilt
+// from the nodes overlapping them and only those tiles of the published
+// OccupancyGrid are converted again.
+class IncrementalOccupancyGrid {
+ public:
+  IncrementalOccupancyGrid(
+      const ::cartographer::mapping_2d::proto::SubmapsOptions& submaps_options,
+      double translation_threshold, double rotation_threshold);
+
+  IncrementalOccupancyGrid(const IncrementalOccupancyGrid&) = delete;
+  IncrementalOccupancyGrid& operator=(const IncrementalOccupancyGrid&) = delete;
+
+  // Brings the grid up to date with 'all_trajectory_nodes'. Returns false if
+  // there is no non-trimmed node yet.
+  bool Update(
+      const std::vector<std::vector<::cartographer::mapping::TrajectoryNode>>&
+          all_trajectory_nodes,
+      const string& map_frame);
+
+  // The full grid in the layout of BuildOccupancyGrid2D().
+  const ::nav_msgs::OccupancyGrid& occupancy_grid() const {
+    return occupancy_grid_;
+  }
+
+  // True if the grid was resized in the last call to Update(). The full
+  // 'occupancy_grid()' has to be republished in this case since 'updates()'
+  // are relative to the previous size.
+  bool limits_changed() const { return limits_changed_; }
+
+  // One update per tile which changed in the last call to Update().
+  const std::vector<::map_msgs::OccupancyGridUpdate>& updates() const {
+    return updates_;
+  }
+
+ private:
+  using TileIndex = std::pair<int, int>;
+
+  struct InsertedNode {
+    ::cartographer::transform::Rigid3d pose;
+    // Bounding box in the map frame of the range data inserted at 'pose'.
+    Eigen::AlignedBox2f bounding_box;
+  };
+
+  bool HasMoved(const InsertedNode& inserted_node,
+                const ::cartographer::transform::Rigid3d& pose) const;
+  void GrowToContain(const Eigen::AlignedBox2f& bounding_box);
+  void AddTiles(const Eigen::AlignedBox2f& bounding_box,
+                std::set<TileIndex>* tiles) const;
+  bool IntersectsTiles(const Eigen::AlignedBox2f& bounding_box,
+                       const std::set<TileIndex>& tiles) const;
+  Eigen::AlignedBox2i GetTileCellBox(const TileIndex& tile_index) const;
+
+  // Re-inserts all nodes overlapping 'tiles' into a scratch grid at their
+  // current pose and copies the cells of 'tiles' into 'probability_grid_'.
+  void RebuildTiles(
+      const std::vector<std::vector<::cartographer::mapping::TrajectoryNode>>&
+          all_trajectory_nodes,
+      const std::set<TileIndex>& tiles);
+
+  void UpdateCells(const Eigen::AlignedBox2i& cell_box);
+  ::map_msgs::OccupancyGridUpdate ExtractUpdate(
+      const Eigen::AlignedBox2i& cell_box) const;
+
+  const ::cartographer::mapping_2d::proto::SubmapsOptions submaps_options_;
+  const double translation_threshold_;
+  const double rotation_threshold_;
+  const ::cartographer::mapping_2d::RangeDataInserter range_data_inserter_;
+
+  std::unique_ptr<::cartographer::mapping_2d::ProbabilityGrid>
+      probability_grid_;
+  std::map<::cartographer::mapping::NodeId, InsertedNode> inserted_nodes_;
+  ::nav_msgs::OccupancyGrid occupancy_grid_;
+  bool limits_changed_ = false;
+  std::vector<::map_msgs::OccupancyGridUpdate> updates_;
+};
+
 }  // namespace cartographer_ros
 
 #endif  // CARTOGRAPHER_ROS_OCCUPANCY_GRID_H_
@@ -19,7 +19,9 @@
 #include <memory>
 
 #include "cartographer/common/time.h"
+#include "cartographer/mapping_2d/proto/submaps_options.pb.h"
 #include "cartographer/sensor/range_data.h"
+#include "cartographer/transform/transform.h"
 #include "gtest/gtest.h"
 #include "ros/ros.h"
 
@@ -50,5 +52,85 @@ TEST(OccupancyGridTest, ComputeMapLimits) {
   EXPECT_GT(2000, limits.cell_limits().num_y_cells);
 }
 
+::cartographer::mapping::TrajectoryNode CreateNode(
+    const ::cartographer::sensor::PointCloud& returns,
+    const ::cartographer::transform::Rigid3d& pose) {
+  using ::cartographer::mapping::TrajectoryNode;
+  return TrajectoryNode{
+      std::make_shared<TrajectoryNode::Data>(TrajectoryNode::Data{
+          ::cartographer::common::FromUniversal(52),
+          ::cartographer::sensor::Compress(::cartographer::sensor::RangeData{
+              Eigen::Vector3f::Zero(), returns, {}}),
+          ::cartographer::transform::Rigid3d::Identity()}),
+      pose};
+}
+
+::cartographer::mapping_2d::proto::SubmapsOptions CreateSubmapsOptions() {
+  ::cartographer::mapping_2d::proto::SubmapsOptions options;
+  options.set_resolution(0.05);
+  options.mutable_range_data_inserter_options()->set_hit_probability(0.55);
+  options.mutable_range_data_inserter_options()->set_miss_probability(0.49);
+  options.mutable_range_data_inserter_options()->set_insert_free_space(true);
+  return options;
+}
+
+TEST(OccupancyGridTest, IncrementalOccupancyGridOnlyUpdatesChangedTiles) {
+  using ::cartographer::transform::Rigid3d;
+  std::vector<std::vector<::cartographer::mapping::TrajectoryNode>>
+      all_trajectory_nodes(1);
+  all_trajectory_nodes[0].push_back(
+      CreateNode({Eigen::Vector3f(-20.f, -20.f, 0.f),
+                  Eigen::Vector3f(20.f, 20.f, 0.f)},
+                 Rigid3d::Identity()));
+  IncrementalOccupancyGrid incremental_occupancy_grid(CreateSubmapsOptions(),
+                                                      0.1, 0.01);
+  ASSERT_TRUE(incremental_occupancy_grid.Update(all_trajectory_nodes, "map"));
+  EXPECT_TRUE(incremental_occupancy_grid.limits_changed());
+  EXPECT_TRUE(incremental_occupancy_grid.updates().empty());
+  const ::nav_msgs::OccupancyGrid& occupancy_grid =
+      incremental_occupancy_grid.occupancy_grid();
+  EXPECT_EQ(occupancy_grid.info.width * occupancy_grid.info.height,
+            occupancy_grid.data.size());
+
+  // Nothing changed, so nothing is published.
+  ASSERT_TRUE(incremental_occupancy_grid.Update(all_trajectory_nodes, "map"));
+  EXPECT_FALSE(incremental_occupancy_grid.limits_changed());
+  EXPECT_TRUE(incremental_occupancy_grid.updates().empty());
+
+  // A new node only touches a few tiles.
+  all_trajectory_nodes[0].push_back(
+      CreateNode({Eigen::Vector3f(1.f, 0.f, 0.f)},
+                 Rigid3d::Translation(Eigen::Vector3d(5., 5., 0.))));
+  ASSERT_TRUE(incremental_occupancy_grid.Update(all_trajectory_nodes, "map"));
+  EXPECT_FALSE(incremental_occupancy_grid.limits_changed());
+  EXPECT_FALSE(incremental_occupancy_grid.updates().empty());
+  EXPECT_GT(4, incremental_occupancy_grid.updates().size());
+
+  // Moving the node below the threshold does not trigger any work.
+  all_trajectory_nodes[0][1].pose =
+      Rigid3d::Translation(Eigen::Vector3d(5.05, 5., 0.));
+  ASSERT_TRUE(incremental_occupancy_grid.Update(all_trajectory_nodes, "map"));
+  EXPECT_TRUE(incremental_occupancy_grid.updates().empty());
+
+  // Moving it further rebuilds the affected tiles, which gives the same result
+  // as building the grid from scratch.
+  all_trajectory_nodes[0][1].pose =
+      Rigid3d(Eigen::Vector3d(-3., 2., 0.),
+              ::cartographer::transform::RollPitchYaw(0., 0., 1.));
+  ASSERT_TRUE(incremental_occupancy_grid.Update(all_trajectory_nodes, "map"));
+  EXPECT_FALSE(incremental_occupancy_grid.limits_changed());
+  EXPECT_FALSE(incremental_occupancy_grid.updates().empty());
+
+  IncrementalOccupancyGrid expected_occupancy_grid(CreateSubmapsOptions(), 0.1,
+                                                   0.01);
+  ASSERT_TRUE(expected_occupancy_grid.Update(all_trajectory_nodes, "map"));
+  EXPECT_EQ(expected_occupancy_grid.occupancy_grid().info.width,
+            occupancy_grid.info.width);
+  EXPECT_EQ(expected_occupancy_grid.occupancy_grid().info.height,
+            occupancy_grid.info.height);
+  EXPECT_EQ(expected_occupancy_grid.occupancy_grid().data,
+            occupancy_grid.data);
+}
+
 }  // namespace
 }  // namespace cartographer_ros
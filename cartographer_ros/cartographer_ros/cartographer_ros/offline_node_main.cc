@@ -17,17 +17,25 @@
 #include <time.h>
 #include <chrono>
 #include <csignal>
+#include <deque>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "cartographer/common/blocking_queue.h"
 #include "cartographer/common/configuration_file_resolver.h"
 #include "cartographer/common/lua_parameter_dictionary.h"
 #include "cartographer/common/make_unique.h"
+#include "cartographer/common/mutex.h"
 #include "cartographer/common/port.h"
+#include "cartographer/common/thread_pool.h"
 #include "cartographer_ros/node.h"
 #include "cartographer_ros/node_options.h"
 #include "cartographer_ros/ros_log_sink.h"
+#include "cartographer_ros/sensor_bridge.h"
 #include "cartographer_ros/split_string.h"
 #include "cartographer_ros/urdf_reader.h"
 #include "gflags/gflags.h"
@@ -54,6 +62,9 @@ DEFINE_bool(use_bag_transforms, true,
             "Whether to read, use and republish the transforms from the bag.");
 DEFINE_string(pbstream_filename, "",
               "If non-empty, filename of a pbstream to load.");
+DEFINE_int32(num_conversion_threads, 4,
+             "Number of threads converting rangefinder data into the tracking "
+             "frame ahead of SLAM.");
 
 namespace cartographer_ros {
 namespace {
@@ -62,11 +73,179 @@ constexpr char kClockTopic[] = "clock";
 constexpr char kTfStaticTopic[] = "/tf_static";
 constexpr char kTfTopic[] = "tf";
 constexpr int kLatestOnlyPublisherQueueSize = 1;
+// Bound on the messages read ahead of SLAM.
+constexpr int kMaxNumPendingMessages = 1000;
+// Bound on the bag time by which messages are read ahead of SLAM. Transforms
+// are added to the tf2 buffer when read, and IMU and odometry data are only
+// transformed on the SLAM thread. Together with the 1 s by which data messages
+// are delayed behind the transforms, this must stay well below the 10 s cache
+// of the tf2 buffer, or lookups fail and data is dropped.
+constexpr double kMaxReadAheadSeconds = 5.;
 
 volatile std::sig_atomic_t sigint_triggered = 0;
 
 void SigintHandler(int) { sigint_triggered = 1; }
 
+// A message on its way from the reader thread to the SLAM thread. IMU and
+// odometry messages are handled on the SLAM thread, since the SensorBridge
+// keeps state for them. Rangefinder messages are converted into the tracking
+// frame on the thread pool.
+struct PendingMessage {
+  ::ros::Time time;
+  string topic;
+  sensor_msgs::Imu::ConstPtr imu;
+  nav_msgs::Odometry::ConstPtr odometry;
+
+  cartographer::common::Mutex mutex;
+  bool converted GUARDED_BY(mutex) = false;
+  std::unique_ptr<SensorBridge::TransformedRangefinderData> rangefinder_data
+      GUARDED_BY(mutex);
+};
+
+// Keeps the reader thread from getting more than 'kMaxReadAheadSeconds' of bag
+// time ahead of the messages handled by the SLAM thread.
+class ReadAheadLimiter {
+ public:
+  explicit ReadAheadLimiter(const ::ros::Time& begin_time)
+      : last_handled_time_(begin_time) {}
+
+  // Blocks until a message at 'time' may be read ahead. Messages are always
+  // let through if SLAM has handled all pushed ones, so that gaps in the bag
+  // do not block reading.
+  void WaitToRead(const ::ros::Time& time) {
+    cartographer::common::MutexLocker lock(&mutex_);
+    lock.Await([this, &time]() REQUIRES(mutex_) {
+      return num_handled_ == num_pushed_ ||
+             (time - last_handled_time_).toSec() < kMaxReadAheadSeconds;
+    });
+  }
+
+  // Called by the reader thread for each message pushed to SLAM.
+  void Pushed() {
+    cartographer::common::MutexLocker lock(&mutex_);
+    ++num_pushed_;
+  }
+
+  // Called by the SLAM thread for each pushed message, in order.
+  void Handled(const ::ros::Time& time) {
+    cartographer::common::MutexLocker lock(&mutex_);
+    ++num_handled_;
+    last_handled_time_ = time;
+  }
+
+ private:
+  cartographer::common::Mutex mutex_;
+  int64 num_pushed_ GUARDED_BY(mutex_) = 0;
+  int64 num_handled_ GUARDED_BY(mutex_) = 0;
+  ::ros::Time last_handled_time_ GUARDED_BY(mutex_);
+};
+
+// Converts the rangefinder message 'msg' of 'pending_message' on the thread
+// pool.
+template <typename MessageType>
+void ScheduleConversion(
+    const typename MessageType::ConstPtr& msg,
+    std::unique_ptr<SensorBridge::TransformedRangefinderData> (
+        SensorBridge::*transform)(const boost::shared_ptr<const MessageType>&)
+        const,
+    const SensorBridge* const sensor_bridge,
+    const std::shared_ptr<PendingMessage>& pending_message,
+    cartographer::common::ThreadPool* const thread_pool) {
+  thread_pool->Schedule([msg, transform, sensor_bridge, pending_message]() {
+    auto rangefinder_data = (sensor_bridge->*transform)(msg);
+    cartographer::common::MutexLocker lock(&pending_message->mutex);
+    pending_message->rangefinder_data = std::move(rangefinder_data);
+    pending_message->converted = true;
+  });
+}
+
+// Reads and deserializes the messages in 'view', adding the transforms to
+// 'tf_buffer'. Sensor messages are scheduled for conversion and pushed in bag
+// order onto 'pending_messages', followed by nullptr once done. Reading waits
+// on 'read_ahead_limiter' to not get too far ahead of SLAM in bag time.
+void ReadBag(rosbag::View* const view,
+             const std::unordered_set<string>& expected_sensor_ids,
+             const ::ros::NodeHandle& node_handle,
+             const SensorBridge* const sensor_bridge,
+             tf2_ros::Buffer* const tf_buffer,
+             ::ros::Publisher* const tf_publisher,
+             cartographer::common::ThreadPool* const thread_pool,
+             ReadAheadLimiter* const read_ahead_limiter,
+             cartographer::common::BlockingQueue<
+                 std::shared_ptr<PendingMessage>>* const pending_messages) {
+  const auto schedule = [&](
+      const rosbag::MessageInstance& msg,
+      const std::shared_ptr<PendingMessage>& pending_message) {
+    read_ahead_limiter->WaitToRead(pending_message->time);
+    if (msg.isType<sensor_msgs::LaserScan>()) {
+      ScheduleConversion(msg.instantiate<sensor_msgs::LaserScan>(),
+                         &SensorBridge::TransformLaserScanMessage,
+                         sensor_bridge, pending_message, thread_pool);
+    } else if (msg.isType<sensor_msgs::MultiEchoLaserScan>()) {
+      ScheduleConversion(msg.instantiate<sensor_msgs::MultiEchoLaserScan>(),
+                         &SensorBridge::TransformMultiEchoLaserScanMessage,
+                         sensor_bridge, pending_message, thread_pool);
+    } else if (msg.isType<sensor_msgs::PointCloud2>()) {
+      ScheduleConversion(msg.instantiate<sensor_msgs::PointCloud2>(),
+                         &SensorBridge::TransformPointCloud2Message,
+                         sensor_bridge, pending_message, thread_pool);
+    } else if (msg.isType<sensor_msgs::Imu>()) {
+      pending_message->imu = msg.instantiate<sensor_msgs::Imu>();
+    } else if (msg.isType<nav_msgs::Odometry>()) {
+      pending_message->odometry = msg.instantiate<nav_msgs::Odometry>();
+    } else {
+      return;
+    }
+    read_ahead_limiter->Pushed();
+    pending_messages->Push(pending_message);
+  };
+
+  // We make sure that tf_messages are read before any data messages are
+  // converted, so that tf lookups always work and that tf_buffer has a small
+  // cache size - because it gets very inefficient with a large one.
+  std::deque<std::pair<rosbag::MessageInstance,
+                       std::shared_ptr<PendingMessage>>>
+      delayed_messages;
+  for (const rosbag::MessageInstance& msg : *view) {
+    if (sigint_triggered) {
+      break;
+    }
+
+    if (FLAGS_use_bag_transforms && msg.isType<tf2_msgs::TFMessage>()) {
+      auto tf_message = msg.instantiate<tf2_msgs::TFMessage>();
+      tf_publisher->publish(tf_message);
+
+      for (const auto& transform : tf_message->transforms) {
+        try {
+          tf_buffer->setTransform(transform, "unused_authority",
+                                  msg.getTopic() == kTfStaticTopic);
+        } catch (const tf2::TransformException& ex) {
+          LOG(WARNING) << ex.what();
+        }
+      }
+    }
+
+    while (!delayed_messages.empty() &&
+           delayed_messages.front().first.getTime() <
+               msg.getTime() - ::ros::Duration(1.)) {
+      schedule(delayed_messages.front().first,
+               delayed_messages.front().second);
+      delayed_messages.pop_front();
+    }
+
+    const string topic =
+        node_handle.resolveName(msg.getTopic(), false /* resolve */);
+    if (expected_sensor_ids.count(topic) == 0) {
+      continue;
+    }
+    auto pending_message = std::make_shared<PendingMessage>();
+    pending_message->time = msg.getTime();
+    pending_message->topic = topic;
+    delayed_messages.emplace_back(msg, std::move(pending_message));
+  }
+  pending_messages->Push(nullptr);
+}
+
 // TODO(hrapp): This is duplicated in node_main.cc. Pull out into a config
 // unit.
 std::tuple<NodeOptions, TrajectoryOptions> LoadOptions() {
@@ -165,6 +344,8 @@ void Run(const std::vector<string>& bag_filenames) {
     static_tf_broadcaster.sendTransform(urdf_transforms);
   }
 
+  cartographer::common::ThreadPool thread_pool(FLAGS_num_conversion_threads);
+  double bag_seconds = 0.;
   for (const string& bag_filename : bag_filenames) {
     if (sigint_triggered) {
       break;
@@ -179,86 +360,52 @@ void Run(const std::vector<string>& bag_filenames) {
     const ::ros::Time begin_time = view.getBeginTime();
     const double duration_in_seconds = (view.getEndTime() - begin_time).toSec();
 
-    // We make sure that tf_messages are published before any data messages, so
-    // that tf lookups always work and that tf_buffer has a small cache size -
-    // because it gets very inefficient with a large one.
-    std::deque<rosbag::MessageInstance> delayed_messages;
-    for (const rosbag::MessageInstance& msg : view) {
-      if (sigint_triggered) {
-        break;
-      }
-
-      if (FLAGS_use_bag_transforms && msg.isType<tf2_msgs::TFMessage>()) {
-        auto tf_message = msg.instantiate<tf2_msgs::TFMessage>();
-        tf_publisher.publish(tf_message);
-
-        for (const auto& transform : tf_message->transforms) {
-          try {
-            tf_buffer.setTransform(transform, "unused_authority",
-                                   msg.getTopic() == kTfStaticTopic);
-          } catch (const tf2::TransformException& ex) {
-            LOG(WARNING) << ex.what();
-          }
+    // Reads the bag on a separate thread, while the rangefinder data is
+    // converted on the thread pool and SLAM runs on this thread.
+    SensorBridge* const sensor_bridge =
+        node.map_builder_bridge()->sensor_bridge(trajectory_id);
+    cartographer::common::BlockingQueue<std::shared_ptr<PendingMessage>>
+        pending_messages(kMaxNumPendingMessages);
+    ReadAheadLimiter read_ahead_limiter(begin_time);
+    std::thread reader_thread([&]() {
+      ReadBag(&view, expected_sensor_ids, *node.node_handle(), sensor_bridge,
+              &tf_buffer, &tf_publisher, &thread_pool, &read_ahead_limiter,
+              &pending_messages);
+    });
+
+    ::ros::Time last_message_time = begin_time;
+    while (const std::shared_ptr<PendingMessage> pending_message =
+               pending_messages.Pop()) {
+      if (pending_message->imu != nullptr) {
+        sensor_bridge->HandleImuMessage(pending_message->topic,
+                                        pending_message->imu);
+      } else if (pending_message->odometry != nullptr) {
+        sensor_bridge->HandleOdometryMessage(pending_message->topic,
+                                             pending_message->odometry);
+      } else {
+        cartographer::common::MutexLocker lock(&pending_message->mutex);
+        lock.Await([&pending_message]() REQUIRES(pending_message->mutex) {
+          return pending_message->converted;
+        });
+        if (pending_message->rangefinder_data != nullptr) {
+          sensor_bridge->HandleTransformedRangefinderData(
+              pending_message->topic, *pending_message->rangefinder_data);
         }
       }
+      last_message_time = pending_message->time;
+      read_ahead_limiter.Handled(last_message_time);
+      rosgraph_msgs::Clock clock;
+      clock.clock = last_message_time;
+      clock_publisher.publish(clock);
 
-      while (!delayed_messages.empty() &&
-             delayed_messages.front().getTime() <
-                 msg.getTime() - ::ros::Duration(1.)) {
-        const rosbag::MessageInstance& delayed_msg = delayed_messages.front();
-        const string topic = node.node_handle()->resolveName(
-            delayed_msg.getTopic(), false /* resolve */);
-        if (delayed_msg.isType<sensor_msgs::LaserScan>()) {
-          node.map_builder_bridge()
-              ->sensor_bridge(trajectory_id)
-              ->HandleLaserScanMessage(
-                  topic, delayed_msg.instantiate<sensor_msgs::LaserScan>());
-        }
-        if (delayed_msg.isType<sensor_msgs::MultiEchoLaserScan>()) {
-          node.map_builder_bridge()
-              ->sensor_bridge(trajectory_id)
-              ->HandleMultiEchoLaserScanMessage(
-                  topic,
-                  delayed_msg.instantiate<sensor_msgs::MultiEchoLaserScan>());
-        }
-        if (delayed_msg.isType<sensor_msgs::PointCloud2>()) {
-          node.map_builder_bridge()
-              ->sensor_bridge(trajectory_id)
-              ->HandlePointCloud2Message(
-                  topic, delayed_msg.instantiate<sensor_msgs::PointCloud2>());
-        }
-        if (delayed_msg.isType<sensor_msgs::Imu>()) {
-          node.map_builder_bridge()
-              ->sensor_bridge(trajectory_id)
-              ->HandleImuMessage(topic,
-                                 delayed_msg.instantiate<sensor_msgs::Imu>());
-        }
-        if (delayed_msg.isType<nav_msgs::Odometry>()) {
-          node.map_builder_bridge()
-              ->sensor_bridge(trajectory_id)
-              ->HandleOdometryMessage(
-                  topic, delayed_msg.instantiate<nav_msgs::Odometry>());
-        }
-        rosgraph_msgs::Clock clock;
-        clock.clock = delayed_msg.getTime();
-        clock_publisher.publish(clock);
-
-        ::ros::spinOnce();
+      ::ros::spinOnce();
 
-        LOG_EVERY_N(INFO, 100000)
-            << "Processed " << (delayed_msg.getTime() - begin_time).toSec()
-            << " of " << duration_in_seconds << " bag time seconds...";
-
-        delayed_messages.pop_front();
-      }
-
-      const string topic =
-          node.node_handle()->resolveName(msg.getTopic(), false /* resolve */);
-      if (expected_sensor_ids.count(topic) == 0) {
-        continue;
-      }
-      delayed_messages.push_back(msg);
+      LOG_EVERY_N(INFO, 100000)
+          << "Processed " << (last_message_time - begin_time).toSec() << " of "
+          << duration_in_seconds << " bag time seconds...";
     }
+    reader_thread.join();
+    bag_seconds += (last_message_time - begin_time).toSec();
 
     bag.close();
     node.map_builder_bridge()->FinishTrajectory(trajectory_id);
@@ -272,6 +419,9 @@ void Run(const std::vector<string>& bag_filenames) {
           .count();
 
   LOG(INFO) << "Elapsed wall clock time: " << wall_clock_seconds << " s";
+  LOG(INFO) << "Processed " << bag_seconds << " s of bag time, i.e. "
+            << bag_seconds / wall_clock_seconds
+            << " bag seconds per wall clock second.";
 #ifdef __linux__
   timespec cpu_timespec = {};
   clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_timespec);
@@ -295,6 +445,8 @@ int main(int argc, char** argv) {
   CHECK(!FLAGS_configuration_basename.empty())
       << "-configuration_basename is missing.";
   CHECK(!FLAGS_bag_filenames.empty()) << "-bag_filenames is missing.";
+  CHECK_GT(FLAGS_num_conversion_threads, 0)
+      << "-num_conversion_threads must be positive.";
 
   std::signal(SIGINT, &::cartographer_ros::SigintHandler);
   ::ros::init(argc, argv, "cartographer_offline_node",
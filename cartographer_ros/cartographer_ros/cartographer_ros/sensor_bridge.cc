@@ -16,6 +16,7 @@
 
 #include "cartographer_ros/sensor_bridge.h"
 
+#include "cartographer/common/make_unique.h"
 #include "cartographer_ros/msg_conversion.h"
 #include "cartographer_ros/time_conversion.h"
 
@@ -451,43 +452,79 @@ void SensorBridge::HandleImuMessage(const string& sensor_id,
 
 void SensorBridge::HandleLaserScanMessage(
     const string& sensor_id, const sensor_msgs::LaserScan::ConstPtr& msg) {
-  HandleRangefinder(sensor_id, FromRos(msg->header.stamp), msg->header.frame_id,
-                    ToPointCloudWithIntensities(*msg).points);
+  const auto data = TransformLaserScanMessage(msg);
+  if (data != nullptr) {
+    HandleTransformedRangefinderData(sensor_id, *data);
+  }
 }
 
 void SensorBridge::HandleMultiEchoLaserScanMessage(
     const string& sensor_id,
     const sensor_msgs::MultiEchoLaserScan::ConstPtr& msg) {
-  HandleRangefinder(sensor_id, FromRos(msg->header.stamp), msg->header.frame_id,
-                    ToPointCloudWithIntensities(*msg).points);
+  const auto data = TransformMultiEchoLaserScanMessage(msg);
+  if (data != nullptr) {
+    HandleTransformedRangefinderData(sensor_id, *data);
+  }
 }
 
 void SensorBridge::HandlePointCloud2Message(
     const string& sensor_id, const sensor_msgs::PointCloud2::ConstPtr& msg) {
+  const auto data = TransformPointCloud2Message(msg);
+  if (data != nullptr) {
+    HandleTransformedRangefinderData(sensor_id, *data);
+  }
+}
+
+std::unique_ptr<SensorBridge::TransformedRangefinderData>
+SensorBridge::TransformLaserScanMessage(
+    const sensor_msgs::LaserScan::ConstPtr& msg) const {
+  return TransformRangefinder(FromRos(msg->header.stamp), msg->header.frame_id,
+                              ToPointCloudWithIntensities(*msg).points);
+}
+
+std::unique_ptr<SensorBridge::TransformedRangefinderData>
+SensorBridge::TransformMultiEchoLaserScanMessage(
+    const sensor_msgs::MultiEchoLaserScan::ConstPtr& msg) const {
+  return TransformRangefinder(FromRos(msg->header.stamp), msg->header.frame_id,
+                              ToPointCloudWithIntensities(*msg).points);
+}
+
+std::unique_ptr<SensorBridge::TransformedRangefinderData>
+SensorBridge::TransformPointCloud2Message(
+    const sensor_msgs::PointCloud2::ConstPtr& msg) const {
   pcl::PointCloud<pcl::PointXYZ> pcl_point_cloud;
   pcl::fromROSMsg(*msg, pcl_point_cloud);
   carto::sensor::PointCloud point_cloud;
   for (const auto& point : pcl_point_cloud) {
     point_cloud.emplace_back(point.x, point.y, point.z);
   }
-  HandleRangefinder(sensor_id, FromRos(msg->header.stamp), msg->header.frame_id,
-                    point_cloud);
+  return TransformRangefinder(FromRos(msg->header.stamp), msg->header.frame_id,
+                              point_cloud);
+}
+
+void SensorBridge::HandleTransformedRangefinderData(
+    const string& sensor_id, const TransformedRangefinderData& data) {
+  trajectory_builder_->AddRangefinderData(sensor_id, data.time, data.origin,
+                                          data.ranges);
 }
 
 const TfBridge& SensorBridge::tf_bridge() const { return tf_bridge_; }
 
-void SensorBridge::HandleRangefinder(const string& sensor_id,
-                                     const carto::common::Time time,
-                                     const string& frame_id,
-                                     const carto::sensor::PointCloud& ranges) {
+std::unique_ptr<SensorBridge::TransformedRangefinderData>
+SensorBridge::TransformRangefinder(const carto::common::Time time,
+                                   const string& frame_id,
+                                   const carto::sensor::PointCloud& ranges)
+    const {
   const auto sensor_to_tracking =
       tf_bridge_.LookupToTracking(time, CheckNoLeadingSlash(frame_id));
-  if (sensor_to_tracking != nullptr) {
-    trajectory_builder_->AddRangefinderData(
-        sensor_id, time, sensor_to_tracking->translation().cast<float>(),
-        carto::sensor::TransformPointCloud(ranges,
-                                           sensor_to_tracking->cast<float>()));
+  if (sensor_to_tracking == nullptr) {
+    return nullptr;
   }
+  return carto::common::make_unique<TransformedRangefinderData>(
+      TransformedRangefinderData{
+          time, sensor_to_tracking->translation().cast<float>(),
+          carto::sensor::TransformPointCloud(
+              ranges, sensor_to_tracking->cast<float>())});
 }
 
 }  // namespace cartographer_ros
@@ -17,6 +17,8 @@
 #ifndef CARTOGRAPHER_ROS_SENSOR_BRIDGE_H_
 #define CARTOGRAPHER_ROS_SENSOR_BRIDGE_H_
 
+#include <memory>
+
 #include "cartographer/mapping/trajectory_builder.h"
 #include "cartographer/transform/rigid_transform.h"
 #include "cartographer/transform/transform.h"
@@ -47,6 +49,14 @@ class SensorBridge {
   SensorBridge(const SensorBridge&) = delete;
   SensorBridge& operator=(const SensorBridge&) = delete;
 
+  // Rangefinder data in the tracking frame, ready to be added to the
+  // trajectory builder.
+  struct TransformedRangefinderData {
+    ::cartographer::common::Time time;
+    Eigen::Vector3f origin;
+    ::cartographer::sensor::PointCloud ranges;
+  };
+
   void HandleOdometryMessage(const string& sensor_id,
                              const nav_msgs::Odometry::ConstPtr& msg);
   void HandleImuMessage(const string& sensor_id,
@@ -59,13 +69,25 @@ class SensorBridge {
   void HandlePointCloud2Message(const string& sensor_id,
                                 const sensor_msgs::PointCloud2::ConstPtr& msg);
 
+  // Convert rangefinder messages into the tracking frame. Return nullptr if
+  // the transform is not available. Unlike the Handle*Message() methods these
+  // are thread-safe, so conversions can run ahead of adding the data.
+  std::unique_ptr<TransformedRangefinderData> TransformLaserScanMessage(
+      const sensor_msgs::LaserScan::ConstPtr& msg) const;
+  std::unique_ptr<TransformedRangefinderData>
+  TransformMultiEchoLaserScanMessage(
+      const sensor_msgs::MultiEchoLaserScan::ConstPtr& msg) const;
+  std::unique_ptr<TransformedRangefinderData> TransformPointCloud2Message(
+      const sensor_msgs::PointCloud2::ConstPtr& msg) const;
+  void HandleTransformedRangefinderData(
+      const string& sensor_id, const TransformedRangefinderData& data);
+
   const TfBridge& tf_bridge() const;
 
  private:
-  void HandleRangefinder(const string& sensor_id,
-                         const ::cartographer::common::Time time,
-                         const string& frame_id,
-                         const ::cartographer::sensor::PointCloud& ranges);
+  std::unique_ptr<TransformedRangefinderData> TransformRangefinder(
+      const ::cartographer::common::Time time, const string& frame_id,
+      const ::cartographer::sensor::PointCloud& ranges) const;
 
   const TfBridge tf_bridge_;
   ::cartographer::mapping::TrajectoryBuilder* const trajectory_builder_;